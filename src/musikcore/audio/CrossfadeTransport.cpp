@@ -52,7 +52,7 @@ CrossfadeTransport::CrossfadeTransport()
 : volume(1.0)
 , playbackState(PlaybackState::Stopped)
 , muted(false)
-, crossfader(*this)
+, crossfader()
 , active(*this, crossfader)
 , next(*this, crossfader) {
     this->crossfader.Emptied.connect(
@@ -100,7 +100,7 @@ void CrossfadeTransport::Start(const std::string& uri, Gain gain, StartMode mode
             }
 
             if (immediate) {
-                this->active.Start(this->volume);
+                this->active.Start();
             }
         }
         else {
@@ -119,6 +119,31 @@ std::string CrossfadeTransport::Uri() {
 
 void CrossfadeTransport::ReloadOutput() {
     this->Stop();
+
+    /* anything that's still fading out keeps the old device alive until
+    it's done; the next track will open the newly selected one. */
+    Lock lock(this->stateMutex);
+    this->mixer.reset();
+}
+
+CrossfadeTransport::Channel CrossfadeTransport::CreateChannel() {
+    Lock lock(this->stateMutex);
+
+    /* every track plays through a channel of the same mixer, so there's only
+    ever one open output device, regardless of how many tracks are fading. */
+    if (!this->mixer) {
+        this->mixer = Mixer::Create(outputs::SelectedOutput());
+        this->UpdateDeviceVolume();
+    }
+
+    return this->mixer->CreateChannel();
+}
+
+void CrossfadeTransport::UpdateDeviceVolume() {
+    Lock lock(this->stateMutex);
+    if (this->mixer) {
+        this->mixer->Device()->SetVolume(this->muted ? 0.0 : this->volume);
+    }
 }
 
 void CrossfadeTransport::StopImmediately() {
@@ -161,7 +186,7 @@ bool CrossfadeTransport::Resume() {
     {
         Lock lock(this->stateMutex);
         this->crossfader.Resume();
-        this->active.Resume(this->volume);
+        this->active.Resume();
     }
 
     if (this->active.player) {
@@ -211,24 +236,7 @@ bool CrossfadeTransport::IsMuted() noexcept {
 void CrossfadeTransport::SetMuted(bool muted) {
     if (this->muted != muted) {
         this->muted = muted;
-
-        /* unconditionally set the volume to zero when we mute. */
-        if (muted) {
-            this->active.SetVolume(0.0f);
-            this->next.SetVolume(0.0f);
-        }
-        /* if we're no longer muted, and the streams aren't currently
-        in the crossfader, set their volume appropriately. */
-        else {
-            if (!crossfader.Contains(this->active.player)) {
-                this->active.SetVolume(this->volume);
-            }
-
-            if (!crossfader.Contains(this->next.player)) {
-                this->next.SetVolume(this->volume);
-            }
-        }
-
+        this->UpdateDeviceVolume();
         this->VolumeChanged();
     }
 }
@@ -244,8 +252,7 @@ void CrossfadeTransport::SetVolume(double volume) {
     {
         Lock lock(this->stateMutex);
         this->volume = volume;
-        active.SetVolume(volume);
-        next.SetVolume(volume);
+        this->UpdateDeviceVolume();
     }
 
     if (oldVolume != this->volume) {
@@ -282,7 +289,7 @@ void CrossfadeTransport::OnPlayerBuffered(Player* player) {
         if (player == active.player) {
             active.canFade = canFade;
             if (active.startImmediate) {
-                active.Start(this->volume);
+                active.Start();
             }
         }
         else if (player == next.player) {
@@ -317,7 +324,7 @@ void CrossfadeTransport::OnPlayerFinished(Player* player) {
 
     if (next.player && next.output) {
         next.TransferTo(active);
-        active.Start(this->volume);
+        active.Start();
     }
     else {
         this->Stop();
@@ -354,7 +361,7 @@ void CrossfadeTransport::OnPlayerMixPoint(Player* player, int id, double time) {
                 next.TransferTo(active);
 
                 if (!active.IsEmpty()) {
-                    active.Start(this->volume);
+                    active.Start();
                 }
                 else {
                     stopped = true;
@@ -466,7 +473,7 @@ void CrossfadeTransport::PlayerContext::Reset(
 
     this->startImmediate = startImmediate;
     this->canFade = this->started = false;
-    this->output = url.size() ? outputs::SelectedOutput() : nullptr;
+    this->output = url.size() ? transport.CreateChannel() : nullptr;
     this->player = url.size()
         ? Player::Create(
             url,
@@ -489,10 +496,10 @@ void CrossfadeTransport::PlayerContext::TransferTo(PlayerContext& to) noexcept {
     this->player = nullptr;
 }
 
-void CrossfadeTransport::PlayerContext::Start(double transportVolume) {
+void CrossfadeTransport::PlayerContext::Start() {
     if (this->output && this->player) {
         this->started = true;
-        this->output->SetVolume(0.0f);
+        this->output->Ramp(this->canFade ? 0.0 : 1.0, 0);
         this->output->Resume();
         this->player->Play();
 
@@ -503,9 +510,6 @@ void CrossfadeTransport::PlayerContext::Start(double transportVolume) {
                 Crossfader::FadeIn,
                 CROSSFADE_DURATION_MS);
         }
-        else {
-            this->output->SetVolume(transportVolume);
-        }
     }
 }
 
@@ -528,9 +532,9 @@ void CrossfadeTransport::PlayerContext::Pause() {
     }
 }
 
-void CrossfadeTransport::PlayerContext::Resume(double transportVolume) {
+void CrossfadeTransport::PlayerContext::Resume() {
     if (!this->started) {
-        this->Start(transportVolume);
+        this->Start();
     }
     else {
         if (this->output) {
@@ -543,12 +547,6 @@ void CrossfadeTransport::PlayerContext::Resume(double transportVolume) {
     }
 }
 
-void CrossfadeTransport::PlayerContext::SetVolume(double volume) {
-    if (this->output) {
-        this->output->SetVolume(volume);
-    }
-}
-
 bool CrossfadeTransport::PlayerContext::IsEmpty() noexcept {
     return !this->player && !this->output;
 }
@@ -38,8 +38,8 @@
 #include <musikcore/audio/ITransport.h>
 #include <musikcore/audio/Player.h>
 #include <musikcore/audio/Crossfader.h>
+#include <musikcore/audio/Mixer.h>
 #include <musikcore/runtime/MessageQueue.h>
-#include <musikcore/sdk/IOutput.h>
 #include <musikcore/sdk/constants.h>
 
 #include <thread>
@@ -87,7 +87,7 @@ namespace musik { namespace core { namespace audio {
 
         private:
             using Lock = std::unique_lock<std::recursive_mutex>;
-            using Output = std::shared_ptr<musik::core::sdk::IOutput>;
+            using Channel = Mixer::ChannelPtr;
             using Thread = std::shared_ptr<std::thread>;
             using IMessage = musik::core::runtime::IMessage;
             using IMessageTarget = musik::core::runtime::IMessageTarget;
@@ -108,23 +108,24 @@ namespace musik { namespace core { namespace audio {
 
                 void TransferTo(PlayerContext& context) noexcept;
 
-                void Start(double transportVolume);
+                void Start();
                 void Stop();
                 void StopIf(Player const* player);
                 void Pause();
-                void Resume(double transportVolume);
-                void SetVolume(double volume);
+                void Resume();
                 bool IsEmpty() noexcept;
 
                 bool startImmediate;
                 bool started;
                 bool canFade;
-                Output output;
+                Channel output;
                 Player *player;
                 CrossfadeTransport& transport;
                 Crossfader& crossfader;
             };
 
+            Channel CreateChannel();
+            void UpdateDeviceVolume();
             void RaiseStreamEvent(musik::core::sdk::StreamState type, Player const* player);
             void SetPlaybackState(musik::core::sdk::PlaybackState state);
 
@@ -140,6 +141,7 @@ namespace musik { namespace core { namespace audio {
             musik::core::sdk::PlaybackState playbackState;
             musik::core::sdk::StreamState activePlayerState;
             std::recursive_mutex stateMutex;
+            std::shared_ptr<Mixer> mixer;
             Crossfader crossfader;
             PlayerContext active;
             PlayerContext next;
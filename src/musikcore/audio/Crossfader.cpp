@@ -38,33 +38,27 @@
 #include <musikcore/runtime/Message.h>
 
 #include <algorithm>
-#include <chrono>
 
 using namespace musik::core::audio;
 using namespace musik::core::sdk;
 using namespace musik::core::runtime;
-using namespace std::chrono;
 
-#define TICKS_PER_SECOND 30
-#define TICK_TIME_MILLIS (1000 / TICKS_PER_SECOND)
+/* the gain ramps themselves are applied per-sample by the Mixer; we only
+need to check in every now and then to clean up fades that have finished. */
+#define TICK_TIME_MILLIS 50
 #define MAX_FADES 3
 
 #define ENQUEUE_TICK() \
     this->messageQueue.Post(Message::Create( \
         this, MESSAGE_TICK, 0, 0), TICK_TIME_MILLIS)
 
-#define ENQUEUE_ADJUSTED_TICK(delay) \
-    this->messageQueue.Post(Message::Create( \
-        this, MESSAGE_TICK, 0, 0), delay > 0 ? delay : 0)
-
 #define LOCK(x) \
     std::unique_lock<std::recursive_mutex> lock(x);
 
 #define MESSAGE_QUIT 0
 #define MESSAGE_TICK 1
 
-Crossfader::Crossfader(ITransport& transport)
-: transport(transport) {
+Crossfader::Crossfader() {
     this->messageQueue.Register(this);
     this->quit = false;
     this->paused = false;
@@ -81,32 +75,35 @@ Crossfader::~Crossfader() {
 
 void Crossfader::Fade(
     Player* player,
-    std::shared_ptr<IOutput> output,
+    Mixer::ChannelPtr channel,
     Direction direction,
     long durationMs)
 {
     LOCK(this->contextListLock);
 
     /* don't add the same player more than once! */
-    if (player && output && !this->Contains(player)) {
+    if (player && channel && !this->Contains(player)) {
         std::shared_ptr<FadeContext> context = std::make_shared<FadeContext>();
-        context->output = output;
+        context->channel = channel;
         context->player = player;
         context->direction = direction;
-        context->ticksCounted = 0;
-        context->ticksTotal = (durationMs / TICK_TIME_MILLIS);
+        context->durationMs = durationMs;
         contextList.push_back(context);
 
         player->Attach(this);
 
+        /* the ramp starts from the channel's current gain, so reversing a
+        fade that's in progress doesn't cause a jump. */
+        channel->Ramp(direction == FadeIn ? 1.0 : 0.0, durationMs);
+
         /* for performance reasons we don't allow more than a couple
-        simultaneous fades. mark extraneous ones as done so they are
+        simultaneous fades. finish extraneous ones immediately so they are
         cleaned up during the next tick */
         int toRemove = (int) this->contextList.size() - MAX_FADES;
         if (toRemove > 0) {
             auto it = contextList.begin();
             for (int i = 0; i < toRemove; i++, it++) {
-                (*it)->ticksCounted = (*it)->ticksTotal;
+                (*it)->channel->Ramp((*it)->direction == FadeIn ? 1.0 : 0.0, 0);
             }
         }
 
@@ -124,7 +121,7 @@ void Crossfader::Stop() {
             context->player->Detach(this);
             context->player->Destroy();
         }
-        context->output->Stop();
+        context->channel->Stop();
     }
 
     this->contextList.clear();
@@ -136,12 +133,18 @@ void Crossfader::Drain() {
     if (this->contextList.size()) {
         for (FadeContextPtr context : this->contextList) {
             context->direction = FadeOut;
+            context->channel->Ramp(0.0, context->durationMs);
+        }
+
+        /* ticks are suspended while paused, but something needs to notice
+        the fades finishing. */
+        if (this->paused) {
+            ENQUEUE_TICK();
         }
 
         this->drainCondition.wait(lock);
     }
 }
-
 void Crossfader::OnPlayerDestroying(Player* player) {
     if (player) {
         LOCK(this->contextListLock);
@@ -197,7 +200,7 @@ void Crossfader::Pause() {
     this->paused = true;
 
     for (FadeContextPtr context : this->contextList) {
-        context->output->Pause();
+        context->channel->Pause();
     }
 
     this->messageQueue.Remove(this, MESSAGE_TICK);
@@ -209,7 +212,7 @@ void Crossfader::Resume() {
     this->paused = false;
 
     for (FadeContextPtr context : this->contextList) {
-        context->output->Resume();
+        context->channel->Resume();
     }
 
     this->messageQueue.Post(
@@ -221,63 +224,32 @@ void Crossfader::ProcessMessage(IMessage &message) {
         case MESSAGE_TICK: {
             bool emptied = false;
 
-            auto start = system_clock::now().time_since_epoch();
-
             {
                 LOCK(this->contextListLock);
 
                 auto it = this->contextList.begin();
-                auto globalVolume = this->transport.Volume();
 
                 while (it != this->contextList.end()) {
                     auto fade = *it;
 
-                    if (fade->ticksCounted < fade->ticksTotal) {
-                        ++fade->ticksCounted;
-
-                        if (this->transport.IsMuted()) {
-                            fade->output->SetVolume(0.0);
-                        }
-                        else {
-                            double percent =
-                                (float)fade->ticksCounted /
-                                (float)fade->ticksTotal;
-
-                            if (fade->direction == FadeOut) {
-                                percent = (1.0f - percent);
-                            }
-
-                            double outputVolume = globalVolume * percent;
-                            fade->output->SetVolume(outputVolume);
-                        }
-                    }
-
                     /* if the fade has finished... */
-                    if (fade->ticksCounted >= fade->ticksTotal) {
-                        auto player = (*it)->player;
+                    if (!fade->channel->Ramping()) {
+                        auto player = fade->player;
 
                         /* we're done with this player now! detach ourself */
                         if (player) {
-                            (*it)->player->Detach(this);
+                            player->Detach(this);
                         }
 
                         if (fade->direction == FadeOut) {
                             /* if we're fading the player out, we get to destroy
-                            it. go ahead and do that now. awkward but efficient,
-                            and it works. */
+                            it. whatever it still has queued is inaudible now, so
+                            there's no need to wait for it to drain. */
                             if (player) {
-                                (*it)->player->Destroy();
+                                player->Destroy();
                             }
 
-                            /* wait for the output to finish playing what it has
-                            buffered -- but do it in the background because it's
-                            a blocking call. */
-                            auto output = (*it)->output;
-                            std::thread drainThread([output]() {
-                                output->Drain();
-                                output->Stop();
-                            });
-                            drainThread.detach();
+                            fade->channel->Stop();
                         }
 
                         it = this->contextList.erase(it);
@@ -296,9 +268,7 @@ void Crossfader::ProcessMessage(IMessage &message) {
                 this->drainCondition.notify_all();
             }
             else {
-                auto end = system_clock::now().time_since_epoch();
-                int64_t duration = duration_cast<milliseconds>(end - start).count();
-                ENQUEUE_ADJUSTED_TICK(TICK_TIME_MILLIS - duration);
+                ENQUEUE_TICK();
             }
         }
         break;
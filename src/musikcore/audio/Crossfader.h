@@ -35,10 +35,9 @@
 #pragma once
 
 #include <musikcore/config.h>
-#include <musikcore/audio/ITransport.h>
+#include <musikcore/audio/Mixer.h>
 #include <musikcore/audio/Player.h>
 #include <musikcore/runtime/MessageQueue.h>
-#include <musikcore/sdk/IOutput.h>
 #include <musikcore/sdk/constants.h>
 
 #include <thread>
@@ -58,12 +57,12 @@ namespace musik { namespace core { namespace audio {
 
             sigslot::signal0<> Emptied;
 
-            Crossfader(ITransport& transport);
+            Crossfader();
             virtual ~Crossfader();
 
             void Fade(
                 Player* player,
-                std::shared_ptr<musik::core::sdk::IOutput> output,
+                Mixer::ChannelPtr channel,
                 Direction direction,
                 long durationMs);
 
@@ -83,11 +82,10 @@ namespace musik { namespace core { namespace audio {
             virtual void OnPlayerDestroying(musik::core::audio::Player* player);
 
             struct FadeContext {
-                std::shared_ptr<musik::core::sdk::IOutput> output;
+                Mixer::ChannelPtr channel;
                 Player* player;
                 Direction direction;
-                long ticksCounted;
-                long ticksTotal;
+                long durationMs;
             };
 
             using FadeContextPtr = std::shared_ptr<FadeContext>;
@@ -98,7 +96,6 @@ namespace musik { namespace core { namespace audio {
             std::list<FadeContextPtr> contextList;
             std::atomic<bool> quit, paused;
             std::condition_variable_any drainCondition;
-            ITransport& transport;
     };
 
 } } }
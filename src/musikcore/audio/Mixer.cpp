@@ -0,0 +1,535 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2021 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "pch.hpp"
+
+#include <musikcore/audio/Mixer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+
+using namespace musik::core::audio;
+using namespace musik::core::sdk;
+
+/* number of frames summed per output buffer. small enough that fades and
+seeks respond quickly, large enough to keep per-buffer overhead low. */
+#define MIX_FRAMES 1024
+
+/* the maximum number of mixed buffers the output device may hold at once */
+#define MAX_BUFFERS_IN_FLIGHT 16
+
+/* how much audio each channel will queue before telling its Player to back off */
+#define MAX_QUEUED_MILLIS 250
+
+/* volume changes are applied over a short ramp to avoid zipper noise */
+#define VOLUME_RAMP_MILLIS 10
+
+static inline long millisToSamples(long ms, long sampleRate, int channels) {
+    return (long) (((int64_t) ms * sampleRate * channels) / 1000);
+}
+
+std::shared_ptr<Mixer> Mixer::Create(Output device) {
+    return std::make_shared<Mixer>(device);
+}
+
+Mixer::Mixer(Output device)
+: device(device) {
+    this->thread.reset(new std::thread(std::bind(&Mixer::ThreadLoop, this)));
+}
+
+Mixer::~Mixer() {
+    {
+        Lock lock(this->mutex);
+        this->quit = true;
+        this->condition.notify_all();
+    }
+
+    this->thread->join();
+
+    /* stopping the device returns any buffers it's still holding */
+    this->device->Stop();
+    this->device.reset();
+
+    for (Buffer* buffer : this->freeBuffers) {
+        delete buffer;
+    }
+}
+
+Mixer::ChannelPtr Mixer::CreateChannel() {
+    Lock lock(this->mutex);
+    auto channel = std::make_shared<Channel>(shared_from_this(), ++this->nextChannelId);
+    this->channels.push_back(channel.get());
+    return channel;
+}
+
+void Mixer::OnBufferProcessed(IBuffer* buffer) {
+    Lock lock(this->mutex);
+    this->freeBuffers.push_back(static_cast<Buffer*>(buffer));
+    --this->buffersInFlight;
+    this->condition.notify_all();
+}
+
+void Mixer::Release(EntryList& entries) {
+    /* must be called without holding our mutex: the provider is a Player, and
+    returning a buffer may raise mix point events that call back into us. */
+    for (auto& entry : entries) {
+        entry.provider->OnBufferProcessed(entry.buffer);
+    }
+    entries.clear();
+}
+
+void Mixer::UpdateDeviceState(bool flush) {
+    std::unique_lock<std::mutex> deviceLock(this->deviceMutex);
+
+    bool playing = false, changed = false;
+
+    {
+        Lock lock(this->mutex);
+
+        for (Channel* channel : this->channels) {
+            if (channel->state == Channel::State::Playing) {
+                playing = true;
+                break;
+            }
+        }
+
+        changed = (playing == this->devicePaused);
+        this->devicePaused = !playing;
+
+        /* only throw away what the device has buffered if nobody else is
+        still audible. */
+        flush = flush && !playing;
+        if (flush) {
+            ++this->flushCount;
+        }
+
+        this->condition.notify_all();
+    }
+
+    if (flush) {
+        this->device->Stop();
+    }
+    else if (changed) {
+        if (playing) {
+            this->device->Resume();
+        }
+        else {
+            this->device->Pause();
+        }
+    }
+}
+
+Buffer* Mixer::Mix(EntryList& finished) {
+    /* the most recently created channel that has something to play decides the
+    output format; it's the incoming track during a crossfade. */
+    Channel* primary = nullptr;
+    for (Channel* channel : this->channels) {
+        if (channel->state == Channel::State::Playing && channel->queuedSamples > 0) {
+            if (!primary || channel->id > primary->id) {
+                primary = channel;
+            }
+        }
+    }
+
+    if (!primary) {
+        return nullptr;
+    }
+
+    if (this->freeBuffers.empty() && this->buffersInFlight >= MAX_BUFFERS_IN_FLIGHT) {
+        return nullptr;
+    }
+
+    IBuffer* format = primary->queue.front().buffer;
+    const long sampleRate = format->SampleRate();
+    const int channelCount = format->Channels();
+
+    /* we can't sum streams with different formats, so a channel that doesn't
+    match the primary is cut rather than faded. the primary itself may have a
+    format change queued up; we stop short of it, and it becomes the output
+    format the next time around. */
+    long frames = std::min((long) MIX_FRAMES, primary->Frames(sampleRate, channelCount));
+    for (Channel* channel : this->channels) {
+        if (channel != primary &&
+            channel->state == Channel::State::Playing &&
+            channel->queuedSamples > 0)
+        {
+            const long available = channel->Frames(sampleRate, channelCount);
+            if (available > 0) {
+                frames = std::min(frames, available);
+            }
+            else {
+                channel->Discard(finished);
+            }
+        }
+    }
+
+    if (frames <= 0) {
+        return nullptr;
+    }
+
+    Buffer* buffer = nullptr;
+    if (this->freeBuffers.size()) {
+        buffer = this->freeBuffers.front();
+        this->freeBuffers.pop_front();
+    }
+    else {
+        buffer = new Buffer();
+    }
+
+    buffer->SetSampleRate(sampleRate);
+    buffer->SetChannels(channelCount);
+    buffer->SetSamples(frames * channelCount);
+    memset(buffer->BufferPointer(), 0, buffer->Bytes());
+
+    for (Channel* channel : this->channels) {
+        if (channel->state == Channel::State::Playing && channel->queuedSamples > 0) {
+            channel->Mix(buffer->BufferPointer(), frames, channelCount, sampleRate, finished);
+        }
+    }
+
+    ++this->buffersInFlight;
+
+    /* wake up anyone waiting for a channel to drain, or for queue space */
+    this->condition.notify_all();
+
+    return buffer;
+}
+
+void Mixer::ThreadLoop() {
+    EntryList finished;
+
+    while (!this->quit) {
+        Buffer* buffer = nullptr;
+        uint64_t flushCount = 0;
+
+        {
+            Lock lock(this->mutex);
+            while (!this->quit && !(buffer = this->Mix(finished)) && finished.empty()) {
+                this->condition.wait(lock);
+            }
+            flushCount = this->flushCount;
+        }
+
+        this->Release(finished);
+
+        while (buffer) {
+            OutputState result = OutputState::InvalidState;
+
+            {
+                Lock lock(this->mutex);
+
+                /* if the device was flushed after we mixed this buffer, what's
+                in it is stale -- e.g. the user seeked. drop it. */
+                if (this->quit || this->flushCount != flushCount) {
+                    this->freeBuffers.push_back(buffer);
+                    --this->buffersInFlight;
+                    buffer = nullptr;
+                    break;
+                }
+            }
+
+            result = this->device->Play(buffer, this);
+
+            if (result == OutputState::BufferWritten) {
+                buffer = nullptr;
+            }
+            else {
+                /* the device is full, or it's paused; try again after the
+                requested delay, or as soon as something changes. */
+                const int sleepMs = (int) result >= 0 ? std::max(1, (int) result) : 10;
+                Lock lock(this->mutex);
+                this->condition.wait_for(lock, std::chrono::milliseconds(sleepMs));
+            }
+        }
+    }
+}
+
+/* Channel */
+
+Mixer::Channel::Channel(std::shared_ptr<Mixer> mixer, uint64_t id)
+: mixer(mixer)
+, id(id) {
+}
+
+Mixer::Channel::~Channel() {
+    EntryList finished;
+
+    {
+        Lock lock(this->mixer->mutex);
+        this->Discard(finished);
+        this->mixer->channels.remove(this);
+    }
+
+    this->mixer->Release(finished);
+    this->mixer->UpdateDeviceState(false);
+}
+
+long Mixer::Channel::Frames(long sampleRate, int channels) {
+    /* frames queued at the head of the queue in the specified format, up to
+    the first buffer that has a different one. */
+    long samples = 0;
+    for (auto& entry : this->queue) {
+        if (entry.buffer->SampleRate() != sampleRate || entry.buffer->Channels() != channels) {
+            break;
+        }
+        samples += entry.buffer->Samples() - entry.offset;
+        if (samples >= MIX_FRAMES * channels) {
+            break;
+        }
+    }
+    return samples / channels;
+}
+
+void Mixer::Channel::Discard(EntryList& finished) {
+    for (auto& entry : this->queue) {
+        finished.push_back(entry);
+    }
+    this->queue.clear();
+    this->queuedSamples = 0;
+}
+
+void Mixer::Channel::Mix(
+    float* target,
+    long frames,
+    int channels,
+    long sampleRate,
+    EntryList& finished)
+{
+    if (this->pendingRampMs >= 0) {
+        this->rampFrames = std::max(1L, (long) (((int64_t) this->pendingRampMs * sampleRate) / 1000));
+        this->gainStep = (this->targetGain - this->gain) / (float) this->rampFrames;
+        this->pendingRampMs = -1;
+    }
+
+    while (frames > 0 && this->queue.size()) {
+        Entry& entry = this->queue.front();
+        const float* source = entry.buffer->BufferPointer() + entry.offset;
+        const long available = (entry.buffer->Samples() - entry.offset) / channels;
+        const long count = std::min(frames, available);
+
+        if (this->rampFrames == 0 && this->gain == 1.0f) {
+            for (long i = 0; i < count * channels; i++) {
+                target[i] += source[i];
+            }
+        }
+        else if (this->rampFrames == 0) {
+            const float gain = this->gain;
+            for (long i = 0; i < count * channels; i++) {
+                target[i] += source[i] * gain;
+            }
+        }
+        else {
+            long i = 0;
+            for (long frame = 0; frame < count; frame++) {
+                const float gain = this->gain;
+                for (int c = 0; c < channels; c++, i++) {
+                    target[i] += source[i] * gain;
+                }
+                if (this->rampFrames > 0) {
+                    this->gain += this->gainStep;
+                    if (--this->rampFrames == 0) {
+                        this->gain = this->targetGain;
+                    }
+                }
+            }
+        }
+
+        target += count * channels;
+        frames -= count;
+        entry.offset += count * channels;
+        this->queuedSamples -= count * channels;
+
+        if (entry.offset >= entry.buffer->Samples()) {
+            finished.push_back(entry);
+            this->queue.pop_front();
+        }
+    }
+}
+
+void Mixer::Channel::Ramp(double target, long durationMs) {
+    Lock lock(this->mixer->mutex);
+    this->targetGain = (float) std::max(0.0, std::min(1.0, target));
+    if (durationMs <= 0) {
+        this->gain = this->targetGain;
+        this->rampFrames = 0;
+        this->pendingRampMs = -1;
+    }
+    else {
+        /* the step size depends on the sample rate, which we may not know
+        yet; it's resolved the next time this channel is mixed. */
+        this->pendingRampMs = durationMs;
+    }
+}
+
+bool Mixer::Channel::Ramping() {
+    Lock lock(this->mixer->mutex);
+
+    /* ramps only advance as this channel is mixed, which doesn't happen if
+    it's not playing or has nothing queued. in that case it's silent, so a
+    ramp heading down can finish right away instead of never finishing. */
+    const bool idle = this->state != State::Playing || this->queuedSamples <= 0;
+    if (idle && this->targetGain <= this->gain) {
+        this->gain = this->targetGain;
+        this->rampFrames = 0;
+        this->pendingRampMs = -1;
+    }
+
+    return this->rampFrames > 0 || this->pendingRampMs >= 0;
+}
+
+void Mixer::Channel::Pause() {
+    {
+        Lock lock(this->mixer->mutex);
+        if (this->state == State::Playing) {
+            this->state = State::Paused;
+        }
+    }
+    this->mixer->UpdateDeviceState(false);
+}
+
+void Mixer::Channel::Resume() {
+    {
+        Lock lock(this->mixer->mutex);
+        this->state = State::Playing;
+    }
+    this->mixer->UpdateDeviceState(false);
+}
+
+void Mixer::Channel::SetVolume(double volume) {
+    this->Ramp(volume, VOLUME_RAMP_MILLIS);
+}
+
+double Mixer::Channel::GetVolume() {
+    Lock lock(this->mixer->mutex);
+    return this->targetGain;
+}
+
+void Mixer::Channel::Stop() {
+    EntryList finished;
+
+    {
+        Lock lock(this->mixer->mutex);
+        this->Discard(finished);
+        this->state = State::Stopped;
+    }
+
+    this->mixer->Release(finished);
+    this->mixer->UpdateDeviceState(true);
+}
+
+OutputState Mixer::Channel::Play(IBuffer *buffer, IBufferProvider *provider) {
+    Lock lock(this->mixer->mutex);
+
+    if (this->state != State::Playing) {
+        return OutputState::InvalidState;
+    }
+
+    const long maxQueued = millisToSamples(
+        MAX_QUEUED_MILLIS, buffer->SampleRate(), buffer->Channels());
+
+    if (this->queue.size() && this->queuedSamples + buffer->Samples() > maxQueued) {
+        /* come back once roughly one buffer's worth has been mixed */
+        const long samplesPerSecond = buffer->SampleRate() * buffer->Channels();
+        return (OutputState) std::max(1L, (long) (((int64_t) buffer->Samples() * 1000) / samplesPerSecond));
+    }
+
+    this->queue.push_back({ buffer, provider, 0 });
+    this->queuedSamples += buffer->Samples();
+    this->mixer->condition.notify_all();
+
+    return OutputState::BufferWritten;
+}
+
+void Mixer::Channel::Drain() {
+    {
+        Lock lock(this->mixer->mutex);
+        while (this->queuedSamples > 0 &&
+            this->state == State::Playing &&
+            !this->mixer->quit)
+        {
+            this->mixer->condition.wait(lock);
+        }
+    }
+
+    /* everything we had has been mixed; wait for the device to play it. we
+    can't Drain() the device itself because other channels may be feeding it. */
+    const double latency = this->mixer->device->Latency();
+    if (latency > 0.0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds((long) (latency * 1000.0)));
+    }
+}
+
+double Mixer::Channel::Latency() {
+    double queued = 0.0;
+
+    {
+        Lock lock(this->mixer->mutex);
+        if (this->queue.size()) {
+            IBuffer* format = this->queue.front().buffer;
+            queued = (double) this->queuedSamples /
+                (double) (format->SampleRate() * format->Channels());
+        }
+    }
+
+    return queued + this->mixer->device->Latency();
+}
+
+const char* Mixer::Channel::Name() {
+    return this->mixer->device->Name();
+}
+
+int Mixer::Channel::GetDefaultSampleRate() {
+    return this->mixer->device->GetDefaultSampleRate();
+}
+
+IDeviceList* Mixer::Channel::GetDeviceList() {
+    return this->mixer->device->GetDeviceList();
+}
+
+bool Mixer::Channel::SetDefaultDevice(const char* deviceId) {
+    return this->mixer->device->SetDefaultDevice(deviceId);
+}
+
+IDevice* Mixer::Channel::GetDefaultDevice() {
+    return this->mixer->device->GetDefaultDevice();
+}
+
+size_t Mixer::Channel::GetUnderrunCount() {
+    return this->mixer->device->GetUnderrunCount();
+}
+
+size_t Mixer::Channel::GetXrunCount() {
+    return this->mixer->device->GetXrunCount();
+}
@@ -0,0 +1,160 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2021 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <musikcore/config.h>
+#include <musikcore/audio/Buffer.h>
+#include <musikcore/sdk/IOutput.h>
+#include <musikcore/sdk/IBufferProvider.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace musik { namespace core { namespace audio {
+
+    /* sums any number of input streams into a single output device. each input
+    is a Mixer::Channel, which implements IOutput so it can be handed to a Player
+    like any other output. every channel has its own gain that can be ramped
+    with per-sample precision; the Crossfader uses this to fade between tracks
+    without opening a second device. */
+    class Mixer:
+        public musik::core::sdk::IBufferProvider,
+        public std::enable_shared_from_this<Mixer>
+    {
+        public:
+            class Channel;
+
+            using Output = std::shared_ptr<musik::core::sdk::IOutput>;
+            using ChannelPtr = std::shared_ptr<Channel>;
+
+            static std::shared_ptr<Mixer> Create(Output device);
+
+            Mixer(Output device);
+            virtual ~Mixer();
+
+            ChannelPtr CreateChannel();
+            Output Device() const noexcept { return this->device; }
+
+            /* IBufferProvider */
+            void OnBufferProcessed(musik::core::sdk::IBuffer* buffer) override;
+
+            class Channel : public musik::core::sdk::IOutput {
+                public:
+                    Channel(std::shared_ptr<Mixer> mixer, uint64_t id);
+                    virtual ~Channel();
+
+                    /* moves this channel's gain from wherever it currently is
+                    to `target` over `durationMs` milliseconds of audio. */
+                    void Ramp(double target, long durationMs);
+                    bool Ramping();
+
+                    /* IOutput */
+                    void Release() override { /* lifetime managed by the mixer's shared_ptr */ }
+                    void Pause() override;
+                    void Resume() override;
+                    void SetVolume(double volume) override;
+                    double GetVolume() override;
+                    void Stop() override;
+                    musik::core::sdk::OutputState Play(
+                        musik::core::sdk::IBuffer *buffer,
+                        musik::core::sdk::IBufferProvider *provider) override;
+                    void Drain() override;
+                    double Latency() override;
+                    const char* Name() override;
+                    int GetDefaultSampleRate() override;
+                    musik::core::sdk::IDeviceList* GetDeviceList() override;
+                    bool SetDefaultDevice(const char* deviceId) override;
+                    musik::core::sdk::IDevice* GetDefaultDevice() override;
+                    size_t GetUnderrunCount() override;
+                    size_t GetXrunCount() override;
+
+                private:
+                    friend class Mixer;
+
+                    enum class State { Stopped, Paused, Playing };
+
+                    struct Entry {
+                        musik::core::sdk::IBuffer* buffer;
+                        musik::core::sdk::IBufferProvider* provider;
+                        long offset;
+                    };
+
+                    using EntryList = std::vector<Entry>;
+
+                    long Frames(long sampleRate, int channels);
+                    void Mix(float* target, long frames, int channels, long sampleRate, EntryList& finished);
+                    void Discard(EntryList& finished);
+
+                    std::shared_ptr<Mixer> mixer;
+                    std::deque<Entry> queue;
+                    long queuedSamples{ 0 };
+                    State state{ State::Stopped };
+                    uint64_t id;
+                    float gain{ 1.0f };
+                    float targetGain{ 1.0f };
+                    float gainStep{ 0.0f };
+                    long rampFrames{ 0 };
+                    long pendingRampMs{ -1 };
+            };
+
+        private:
+            using Lock = std::unique_lock<std::mutex>;
+            using EntryList = Channel::EntryList;
+
+            void ThreadLoop();
+            Buffer* Mix(EntryList& finished);
+            void Release(EntryList& entries);
+            void UpdateDeviceState(bool flush);
+
+            Output device;
+            std::mutex mutex, deviceMutex;
+            std::condition_variable condition;
+            std::list<Channel*> channels;
+            std::list<Buffer*> freeBuffers;
+            size_t buffersInFlight{ 0 };
+            uint64_t nextChannelId{ 0 };
+            uint64_t flushCount{ 0 };
+            bool devicePaused{ true };
+            std::atomic<bool> quit{ false };
+            std::unique_ptr<std::thread> thread;
+    };
+
+} } }
@@ -77,6 +77,8 @@ class NoOutput: public IOutput {
         bool SetDefaultDevice(const char* deviceId) override { return false; }
         IDevice* GetDefaultDevice() override { return nullptr; }
         int GetDefaultSampleRate() override { return -1; }
+        size_t GetUnderrunCount() override { return 0; }
+        size_t GetXrunCount() override { return 0; }
     private:
         double volume{ 1.0f };
 };
@@ -34,7 +34,6 @@
 
 #include "pch.hpp"
 
-#include <kiss_fftr.h>
 #include <musikcore/debug.h>
 #include <musikcore/audio/Stream.h>
 #include <musikcore/audio/Player.h>
@@ -47,8 +46,6 @@
 #include <future>
 
 #define MAX_PREBUFFER_QUEUE_COUNT 8
-#define FFT_N 512
-#define PI 3.14159265358979323846
 
 using namespace musik::core::audio;
 using namespace musik::core::sdk;
@@ -57,7 +54,6 @@ using std::min;
 using std::max;
 
 static std::string TAG = "Player";
-static float* hammingWindow = nullptr;
 
 using Listener = Player::EventListener;
 using ListenerList = std::list<Listener*>;
@@ -66,43 +62,6 @@ namespace musik {
     namespace core {
         namespace audio {
             void playerThreadLoop(Player* player);
-
-            struct FftContext {
-                FftContext() {
-                    samples = 0;
-                    cfg = nullptr;
-                    deinterleaved = nullptr;
-                    scratch = nullptr;
-                }
-
-                ~FftContext() {
-                    Reset();
-                }
-
-                void Reset() {
-                    kiss_fftr_free(cfg);
-                    delete[] deinterleaved;
-                    delete[] scratch;
-                    cfg = nullptr;
-                    deinterleaved = nullptr;
-                    scratch = nullptr;
-                }
-
-                void Init(int samples) {
-                    if (!cfg || samples != this->samples) {
-                        Reset();
-                        cfg = kiss_fftr_alloc(FFT_N, false, 0, 0);
-                        deinterleaved = new float[samples];
-                        scratch = new kiss_fft_cpx[(FFT_N / 2) + 1];
-                        this->samples = samples;
-                    }
-                }
-
-                int samples;
-                kiss_fftr_cfg cfg;
-                float* deinterleaved;
-                kiss_fft_cpx* scratch;
-            };
         }
     }
 }
@@ -134,12 +93,9 @@ Player::Player(
 , nextMixPoint(-1.0)
 , pendingBufferCount(0)
 , destroyMode(destroyMode)
-, fftContext(nullptr)
 , gain(gain) {
     musik::debug::info(TAG, "new instance created");
 
-    this->spectrum = new float[FFT_N / 2];
-
     if (!this->output) {
         throw std::runtime_error("output cannot be null!");
     }
@@ -153,8 +109,6 @@ Player::Player(
 }
 
 Player::~Player() {
-    delete[] this->spectrum;
-    delete fftContext;
 }
 
 void Player::Play() {
@@ -480,77 +434,13 @@ bool Player::Exited() {
     return (this->internalState == Player::Quit);
 }
 
-static inline void initHammingWindow() {
-    delete hammingWindow;
-    hammingWindow = new float[FFT_N];
-
-    for (int i = 0; i < FFT_N; i++) {
-        hammingWindow[i] = 0.54f - 0.46f * (float) cos((2 * PI * i) / (FFT_N - 1));
-    }
-}
-
-static inline bool performFft(IBuffer* buffer, FftContext* fft, float* output, int outputSize) {
-    long samples = buffer->Samples();
-    int channels = buffer->Channels();
-    long samplesPerChannel = samples / channels;
-
-    if (samplesPerChannel < FFT_N || outputSize != FFT_N / 2) {
-        return false;
-    }
-
-    if (!hammingWindow) {
-        initHammingWindow();
-    }
-
-    memset(output, 0, outputSize * sizeof(float));
-
-    float* input = buffer->BufferPointer();
-
-    fft->Init(samples);
-
-    for (int i = 0; i < samples; i++) {
-        const int to = ((i % channels) * samplesPerChannel) + (i / channels);
-        fft->deinterleaved[to] = input[i] * hammingWindow[to % FFT_N];
-    }
-
-    int offset = 0;
-    int iterations = samples / FFT_N;
-    for (int i = 0; i < iterations; i++) {
-        kiss_fftr(fft->cfg, fft->deinterleaved + offset, fft->scratch);
-
-        for (int z = 0; z < outputSize; z++) {
-            /* convert to decibels */
-            double db = (fft->scratch[z].r * fft->scratch[z].r + fft->scratch[z].i + fft->scratch[z].i);
-            output[z] += (db < 1 ? 0 : 20 * (float) log10(db)) / iterations; /* frequencies over all channels */
-        }
-
-        offset += FFT_N;
-    }
-
-    return true;
-}
-
 void Player::OnBufferProcessed(IBuffer *buffer) {
     bool started = false;
     bool found = false;
 
-    /* process visualizer data, and write to the selected plugin, if applicable */
-
-    ISpectrumVisualizer* specVis = vis::SpectrumVisualizer();
-    IPcmVisualizer* pcmVis = vis::PcmVisualizer();
-
-    if (specVis && specVis->Visible()) {
-        if (!fftContext) {
-            fftContext = new FftContext();
-        }
-
-        if (performFft(buffer, fftContext, spectrum, FFT_N / 2)) {
-            vis::SpectrumVisualizer()->Write(spectrum, FFT_N / 2);
-        }
-    }
-    else if (pcmVis && pcmVis->Visible()) {
-        vis::PcmVisualizer()->Write(buffer);
-    }
+    /* hand a copy of the samples to the visualization tap. this never blocks;
+    analysis happens on a separate, low priority thread. */
+    vis::Tap(buffer);
 
     /* release the buffer back to the stream, find mixpoints */
 
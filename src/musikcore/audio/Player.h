@@ -49,8 +49,6 @@
 
 namespace musik { namespace core { namespace audio {
 
-    struct FftContext;
-
     class Player : public musik::core::sdk::IBufferProvider {
         public:
             enum class DestroyMode: int { Drain = 0, NoDrain = 1 };
@@ -168,13 +166,10 @@ namespace musik { namespace core { namespace audio {
             std::atomic<musik::core::sdk::StreamState> streamState;
             std::atomic<int> internalState;
             bool notifiedStarted;
-            float* spectrum;
             DestroyMode destroyMode;
             Gain gain;
             int pendingBufferCount;
             bool threadFinished;
-
-            FftContext* fftContext;
     };
 
 } } }
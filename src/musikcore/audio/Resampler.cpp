@@ -0,0 +1,265 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2021 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "pch.hpp"
+
+#include <musikcore/audio/Resampler.h>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <numeric>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define RESAMPLER_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define RESAMPLER_NEON
+#endif
+
+using namespace musik::core::audio;
+
+#define PI 3.14159265358979323846
+
+/* coefficient tables are exact for ratios with a small denominator (44.1k to
+48k needs 160 phases). finer ratios use the nearest of this many phases. */
+static const long MAX_PHASES = 512;
+
+struct Preset {
+    int taps; /* must be a multiple of 4 */
+    double cutoff; /* fraction of the lower nyquist frequency */
+    double beta; /* kaiser window shape; higher means more stopband attenuation */
+};
+
+/* indexed by Resampler::Quality */
+static const Preset PRESETS[] = {
+    { 16, 0.80, 6.0 },
+    { 64, 0.91, 8.0 },
+    { 128, 0.95, 10.0 }
+};
+
+static double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    const double half = x / 2.0;
+    for (int k = 1; k < 64; k++) {
+        term *= (half / k) * (half / k);
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+/* `count` must be a multiple of 4. */
+static inline float dot(const float* x, const float* h, int count) {
+#if defined(RESAMPLER_SSE)
+    __m128 sum = _mm_setzero_ps();
+    for (int i = 0; i < count; i += 4) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(h + i)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(RESAMPLER_NEON)
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    for (int i = 0; i < count; i += 4) {
+        sum = vmlaq_f32(sum, vld1q_f32(x + i), vld1q_f32(h + i));
+    }
+    float lanes[4];
+    vst1q_f32(lanes, sum);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+    float sum = 0.0f;
+    for (int i = 0; i < count; i++) {
+        sum += x[i] * h[i];
+    }
+    return sum;
+#endif
+}
+
+Resampler::Resampler(long inputRate, long outputRate, int channels, Quality quality)
+: inputRate(inputRate)
+, outputRate(outputRate)
+, channels(channels) {
+    const long divisor = std::gcd(inputRate, outputRate);
+    this->step = inputRate / divisor;
+    this->interpolation = outputRate / divisor;
+    this->history.resize(channels);
+    this->BuildFilter(quality);
+    this->Reset();
+}
+
+void Resampler::BuildFilter(Quality quality) {
+    const int index = std::clamp((int) quality, (int) Quality::Fast, (int) Quality::High);
+    const Preset& preset = PRESETS[index];
+
+    this->taps = preset.taps;
+    this->phases = (int) std::min(this->interpolation, MAX_PHASES);
+
+    /* relative to the input rate. when downsampling the cutoff needs to be
+    below the output's nyquist frequency, not the input's. */
+    const double ratio = std::min(1.0, (double) this->outputRate / (double) this->inputRate);
+    const double cutoff = 0.5 * ratio * preset.cutoff;
+    const double half = this->taps / 2.0;
+    const double norm = besselI0(preset.beta);
+
+    this->filter.resize((size_t) this->phases * this->taps);
+
+    for (int p = 0; p < this->phases; p++) {
+        const double fraction = (double) p / (double) this->phases;
+        float* coefficients = &this->filter[(size_t) p * this->taps];
+        double sum = 0.0;
+
+        for (int k = 0; k < this->taps; k++) {
+            /* distance between this tap and the output sample, in input frames */
+            const double x = (double) k - (half - 1.0) - fraction;
+            const double arg = 2.0 * PI * cutoff * x;
+            const double sinc = (x == 0.0) ? 1.0 : sin(arg) / arg;
+            const double w = x / half;
+            const double window = (std::abs(w) >= 1.0)
+                ? 0.0 : besselI0(preset.beta * sqrt(1.0 - w * w)) / norm;
+            const double value = 2.0 * cutoff * sinc * window;
+            coefficients[k] = (float) value;
+            sum += value;
+        }
+
+        /* unity gain at dc for every phase */
+        if (sum != 0.0) {
+            for (int k = 0; k < this->taps; k++) {
+                coefficients[k] = (float) (coefficients[k] / sum);
+            }
+        }
+    }
+}
+
+void Resampler::Reset() {
+    const long lead = this->taps / 2 - 1;
+    for (auto& channel : this->history) {
+        channel.assign(lead, 0.0f);
+    }
+    this->historyFrames = lead;
+    this->position = 0;
+    this->phase = 0;
+    this->totalInputFrames = 0;
+    this->totalOutputFrames = 0;
+}
+
+void Resampler::Append(const float* input, long frames) {
+    for (int c = 0; c < this->channels; c++) {
+        auto& channel = this->history[c];
+        const size_t offset = channel.size();
+        channel.resize(offset + frames);
+        const float* src = input + c;
+        float* dst = channel.data() + offset;
+        for (long i = 0; i < frames; i++) {
+            dst[i] = *src;
+            src += this->channels;
+        }
+    }
+    this->historyFrames += frames;
+}
+
+void Resampler::Run(Buffer* output, long maxFrames) {
+    /* upper bound on the number of frames we can produce with the input
+    we have; see the loop condition below. */
+    long capacity = 0;
+    const long remain = this->historyFrames - this->taps - this->position;
+    if (remain >= 0) {
+        const int64_t numerator = (int64_t) (remain + 1) * this->interpolation;
+        capacity = (long) ((numerator + this->step - 1) / this->step);
+    }
+    capacity = std::min(capacity, maxFrames);
+
+    output->SetSamples(capacity * this->channels);
+
+    float* out = output->BufferPointer();
+    const bool exact = (this->phases == this->interpolation);
+    long produced = 0;
+
+    while (produced < capacity && this->position + this->taps <= this->historyFrames) {
+        const long index = exact
+            ? this->phase
+            : (long) (((int64_t) this->phase * this->phases) / this->interpolation);
+
+        const float* coefficients = &this->filter[(size_t) index * this->taps];
+
+        for (int c = 0; c < this->channels; c++) {
+            *out++ = dot(this->history[c].data() + this->position, coefficients, this->taps);
+        }
+
+        ++produced;
+        this->phase += this->step;
+        this->position += this->phase / this->interpolation;
+        this->phase %= this->interpolation;
+    }
+
+    output->SetSamples(produced * this->channels);
+    this->totalOutputFrames += produced;
+
+    /* drop input we'll never look at again. what's left is roughly one
+    filter's worth of frames, so this is cheap. */
+    if (this->position > 0) {
+        const long consumed = std::min(this->position, this->historyFrames);
+        for (auto& channel : this->history) {
+            channel.erase(channel.begin(), channel.begin() + consumed);
+        }
+        this->historyFrames -= consumed;
+        this->position -= consumed;
+    }
+}
+
+void Resampler::Process(const float* input, long samples, Buffer* output) {
+    const long frames = samples / this->channels;
+    this->Append(input, frames);
+    this->totalInputFrames += frames;
+    this->Run(output, LONG_MAX);
+}
+
+void Resampler::Drain(Buffer* output) {
+    /* pad with enough silence for the last input frame to reach the center
+    of the filter, then stop at the exact length the input implies, so
+    gapless transitions don't pick up extra samples. */
+    const long padding = this->taps / 2 + 1;
+    std::vector<float> silence((size_t) padding * this->channels, 0.0f);
+    this->Append(silence.data(), padding);
+
+    const uint64_t expected =
+        (this->totalInputFrames * this->interpolation + this->step - 1) / this->step;
+
+    const long remaining = (expected > this->totalOutputFrames)
+        ? (long) (expected - this->totalOutputFrames) : 0;
+
+    this->Run(output, remaining);
+}
@@ -0,0 +1,99 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2021 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <musikcore/config.h>
+#include <musikcore/audio/Buffer.h>
+#include <vector>
+
+namespace musik { namespace core { namespace audio {
+
+    /* polyphase windowed-sinc sample rate converter used by Stream to bring
+    every track to the same output rate. input and output are interleaved
+    float samples. */
+    class Resampler {
+        public:
+            enum class Quality: int {
+                Fast = 0,
+                Balanced = 1,
+                High = 2
+            };
+
+            Resampler(long inputRate, long outputRate, int channels, Quality quality);
+
+            Resampler(const Resampler&) = delete;
+            Resampler& operator=(const Resampler&) = delete;
+
+            /* converts `samples` interleaved input samples; the result replaces
+            the contents of `output`. the filter needs a few frames of look-ahead,
+            so output lags input slightly until Drain() is called. */
+            void Process(const float* input, long samples, Buffer* output);
+
+            /* flushes the remaining look-ahead at the end of a stream. */
+            void Drain(Buffer* output);
+
+            /* discards all history, e.g. after a seek. */
+            void Reset();
+
+            long InputRate() const noexcept { return this->inputRate; }
+            long OutputRate() const noexcept { return this->outputRate; }
+
+        private:
+            void BuildFilter(Quality quality);
+            void Append(const float* input, long frames);
+            void Run(Buffer* output, long maxFrames);
+
+            long inputRate, outputRate;
+            int channels;
+
+            /* output frame n is taken at input time n * step / interpolation,
+            tracked exactly as an integer index plus phase. */
+            long step, interpolation;
+            long phase{ 0 };
+            long position{ 0 };
+
+            int taps;
+            int phases;
+            std::vector<float> filter; /* phases * taps coefficients */
+
+            /* per-channel input, prefixed with taps / 2 - 1 frames of silence */
+            std::vector<std::vector<float>> history;
+            long historyFrames{ 0 };
+
+            uint64_t totalInputFrames{ 0 };
+            uint64_t totalOutputFrames{ 0 };
+    };
+
+} } }
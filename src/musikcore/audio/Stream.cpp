@@ -37,10 +37,13 @@
 #include "Stream.h"
 #include "Streams.h"
 #include <musikcore/debug.h>
+#include <musikcore/support/Preferences.h>
+#include <musikcore/support/PreferenceKeys.h>
 
 using namespace musik::core::audio;
 using namespace musik::core::sdk;
 using namespace musik::core::io;
+using namespace musik::core::prefs;
 
 static std::string TAG = "Stream";
 
@@ -56,7 +59,13 @@ Stream::Stream(int samplesPerChannel, double bufferLengthSeconds, StreamFlags op
 , decoderPosition(0)
 , decoderSampleOffset(0)
 , decoderSamplesRemain(0)
+, resamplerBuffer(nullptr)
+, resamplerRate(0)
+, resamplerQuality(Resampler::Quality::Balanced)
+, resamplerDrained(false)
+, outputSampleRate(0)
 , done(false)
+, decodeInto(true)
 , capabilities(0)
 , rawBuffer(nullptr) {
     if (((int) this->options & (int) StreamFlags::NoDSP) == 0) {
@@ -70,6 +79,7 @@ Stream::Stream(int samplesPerChannel, double bufferLengthSeconds, StreamFlags op
 Stream::~Stream() {
     delete[] rawBuffer;
     delete this->decoderBuffer;
+    delete this->resamplerBuffer;
 
     for (Buffer* buffer : this->recycledBuffers) {
         delete buffer;
@@ -92,7 +102,12 @@ double Stream::SetPosition(double requestedSeconds) {
     double actualSeconds = this->decoder->SetPosition(requestedSeconds);
 
     if (actualSeconds != -1) {
-        double rate = (double) this->decoderSampleRate;
+        double rate = (double) this->outputSampleRate;
+
+        if (this->resampler) {
+            this->resampler->Reset();
+            this->resamplerDrained = false;
+        }
 
         this->decoderPosition =
             (uint64_t)(actualSeconds * rate) * this->decoderChannels;
@@ -133,13 +148,23 @@ bool Stream::OpenStream(std::string uri, IOutput* output) {
     this->decoder = streams::GetDecoderForDataStream(this->dataStream);
 
     if (this->decoder) {
-        /* if the output has a default/preferred sample rate, let the decoder know
-        before sending samples. this way the decoder can resample the audio itself
-        if it likes. */
+        /* if the output has a default/preferred sample rate (or the user has
+        asked for a fixed one), let the decoder know before sending samples. this
+        way the decoder can resample the audio itself if it likes. decoders that
+        don't are handled by our own resampler, see GetNextBufferFromDecoder(). */
         if (output) {
+            auto playbackPrefs = Preferences::ForComponent(components::Playback);
+
+            this->resamplerQuality = (Resampler::Quality) playbackPrefs->GetInt(
+                keys::ResamplerQuality, (int) Resampler::Quality::Balanced);
+
             int defaultOutputSampleRate = output->GetDefaultSampleRate();
-            if (defaultOutputSampleRate > 0) {
-                this->decoder->SetPreferredSampleRate(defaultOutputSampleRate);
+            this->resamplerRate = (defaultOutputSampleRate > 0)
+                ? defaultOutputSampleRate
+                : playbackPrefs->GetInt(keys::ResamplerSampleRate, 0);
+
+            if (this->resamplerRate > 0) {
+                this->decoder->SetPreferredSampleRate(this->resamplerRate);
             }
         }
         if (this->dataStream->CanPrefetch()) {
@@ -173,15 +198,30 @@ bool Stream::GetNextBufferFromDecoder() {
         this->decoderSampleRate = this->decoderBuffer->SampleRate();
         this->decoderChannels = this->decoderBuffer->Channels();
         this->samplesPerBuffer = samplesPerChannel * decoderChannels;
+        this->outputSampleRate = this->decoderSampleRate;
+
+        /* the decoder didn't honor the preferred rate; do it ourselves, before
+        the dsps see the audio. */
+        if (this->resamplerRate > 0 && this->resamplerRate != this->decoderSampleRate) {
+            this->resampler = std::make_unique<Resampler>(
+                this->decoderSampleRate,
+                this->resamplerRate,
+                (int) this->decoderChannels,
+                this->resamplerQuality);
+
+            this->resamplerBuffer = new Buffer();
+            this->outputSampleRate = this->resamplerRate;
+            this->decodeInto = false;
+        }
 
         this->bufferCount = std::max(MIN_BUFFER_COUNT, (int)(this->bufferLengthSeconds *
-            (double)(this->decoderSampleRate / this->samplesPerBuffer)));
+            (double)(this->outputSampleRate / this->samplesPerBuffer)));
 
         this->rawBuffer = new float[bufferCount * this->samplesPerBuffer];
         int offset = 0;
         for (int i = 0; i < bufferCount; i++) {
             auto buffer = new Buffer(this->rawBuffer + offset, this->samplesPerBuffer);
-            buffer->SetSampleRate(this->decoderSampleRate);
+            buffer->SetSampleRate(this->outputSampleRate);
             buffer->SetChannels(this->decoderChannels);
             this->recycledBuffers.push_back(buffer);
             offset += this->samplesPerBuffer;
@@ -237,9 +277,74 @@ void Stream::RefillInternalBuffers() {
     long targetSamplesRemain = 0;
 
     while (!this->done && (count > 0 || count == -1)) {
+        /* once our buffers have been allocated, decoders that support it
+        write directly into the target buffer, instead of into decoderBuffer
+        followed by a copy. the first buffer always comes through GetBuffer(),
+        because that's how we learn the format. */
+        if (this->decodeInto && this->rawBuffer && this->decoderSamplesRemain <= 0) {
+            if (count < 0) {
+                count = bufferCount / 4;
+            }
+
+            if (!target) {
+                target = this->GetEmptyBuffer();
+
+                if (!target) {
+                    break; /* no available buffers. break out. */
+                }
+
+                target->SetSamples(0);
+
+                target->SetPosition(
+                    ((double) this->decoderPosition) /
+                    ((double) this->decoderChannels) /
+                    ((double) this->outputSampleRate));
+
+                filledBuffers.push_back(target);
+            }
+
+            targetSamplesRemain = this->samplesPerBuffer - targetSampleOffset;
+
+            long written = this->decoder->DecodeInto(
+                target->BufferPointer() + targetSampleOffset, targetSamplesRemain);
+
+            if (written < 0) { /* not supported; use the copy path from now on */
+                this->decodeInto = false;
+                continue;
+            }
+
+            if (written == 0) { /* very last buffer for this stream. */
+                target->SetSamples(targetSampleOffset);
+                this->done = true;
+                break;
+            }
+
+            this->decoderPosition += written;
+            targetSampleOffset += written;
+            target->SetSamples(targetSampleOffset);
+
+            if (targetSampleOffset == this->samplesPerBuffer) {
+                targetSampleOffset = 0;
+                target = nullptr;
+                --count; /* target buffer has been filled. */
+            }
+
+            continue;
+        }
+
         /* get the next buffer, if the last one has been consumed... */
         if (this->decoderSamplesRemain <= 0) {
             if (!GetNextBufferFromDecoder()) {
+                /* the resampler holds on to a few frames of look-ahead; give
+                them back before finishing up. */
+                if (this->resampler && !this->resamplerDrained) {
+                    this->resamplerDrained = true;
+                    this->resampler->Drain(this->resamplerBuffer);
+                    this->decoderSamplesRemain = this->resamplerBuffer->Samples();
+                    this->decoderSampleOffset = 0;
+                    continue;
+                }
+
                 if (target) { /* very last buffer for this stream. */
                     target->SetSamples(targetSampleOffset);
                 }
@@ -247,11 +352,20 @@ void Stream::RefillInternalBuffers() {
                 break;
             }
 
-            if (this->decoderBuffer->Samples() == 0) {
+            if (this->resampler) {
+                this->resampler->Process(
+                    this->decoderBuffer->BufferPointer(),
+                    this->decoderBuffer->Samples(),
+                    this->resamplerBuffer);
+            }
+
+            Buffer* source = this->resampler ? this->resamplerBuffer : this->decoderBuffer;
+
+            if (source->Samples() == 0) {
                 continue;
             }
 
-            this->decoderSamplesRemain = this->decoderBuffer->Samples();
+            this->decoderSamplesRemain = source->Samples();
             this->decoderSampleOffset = 0;
         }
 
@@ -274,7 +388,7 @@ void Stream::RefillInternalBuffers() {
             target->SetPosition(
                 ((double) this->decoderPosition) /
                 ((double) this->decoderChannels) /
-                ((double) this->decoderSampleRate));
+                ((double) this->outputSampleRate));
 
             filledBuffers.push_back(target);
         }
@@ -286,7 +400,8 @@ void Stream::RefillInternalBuffers() {
         if (targetSamplesRemain > 0) {
             long samplesToCopy = std::min(this->decoderSamplesRemain, targetSamplesRemain);
             if (samplesToCopy > 0) {
-                float* src = this->decoderBuffer->BufferPointer() + this->decoderSampleOffset;
+                Buffer* source = this->resampler ? this->resamplerBuffer : this->decoderBuffer;
+                float* src = source->BufferPointer() + this->decoderSampleOffset;
                 target->Copy(src, samplesToCopy, targetSampleOffset);
 
                 this->decoderPosition += samplesToCopy;
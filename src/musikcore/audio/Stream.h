@@ -38,6 +38,7 @@
 #include <musikcore/io/DataStreamFactory.h>
 #include <musikcore/audio/Buffer.h>
 #include <musikcore/audio/IStream.h>
+#include <musikcore/audio/Resampler.h>
 #include <musikcore/sdk/IDecoder.h>
 #include <musikcore/sdk/IOutput.h>
 
@@ -46,6 +47,7 @@
 
 #include <deque>
 #include <list>
+#include <memory>
 
 namespace musik { namespace core { namespace audio {
 
@@ -108,11 +110,21 @@ namespace musik { namespace core { namespace audio {
             long decoderSamplesRemain;
             uint64_t decoderPosition;
 
+            /* converts decoder output to `resamplerRate` when the two differ;
+            `outputSampleRate` is the rate of the buffers we hand out. */
+            std::unique_ptr<Resampler> resampler;
+            Buffer* resamplerBuffer;
+            long resamplerRate;
+            Resampler::Quality resamplerQuality;
+            bool resamplerDrained;
+            long outputSampleRate;
+
             musik::core::sdk::StreamFlags options;
             int samplesPerChannel;
             long samplesPerBuffer;
             int bufferCount;
             bool done;
+            bool decodeInto;
             double bufferLengthSeconds;
             int capabilities;
 
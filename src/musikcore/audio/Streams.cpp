@@ -40,9 +40,15 @@
 #include <musikcore/sdk/IEncoderFactory.h>
 #include <musikcore/plugin/PluginFactory.h>
 #include <mutex>
+#include <unordered_map>
 
 #define TAG "Streams"
 
+/* upper bound on idle instances we'll hold per dsp plugin. a stream owns
+one of each; gapless and crossfade playback keep at most three alive. */
+#define MAX_IDLE_DSPS_PER_PLUGIN 4
+#define MAX_CACHED_DECODER_TYPES 256
+
 using namespace musik::core::audio;
 using namespace musik::core::sdk;
 using musik::core::PluginFactory;
@@ -54,10 +60,61 @@ using DspList = std::vector<std::shared_ptr<IDSP>>;
 using Deleter = PluginFactory::ReleaseDeleter<IDecoder>;
 using DecoderPtr = std::shared_ptr<IDecoder>;
 
+typedef IDSP* STDCALL(GetDspCall);
+using DecoderFactoryPtr = std::shared_ptr<IDecoderFactory>;
+
 static std::mutex initLock;
 static DecoderFactoryList decoders;
 static EncoderFactoryList encoders;
 
+/* type (e.g. file extension or mime type) -> the first factory that claimed
+it. null values are cached too, so unsupported types don't re-probe. */
+static std::mutex decoderCacheLock;
+static std::unordered_map<std::string, DecoderFactoryPtr> decoderCache;
+
+/* dsp instances are expensive to create (some spin up worker threads, all
+are allocated inside the plugin), so instead of releasing them when a
+stream goes away we park them here, per plugin, and hand them out again. */
+static struct DspPool {
+    std::mutex mutex;
+    std::unordered_map<IPlugin*, std::vector<IDSP*>> idle;
+
+    ~DspPool() {
+        for (auto& it : this->idle) {
+            for (IDSP* dsp : it.second) {
+                dsp->Release();
+            }
+        }
+    }
+
+    IDSP* Acquire(IPlugin* plugin, GetDspCall create) {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            auto& instances = this->idle[plugin];
+            if (instances.size()) {
+                IDSP* dsp = instances.back();
+                instances.pop_back();
+                lock.unlock();
+                dsp->Reset();
+                return dsp;
+            }
+        }
+        return create();
+    }
+
+    void Recycle(IPlugin* plugin, IDSP* dsp) {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            auto& instances = this->idle[plugin];
+            if (instances.size() < MAX_IDLE_DSPS_PER_PLUGIN) {
+                instances.push_back(dsp);
+                return;
+            }
+        }
+        dsp->Release();
+    }
+} dspPool;
+
 static void init() {
     std::unique_lock<std::mutex> lock(initLock);
 
@@ -76,6 +133,32 @@ static void init() {
     }
 }
 
+static DecoderFactoryPtr findDecoderFactory(const char* type) {
+    const std::string key(type ? type : "");
+
+    std::unique_lock<std::mutex> lock(decoderCacheLock);
+
+    auto it = decoderCache.find(key);
+    if (it != decoderCache.end()) {
+        return it->second;
+    }
+
+    DecoderFactoryPtr result;
+    for (auto factory : decoders) {
+        if (factory->CanHandle(key.c_str())) {
+            result = factory;
+            break;
+        }
+    }
+
+    if (decoderCache.size() >= MAX_CACHED_DECODER_TYPES) {
+        decoderCache.clear(); /* not expected in practice; just stay bounded */
+    }
+
+    decoderCache[key] = result;
+    return result;
+}
+
 namespace musik { namespace core { namespace audio {
 
     namespace streams {
@@ -85,16 +168,7 @@ namespace musik { namespace core { namespace audio {
             IDecoder* decoder = nullptr;
 
             /* find a DecoderFactory we can use for this type of data*/
-            DecoderFactoryList::iterator factories = decoders.begin();
-            DecoderFactoryList::iterator end = decoders.end();
-            std::shared_ptr<IDecoderFactory> factory;
-
-            for (; factories != end && !factory; ++factories) {
-                if ((*factories)->CanHandle(dataStream->Type())) {
-                    factory = (*factories);
-                    break;
-                }
-            }
+            std::shared_ptr<IDecoderFactory> factory = findDecoderFactory(dataStream->Type());
 
             const std::string uri = dataStream->Uri();
 
@@ -142,8 +216,22 @@ namespace musik { namespace core { namespace audio {
         }
 
         DspList GetDspPlugins() {
-            typedef PluginFactory::ReleaseDeleter<IDSP> Deleter;
-            return PluginFactory::Instance().QueryInterface<IDSP, Deleter>("GetDSP");
+            DspList result;
+
+            /* the returned pointers hand their instances back to the pool
+            instead of releasing them. */
+            PluginFactory::Instance().QueryFunction<GetDspCall>(
+                "GetDSP",
+                [&result](IPlugin* plugin, GetDspCall create) {
+                    IDSP* dsp = dspPool.Acquire(plugin, create);
+                    if (dsp) {
+                        result.push_back(std::shared_ptr<IDSP>(dsp, [plugin](IDSP* instance) {
+                            dspPool.Recycle(plugin, instance);
+                        }));
+                    }
+                });
+
+            return result;
         }
     };
 
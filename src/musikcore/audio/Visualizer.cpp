@@ -35,10 +35,22 @@
 #include "pch.hpp"
 #include "Visualizer.h"
 #include <musikcore/plugin/PluginFactory.h>
+#include <musikcore/audio/Buffer.h>
+#include <musikcore/sdk/RingBuffer.h>
+#include <musikcore/support/Preferences.h>
+#include <musikcore/support/PreferenceKeys.h>
+
+#include <kiss_fftr.h>
 
 #include <atomic>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <math.h>
 
+using namespace musik::core;
 using namespace musik::core::audio;
 using namespace musik::core::sdk;
 
@@ -46,11 +58,328 @@ static std::vector<std::shared_ptr<IVisualizer > > visualizers;
 static std::atomic<bool> initialized;
 
 static std::shared_ptr<IVisualizer> selectedVisualizer;
-static ISpectrumVisualizer* spectrumVisualizer = nullptr;
-static IPcmVisualizer* pcmVisualizer = nullptr;
+static std::atomic<ISpectrumVisualizer*> spectrumVisualizer{ nullptr };
+static std::atomic<IPcmVisualizer*> pcmVisualizer{ nullptr };
 
 #define LOWER(x) std::transform(x.begin(), x.end(), x.begin(), tolower);
 
+/* ~1 second of 8 channel, 32khz audio; the analysis thread drains it many times
+per second, so in practice it never fills up. */
+#define TAP_CAPACITY (1 << 18)
+#define DEFAULT_FFT_SIZE 512
+#define MIN_FFT_SIZE 64
+#define MAX_FFT_SIZE 16384
+#define DEFAULT_BAND_COUNT 32
+#define DEFAULT_FRAME_RATE 30
+#define MIN_LOG_FREQUENCY 20.0
+#define MAX_LOG_FREQUENCY 20000.0
+#define PI 3.14159265358979323846
+
+/* edges of the 24 critical bands of the bark scale, in hz */
+static const double BARK_EDGES[] = {
+    20, 100, 200, 300, 400, 510, 630, 770, 920, 1080, 1270, 1480, 1720,
+    2000, 2320, 2700, 3150, 3700, 4400, 5300, 6400, 7700, 9500, 12000, 15500
+};
+
+enum class BandLayout: int { Linear = 0, Log = 1, Bark = 2 };
+
+struct AnalysisConfig {
+    int fftSize{ DEFAULT_FFT_SIZE };
+    BandLayout layout{ BandLayout::Linear };
+    int bandCount{ DEFAULT_BAND_COUNT };
+    int frameRate{ DEFAULT_FRAME_RATE };
+};
+
+static std::atomic_flag tapLock = ATOMIC_FLAG_INIT;
+static std::atomic<int> tapChannels{ 0 };
+static std::atomic<long> tapSampleRate{ 0 };
+
+static std::thread* analysisThread = nullptr;
+static std::mutex analysisMutex;
+static std::condition_variable analysisCondition;
+static AnalysisConfig analysisConfig;
+static bool analysisConfigChanged = true;
+static bool analysisQuit = false;
+
+static RingBuffer<float>& tap() {
+    static RingBuffer<float> ring(TAP_CAPACITY);
+    return ring;
+}
+
+static AnalysisConfig loadAnalysisConfig() {
+    namespace keys = prefs::keys;
+    auto prefs = Preferences::ForComponent(prefs::components::Settings);
+
+    AnalysisConfig config;
+
+    int fftSize = std::max(MIN_FFT_SIZE, std::min(MAX_FFT_SIZE,
+        prefs->GetInt(keys::VisualizerFftSize, DEFAULT_FFT_SIZE)));
+
+    config.fftSize = MIN_FFT_SIZE;
+    while (config.fftSize < fftSize) { /* round up to a power of two */
+        config.fftSize <<= 1;
+    }
+
+    std::string layout = prefs->GetString(keys::VisualizerBandLayout, "linear");
+    if (layout == "log") {
+        config.layout = BandLayout::Log;
+    }
+    else if (layout == "bark") {
+        config.layout = BandLayout::Bark;
+    }
+
+    config.bandCount = std::max(1, std::min(config.fftSize / 2,
+        prefs->GetInt(keys::VisualizerBandCount, DEFAULT_BAND_COUNT)));
+
+    config.frameRate = std::max(1, std::min(240,
+        prefs->GetInt(keys::VisualizerFrameRate, DEFAULT_FRAME_RATE)));
+
+    return config;
+}
+
+/* computes a windowed spectrum over the most recent fftSize frames of audio,
+averaged across channels, then folds the bins into the configured band layout.
+only ever used from the analysis thread. */
+class SpectrumAnalyzer {
+    public:
+        ~SpectrumAnalyzer() {
+            kiss_fftr_free(this->cfg);
+        }
+
+        void Configure(const AnalysisConfig& config) {
+            kiss_fftr_free(this->cfg);
+            this->config = config;
+            const int n = config.fftSize;
+            this->cfg = kiss_fftr_alloc(n, 0, nullptr, nullptr);
+            this->window.resize(n);
+            for (int i = 0; i < n; i++) {
+                this->window[i] = 0.54f - 0.46f * (float) cos((2 * PI * i) / (n - 1));
+            }
+            this->input.resize(n);
+            this->scratch.resize((n / 2) + 1);
+            this->bins.resize(n / 2);
+            this->edgesSampleRate = 0;
+        }
+
+        size_t FrameCount() const {
+            return (size_t) this->config.fftSize;
+        }
+
+        /* `interleaved` must contain exactly FrameCount() frames */
+        void Analyze(const float* interleaved, int channels, long sampleRate, std::vector<float>& output) {
+            const int n = this->config.fftSize;
+            const int binCount = n / 2;
+
+            /* normalize so values are on the same scale regardless of fft size */
+            const float scale = (float) DEFAULT_FFT_SIZE / (float) n;
+
+            std::fill(this->bins.begin(), this->bins.end(), 0.0f);
+
+            for (int c = 0; c < channels; c++) {
+                for (int i = 0; i < n; i++) {
+                    this->input[i] = interleaved[(i * channels) + c] * this->window[i];
+                }
+
+                kiss_fftr(this->cfg, this->input.data(), this->scratch.data());
+
+                for (int z = 0; z < binCount; z++) {
+                    /* convert to decibels */
+                    const float r = this->scratch[z].r * scale;
+                    const float i = this->scratch[z].i * scale;
+                    const double power = (double) r * r + (double) i * i;
+                    this->bins[z] += (power < 1 ? 0 : 20 * (float) log10(power)) / channels;
+                }
+            }
+
+            if (this->config.layout == BandLayout::Linear) {
+                output.assign(this->bins.begin(), this->bins.end());
+                return;
+            }
+
+            if (sampleRate != this->edgesSampleRate) {
+                this->ComputeEdges(sampleRate);
+            }
+
+            const size_t bandCount = this->edges.size() - 1;
+            output.resize(bandCount);
+            for (size_t b = 0; b < bandCount; b++) {
+                float peak = 0.0f;
+                for (int z = this->edges[b]; z < this->edges[b + 1]; z++) {
+                    peak = std::max(peak, this->bins[z]);
+                }
+                output[b] = peak;
+            }
+        }
+
+    private:
+        /* maps band edges (in hz) to fft bin indexes. every band covers at least
+        one bin; at small fft sizes the low bands are widened, and there may end
+        up being fewer bands than requested. */
+        void ComputeEdges(long sampleRate) {
+            const int binCount = this->config.fftSize / 2;
+            const double nyquist = sampleRate / 2.0;
+            const double hzPerBin = (double) sampleRate / this->config.fftSize;
+
+            std::vector<double> hz;
+            if (this->config.layout == BandLayout::Bark) {
+                for (double edge : BARK_EDGES) {
+                    if (edge >= nyquist && hz.size() > 1) {
+                        break;
+                    }
+                    hz.push_back(std::min(edge, nyquist));
+                }
+            }
+            else {
+                const double lo = MIN_LOG_FREQUENCY;
+                const double hi = std::min(MAX_LOG_FREQUENCY, nyquist);
+                const int count = this->config.bandCount;
+                for (int i = 0; i <= count; i++) {
+                    hz.push_back(lo * pow(hi / lo, (double) i / count));
+                }
+            }
+
+            this->edges.clear();
+            for (double edge : hz) {
+                int bin = std::min(binCount, (int) floor(edge / hzPerBin));
+                if (!this->edges.empty()) {
+                    if (this->edges.back() >= binCount) {
+                        break;
+                    }
+                    bin = std::max(bin, this->edges.back() + 1);
+                }
+                this->edges.push_back(bin);
+            }
+
+            if (this->edges.size() < 2) {
+                this->edges = { 0, binCount };
+            }
+
+            this->edgesSampleRate = sampleRate;
+        }
+
+        AnalysisConfig config;
+        kiss_fftr_cfg cfg{ nullptr };
+        std::vector<float> window;
+        std::vector<float> input;
+        std::vector<kiss_fft_cpx> scratch;
+        std::vector<float> bins;
+        std::vector<int> edges;
+        long edgesSampleRate{ 0 };
+};
+
+static void analysisThreadLoop() {
+#ifdef WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#endif
+
+    using Clock = std::chrono::steady_clock;
+
+    auto& ring = tap();
+    AnalysisConfig config;
+    SpectrumAnalyzer analyzer;
+    std::vector<float> chunk, history, spectrum;
+    Buffer pcm;
+    int channels = 0;
+    auto nextFrame = Clock::now();
+
+    chunk.resize(ring.Capacity());
+
+    while (true) {
+        bool reconfigure = false;
+
+        {
+            std::unique_lock<std::mutex> lock(analysisMutex);
+            analysisCondition.wait_until(lock, nextFrame, [] { return analysisQuit; });
+
+            if (analysisQuit) {
+                return;
+            }
+
+            if (analysisConfigChanged) {
+                config = analysisConfig;
+                analysisConfigChanged = false;
+                reconfigure = true;
+            }
+        }
+
+        /* schedule the next frame. if we fell behind (e.g. the system was
+        suspended) don't try to catch up, just start over from now. */
+        const auto interval = std::chrono::microseconds(1000000 / config.frameRate);
+        const auto now = Clock::now();
+        nextFrame = (now - nextFrame > interval) ? now + interval : nextFrame + interval;
+
+        if (reconfigure) {
+            analyzer.Configure(config);
+        }
+
+        /* drain everything that was tapped since the last frame */
+        const size_t read = ring.Read(chunk.data(), ring.Readable());
+        const int tappedChannels = tapChannels.load();
+        const long sampleRate = tapSampleRate.load();
+
+        if (read == 0 || tappedChannels <= 0) {
+            continue;
+        }
+
+        ISpectrumVisualizer* specVis = spectrumVisualizer.load();
+        IPcmVisualizer* pcmVis = pcmVisualizer.load();
+
+        if (specVis && specVis->Visible()) {
+            /* keep a sliding window of the most recent fftSize frames */
+            if (tappedChannels != channels) {
+                history.clear();
+                channels = tappedChannels;
+            }
+
+            history.insert(history.end(), chunk.begin(), chunk.begin() + read);
+
+            const size_t windowSize = analyzer.FrameCount() * channels;
+            if (history.size() > windowSize) {
+                history.erase(history.begin(), history.end() - windowSize);
+            }
+
+            if (history.size() == windowSize) {
+                analyzer.Analyze(history.data(), channels, sampleRate, spectrum);
+                specVis->Write(spectrum.data(), (int) spectrum.size());
+            }
+        }
+        else if (pcmVis && pcmVis->Visible()) {
+            pcm.SetChannels(tappedChannels);
+            pcm.SetSampleRate(sampleRate);
+            pcm.SetSamples((long) (read - (read % tappedChannels)));
+            std::copy(chunk.begin(), chunk.begin() + pcm.Samples(), pcm.BufferPointer());
+            pcmVis->Write(&pcm);
+        }
+    }
+}
+
+static void startAnalysis(const AnalysisConfig& config) {
+    std::unique_lock<std::mutex> lock(analysisMutex);
+    analysisConfig = config;
+    analysisConfigChanged = true;
+    if (!analysisThread) {
+        analysisQuit = false;
+        analysisThread = new std::thread(&analysisThreadLoop);
+    }
+}
+
+static void stopAnalysis() {
+    std::thread* thread = nullptr;
+
+    {
+        std::unique_lock<std::mutex> lock(analysisMutex);
+        analysisQuit = true;
+        std::swap(thread, analysisThread);
+    }
+
+    analysisCondition.notify_all();
+
+    if (thread) {
+        thread->join();
+        delete thread;
+    }
+}
+
 namespace musik {
     namespace core {
         namespace audio {
@@ -104,14 +433,49 @@ namespace musik {
 
                 void Shutdown() {
                     HideSelectedVisualizer();
+                    stopAnalysis();
                 }
 
                 ISpectrumVisualizer* SpectrumVisualizer() {
-                    return spectrumVisualizer;
+                    return spectrumVisualizer.load();
                 }
 
                 IPcmVisualizer* PcmVisualizer() {
-                    return pcmVisualizer;
+                    return pcmVisualizer.load();
+                }
+
+                void Tap(IBuffer* buffer) {
+                    ISpectrumVisualizer* specVis = spectrumVisualizer.load();
+                    IPcmVisualizer* pcmVis = pcmVisualizer.load();
+
+                    if (!((specVis && specVis->Visible()) || (pcmVis && pcmVis->Visible()))) {
+                        return;
+                    }
+
+                    /* the tap is single-producer, but multiple players may be writing
+                    at the same time while crossfading; whoever loses just drops its
+                    samples, the visualization doesn't need them. */
+                    if (tapLock.test_and_set(std::memory_order_acquire)) {
+                        return;
+                    }
+
+                    auto& ring = tap();
+                    const int channels = buffer->Channels();
+                    const long sampleRate = buffer->SampleRate();
+                    const size_t samples = (size_t) buffer->Samples();
+
+                    if (channels != tapChannels.load() || sampleRate != tapSampleRate.load()) {
+                        ring.Flush(); /* stale samples would be misinterpreted */
+                        tapChannels.store(channels);
+                        tapSampleRate.store(sampleRate);
+                    }
+
+                    /* whole buffers only, so the consumer always sees complete frames */
+                    if (samples <= ring.Writable()) {
+                        ring.Write(buffer->BufferPointer(), samples);
+                    }
+
+                    tapLock.clear(std::memory_order_release);
                 }
 
                 std::shared_ptr<IVisualizer> GetVisualizer(size_t index) {
@@ -130,6 +494,12 @@ namespace musik {
                     selectedVisualizer = visualizer;
                     pcmVisualizer = dynamic_cast<IPcmVisualizer*>(visualizer.get());
                     spectrumVisualizer = dynamic_cast<ISpectrumVisualizer*>(visualizer.get());
+
+                    if (visualizer) {
+                        /* (re)read the analysis settings every time a visualizer is
+                        selected so changes apply without a restart */
+                        startAnalysis(loadAnalysisConfig());
+                    }
                 }
 
                 std::shared_ptr<IVisualizer> SelectedVisualizer() {
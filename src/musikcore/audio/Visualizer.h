@@ -37,6 +37,7 @@
 #include <musikcore/config.h>
 #include <musikcore/sdk/ISpectrumVisualizer.h>
 #include <musikcore/sdk/IPcmVisualizer.h>
+#include <musikcore/sdk/IBuffer.h>
 
 namespace musik { namespace core { namespace audio { namespace vis {
 
@@ -50,4 +51,10 @@ namespace musik { namespace core { namespace audio { namespace vis {
     void HideSelectedVisualizer();
     void Shutdown();
 
+    /* copies the specified buffer into the visualization tap if a visualizer is
+    visible. never blocks: if the tap is full, or another player is writing to
+    it, the samples are dropped. spectrum analysis and pcm delivery happen on a
+    separate, low priority thread at the configured frame rate. */
+    void Tap(musik::core::sdk::IBuffer* buffer);
+
 } } } }
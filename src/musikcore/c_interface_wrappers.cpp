@@ -63,6 +63,8 @@
 #include <musikcore/library/ILibrary.h>
 #include <musikcore/library/IIndexer.h>
 #include <musikcore/library/track/TrackList.h>
+#include <musikcore/library/LocalMetadataProxy.h>
+#include <musikcore/library/query/util/SdkWrappers.h>
 #include <musikcore/audio/Stream.h>
 #include <musikcore/audio/Player.h>
 #include <musikcore/db/ScopedTransaction.h>
@@ -71,12 +73,15 @@
 #include <musikcore/support/Common.h>
 
 #include <string>
+#include <atomic>
+#include <vector>
 
 using namespace musik;
 using namespace musik::core;
 using namespace musik::core::db;
 using namespace musik::core::sdk;
 using namespace musik::core::audio;
+using namespace musik::core::library::query;
 
 #define ENV musik::core::plugin::Environment()
 
@@ -89,6 +94,7 @@ using namespace musik::core::audio;
 #define TRACKLIST(x) static_cast<ITrackList*>(x.opaque)
 #define TRACKLISTEDITOR(x) static_cast<ITrackListEditor*>(x.opaque)
 #define METADATA(x) static_cast<IMetadataProxy*>(x.opaque)
+#define METADATAREQUEST(x) static_cast<mcsdk_svc_metadata_request_internal*>(x.opaque)
 #define PLAYBACK(x) static_cast<IPlaybackService*>(x.opaque)
 #define PREFS(x) static_cast<IPreferences*>(x.opaque)
 #define DATASTREAM(x) static_cast<IDataStream*>(x.opaque)
@@ -250,6 +256,82 @@ mcsdk_export mcsdk_track mcsdk_track_list_get_track_at(mcsdk_track_list tl, size
     return mcsdk_track { TRACKLIST(tl)->GetTrack(index) };
 }
 
+/* track lists produced by queries (and TrackList::GetSdkValue()) are backed
+by a TrackList, which can resolve an entire range of rows with a single batch
+query. anything else falls back to one GetTrack() call per row. rows that
+can't be resolved are still visited, with a null track, so the visitor can
+fill in an empty value. */
+template <typename T>
+static size_t visitTrackRange(ITrackList* trackList, size_t from, size_t count, T visitor) {
+    auto sdkTrackList = dynamic_cast<SdkTrackList*>(trackList);
+    if (sdkTrackList) {
+        std::vector<TrackPtr> tracks;
+        sdkTrackList->Wrapped()->GetRange(from, count, tracks);
+        for (size_t i = 0; i < tracks.size(); i++) {
+            visitor(i, tracks[i].get());
+        }
+        return tracks.size();
+    }
+
+    const size_t total = trackList->Count();
+    const size_t to = (from < total) ? std::min(total, from + count) : from;
+    for (size_t i = from; i < to; i++) {
+        ITrack* track = trackList->GetTrack(i);
+        visitor(i - from, track);
+        if (track) {
+            track->Release();
+        }
+    }
+    return to - from;
+}
+
+mcsdk_export size_t mcsdk_track_list_get_ids(mcsdk_track_list tl, size_t from, size_t count, int64_t* dst) {
+    const size_t total = TRACKLIST(tl)->Count();
+    const size_t to = (from < total) ? std::min(total, from + count) : from;
+    for (size_t i = from; i < to; i++) {
+        dst[i - from] = TRACKLIST(tl)->GetId(i);
+    }
+    return to - from;
+}
+
+mcsdk_export size_t mcsdk_track_list_get_tracks(mcsdk_track_list tl, size_t from, size_t count, mcsdk_track* dst) {
+    auto sdkTrackList = dynamic_cast<SdkTrackList*>(TRACKLIST(tl));
+    if (sdkTrackList) {
+        std::vector<TrackPtr> tracks;
+        sdkTrackList->Wrapped()->GetRange(from, count, tracks);
+        for (size_t i = 0; i < tracks.size(); i++) {
+            dst[i] = mcsdk_track { tracks[i]->GetSdkValue() };
+        }
+        return tracks.size();
+    }
+
+    const size_t total = TRACKLIST(tl)->Count();
+    const size_t to = (from < total) ? std::min(total, from + count) : from;
+    for (size_t i = from; i < to; i++) {
+        dst[i - from] = mcsdk_track { TRACKLIST(tl)->GetTrack(i) };
+    }
+    return to - from;
+}
+
+mcsdk_export size_t mcsdk_track_list_get_string_field(mcsdk_track_list tl, size_t from, size_t count, const char* key, char* dst, int stride) {
+    if (stride <= 0) {
+        return 0;
+    }
+    return visitTrackRange(TRACKLIST(tl), from, count, [key, dst, stride](size_t i, ITrack* track) {
+        char* row = dst + (i * (size_t) stride);
+        row[0] = 0;
+        if (track) {
+            track->GetString(key, row, stride);
+        }
+    });
+}
+
+mcsdk_export size_t mcsdk_track_list_get_int64_field(mcsdk_track_list tl, size_t from, size_t count, const char* key, int64_t default_value, int64_t* dst) {
+    return visitTrackRange(TRACKLIST(tl), from, count, [key, default_value, dst](size_t i, ITrack* track) {
+        dst[i] = track ? track->GetInt64(key, default_value) : default_value;
+    });
+}
+
 mcsdk_export void mcsdk_track_list_release(mcsdk_track_list tl) {
     RELEASE(tl, TRACKLIST);
 }
@@ -382,6 +464,175 @@ mcsdk_export void mcsdk_svc_metadata_release(mcsdk_svc_metadata mp) {
     RELEASE(mp, METADATA);
 }
 
+/*
+ * IMetadataProxy (async)
+ */
+
+class mcsdk_svc_metadata_request_internal {
+    public:
+        mcsdk_svc_metadata_request_internal(
+            std::shared_ptr<QueryBase> query,
+            mcsdk_svc_metadata_request_callback cb,
+            void* user_context)
+        {
+            this->query = query;
+            this->cb = cb;
+            this->user_context = user_context;
+        }
+
+        void Retain() noexcept {
+            ++this->count;
+        }
+
+        void Release() noexcept {
+            if (--this->count == 0) {
+                delete this;
+            }
+        }
+
+        std::shared_ptr<QueryBase> query;
+        mcsdk_svc_metadata_request_callback cb;
+        void* user_context;
+
+    private:
+        std::atomic<int> count{ 1 };
+};
+
+static mcsdk_svc_metadata_request enqueue_metadata_request(
+    ILibraryPtr library,
+    std::shared_ptr<QueryBase> query,
+    mcsdk_svc_metadata_request_callback cb,
+    void* user_context)
+{
+    auto request = new mcsdk_svc_metadata_request_internal(query, cb, user_context);
+
+    /* one reference for the caller's handle, one for the in-flight query.
+    the library runs the completion on its message queue thread, which for
+    an mcsdk_context is the context's own queue. the in-flight reference is
+    owned by the completion itself, so it's dropped even if the library
+    shuts down and discards the query without ever running it. */
+    request->Retain();
+
+    std::shared_ptr<mcsdk_svc_metadata_request_internal> inflight(
+        request, [](mcsdk_svc_metadata_request_internal* r) { r->Release(); });
+
+    const int id = library->Enqueue(query, [inflight](auto q) {
+        if (inflight->cb) {
+            inflight->cb(mcsdk_svc_metadata_request { inflight.get() }, inflight->user_context);
+        }
+    });
+
+    inflight.reset();
+
+    if (id < 0) {
+        request->Release();
+        return mcsdk_svc_metadata_request { nullptr };
+    }
+
+    return mcsdk_svc_metadata_request { request };
+}
+
+static LocalMetadataProxy* local_metadata_proxy(mcsdk_svc_metadata mp) {
+    return dynamic_cast<LocalMetadataProxy*>(METADATA(mp));
+}
+
+mcsdk_export mcsdk_svc_metadata_request mcsdk_svc_metadata_query_tracks_async(mcsdk_svc_metadata mp, const char* keyword, int limit, int offset, mcsdk_svc_metadata_request_callback cb, void* user_context) {
+    auto proxy = local_metadata_proxy(mp);
+    if (!proxy) {
+        return mcsdk_svc_metadata_request { nullptr };
+    }
+    return enqueue_metadata_request(
+        proxy->GetLibrary(), proxy->CreateTracksQuery(keyword, limit, offset), cb, user_context);
+}
+
+mcsdk_export mcsdk_svc_metadata_request mcsdk_svc_metadata_query_tracks_by_category_async(mcsdk_svc_metadata mp, const char* category_type, int64_t selected_id, const char* filter, int limit, int offset, mcsdk_svc_metadata_request_callback cb, void* user_context) {
+    auto proxy = local_metadata_proxy(mp);
+    if (!proxy) {
+        return mcsdk_svc_metadata_request { nullptr };
+    }
+    return enqueue_metadata_request(
+        proxy->GetLibrary(),
+        proxy->CreateTracksByCategoryQuery(category_type, selected_id, filter, limit, offset),
+        cb,
+        user_context);
+}
+
+mcsdk_export mcsdk_svc_metadata_request mcsdk_svc_metadata_query_tracks_by_categories_async(mcsdk_svc_metadata mp, mcsdk_value* categories, size_t category_count, const char* filter, int limit, int offset, mcsdk_svc_metadata_request_callback cb, void* user_context) {
+    auto proxy = local_metadata_proxy(mp);
+    if (!proxy) {
+        return mcsdk_svc_metadata_request { nullptr };
+    }
+    return enqueue_metadata_request(
+        proxy->GetLibrary(),
+        proxy->CreateTracksByCategoriesQuery(reinterpret_cast<IValue**>(categories), category_count, filter, limit, offset),
+        cb,
+        user_context);
+}
+
+mcsdk_export mcsdk_svc_metadata_request mcsdk_svc_metadata_query_category_async(mcsdk_svc_metadata mp, const char* type, const char* filter, mcsdk_svc_metadata_request_callback cb, void* user_context) {
+    return mcsdk_svc_metadata_query_category_with_predicates_async(mp, type, nullptr, 0, filter, cb, user_context);
+}
+
+mcsdk_export mcsdk_svc_metadata_request mcsdk_svc_metadata_query_category_with_predicates_async(mcsdk_svc_metadata mp, const char* type, mcsdk_value* predicates, size_t predicate_count, const char* filter, mcsdk_svc_metadata_request_callback cb, void* user_context) {
+    auto proxy = local_metadata_proxy(mp);
+    if (!proxy) {
+        return mcsdk_svc_metadata_request { nullptr };
+    }
+    return enqueue_metadata_request(
+        proxy->GetLibrary(),
+        proxy->CreateCategoryQuery(type, reinterpret_cast<IValue**>(predicates), predicate_count, filter),
+        cb,
+        user_context);
+}
+
+mcsdk_export mcsdk_svc_metadata_request mcsdk_svc_metadata_query_albums_by_category_async(mcsdk_svc_metadata mp, const char* category_id_name, int64_t category_id_value, const char* filter, mcsdk_svc_metadata_request_callback cb, void* user_context) {
+    auto proxy = local_metadata_proxy(mp);
+    if (!proxy) {
+        return mcsdk_svc_metadata_request { nullptr };
+    }
+    return enqueue_metadata_request(
+        proxy->GetLibrary(),
+        proxy->CreateAlbumsQuery(category_id_name, category_id_value, filter),
+        cb,
+        user_context);
+}
+
+mcsdk_export mcsdk_svc_metadata_request_status mcsdk_svc_metadata_request_get_status(mcsdk_svc_metadata_request r) {
+    return (mcsdk_svc_metadata_request_status) METADATAREQUEST(r)->query->GetStatus();
+}
+
+mcsdk_export void mcsdk_svc_metadata_request_cancel(mcsdk_svc_metadata_request r) {
+    METADATAREQUEST(r)->query->Cancel();
+}
+
+mcsdk_export mcsdk_track_list mcsdk_svc_metadata_request_get_track_list(mcsdk_svc_metadata_request r) {
+    auto query = std::dynamic_pointer_cast<TrackListQueryBase>(METADATAREQUEST(r)->query);
+    if (query && query->GetStatus() == IQuery::Finished) {
+        return mcsdk_track_list { query->GetSdkResult() };
+    }
+    return mcsdk_track_list { nullptr };
+}
+
+mcsdk_export mcsdk_value_list mcsdk_svc_metadata_request_get_value_list(mcsdk_svc_metadata_request r) {
+    auto query = std::dynamic_pointer_cast<CategoryListQuery>(METADATAREQUEST(r)->query);
+    if (query && query->GetStatus() == IQuery::Finished) {
+        return mcsdk_value_list { query->GetSdkResult() };
+    }
+    return mcsdk_value_list { nullptr };
+}
+
+mcsdk_export mcsdk_map_list mcsdk_svc_metadata_request_get_map_list(mcsdk_svc_metadata_request r) {
+    auto query = std::dynamic_pointer_cast<AlbumListQuery>(METADATAREQUEST(r)->query);
+    if (query && query->GetStatus() == IQuery::Finished) {
+        return mcsdk_map_list { query->GetSdkResult() };
+    }
+    return mcsdk_map_list { nullptr };
+}
+
+mcsdk_export void mcsdk_svc_metadata_request_release(mcsdk_svc_metadata_request r) {
+    RELEASE(r, METADATAREQUEST);
+}
+
 /*
  * IPlaybackService
  */
@@ -606,6 +857,10 @@ mcsdk_export bool mcsdk_data_stream_can_prefetch(mcsdk_data_stream ds) {
     return DATASTREAM(ds)->CanPrefetch();
 }
 
+mcsdk_export long mcsdk_data_stream_read_window(mcsdk_data_stream ds, const void** window, long max_count) {
+    return DATASTREAM(ds)->ReadWindow(window, max_count);
+}
+
 mcsdk_export void mcsdk_data_stream_release(mcsdk_data_stream ds) {
     RELEASE(ds, DATASTREAM);
 }
@@ -761,6 +1016,14 @@ mcsdk_export mcsdk_device mcsdk_audio_output_get_default_device(mcsdk_audio_outp
     return mcsdk_device { OUTPUT(o)->GetDefaultDevice() };
 }
 
+mcsdk_export size_t mcsdk_audio_output_get_underrun_count(mcsdk_audio_output o) {
+    return OUTPUT(o)->GetUnderrunCount();
+}
+
+mcsdk_export size_t mcsdk_audio_output_get_xrun_count(mcsdk_audio_output o) {
+    return OUTPUT(o)->GetXrunCount();
+}
+
 mcsdk_export void mcsdk_audio_output_release(mcsdk_audio_output o) {
     RELEASE(o, OUTPUT);
 }
@@ -38,7 +38,11 @@
 #include <musikcore/config.h>
 #include <musikcore/plugin/PluginFactory.h>
 #include <musikcore/io/LocalFileStream.h>
+#include <musikcore/io/MappedFileStream.h>
+#include <musikcore/support/Preferences.h>
+#include <musikcore/support/PreferenceKeys.h>
 
+using namespace musik::core;
 using namespace musik::core::io;
 using namespace musik::core::sdk;
 
@@ -51,6 +55,9 @@ DataStreamFactory::DataStreamFactory() {
 
     this->dataStreamFactories = musik::core::PluginFactory::Instance()
         .QueryInterface<PluginType, Deleter>("GetDataStreamFactory");
+
+    auto settings = Preferences::ForComponent(prefs::components::Settings);
+    this->memoryMapLocalFiles = settings->GetBool(prefs::keys::MemoryMapLocalFiles, false);
 }
 
 DataStreamFactory* DataStreamFactory::Instance() {
@@ -78,7 +85,16 @@ IDataStream* DataStreamFactory::OpenDataStream(const char* uri, OpenFlags flags)
             }
         }
 
-        /* no plugins accepted it? try to open as a local file */
+        /* no plugins accepted it? try to open as a local file. read-only
+        opens are memory mapped if possible. */
+        if (flags == OpenFlags::Read && DataStreamFactory::Instance()->memoryMapLocalFiles) {
+            IDataStream* mappedFile = new MappedFileStream();
+            if (mappedFile->Open(uri, flags)) {
+                return mappedFile;
+            }
+            mappedFile->Release();
+        }
+
         IDataStream* regularFile = new LocalFileStream();
         if (regularFile->Open(uri, flags)) {
             return regularFile;
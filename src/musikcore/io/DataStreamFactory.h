@@ -57,6 +57,7 @@ namespace musik { namespace core { namespace io {
             static DataStreamFactory* Instance();
 
             DataStreamFactoryVector dataStreamFactories;
+            bool memoryMapLocalFiles;
     };
 
 } } }
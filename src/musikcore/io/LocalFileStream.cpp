@@ -45,6 +45,10 @@
 
 static const std::string TAG = "LocalFileStream";
 
+/* writers (encoders, mostly) tend to emit lots of small chunks; give them a
+bigger stdio buffer than the default so they hit the disk less often. */
+static const size_t WRITE_BUFFER_SIZE = 256 * 1024;
+
 using namespace musik::core::io;
 using namespace musik::core::sdk;
 
@@ -118,6 +122,12 @@ bool LocalFileStream::Open(const char *filename, OpenFlags flags) {
 
         if (this->file.load()) {
             this->flags = flags;
+
+            if (flags & OpenFlags::Write) {
+                this->writeBuffer.reset(new char[WRITE_BUFFER_SIZE]);
+                setvbuf(this->file.load(), this->writeBuffer.get(), _IOFBF, WRITE_BUFFER_SIZE);
+            }
+
             return true;
         }
     }
@@ -37,6 +37,7 @@
 #include <musikcore/config.h>
 #include <musikcore/sdk/IDataStream.h>
 #include <atomic>
+#include <memory>
 
 namespace musik { namespace core { namespace io {
 
@@ -66,12 +67,14 @@ namespace musik { namespace core { namespace io {
             const char* Type() noexcept override;
             const char* Uri() noexcept override;
             bool CanPrefetch() noexcept override { return true; }
+            PositionType ReadWindow(const void** window, PositionType maxBytes) noexcept override { return -1; }
 
         private:
             OpenFlags flags { OpenFlags::None };
             std::string extension;
             std::string uri;
             std::atomic<FILE*> file;
+            std::unique_ptr<char[]> writeBuffer;
             long filesize;
     };
 
@@ -0,0 +1,267 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2021 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "pch.hpp"
+
+#include <musikcore/debug.h>
+#include <musikcore/io/MappedFileStream.h>
+#include <musikcore/support/Common.h>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <climits>
+#include <thread>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const std::string TAG = "MappedFileStream";
+
+/* when seeking, ask the kernel to start paging in this much of the file
+at the new position. */
+static const size_t SEEK_READAHEAD_BYTES = 1024 * 1024;
+
+/* don't burn a large chunk of a 32-bit address space on one file; callers
+fall back to LocalFileStream. */
+static const size_t MAX_MAPPED_BYTES = sizeof(void*) > 4
+    ? (size_t) LONG_MAX : (size_t) 256 * 1024 * 1024;
+
+using namespace musik::core::io;
+using namespace musik::core::sdk;
+
+MappedFileStream::MappedFileStream() noexcept {
+}
+
+MappedFileStream::~MappedFileStream() noexcept {
+    this->Close();
+}
+
+bool MappedFileStream::Open(const char *filename, OpenFlags flags) {
+    if (flags != OpenFlags::Read || this->data.load()) {
+        return false;
+    }
+
+    try {
+        std::filesystem::path path(std::filesystem::u8path(filename));
+
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(path, ec)) {
+            return false;
+        }
+
+        const auto size = std::filesystem::file_size(path, ec);
+        if (ec || size == 0 || size > MAX_MAPPED_BYTES) {
+            return false; /* empty files can't be mapped */
+        }
+
+        this->uri = filename;
+        this->extension = path.extension().u8string();
+        this->length = (size_t) size;
+        this->position = 0;
+        this->interrupted = false;
+
+#ifdef WIN32
+        std::wstring u16fn = u8to16(this->uri);
+
+        this->file = CreateFileW(
+            u16fn.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ | FILE_SHARE_WRITE,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr);
+
+        if (this->file != INVALID_HANDLE_VALUE) {
+            this->mapping = CreateFileMappingW(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (this->mapping) {
+                this->data = static_cast<const char*>(
+                    MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, this->length));
+            }
+        }
+#else
+        this->fd = open(filename, O_RDONLY | O_CLOEXEC);
+
+        if (this->fd != -1) {
+            void* mapped = mmap(nullptr, this->length, PROT_READ, MAP_SHARED, this->fd, 0);
+            if (mapped != MAP_FAILED) {
+#ifdef POSIX_FADV_SEQUENTIAL
+                posix_fadvise(this->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+                posix_madvise(mapped, this->length, POSIX_MADV_SEQUENTIAL);
+                this->WillNeed(static_cast<const char*>(mapped), 0);
+                this->data = static_cast<const char*>(mapped);
+            }
+        }
+#endif
+
+        if (this->data.load()) {
+            debug::info(TAG, "mapped file: " + this->uri);
+            return true;
+        }
+    }
+    catch (...) {
+    }
+
+    this->Close();
+    return false;
+}
+
+bool MappedFileStream::Close() noexcept {
+    const char* data = this->data.exchange(nullptr);
+
+    /* anyone who got in before the exchange is still touching the mapping */
+    while (this->readers.load() > 0) {
+        std::this_thread::yield();
+    }
+
+#ifdef WIN32
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+    if (this->mapping) {
+        CloseHandle(this->mapping);
+        this->mapping = nullptr;
+    }
+    if (this->file != INVALID_HANDLE_VALUE) {
+        CloseHandle(this->file);
+        this->file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (data) {
+        munmap(const_cast<char*>(data), this->length);
+    }
+    if (this->fd != -1) {
+        close(this->fd);
+        this->fd = -1;
+    }
+#endif
+
+    this->length = 0;
+    this->position = 0;
+    return data != nullptr;
+}
+
+void MappedFileStream::Interrupt() noexcept {
+    /* reads never block on anything but page faults, but stop handing out
+    data so the decoder winds down promptly */
+    this->interrupted = true;
+}
+
+void MappedFileStream::Release() noexcept {
+    delete this;
+}
+
+void MappedFileStream::WillNeed(const char* data, size_t offset) noexcept {
+#ifndef WIN32
+    /* madvise wants a page aligned address */
+    const size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+    const size_t start = offset - (offset % pageSize);
+    const size_t end = std::min(this->length, offset + SEEK_READAHEAD_BYTES);
+    if (end > start) {
+        posix_madvise(const_cast<char*>(data) + start, end - start, POSIX_MADV_WILLNEED);
+    }
+#endif
+}
+
+PositionType MappedFileStream::Read(void* buffer, PositionType readBytes) noexcept {
+    this->readers++;
+    PositionType count = 0;
+    const char* data = this->data.load();
+    if (data && !this->interrupted && readBytes > 0) {
+        const size_t n = std::min((size_t) readBytes, this->length - this->position);
+        memcpy(buffer, data + this->position, n);
+        this->position += n;
+        count = narrow_cast<PositionType>(n);
+    }
+    this->readers--;
+    return count;
+}
+
+PositionType MappedFileStream::ReadWindow(const void** window, PositionType maxBytes) noexcept {
+    /* the window is only valid until the stream is closed, which callers
+    already have to serialize against their own reads */
+    const char* data = this->data.load();
+    if (!data || !window || maxBytes < 0) {
+        return data ? 0 : -1;
+    }
+
+    if (this->interrupted) {
+        return 0;
+    }
+
+    const size_t count = std::min((size_t) maxBytes, this->length - this->position);
+    *window = data + this->position;
+    this->position += count;
+    return narrow_cast<PositionType>(count);
+}
+
+bool MappedFileStream::SetPosition(PositionType position) noexcept {
+    const char* data = this->data.load();
+    if (!data || position < 0 || (size_t) position > this->length) {
+        return false;
+    }
+
+    /* a seek breaks the sequential pattern; warm up the new region */
+    if ((size_t) position != this->position) {
+        this->WillNeed(data, (size_t) position);
+    }
+
+    this->position = (size_t) position;
+    return true;
+}
+
+PositionType MappedFileStream::Position() noexcept {
+    return this->data.load() ? narrow_cast<PositionType>(this->position) : -1;
+}
+
+bool MappedFileStream::Eof() noexcept {
+    return !this->data.load() || this->interrupted || this->position >= this->length;
+}
+
+long MappedFileStream::Length() noexcept {
+    return narrow_cast<long>(this->length);
+}
+
+const char* MappedFileStream::Type() noexcept {
+    return this->extension.c_str();
+}
+
+const char* MappedFileStream::Uri() noexcept {
+    return this->uri.c_str();
+}
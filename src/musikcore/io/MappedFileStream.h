@@ -0,0 +1,100 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2021 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <musikcore/config.h>
+#include <musikcore/sdk/IDataStream.h>
+#include <string>
+#include <atomic>
+
+namespace musik { namespace core { namespace io {
+
+    /* a read-only IDataStream over a memory mapped local file. reads are a
+    single copy out of the page cache, ReadWindow() hands out pointers into
+    the mapping directly, and the kernel is told we'll be reading
+    sequentially so it reads ahead aggressively. note that if another process
+    truncates the file (or the volume it lives on goes away) while it's
+    mapped, touching the missing pages raises SIGBUS, so mapping is opt-in
+    via the MemoryMapLocalFiles preference. */
+    class MappedFileStream : public musik::core::sdk::IDataStream {
+        public:
+            using PositionType = musik::core::sdk::PositionType;
+            using OpenFlags = musik::core::sdk::OpenFlags;
+
+            DELETE_COPY_AND_ASSIGNMENT_DEFAULTS(MappedFileStream)
+
+            MappedFileStream() noexcept;
+            virtual ~MappedFileStream() noexcept;
+
+            bool Open(const char *filename, OpenFlags flags) override;
+            bool Close() noexcept override;
+            void Interrupt() noexcept override;
+            void Release() noexcept override;
+            bool Readable() noexcept override { return this->data.load() != nullptr; }
+            bool Writable() noexcept override { return false; }
+            PositionType Read(void* buffer, PositionType readBytes) noexcept override;
+            PositionType Write(void* buffer, PositionType writeBytes) noexcept override { return 0; }
+            bool SetPosition(PositionType position) noexcept override;
+            PositionType Position() noexcept override;
+            bool Eof() noexcept override;
+            long Length() noexcept override;
+            bool Seekable() noexcept override { return true; }
+            const char* Type() noexcept override;
+            const char* Uri() noexcept override;
+            bool CanPrefetch() noexcept override { return true; }
+            PositionType ReadWindow(const void** window, PositionType maxBytes) noexcept override;
+
+        private:
+            void WillNeed(const char* data, size_t offset) noexcept;
+
+            std::string extension;
+            std::string uri;
+            /* Close() may be called from another thread while a decoder is
+            still reading; it swaps the pointer out, then waits for in-flight
+            reads to finish before unmapping. */
+            std::atomic<const char*> data{ nullptr };
+            std::atomic<int> readers{ 0 };
+            std::atomic<bool> interrupted{ false };
+            size_t length{ 0 };
+            size_t position{ 0 };
+#ifdef WIN32
+            HANDLE file{ INVALID_HANDLE_VALUE };
+            HANDLE mapping{ nullptr };
+#else
+            int fd{ -1 };
+#endif
+    };
+
+} } }
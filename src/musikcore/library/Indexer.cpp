@@ -52,6 +52,7 @@
 #include <musikcore/support/PreferenceKeys.h>
 #include <musikcore/sdk/IAnalyzer.h>
 #include <musikcore/sdk/IIndexerSource.h>
+#include <musikcore/sdk/String.h>
 #include <musikcore/audio/Stream.h>
 #include <musikcore/support/ThreadGroup.h>
 
@@ -59,8 +60,7 @@
 #include <algorithm>
 #include <atomic>
 #include <functional>
-
-#define STRESS_TEST_DB 0
+#include <chrono>
 
 constexpr const char* TAG = "Indexer";
 constexpr size_t TRANSACTION_INTERVAL = 300;
@@ -107,6 +107,19 @@ static void closeLogFile() noexcept {
     }
 }
 
+/* " .NSF" -> ".nsf", to match std::fs::path::extension() */
+static std::string normalizeExtension(std::string extension) {
+    extension.erase(
+        std::remove_if(extension.begin(), extension.end(), [](char c) {
+            return str::IsSpace(c) || c == '.';
+        }),
+        extension.end());
+
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+    return extension.size() ? "." + extension : extension;
+}
+
 static std::string normalizePath(const std::string& path) {
     return std::fs::path(std::fs::u8path(path)).make_preferred().u8string();
 }
@@ -228,12 +241,15 @@ void Indexer::RemovePath(const std::string& path) {
 void Indexer::Synchronize(const SyncContext& context, asio::io_service* io) {
     LocalLibrary::CreateIndexes(this->dbConnection);
 
-    IndexerTrack::OnIndexerStarted(this->dbConnection);
+    /* a rebuild re-extracts artwork for every album */
+    IndexerTrack::OnIndexerStarted(
+        this->dbConnection, context.type != SyncType::Rebuild);
 
     this->ProcessAddRemoveQueue();
 
     this->incrementalUrisScanned = 0;
     this->totalUrisScanned = 0;
+    this->pendingJobs = 0;
 
     /* always remove tracks that no longer have a corresponding source */
     for (const auto id : this->GetOrphanedSourceIds()) {
@@ -278,31 +294,64 @@ void Indexer::Synchronize(const SyncContext& context, asio::io_service* io) {
         }
     }
 
-    /* refresh sources */
-    for (auto it : this->sources) {
-        if (this->Bail()) {
-            break;
-        }
+    /* figure out which sources we're syncing, and which of them want the
+    files from our directory walk instead of walking the paths themselves */
+    IndexerSourceList scanSources, walkSources;
+    this->fileSources.clear();
 
+    for (auto it : this->sources) {
         if (sourceId != 0 && sourceId != it->SourceId()) {
             continue; /* asked to scan a specific source, and this isn't it. */
         }
 
+        if (it->SourceId() == 0) {
+            continue; /* invalid */
+        }
+
+        const char* extensions = it->ScanFileExtensions();
+        if (extensions && strlen(extensions)) {
+            for (auto& extension : str::Split(std::string(extensions), ",")) {
+                const std::string normalized = normalizeExtension(extension);
+                if (normalized.size()) {
+                    this->fileSources[normalized].push_back(it);
+                }
+            }
+            walkSources.push_back(it);
+        }
+        else {
+            scanSources.push_back(it);
+        }
+    }
+
+    /* refresh sources that do their own scanning */
+    const auto sourcesStart = std::chrono::steady_clock::now();
+
+    for (auto it : scanSources) {
+        if (this->Bail()) {
+            break;
+        }
+
         this->currentSource = it;
+        it->OnBeforeScan();
         if (this->SyncSource(it.get(), paths) == ScanRollback) {
             this->trackTransaction->Cancel();
         }
         this->trackTransaction->CommitAndRestart();
-
-        if (sourceId != 0) {
-            break; /* done with the one we were asked to scan */
-        }
     }
 
     this->currentSource.reset();
 
-    /* process local files */
-    if (type != SyncType::Sources) {
+    this->AddSyncTiming("sources", sourcesStart);
+
+    /* walk the library paths once, reading local files and handing off
+    anything the remaining sources asked for */
+    const bool readLocalFiles = (type != SyncType::Sources);
+
+    if (readLocalFiles || walkSources.size()) {
+        for (auto it : walkSources) {
+            it->OnBeforeScan();
+        }
+
         if (logFile) {
             fprintf(logFile, "\n\nSYNCING LOCAL FILES:\n");
         }
@@ -310,18 +359,62 @@ void Indexer::Synchronize(const SyncContext& context, asio::io_service* io) {
         /* read metadata from the files  */
         for (std::size_t i = 0; i < paths.size(); ++i) {
             musik::debug::info(TAG, "scanning " + paths[i]);
-            this->SyncDirectory(io, paths[i], paths[i], pathIds[i]);
+            this->SyncDirectory(io, paths[i], paths[i], pathIds[i], readLocalFiles);
+        }
+
+        /* sources see all of their files before Scan() is called, and may
+        remove tracks from there, so let the worker threads catch up. */
+        if (walkSources.size()) {
+            this->WaitForPendingJobs();
         }
 
-        /* close any pending transaction */
+        /* close any pending transaction. this includes everything sources
+        wrote from ScanFile(), so a ScanRollback below can't undo it; see
+        IIndexerSource::ScanFileExtensions(). */
         this->trackTransaction->CommitAndRestart();
 
+        if (walkSources.size()) {
+            const auto start = std::chrono::steady_clock::now();
+
+            for (auto it : walkSources) {
+                if (this->Bail()) {
+                    it->OnAfterScan();
+                    continue;
+                }
+
+                this->currentSource = it;
+                if (this->SyncSource(it.get(), paths) == ScanRollback) {
+                    this->trackTransaction->Cancel();
+                }
+                this->trackTransaction->CommitAndRestart();
+            }
+
+            this->currentSource.reset();
+
+            this->AddSyncTiming("walk sources", start);
+        }
+
         /* re-index */
-        LocalLibrary::CreateIndexes(this->dbConnection);
+        if (readLocalFiles) {
+            LocalLibrary::CreateIndexes(this->dbConnection);
+        }
     }
+
+    this->fileSources.clear();
 }
 
 void Indexer::FinalizeSync(const SyncContext& context) {
+    /* artwork read during the scan was deferred until now, one image per
+    album, so the scan didn't have to checksum and write it while holding
+    the shared write lock. this runs even if we're bailing: the tracks it
+    came from have already been committed with their current file times,
+    so an incremental rescan won't read them (or their artwork) again. */
+    {
+        const auto start = std::chrono::steady_clock::now();
+        IndexerTrack::SavePendingThumbnails(this->dbConnection, this->libraryPath);
+        this->AddSyncTiming("artwork", start);
+    }
+
     /* remove undesired entries from db (files themselves will remain) */
     musik::debug::info(TAG, "cleanup 1/2");
 
@@ -329,7 +422,9 @@ void Indexer::FinalizeSync(const SyncContext& context) {
 
     if (type != SyncType::Sources) {
         if (!this->Bail()) {
+            const auto start = std::chrono::steady_clock::now();
             this->SyncDelete();
+            this->AddSyncTiming("delete", start);
         }
     }
 
@@ -337,18 +432,26 @@ void Indexer::FinalizeSync(const SyncContext& context) {
     musik::debug::info(TAG, "cleanup 2/2");
 
     if (!this->Bail()) {
+        const auto start = std::chrono::steady_clock::now();
         this->SyncCleanup();
+        this->AddSyncTiming("cleanup", start);
     }
 
     /* optimize and sort */
     musik::debug::info(TAG, "optimizing");
 
     if (!this->Bail()) {
+        const auto start = std::chrono::steady_clock::now();
         this->SyncOptimize();
+        this->AddSyncTiming("optimize", start);
     }
 
     /* run analyzers. */
-    this->RunAnalyzers();
+    {
+        const auto start = std::chrono::steady_clock::now();
+        this->RunAnalyzers();
+        this->AddSyncTiming("analyzers", start);
+    }
 
     IndexerTrack::OnIndexerFinished(this->dbConnection);
 }
@@ -407,25 +510,6 @@ void Indexer::ReadMetadataFromFile(
         if (saveToDb) {
             track.SetValue("path_id", pathId.c_str());
             track.Save(this->dbConnection, this->libraryPath);
-
-#if STRESS_TEST_DB != 0
-            #define INC(track, key, x) \
-                { \
-                    std::string val = track.GetValue(key); \
-                    val += (char) ('a' + x); \
-                    track.ClearValue(key); \
-                    track.SetValue(key, val.c_str()); \
-                }
-
-            for (int i = 0; i < 20; i++) {
-                track.SetId(0);
-                INC(track, "title", i);
-                INC(track, "artist", i);
-                INC(track, "album_artist", i);
-                INC(track, "album", i);
-                track.Save(this->dbConnection, this->libraryPath);
-            }
-#endif
         }
         else {
             APPEND_LOG("read failed")
@@ -456,11 +540,59 @@ inline void Indexer::IncrementTracksScanned(int delta) {
     }
 }
 
+void Indexer::ScanFileWithSource(
+    asio::io_service* io,
+    std::shared_ptr<IIndexerSource> source,
+    const std::fs::path& file)
+{
+    if (io && this->Bail()) {
+        if (!io->stopped()) {
+            musik::debug::info(TAG, "run aborted");
+            io->stop();
+        }
+        return;
+    }
+
+    try {
+        source->ScanFile(this, file.u8string().c_str());
+    }
+    catch (...) {
+        debug::error(TAG, u8fmt("indexer source %d failed to scan a file", source->SourceId()));
+    }
+}
+
+void Indexer::RunOrPost(asio::io_service* io, std::function<void()> job) {
+    if (!io) {
+        job();
+        return;
+    }
+
+    this->pendingJobs.fetch_add(1);
+
+    io->post([this, job]() {
+        job();
+        std::unique_lock<std::mutex> lock(this->pendingJobsMutex);
+        if (this->pendingJobs.fetch_sub(1) == 1) {
+            this->pendingJobsCondition.notify_all();
+        }
+    });
+}
+
+void Indexer::WaitForPendingJobs() {
+    /* if the run is aborted the queue is stopped and outstanding jobs
+    never run, so check periodically instead of waiting for zero */
+    std::unique_lock<std::mutex> lock(this->pendingJobsMutex);
+    while (this->pendingJobs.load() > 0 && !this->Bail()) {
+        this->pendingJobsCondition.wait_for(lock, std::chrono::milliseconds(100));
+    }
+}
+
 void Indexer::SyncDirectory(
     asio::io_service* io,
     const std::string &syncRoot,
     const std::string &currentPath,
-    int64_t pathId)
+    int64_t pathId,
+    bool readLocalFiles)
 {
     std::string normalizedSyncRoot = NormalizeDir(syncRoot);
     std::string normalizedCurrentPath = NormalizeDir(currentPath);
@@ -482,25 +614,37 @@ void Indexer::SyncDirectory(
             }
             if (is_directory(file->status())) {
                 /* recursion here */
-                this->SyncDirectory(io, syncRoot, file->path().u8string(), pathId);
+                this->SyncDirectory(io, syncRoot, file->path().u8string(), pathId, readLocalFiles);
             }
             else {
                 try {
                     std::string extension = file->path().extension().u8string();
-                    for (auto it : this->tagReaders) {
-                        if (it->CanRead(extension.c_str())) {
-                            if (io) {
-                                io->post(std::bind(
+
+                    if (readLocalFiles) {
+                        for (auto it : this->tagReaders) {
+                            if (it->CanRead(extension.c_str())) {
+                                this->RunOrPost(io, std::bind(
                                     &Indexer::ReadMetadataFromFile,
                                     this,
                                     io,
                                     file->path(),
                                     pathIdStr));
+                                break;
                             }
-                            else {
-                                this->ReadMetadataFromFile(nullptr, file->path(), pathIdStr);
+                        }
+                    }
+
+                    if (this->fileSources.size()) {
+                        auto sources = this->fileSources.find(normalizeExtension(extension));
+                        if (sources != this->fileSources.end()) {
+                            for (auto source : sources->second) {
+                                this->RunOrPost(io, std::bind(
+                                    &Indexer::ScanFileWithSource,
+                                    this,
+                                    io,
+                                    source,
+                                    file->path()));
                             }
-                            break;
                         }
                     }
                 }
@@ -528,8 +672,6 @@ ScanResult Indexer::SyncSource(
     /* only commit if explicitly succeeded */
     ScanResult result = ScanRollback;
 
-    source->OnBeforeScan();
-
     try {
         /* alloc/init fun interop; we pass all paths to the indexer source */
         const char** pathsList = new const char*[paths.size()];
@@ -619,6 +761,12 @@ void Indexer::ThreadLoop() {
         this->state = StateIndexing;
         this->Started();
 
+        const auto syncStart = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::mutex> lock(this->timingsMutex);
+            this->currentTimings.clear();
+        }
+
         this->dbConnection.Open(this->dbFilename.c_str(), 0);
         this->trackTransaction = std::make_shared<db::ScopedTransaction>(this->dbConnection);
 
@@ -637,6 +785,8 @@ void Indexer::ThreadLoop() {
                 });
             }
 
+            const auto start = std::chrono::steady_clock::now();
+
             this->Synchronize(context, &io);
 
             /* done with sync, remove all the threads in the pool to free resources. they'll
@@ -649,9 +799,13 @@ void Indexer::ThreadLoop() {
             });
 
             threadGroup.join_all();
+
+            this->AddSyncTiming("synchronize", start);
         }
         else {
+            const auto start = std::chrono::steady_clock::now();
             this->Synchronize(context, nullptr);
+            this->AddSyncTiming("synchronize", start);
         }
 
         this->FinalizeSync(context);
@@ -660,6 +814,13 @@ void Indexer::ThreadLoop() {
 
         this->dbConnection.Close();
 
+        this->AddSyncTiming("total", syncStart);
+
+        {
+            std::unique_lock<std::mutex> lock(this->timingsMutex);
+            std::swap(this->lastTimings, this->currentTimings);
+        }
+
         if (!this->Bail()) {
             this->Progress(this->totalUrisScanned);
             this->Finished(this->totalUrisScanned);
@@ -1097,6 +1258,24 @@ void Indexer::ScheduleRescan(IIndexerSource* source) {
     }
 }
 
+void Indexer::AddSyncTiming(
+    const std::string& phase,
+    std::chrono::steady_clock::time_point start)
+{
+    const double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    debug::info(TAG, u8fmt("%s took %.1fms", phase.c_str(), ms));
+
+    std::unique_lock<std::mutex> lock(this->timingsMutex);
+    this->currentTimings.push_back({ phase, ms });
+}
+
+std::vector<Indexer::SyncTiming> Indexer::GetLastSyncTimings() {
+    std::unique_lock<std::mutex> lock(this->timingsMutex);
+    return this->lastTimings;
+}
+
 bool Indexer::Bail() noexcept {
     return
         this->state == StateStopping ||
@@ -49,9 +49,12 @@
 #pragma warning(pop)
 
 #include <filesystem>
+#include <chrono>
+#include <mutex>
 #include <thread>
 #include <condition_variable>
 #include <deque>
+#include <functional>
 #include <vector>
 #include <atomic>
 #include <set>
@@ -100,6 +103,16 @@ namespace musik { namespace core {
             /* IIndexerNotifier */
             void ScheduleRescan(musik::core::sdk::IIndexerSource* source) override;
 
+            /* Indexer */
+            struct SyncTiming {
+                std::string phase;
+                double milliseconds;
+            };
+
+            /* wall clock time spent in each phase of the most recently
+            completed sync. updated before the Finished signal is raised. */
+            std::vector<SyncTiming> GetLastSyncTimings();
+
         private:
             struct AddRemoveContext {
                 bool add{ false };
@@ -120,6 +133,10 @@ namespace musik { namespace core {
             typedef std::vector<std::shared_ptr<
                 musik::core::sdk::IIndexerSource>> IndexerSourceList;
 
+            /* lowercase extension, including the dot -> sources that asked to
+            receive those files from our directory walk */
+            typedef std::map<std::string, IndexerSourceList> FileSourceMap;
+
             void ThreadLoop();
 
             void Synchronize(const SyncContext& context, asio::io_service* io);
@@ -148,15 +165,28 @@ namespace musik { namespace core {
                 asio::io_service* io,
                 const std::string& syncRoot,
                 const std::string& currentPath,
-                int64_t pathId);
+                int64_t pathId,
+                bool readLocalFiles);
 
             void ReadMetadataFromFile(
                 asio::io_service* io,
                 const std::filesystem::path& path,
                 const std::string& pathId);
 
+            void ScanFileWithSource(
+                asio::io_service* io,
+                std::shared_ptr<musik::core::sdk::IIndexerSource> source,
+                const std::filesystem::path& path);
+
+            void RunOrPost(asio::io_service* io, std::function<void()> job);
+            void WaitForPendingJobs();
+
             bool Bail() noexcept;
 
+            void AddSyncTiming(
+                const std::string& phase,
+                std::chrono::steady_clock::time_point start);
+
             db::Connection dbConnection;
             std::string libraryPath;
             std::string dbFilename;
@@ -174,6 +204,12 @@ namespace musik { namespace core {
             std::shared_ptr<musik::core::db::ScopedTransaction> trackTransaction;
             std::vector<std::string> paths;
             std::shared_ptr<musik::core::sdk::IIndexerSource> currentSource;
+            std::mutex timingsMutex;
+            std::vector<SyncTiming> currentTimings, lastTimings;
+            FileSourceMap fileSources;
+            std::atomic<int> pendingJobs{ 0 };
+            std::mutex pendingJobsMutex;
+            std::condition_variable pendingJobsCondition;
     };
 
     typedef std::shared_ptr<Indexer> IndexerPtr;
@@ -299,17 +299,83 @@ void LocalMetadataProxy::Release() noexcept {
     delete this;
 }
 
-ITrackList* LocalMetadataProxy::QueryTracks(const char* query, int limit, int offset) {
-    try {
-        auto search = std::make_shared<SearchTrackListQuery>(
-            this->library,
-            SearchTrackListQuery::MatchType::Substring,
-            std::string(query ? query : ""),
-            TrackSortType::Album);
+std::shared_ptr<TrackListQueryBase> LocalMetadataProxy::CreateTracksQuery(
+    const char* query, int limit, int offset)
+{
+    auto search = std::make_shared<SearchTrackListQuery>(
+        this->library,
+        SearchTrackListQuery::MatchType::Substring,
+        std::string(query ? query : ""),
+        TrackSortType::Album);
+
+    if (limit >= 0) {
+        search->SetLimitAndOffset(limit, offset);
+    }
 
-        if (limit >= 0) {
-            search->SetLimitAndOffset(limit, offset);
+    return search;
+}
+
+std::shared_ptr<TrackListQueryBase> LocalMetadataProxy::CreateTracksByCategoryQuery(
+    const char* categoryType, int64_t selectedId, const char* filter, int limit, int offset)
+{
+    std::shared_ptr<TrackListQueryBase> search;
+
+    if (std::string(categoryType) == constants::Playlists::TABLE_NAME) {
+        search = std::make_shared<GetPlaylistQuery>(this->library, selectedId);
+    }
+    else {
+        if (categoryType && strlen(categoryType) && selectedId > 0) {
+            search = std::make_shared<CategoryTrackListQuery>(
+                this->library, categoryType, selectedId, filter);
+        }
+        else {
+            search = std::make_shared<CategoryTrackListQuery>(this->library, filter);
         }
+    }
+
+    if (limit >= 0) {
+        search->SetLimitAndOffset(limit, offset);
+    }
+
+    return search;
+}
+
+std::shared_ptr<TrackListQueryBase> LocalMetadataProxy::CreateTracksByCategoriesQuery(
+    IValue** categories, size_t categoryCount, const char* filter, int limit, int offset)
+{
+    PredicateList list = toPredicateList(categories, categoryCount);
+
+    auto query = std::make_shared<CategoryTrackListQuery>(this->library, list, filter);
+
+    if (limit >= 0) {
+        query->SetLimitAndOffset(limit, offset);
+    }
+
+    return query;
+}
+
+std::shared_ptr<CategoryListQuery> LocalMetadataProxy::CreateCategoryQuery(
+    const char* type, IValue** predicates, size_t predicateCount, const char* filter)
+{
+    return std::make_shared<CategoryListQuery>(
+        CategoryListQuery::MatchType::Substring,
+        type,
+        toPredicateList(predicates, predicateCount),
+        std::string(filter ? filter : ""));
+}
+
+std::shared_ptr<AlbumListQuery> LocalMetadataProxy::CreateAlbumsQuery(
+    const char* categoryIdName, int64_t categoryIdValue, const char* filter)
+{
+    return std::make_shared<AlbumListQuery>(
+        std::string(categoryIdName ? categoryIdName : ""),
+        categoryIdValue,
+        std::string(filter ? filter : ""));
+}
+
+ITrackList* LocalMetadataProxy::QueryTracks(const char* query, int limit, int offset) {
+    try {
+        auto search = this->CreateTracksQuery(query, limit, offset);
 
         this->library->EnqueueAndWait(search);
 
@@ -363,24 +429,8 @@ ITrackList* LocalMetadataProxy::QueryTracksByCategory(
     const char* categoryType, int64_t selectedId, const char* filter, int limit, int offset)
 {
     try {
-        std::shared_ptr<TrackListQueryBase> search;
-
-        if (std::string(categoryType) == constants::Playlists::TABLE_NAME) {
-            search = std::make_shared<GetPlaylistQuery>(this->library, selectedId);
-        }
-        else {
-            if (categoryType && strlen(categoryType) && selectedId > 0) {
-                search = std::make_shared<CategoryTrackListQuery>(
-                    this->library, categoryType, selectedId, filter);
-            }
-            else {
-                search = std::make_shared<CategoryTrackListQuery>(this->library, filter);
-            }
-        }
-
-        if (limit >= 0) {
-            search->SetLimitAndOffset(limit, offset);
-        }
+        auto search = this->CreateTracksByCategoryQuery(
+            categoryType, selectedId, filter, limit, offset);
 
         this->library->EnqueueAndWait(search);
 
@@ -399,13 +449,8 @@ ITrackList* LocalMetadataProxy::QueryTracksByCategories(
     IValue** categories, size_t categoryCount, const char* filter, int limit, int offset)
 {
     try {
-        PredicateList list = toPredicateList(categories, categoryCount);
-
-        auto query = std::make_shared<CategoryTrackListQuery>(this->library, list, filter);
-
-        if (limit >= 0) {
-            query->SetLimitAndOffset(limit, offset);
-        }
+        auto query = this->CreateTracksByCategoriesQuery(
+            categories, categoryCount, filter, limit, offset);
 
         this->library->EnqueueAndWait(query);
 
@@ -471,13 +516,8 @@ IValueList* LocalMetadataProxy::QueryCategoryWithPredicates(
     const char* type, IValue** predicates, size_t predicateCount, const char* filter)
 {
     try {
-        auto predicateList = toPredicateList(predicates, predicateCount);
-
-        auto query = std::make_shared<CategoryListQuery>(
-            CategoryListQuery::MatchType::Substring,
-            type,
-            predicateList,
-            std::string(filter ? filter : ""));
+        auto query = this->CreateCategoryQuery(
+            type, predicates, predicateCount, filter);
 
         this->library->EnqueueAndWait(query);
 
@@ -496,10 +536,8 @@ IMapList* LocalMetadataProxy::QueryAlbums(
     const char* categoryIdName, int64_t categoryIdValue, const char* filter)
 {
     try {
-        auto search = std::make_shared<AlbumListQuery>(
-            std::string(categoryIdName ? categoryIdName : ""),
-            categoryIdValue,
-            std::string(filter ? filter : ""));
+        auto search = this->CreateAlbumsQuery(
+            categoryIdName, categoryIdValue, filter);
 
         this->library->EnqueueAndWait(search);
 
@@ -774,6 +812,26 @@ ITrackList* LocalMetadataProxy::QueryTracksByExternalId(
     return nullptr;
 }
 
+ITrackList* LocalMetadataProxy::QueryTracksByIds(const int64_t* trackIds, size_t trackIdCount) {
+    try {
+        auto trackList = std::make_shared<TrackList>(this->library, trackIds, trackIdCount);
+
+        if (trackIdCount > 0) {
+            /* size the cache to hold every track, then resolve all of them
+            with a single batch query up front. */
+            trackList->SetCacheWindowSize(trackIdCount);
+            trackList->CacheWindow(0, trackIdCount - 1, false);
+        }
+
+        return trackList->GetSdkValue();
+    }
+    catch (...) {
+        musik::debug::error(TAG, "QueryTracksByIds failed");
+    }
+
+    return nullptr;
+}
+
 bool LocalMetadataProxy::SendRawQuery(
     const char* query, IAllocator& allocator, char** resultData, int* resultSize)
 {
@@ -35,6 +35,9 @@
 #pragma once
 
 #include <musikcore/library/ILibrary.h>
+#include <musikcore/library/query/AlbumListQuery.h>
+#include <musikcore/library/query/CategoryListQuery.h>
+#include <musikcore/library/query/TrackListQueryBase.h>
 #include <musikcore/sdk/IMetadataProxy.h>
 
 namespace musik { namespace core { namespace library { namespace query {
@@ -157,6 +160,45 @@ namespace musik { namespace core { namespace library { namespace query {
 
             void Release() noexcept override;
 
+            musik::core::sdk::ITrackList* QueryTracksByIds(
+                const int64_t* trackIds, size_t trackIdCount) override;
+
+            /* implementation specific. these build (but do not run) the same
+            queries used by the blocking calls above, so callers that want to
+            Enqueue() them with a completion callback don't need to duplicate
+            the logic. */
+            musik::core::ILibraryPtr GetLibrary() const noexcept {
+                return this->library;
+            }
+
+            std::shared_ptr<TrackListQueryBase> CreateTracksQuery(
+                const char* query, int limit, int offset);
+
+            std::shared_ptr<TrackListQueryBase> CreateTracksByCategoryQuery(
+                const char* categoryType,
+                int64_t selectedId,
+                const char* filter,
+                int limit,
+                int offset);
+
+            std::shared_ptr<TrackListQueryBase> CreateTracksByCategoriesQuery(
+                musik::core::sdk::IValue** categories,
+                size_t categoryCount,
+                const char* filter,
+                int limit,
+                int offset);
+
+            std::shared_ptr<CategoryListQuery> CreateCategoryQuery(
+                const char* type,
+                musik::core::sdk::IValue** predicates,
+                size_t predicateCount,
+                const char* filter);
+
+            std::shared_ptr<AlbumListQuery> CreateAlbumsQuery(
+                const char* categoryIdName,
+                int64_t categoryIdValue,
+                const char* filter);
+
         private:
             musik::core::ILibraryPtr library;
     };
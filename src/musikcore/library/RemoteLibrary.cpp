@@ -227,26 +227,26 @@ int RemoteLibrary::EnqueueAndWait(QueryPtr query, size_t timeoutMs, Callback cal
     return -1;
 }
 
-RemoteLibrary::QueryContextPtr RemoteLibrary::GetNextQuery() {
+RemoteLibrary::QueryList RemoteLibrary::GetNextQueries() {
+    /* drain everything that's queued up; screens tend to issue a handful
+    of queries at once, and sending them together lets the client batch
+    them into a single round trip. */
     std::unique_lock<std::recursive_mutex> lock(this->queueMutex);
     while (this->queryQueue.empty() && !this->exit) {
         this->queueCondition.wait(lock);
     }
-    if (this->exit) {
-        return QueryContextPtr();
-    }
-    else {
-        auto front = queryQueue.front();
-        queryQueue.pop_front();
-        return front;
+    QueryList result;
+    if (!this->exit) {
+        result.swap(this->queryQueue);
     }
+    return result;
 }
 
 void RemoteLibrary::ThreadProc() {
     while (!this->exit) {
-        auto query = GetNextQuery();
-        if (query) {
-            this->RunQuery(query);
+        auto queries = GetNextQueries();
+        if (!queries.empty()) {
+            this->RunQueries(queries);
         }
     }
 }
@@ -285,12 +285,14 @@ void RemoteLibrary::OnQueryCompleted(const std::string& messageId, Query query)
     this->syncQueryCondition.notify_all();
 }
 
-void RemoteLibrary::RunQuery(QueryContextPtr context) {
+void RemoteLibrary::RunQueries(QueryList& contexts) {
     std::unique_lock<std::recursive_mutex> lock(this->queueMutex);
 #if 0
-    this->RunQueryOnLoopback(context);
+    for (auto& context : contexts) {
+        this->RunQueryOnLoopback(context);
+    }
 #else
-    this->RunQueryOnWebSocketClient(context);
+    this->RunQueriesOnWebSocketClient(contexts);
 #endif
 }
 
@@ -325,11 +327,22 @@ void RemoteLibrary::RunQueryOnLoopback(QueryContextPtr context) {
     }
 }
 
-void RemoteLibrary::RunQueryOnWebSocketClient(QueryContextPtr context) {
-    if (context->query) {
-        const std::string messageId = wsc.EnqueueQuery(context->query);
-        if (!messageId.empty()) {
-            queriesInFlight[messageId] = context;
+void RemoteLibrary::RunQueriesOnWebSocketClient(QueryList& contexts) {
+    std::vector<QueryContextPtr> pending;
+    std::vector<Client::Query> queries;
+    for (auto& context : contexts) {
+        if (context->query) {
+            pending.push_back(context);
+            queries.push_back(context->query);
+        }
+    }
+
+    const auto messageIds = wsc.EnqueueQueries(queries);
+
+    for (size_t i = 0; i < pending.size(); i++) {
+        auto& context = pending[i];
+        if (!messageIds[i].empty()) {
+            queriesInFlight[messageIds[i]] = context;
         }
         else {
             context->query->Invalidate();
@@ -109,9 +109,9 @@ namespace musik { namespace core { namespace library {
             using QueryContextPtr = std::shared_ptr<QueryContext>;
             using QueryList = std::list<QueryContextPtr>;
 
-            void RunQuery(QueryContextPtr context);
+            void RunQueries(QueryList& contexts);
             void RunQueryOnLoopback(QueryContextPtr context);
-            void RunQueryOnWebSocketClient(QueryContextPtr context);
+            void RunQueriesOnWebSocketClient(QueryList& contexts);
 
             void OnQueryCompleted(const std::string& messageId, Query query);
             void OnQueryCompleted(QueryContextPtr context);
@@ -120,7 +120,7 @@ namespace musik { namespace core { namespace library {
             bool IsQueryInFlight(Query query);
 
             void ThreadProc();
-            QueryContextPtr GetNextQuery();
+            QueryList GetNextQueries();
 
             QueryList queryQueue;
 
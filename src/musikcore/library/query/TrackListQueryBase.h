@@ -39,6 +39,7 @@
 #include <musikcore/library/track/Track.h>
 #include <musikcore/library/track/TrackList.h>
 #include <musikcore/library/query/util/Serialization.h>
+#include <musikcore/library/query/util/SdkWrappers.h>
 
 #pragma warning(push, 0)
 #include <nlohmann/json.hpp>
@@ -71,7 +72,7 @@ namespace musik { namespace core { namespace library { namespace query {
             }
 
             virtual musik::core::sdk::ITrackList* GetSdkResult() {
-                return new WrappedTrackList(GetResult());
+                return new SdkTrackList(GetResult());
             }
 
         protected:
@@ -122,39 +123,6 @@ namespace musik { namespace core { namespace library { namespace query {
 
         private:
             int limit, offset;
-
-            class WrappedTrackList : public musik::core::sdk::ITrackList {
-                public:
-                    WrappedTrackList(Result wrapped) noexcept {
-                        this->wrapped = wrapped;
-                    }
-
-                    virtual ~WrappedTrackList() {
-                    }
-
-                    void Release() noexcept override {
-                        delete this;
-                    }
-
-                    size_t Count() const override {
-                        return this->wrapped->Count();
-                    }
-
-                    int64_t GetId(size_t index) const override {
-                        return this->wrapped->GetId(index);
-                    }
-
-                    int IndexOf(int64_t id) const override {
-                        return this->wrapped->IndexOf(id);
-                    }
-
-                    musik::core::sdk::ITrack* GetTrack(size_t index) const override  {
-                        return this->wrapped->GetTrack(index);
-                    }
-
-                private:
-                    Result wrapped;
-            };
     };
 
 } } } }
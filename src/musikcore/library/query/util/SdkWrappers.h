@@ -198,6 +198,10 @@ namespace musik { namespace core { namespace library { namespace query {
                 return this->wrapped->GetTrack(index);
             }
 
+            std::shared_ptr<musik::core::TrackList> Wrapped() const noexcept {
+                return this->wrapped;
+            }
+
         private:
             std::shared_ptr<musik::core::TrackList> wrapped;
     };
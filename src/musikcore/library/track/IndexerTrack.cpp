@@ -45,6 +45,7 @@
 #include <musikcore/io/DataStreamFactory.h>
 
 #include <unordered_map>
+#include <set>
 #include <chrono>
 
 using namespace musik::core;
@@ -62,9 +63,23 @@ using namespace std::chrono;
 #define ARTIST_TRACK_JUNCTION_TABLE_NAME "track_artists"
 #define ARTIST_TRACK_FOREIGN_KEY "artist_id"
 
+/* embedded artwork that has been read, but not yet checksummed and written
+to disk, is parked here (at most one per album) until the indexer's artwork
+stage. if we're holding more than this, we write synchronously instead. */
+#define MAX_PENDING_THUMBNAIL_BYTES (64 * 1024 * 1024)
+
+struct PendingThumbnail {
+    char* data;
+    int size;
+};
+
 std::mutex IndexerTrack::sharedWriteMutex;
 static std::unordered_map<std::string, int64_t> metadataIdCache;
 static std::unordered_map<int, int64_t> thumbnailIdCache; /* albumId:thumbnailId */
+static std::unordered_map<int, PendingThumbnail> pendingThumbnails; /* albumId:image */
+static std::set<int> extractedThumbnailAlbumIds; /* albums whose artwork was read this run */
+static std::set<int> updatedThumbnailAlbumIds;
+static size_t pendingThumbnailBytes = 0;
 
 /* http://stackoverflow.com/a/2351171 */
 static size_t hash32(const char* str) noexcept {
@@ -78,8 +93,115 @@ static size_t hash32(const char* str) noexcept {
     return h;
 }
 
-void IndexerTrack::OnIndexerStarted(db::Connection &dbConnection) {
-    /* unused, for now */
+static bool albumArtistFallbackDisabled() {
+    static bool disabled =
+        Preferences::ForComponent("settings")
+            ->GetBool(prefs::keys::DisableAlbumArtistFallback, false);
+
+    return disabled;
+}
+
+static int64_t saveThumbnail(
+    db::Connection& connection,
+    const std::string& libraryDirectory,
+    char* data,
+    int size)
+{
+    int64_t thumbnailId = 0;
+
+    const int64_t sum = Checksum(data, size);
+
+    db::Statement thumbs("SELECT id FROM thumbnails WHERE filesize=? AND checksum=?", connection);
+    thumbs.BindInt32(0, size);
+    thumbs.BindInt64(1, sum);
+
+    if (thumbs.Step() == db::Row) {
+        thumbnailId = thumbs.ColumnInt64(0); /* thumbnail already exists */
+    }
+
+    if (thumbnailId == 0) { /* doesn't exist yet, let's insert the record and write the file */
+        db::Statement insertThumb("INSERT INTO thumbnails (filesize,checksum) VALUES (?,?)", connection);
+        insertThumb.BindInt32(0, size);
+        insertThumb.BindInt64(1, sum);
+
+        if (insertThumb.Step() == db::Done) {
+            thumbnailId = connection.LastInsertedId();
+
+            std::string filename =
+                libraryDirectory +
+                "thumbs/" +
+                std::to_string(thumbnailId) +
+                ".jpg";
+
+#ifdef WIN32
+            std::wstring wfilename = u8to16(filename);
+            FILE *thumbFile = _wfopen(wfilename.c_str(), L"wb");
+#else
+            FILE *thumbFile = fopen(filename.c_str(), "wb");
+#endif
+            if (thumbFile) {
+                fwrite(data, sizeof(char), size, thumbFile);
+                fclose(thumbFile);
+            }
+        }
+    }
+
+    return thumbnailId;
+}
+
+static void setAlbumThumbnailId(db::Connection& connection, int albumId, int64_t thumbnailId) {
+    auto it = thumbnailIdCache.find(albumId);
+    if (it != thumbnailIdCache.end() && it->second == thumbnailId) {
+        return;
+    }
+
+    db::Statement updateStatement(
+        "UPDATE albums SET thumbnail_id=? WHERE id=?", connection);
+
+    updateStatement.BindInt64(0, thumbnailId);
+    updateStatement.BindInt64(1, (int64_t)(unsigned int) albumId);
+    updateStatement.Step();
+
+    thumbnailIdCache[albumId] = thumbnailId;
+    updatedThumbnailAlbumIds.insert(albumId);
+}
+
+void IndexerTrack::OnIndexerStarted(db::Connection &dbConnection, bool reuseAlbumThumbnails) {
+    std::unique_lock<std::mutex> lock(sharedWriteMutex);
+
+    /* remember existing album artwork so we only touch albums whose artwork
+    actually changes. this doesn't stop it from being extracted: a rescanned
+    file may carry new artwork. */
+    if (reuseAlbumThumbnails) {
+        db::Statement albums("SELECT id, thumbnail_id FROM albums WHERE thumbnail_id != 0", dbConnection);
+        while (albums.Step() == db::Row) {
+            thumbnailIdCache[(int) albums.ColumnInt64(0)] = albums.ColumnInt64(1);
+        }
+    }
+}
+
+void IndexerTrack::SavePendingThumbnails(db::Connection& dbConnection, const std::string& libraryDirectory) {
+    std::unordered_map<int, PendingThumbnail> pending;
+
+    {
+        std::unique_lock<std::mutex> lock(sharedWriteMutex);
+        std::swap(pending, pendingThumbnails);
+        pendingThumbnailBytes = 0;
+    }
+
+    db::ScopedTransaction transaction(dbConnection);
+
+    for (auto& it : pending) {
+        const int64_t thumbnailId = saveThumbnail(
+            dbConnection, libraryDirectory, it.second.data, it.second.size);
+
+        delete[] it.second.data;
+
+        if (thumbnailId != 0) {
+            std::unique_lock<std::mutex> lock(sharedWriteMutex);
+            setAlbumThumbnailId(dbConnection, it.first, thumbnailId);
+        }
+    }
 }
 
 void IndexerTrack::OnIndexerFinished(db::Connection &dbConnection) {
@@ -87,15 +209,26 @@ void IndexerTrack::OnIndexerFinished(db::Connection &dbConnection) {
 
     /* if we got some new album art, make sure all of the tracks for the
     album get the updated ID! */
-    std::string query = "UPDATE tracks SET thumbnail_id=? WHERE album_id=?)";
-    db::ScopedTransaction transaction(dbConnection);
-    for (auto it : thumbnailIdCache) {
-        db::Statement stmt(query.c_str(), dbConnection);
-        stmt.BindInt64(0, it.second);
-        stmt.BindInt64(1, it.first);
-        stmt.Step();
+    {
+        db::ScopedTransaction transaction(dbConnection);
+        db::Statement stmt("UPDATE tracks SET thumbnail_id=? WHERE album_id=?", dbConnection);
+        for (auto albumId : updatedThumbnailAlbumIds) {
+            stmt.Reset();
+            stmt.BindInt64(0, thumbnailIdCache[albumId]);
+            stmt.BindInt64(1, (int64_t)(unsigned int) albumId);
+            stmt.Step();
+        }
+    }
+
+    /* the run may have been aborted before the artwork stage */
+    for (auto& it : pendingThumbnails) {
+        delete[] it.second.data;
     }
 
+    pendingThumbnails.clear();
+    pendingThumbnailBytes = 0;
+    updatedThumbnailAlbumIds.clear();
+    extractedThumbnailAlbumIds.clear();
     thumbnailIdCache.clear();
 }
 
@@ -184,10 +317,19 @@ void IndexerTrack::SetThumbnail(const char *data, long size) {
     memcpy(this->internalMetadata->thumbnailData, data, size);
 }
 
+int IndexerTrack::GetAlbumKey() {
+    /* must match SaveAlbum(), which runs after Save() has applied the
+    album artist fallback; tag readers may ask before that. */
+    std::string albumArtist = this->GetString("album_artist");
+    if (albumArtist.empty() && !albumArtistFallbackDisabled()) {
+        albumArtist = this->GetString("artist");
+    }
+    const std::string key = this->GetString("album") + "-" + albumArtist;
+    return (int) hash32(key.c_str());
+}
+
 int64_t IndexerTrack::GetThumbnailId() {
-    std::string key = this->GetString("album") + "-" + this->GetString("album_artist");
-    const size_t id = hash32(key.c_str());
-    auto it = thumbnailIdCache.find((int) id);
+    auto it = thumbnailIdCache.find(this->GetAlbumKey());
     if (it != thumbnailIdCache.end()) {
         return it->second;
     }
@@ -201,7 +343,7 @@ bool IndexerTrack::ContainsThumbnail() {
         return true;
     }
     std::unique_lock<std::mutex> lock(sharedWriteMutex);
-    return this->GetThumbnailId() != 0;
+    return extractedThumbnailAlbumIds.find(this->GetAlbumKey()) != extractedThumbnailAlbumIds.end();
 }
 
 void IndexerTrack::SetReplayGain(const ReplayGain& replayGain) {
@@ -446,46 +588,33 @@ void IndexerTrack::SaveReplayGain(db::Connection& dbConnection)
 }
 
 int64_t IndexerTrack::SaveThumbnail(db::Connection& connection, const std::string& libraryDirectory) {
-    int64_t thumbnailId = 0;
-
-    if (this->internalMetadata->thumbnailData) {
-        const int64_t sum = Checksum(this->internalMetadata->thumbnailData, this->internalMetadata->thumbnailSize);
-
-        db::Statement thumbs("SELECT id FROM thumbnails WHERE filesize=? AND checksum=?", connection);
-        thumbs.BindInt32(0, this->internalMetadata->thumbnailSize);
-        thumbs.BindInt64(1, sum);
-
-        if (thumbs.Step() == db::Row) {
-            thumbnailId = thumbs.ColumnInt64(0); /* thumbnail already exists */
-        }
+    /* note: callers hold sharedWriteMutex */
+    auto& data = this->internalMetadata->thumbnailData;
+    const int size = this->internalMetadata->thumbnailSize;
 
-        if (thumbnailId == 0) { /* doesn't exist yet, let's insert the record and write the file */
-            db::Statement insertThumb("INSERT INTO thumbnails (filesize,checksum) VALUES (?,?)", connection);
-            insertThumb.BindInt32(0, this->internalMetadata->thumbnailSize);
-            insertThumb.BindInt64(1, sum);
+    if (!data || !size) {
+        return 0;
+    }
 
-            if (insertThumb.Step() == db::Done) {
-                thumbnailId = connection.LastInsertedId();
+    const int albumKey = this->GetAlbumKey();
 
-                std::string filename =
-                    libraryDirectory +
-                    "thumbs/" +
-                    std::to_string(thumbnailId) +
-                    ".jpg";
+    /* the first image we see for an album in this run wins; later ones only
+    get here if their tag reader didn't check ContainsThumbnail(). */
+    if (!extractedThumbnailAlbumIds.insert(albumKey).second) {
+        return 0;
+    }
 
-#ifdef WIN32
-                std::wstring wfilename = u8to16(filename);
-                FILE *thumbFile = _wfopen(wfilename.c_str(), L"wb");
-#else
-                FILE *thumbFile = fopen(filename.c_str(), "wb");
-#endif
-                fwrite(this->internalMetadata->thumbnailData, sizeof(char), this->internalMetadata->thumbnailSize, thumbFile);
-                fclose(thumbFile);
-            }
-        }
+    /* defer the checksum and file write to the artwork stage, handing over
+    the buffer instead of copying it. */
+    if (pendingThumbnailBytes + size <= MAX_PENDING_THUMBNAIL_BYTES) {
+        pendingThumbnails[albumKey] = { data, size };
+        pendingThumbnailBytes += size;
+        data = nullptr;
+        this->internalMetadata->thumbnailSize = 0;
+        return 0;
     }
 
-    return thumbnailId;
+    return saveThumbnail(connection, libraryDirectory, data, size);
 }
 
 void IndexerTrack::ProcessNonStandardMetadata(db::Connection& connection) {
@@ -640,14 +769,7 @@ int64_t IndexerTrack::SaveAlbum(db::Connection& dbConnection, int64_t thumbnailI
     }
 
     if (thumbnailId != 0) {
-        db::Statement updateStatement(
-            "UPDATE albums SET thumbnail_id=? WHERE id=?", dbConnection);
-
-        updateStatement.BindInt64(0, thumbnailId);
-        updateStatement.BindInt64(1, albumId);
-        updateStatement.Step();
-
-        thumbnailIdCache[(int) albumId] = thumbnailId;
+        setAlbumThumbnailId(dbConnection, (int) albumId, thumbnailId);
     }
 
     return albumId;
@@ -797,13 +919,9 @@ void IndexerTrack::SaveDirectory(db::Connection& db, const std::string& filename
 }
 
 bool IndexerTrack::Save(db::Connection &dbConnection, std::string libraryDirectory) {
-    static bool disableAlbumArtistFallback =
-        Preferences::ForComponent("settings")
-            ->GetBool(prefs::keys::DisableAlbumArtistFallback, false);
-
     std::unique_lock<std::mutex> lock(sharedWriteMutex);
 
-    if (!disableAlbumArtistFallback && this->GetString("album_artist") == "") {
+    if (!albumArtistFallbackDisabled() && this->GetString("album_artist") == "") {
         this->SetValue("album_artist", this->GetString("artist").c_str());
     }
 
@@ -827,8 +945,9 @@ bool IndexerTrack::Save(db::Connection &dbConnection, std::string libraryDirecto
         return false;
     }
 
-    /* see if the metadata reader plugin extracted a thumbnail. if not, we call
-    this->GetThumbnailId() to see if one already exists for the album */
+    /* see if the metadata reader plugin extracted a thumbnail. if not (or if
+    it was deferred to the artwork stage), we call this->GetThumbnailId() to
+    see if one already exists for the album */
     int64_t thumbnailId = this->SaveThumbnail(dbConnection, libraryDirectory);
     if (thumbnailId == 0) {
         thumbnailId = this->GetThumbnailId();
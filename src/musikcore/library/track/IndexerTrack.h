@@ -81,9 +81,15 @@ namespace musik { namespace core {
                 db::Connection &dbConnection,
                 std::string libraryDirectory);
 
-            static void OnIndexerStarted(db::Connection &dbConnection);
+            static void OnIndexerStarted(db::Connection &dbConnection, bool reuseAlbumThumbnails);
             static void OnIndexerFinished(db::Connection &dbConnection);
 
+            /* checksums and writes artwork that Save() deferred, and assigns
+            it to its album. call once no more tracks are being saved. */
+            static void SavePendingThumbnails(
+                db::Connection& dbConnection,
+                const std::string& libraryDirectory);
+
         protected:
             friend class Indexer;
             static std::mutex sharedWriteMutex;
@@ -111,6 +117,8 @@ namespace musik { namespace core {
 
             int64_t GetThumbnailId();
 
+            int GetAlbumKey();
+
             int64_t SaveGenre(db::Connection& connection);
 
             int64_t SaveArtist(db::Connection& connection);
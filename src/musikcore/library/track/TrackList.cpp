@@ -194,6 +194,55 @@ TrackPtr TrackList::GetWithTimeout(size_t index, size_t timeoutMs) const {
     return TrackPtr();
 }
 
+size_t TrackList::GetRange(size_t from, size_t count, std::vector<TrackPtr>& target) const {
+    target.clear();
+
+    if (from >= this->ids.size() || count == 0) {
+        return 0;
+    }
+
+    const size_t to = std::min(this->ids.size(), from + count);
+
+    /* resolve everything that isn't already cached with a single batch
+    query. results are intentionally not added to the lru cache; it's sized
+    for a scrolling window, and a large range would just evict all of it. */
+    std::unordered_set<int64_t> idsNotInCache;
+    for (size_t i = from; i < to; i++) {
+        const auto id = this->ids.at(i);
+        if (this->cacheMap.find(id) == this->cacheMap.end()) {
+            idsNotInCache.insert(id);
+        }
+    }
+
+    TrackMetadataBatchQuery::IdToTrackMap loaded;
+    if (idsNotInCache.size()) {
+        auto query = std::make_shared<TrackMetadataBatchQuery>(idsNotInCache, this->library);
+        this->library->EnqueueAndWait(query);
+        if (query->GetStatus() == IQuery::Finished) {
+            loaded = query->Result();
+        }
+    }
+
+    target.reserve(to - from);
+    for (size_t i = from; i < to; i++) {
+        const auto id = this->ids.at(i);
+        auto track = this->GetFromCache(id);
+        if (!track) {
+            auto it = loaded.find(id);
+            if (it != loaded.end()) {
+                track = it->second;
+            }
+            else {
+                track = std::make_shared<LibraryTrack>(id, this->library);
+                track->SetMetadataState(MetadataState::Missing);
+            }
+        }
+        target.push_back(track);
+    }
+
+    return target.size();
+}
+
 ITrack* TrackList::GetTrack(size_t index) const {
     return this->Get(index)->GetSdkValue();
 }
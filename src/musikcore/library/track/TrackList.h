@@ -79,6 +79,7 @@ namespace musik { namespace core {
             /* implementation specific */
             TrackPtr Get(size_t index, bool async = false) const;
             TrackPtr GetWithTimeout(size_t index, size_t timeoutMs) const;
+            size_t GetRange(size_t from, size_t count, std::vector<TrackPtr>& target) const;
             void ClearCache() noexcept;
             void Swap(TrackList& list) noexcept;
             void CopyFrom(const TrackList& from);
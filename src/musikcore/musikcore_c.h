@@ -169,6 +169,14 @@ typedef enum mcsdk_audio_player_release_mode {
     mcsdk_audio_player_release_mode_no_drain = 1
 } mcsdk_audio_player_release_mode;
 
+typedef enum mcsdk_svc_metadata_request_status {
+    mcsdk_svc_metadata_request_status_idle = 1,
+    mcsdk_svc_metadata_request_status_running = 2,
+    mcsdk_svc_metadata_request_status_failed = 3,
+    mcsdk_svc_metadata_request_status_finished = 4,
+    mcsdk_svc_metadata_request_status_canceled = 5
+} mcsdk_svc_metadata_request_status;
+
 typedef enum mcsdk_db_result {
     mcsdk_db_result_okay = 0,
     mcsdk_db_result_row = 100,
@@ -238,6 +246,7 @@ mcsdk_define_handle(mcsdk_map_list);
 mcsdk_define_handle(mcsdk_track_list);
 mcsdk_define_handle(mcsdk_track_list_editor);
 mcsdk_define_handle(mcsdk_svc_metadata);
+mcsdk_define_handle(mcsdk_svc_metadata_request);
 mcsdk_define_handle(mcsdk_svc_playback);
 mcsdk_define_handle(mcsdk_svc_indexer);
 mcsdk_define_handle(mcsdk_svc_library);
@@ -281,6 +290,8 @@ typedef struct mcsdk_audio_player_gain {
     float peakValid;
 } mcsdk_audio_player_gain;
 
+typedef void (*mcsdk_svc_metadata_request_callback)(mcsdk_svc_metadata_request r, void* user_context);
+
 typedef bool (*mcsdk_svc_library_run_query_callback)(mcsdk_svc_library l, mcsdk_db_connection db, void* user_context);
 
 typedef bool (*mcsdk_audio_buffer_provider_processed_callback)(mcsdk_audio_buffer buffer);
@@ -368,6 +379,10 @@ mcsdk_export size_t mcsdk_track_list_get_count(mcsdk_track_list tl);
 mcsdk_export int64_t mcsdk_track_list_get_id(mcsdk_track_list tl, size_t index);
 mcsdk_export int64_t mcsdk_track_list_index_of(mcsdk_track_list tl, int64_t id);
 mcsdk_export mcsdk_track mcsdk_track_list_get_track_at(mcsdk_track_list tl, size_t index);
+mcsdk_export size_t mcsdk_track_list_get_ids(mcsdk_track_list tl, size_t from, size_t count, int64_t* dst);
+mcsdk_export size_t mcsdk_track_list_get_tracks(mcsdk_track_list tl, size_t from, size_t count, mcsdk_track* dst);
+mcsdk_export size_t mcsdk_track_list_get_string_field(mcsdk_track_list tl, size_t from, size_t count, const char* key, char* dst, int stride);
+mcsdk_export size_t mcsdk_track_list_get_int64_field(mcsdk_track_list tl, size_t from, size_t count, const char* key, int64_t default_value, int64_t* dst);
 mcsdk_export void mcsdk_track_list_release(mcsdk_track_list tl);
 
 /*
@@ -418,6 +433,31 @@ mcsdk_export bool mcsdk_svc_metadata_append_to_playlist_with_track_list(mcsdk_sv
 mcsdk_export size_t mcsdk_svc_metadata_remove_tracks_from_playlist(mcsdk_svc_metadata mp, const int64_t playlist_id, const char** external_ids, const int* sort_orders, int count);
 mcsdk_export void mcsdk_svc_metadata_release(mcsdk_svc_metadata mp);
 
+/*
+ * IMetadataProxy (async). each call returns immediately; the callback is
+ * invoked at most once on the context's message queue thread when the
+ * request completes, fails, or is canceled. requests that are still pending
+ * when the context is released (mcsdk_context_release) or the environment
+ * is torn down (mcsdk_env_release) are discarded, and their callbacks will
+ * never be invoked. a null handle is returned if the request could not be
+ * scheduled, in which case the callback will not be invoked either. the
+ * caller owns the returned handle and must release it; doing so before
+ * completion is allowed and does not cancel the request.
+ */
+
+mcsdk_export mcsdk_svc_metadata_request mcsdk_svc_metadata_query_tracks_async(mcsdk_svc_metadata mp, const char* keyword, int limit, int offset, mcsdk_svc_metadata_request_callback cb, void* user_context);
+mcsdk_export mcsdk_svc_metadata_request mcsdk_svc_metadata_query_tracks_by_category_async(mcsdk_svc_metadata mp, const char* category_type, int64_t selected_id, const char* filter, int limit, int offset, mcsdk_svc_metadata_request_callback cb, void* user_context);
+mcsdk_export mcsdk_svc_metadata_request mcsdk_svc_metadata_query_tracks_by_categories_async(mcsdk_svc_metadata mp, mcsdk_value* categories, size_t category_count, const char* filter, int limit, int offset, mcsdk_svc_metadata_request_callback cb, void* user_context);
+mcsdk_export mcsdk_svc_metadata_request mcsdk_svc_metadata_query_category_async(mcsdk_svc_metadata mp, const char* type, const char* filter, mcsdk_svc_metadata_request_callback cb, void* user_context);
+mcsdk_export mcsdk_svc_metadata_request mcsdk_svc_metadata_query_category_with_predicates_async(mcsdk_svc_metadata mp, const char* type, mcsdk_value* predicates, size_t predicate_count, const char* filter, mcsdk_svc_metadata_request_callback cb, void* user_context);
+mcsdk_export mcsdk_svc_metadata_request mcsdk_svc_metadata_query_albums_by_category_async(mcsdk_svc_metadata mp, const char* category_id_name, int64_t category_id_value, const char* filter, mcsdk_svc_metadata_request_callback cb, void* user_context);
+mcsdk_export mcsdk_svc_metadata_request_status mcsdk_svc_metadata_request_get_status(mcsdk_svc_metadata_request r);
+mcsdk_export void mcsdk_svc_metadata_request_cancel(mcsdk_svc_metadata_request r);
+mcsdk_export mcsdk_track_list mcsdk_svc_metadata_request_get_track_list(mcsdk_svc_metadata_request r);
+mcsdk_export mcsdk_value_list mcsdk_svc_metadata_request_get_value_list(mcsdk_svc_metadata_request r);
+mcsdk_export mcsdk_map_list mcsdk_svc_metadata_request_get_map_list(mcsdk_svc_metadata_request r);
+mcsdk_export void mcsdk_svc_metadata_request_release(mcsdk_svc_metadata_request r);
+
 /*
  * IPlaybackService
  */
@@ -485,6 +525,7 @@ mcsdk_export long mcsdk_data_stream_get_length(mcsdk_data_stream ds);
 mcsdk_export const char* mcsdk_data_stream_get_type(mcsdk_data_stream ds);
 mcsdk_export const char* mcsdk_data_stream_get_uri(mcsdk_data_stream ds);
 mcsdk_export bool mcsdk_data_stream_can_prefetch(mcsdk_data_stream ds);
+mcsdk_export long mcsdk_data_stream_read_window(mcsdk_data_stream ds, const void** window, long max_count);
 mcsdk_export void mcsdk_data_stream_release(mcsdk_data_stream ds);
 
 /*
@@ -540,6 +581,8 @@ mcsdk_export const char* mcsdk_audio_output_get_name(mcsdk_audio_output o);
 mcsdk_export mcsdk_device_list mcsdk_audio_output_get_device_list(mcsdk_audio_output o);
 mcsdk_export bool mcsdk_audio_output_set_default_device(mcsdk_audio_output o, const char* device_id);
 mcsdk_export mcsdk_device mcsdk_audio_output_get_default_device(mcsdk_audio_output o);
+mcsdk_export size_t mcsdk_audio_output_get_underrun_count(mcsdk_audio_output o);
+mcsdk_export size_t mcsdk_audio_output_get_xrun_count(mcsdk_audio_output o);
 mcsdk_export void mcsdk_audio_output_release(mcsdk_audio_output o);
 
 /*
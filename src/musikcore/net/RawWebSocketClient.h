@@ -43,6 +43,7 @@
 #pragma warning(push, 0)
 #include <websocketpp/config/asio_no_tls_client.hpp>
 #include <websocketpp/config/asio_client.hpp>
+#include <websocketpp/extensions/permessage_deflate/enabled.hpp>
 #include <websocketpp/client.hpp>
 #pragma warning(pop)
 
@@ -53,11 +54,58 @@
 
 namespace musik { namespace core { namespace net {
 
+    /* client configs that offer permessage-deflate to the server during the
+    handshake. large query results compress very well. */
+    template <typename Base, typename Socket>
+    struct with_deflate : public Base {
+        typedef with_deflate type;
+        typedef Base base;
+
+        typedef typename base::concurrency_type concurrency_type;
+
+        typedef typename base::request_type request_type;
+        typedef typename base::response_type response_type;
+
+        typedef typename base::message_type message_type;
+        typedef typename base::con_msg_manager_type con_msg_manager_type;
+        typedef typename base::endpoint_msg_manager_type endpoint_msg_manager_type;
+
+        typedef typename base::alog_type alog_type;
+        typedef typename base::elog_type elog_type;
+
+        typedef typename base::rng_type rng_type;
+
+        struct transport_config : public base::transport_config {
+            typedef typename type::concurrency_type concurrency_type;
+            typedef typename type::alog_type alog_type;
+            typedef typename type::elog_type elog_type;
+            typedef typename type::request_type request_type;
+            typedef typename type::response_type response_type;
+            typedef Socket socket_type;
+        };
+
+        typedef websocketpp::transport::asio::endpoint<transport_config>
+            transport_type;
+
+        struct permessage_deflate_config {};
+
+        typedef websocketpp::extensions::permessage_deflate::enabled
+            <permessage_deflate_config> permessage_deflate_type;
+    };
+
+    using asio_client_with_deflate = with_deflate<
+        websocketpp::config::asio_client,
+        websocketpp::transport::asio::basic_socket::endpoint>;
+
+    using asio_tls_client_with_deflate = with_deflate<
+        websocketpp::config::asio_tls_client,
+        websocketpp::transport::asio::tls_socket::endpoint>;
+
     class RawWebSocketClient {
         public:
-            using PlainTextClient = websocketpp::client<websocketpp::config::asio_client>;
+            using PlainTextClient = websocketpp::client<asio_client_with_deflate>;
             using PlainTextClientPtr = std::unique_ptr<PlainTextClient>;
-            using TlsClient = websocketpp::client<websocketpp::config::asio_tls_client>;
+            using TlsClient = websocketpp::client<asio_tls_client_with_deflate>;
             using TlsClientPtr = std::unique_ptr<TlsClient>;
             using SslContext = std::shared_ptr<asio::ssl::context>;
             using Message = websocketpp::config::asio_client::message_type::ptr;
@@ -59,6 +59,10 @@ static const int kPingMessage = 6000;
 
 static const bool kDisableOfflineQueue = true;
 
+/* servers with this api version or newer understand "batch" requests */
+static const int kMinBatchApiVersion = 22;
+static const size_t kMaxBatchSize = 32;
+
 static std::atomic<int> nextMessageId(0);
 
 static inline std::string generateMessageId() {
@@ -89,17 +93,35 @@ static inline std::string createAuthenticateRequest(const std::string& password)
     return authRequestJson.dump();
 }
 
-static inline std::string createSendRawQueryRequest(const std::string& rawQuery, const std::string& messageId) {
-    nlohmann::json rawQueryJson = {
+static inline nlohmann::json createSendRawQueryRequestJson(const std::string& rawQuery, const std::string& messageId) {
+    return {
         { "name", "send_raw_query" },
         { "type" , "request" },
         { "id", messageId },
         { "device_id", "integrated-websocket-client" },
+        { "chunked", true },
         { "options", {
             { "raw_query_data", rawQuery }
         }}
     };
-    return rawQueryJson.dump();
+}
+
+static inline std::string createSendRawQueryRequest(const std::string& rawQuery, const std::string& messageId) {
+    return createSendRawQueryRequestJson(rawQuery, messageId).dump();
+}
+
+static inline std::string createBatchRequest(nlohmann::json&& requests, const std::string& messageId) {
+    nlohmann::json batchJson = {
+        { "name", "batch" },
+        { "type" , "request" },
+        { "id", messageId },
+        { "device_id", "integrated-websocket-client" },
+        { "chunked", true },
+        { "options", {
+            { "requests", std::move(requests) }
+        }}
+    };
+    return batchJson.dump();
 }
 
 static inline bool extractRawQueryResult(
@@ -112,6 +134,20 @@ static inline bool extractRawQueryResult(
     return true;
 }
 
+static inline bool parseResponseChunk(
+    const std::string& payload, std::string& id, bool& final, size_t& dataOffset)
+{
+    /* chunked responses are sent as binary frames: "<id>\n<0|1>\n<data>" */
+    const size_t idEnd = payload.find('\n');
+    if (idEnd == std::string::npos || idEnd + 2 >= payload.size() || payload[idEnd + 2] != '\n') {
+        return false;
+    }
+    id = payload.substr(0, idEnd);
+    final = payload[idEnd + 1] == '1';
+    dataOffset = idEnd + 3;
+    return true;
+}
+
 static inline bool isVersionCompatible(const std::string& str) {
     auto parts = str::Split(str, ".");
     return
@@ -140,8 +176,50 @@ WebSocketClient::WebSocketClient(IMessageQueue* messageQueue, Listener* listener
         this->SetDisconnected(ConnectionError::ConnectionFailed);
     });
 
-    rawClient->SetMessageHandler([this](Connection connection, ClientMessage message) {
-        nlohmann::json responseJson = nlohmann::json::parse(message->get_payload());
+    auto handleRawQueryResponse = [this](nlohmann::json& responseJson) {
+        auto messageId = responseJson["id"].get<std::string>();
+
+        Query query;
+        {
+            std::unique_lock<decltype(this->mutex)> lock(this->mutex);
+            auto it = this->messageIdToQuery.find(messageId);
+            if (it != this->messageIdToQuery.end()) {
+                query = it->second;
+                this->messageIdToQuery.erase(it);
+            }
+        }
+
+        /* the listener is notified without our lock held: RemoteLibrary
+        takes its queue lock before calling back into EnqueueQueries(). */
+        if (query) {
+            auto& options = responseJson["options"];
+            if (options.find("success") != options.end() && options["success"] == false) {
+                this->listener->OnClientQueryFailed(
+                    this, messageId, query, QueryError::QueryFailed);
+            }
+            else {
+                std::string rawResult;
+                if (extractRawQueryResult(responseJson, rawResult)) {
+                    if (query) {
+                        try {
+                            query->DeserializeResult(rawResult);
+                            this->listener->OnClientQuerySucceeded(this, messageId, query);
+                        }
+                        catch (...) {
+                            this->listener->OnClientQueryFailed(
+                                this, messageId, query, QueryError::ParseFailed);
+                        }
+                    }
+                    else {
+                        this->listener->OnClientQueryFailed(
+                            this, messageId, query, QueryError::QueryNotFound);
+                    }
+                }
+            }
+        }
+    };
+
+    auto handleResponse = [this, handleRawQueryResponse](Connection connection, nlohmann::json& responseJson) {
         auto name = responseJson["name"].get<std::string>();
         auto messageId = responseJson["id"].get<std::string>();
         if (name == "authenticate") {
@@ -151,7 +229,9 @@ WebSocketClient::WebSocketClient(IMessageQueue* messageQueue, Listener* listener
             auto const ignoreVersionMismatch = prefs->GetInt(
                 core::prefs::keys::RemoteLibraryIgnoreVersionMismatch, false);
 
-            this->serverVersion = responseJson["options"]["environment"]["app_version"].get<std::string>();
+            auto& environment = responseJson["options"]["environment"];
+            this->serverVersion = environment["app_version"].get<std::string>();
+            this->serverApiVersion = environment.value("api_version", 0);
             if (!ignoreVersionMismatch && !isVersionCompatible(this->serverVersion)) {
                 this->SetDisconnected(ConnectionError::IncompatibleVersion);
             }
@@ -160,35 +240,59 @@ WebSocketClient::WebSocketClient(IMessageQueue* messageQueue, Listener* listener
             }
         }
         else if (name == "send_raw_query") {
-            auto query = this->messageIdToQuery[messageId];
-            if (query) {
-                this->messageIdToQuery.erase(messageId);
-                auto& options = responseJson["options"];
-                if (options.find("success") != options.end() && options["success"] == false) {
-                    this->listener->OnClientQueryFailed(
-                        this, messageId, query, QueryError::QueryFailed);
+            handleRawQueryResponse(responseJson);
+        }
+        else if (name == "batch") {
+            auto& options = responseJson["options"];
+            auto responses = options.find("responses");
+            if (responses != options.end() && responses->is_array()) {
+                for (auto& response : *responses) {
+                    if (response.value("name", "") == "send_raw_query") {
+                        handleRawQueryResponse(response);
+                    }
                 }
-                else {
-                    std::string rawResult;
-                    if (extractRawQueryResult(responseJson, rawResult)) {
-                        if (query) {
-                            try {
-                                query->DeserializeResult(rawResult);
-                                this->listener->OnClientQuerySucceeded(this, messageId, query);
-                            }
-                            catch (...) {
-                                this->listener->OnClientQueryFailed(
-                                    this, messageId, query, QueryError::ParseFailed);
-                            }
-                        }
-                        else {
-                            this->listener->OnClientQueryFailed(
-                                this, messageId, query, QueryError::QueryNotFound);
-                        }
+            }
+            this->FailUnansweredQueries(messageId);
+        }
+    };
+
+    rawClient->SetMessageHandler([this, handleResponse](Connection connection, ClientMessage message) {
+        if (message->get_opcode() == websocketpp::frame::opcode::binary) {
+            /* large responses may arrive as a series of chunks; accumulate them
+            until the last one arrives, then handle it like any other. */
+            std::string id;
+            bool final = false;
+            size_t dataOffset = 0;
+            auto& payload = message->get_payload();
+            if (parseResponseChunk(payload, id, final, dataOffset)) {
+                /* SetState() clears partial responses from other threads */
+                std::string complete;
+                {
+                    std::unique_lock<decltype(this->mutex)> lock(this->mutex);
+                    auto& partial = this->partialResponses[id];
+                    partial.append(payload, dataOffset, std::string::npos);
+                    if (!final) {
+                        return;
                     }
+                    complete = std::move(partial);
+                    this->partialResponses.erase(id);
                 }
+                nlohmann::json responseJson = nlohmann::json::parse(complete);
+                handleResponse(connection, responseJson);
             }
         }
+        else {
+            nlohmann::json responseJson = nlohmann::json::parse(message->get_payload());
+            {
+                /* the server may have given up on a chunked response and sent
+                an error instead */
+                std::unique_lock<decltype(this->mutex)> lock(this->mutex);
+                if (!this->partialResponses.empty()) {
+                    this->partialResponses.erase(responseJson.value("id", ""));
+                }
+            }
+            handleResponse(connection, responseJson);
+        }
     });
 
     rawClient->SetCloseHandler([this](Connection connection) {
@@ -257,6 +361,85 @@ std::string WebSocketClient::EnqueueQuery(Query query) {
     return messageId;
 }
 
+std::vector<std::string> WebSocketClient::EnqueueQueries(const std::vector<Query>& queries) {
+    std::unique_lock<decltype(this->mutex)> lock(this->mutex);
+    std::vector<std::string> result;
+    std::vector<std::pair<std::string, Query>> toSend;
+    for (auto query : queries) {
+        if (!query) {
+            result.push_back("");
+        }
+        else if (kDisableOfflineQueue && this->state != State::Connected) {
+            query->Invalidate(); /* mark it as failed */
+            result.push_back("");
+        }
+        else {
+            auto messageId = generateMessageId();
+            messageIdToQuery[messageId] = query;
+            toSend.push_back({ messageId, query });
+            result.push_back(messageId);
+        }
+    }
+    if (this->state == State::Connected) {
+        this->SendQueries(toSend);
+    }
+    return result;
+}
+
+void WebSocketClient::SendQueries(const std::vector<std::pair<std::string, Query>>& queries) {
+    std::unique_lock<decltype(this->mutex)> lock(this->mutex);
+
+    if (queries.size() < 2 || this->serverApiVersion < kMinBatchApiVersion) {
+        for (auto& kv : queries) {
+            this->rawClient->Send(
+                this->connection,
+                createSendRawQueryRequest(kv.second->SerializeQuery(), kv.first));
+        }
+        return;
+    }
+
+    for (size_t offset = 0; offset < queries.size(); offset += kMaxBatchSize) {
+        const size_t end = std::min(queries.size(), offset + kMaxBatchSize);
+        const auto batchId = generateMessageId();
+        auto& messageIds = this->batchIdToMessageIds[batchId];
+        nlohmann::json requests = nlohmann::json::array();
+        for (size_t i = offset; i < end; i++) {
+            auto& kv = queries[i];
+            requests.push_back(createSendRawQueryRequestJson(kv.second->SerializeQuery(), kv.first));
+            messageIds.push_back(kv.first);
+        }
+        this->rawClient->Send(this->connection, createBatchRequest(std::move(requests), batchId));
+    }
+}
+
+void WebSocketClient::FailUnansweredQueries(const std::string& batchId) {
+    /* every request in a batch gets a response; if we didn't see one the
+    batch was rejected, so fail whatever is left instead of waiting on it
+    until we're disconnected. */
+    std::vector<std::pair<std::string, Query>> failed;
+
+    {
+        std::unique_lock<decltype(this->mutex)> lock(this->mutex);
+        auto it = this->batchIdToMessageIds.find(batchId);
+        if (it != this->batchIdToMessageIds.end()) {
+            for (auto& messageId : it->second) {
+                auto query = this->messageIdToQuery.find(messageId);
+                if (query != this->messageIdToQuery.end()) {
+                    failed.push_back({ messageId, query->second });
+                    this->messageIdToQuery.erase(query);
+                }
+            }
+            this->batchIdToMessageIds.erase(it);
+        }
+    }
+
+    /* notify outside of the lock, see handleRawQueryResponse above. */
+    for (auto& kv : failed) {
+        this->listener->OnClientQueryFailed(
+            this, kv.first, kv.second, QueryError::QueryFailed);
+    }
+}
+
 void WebSocketClient::Connect(
     const std::string& host,
     unsigned short port,
@@ -282,6 +465,7 @@ void WebSocketClient::Connect(
 void WebSocketClient::Reconnect() {
     std::unique_lock<decltype(this->mutex)> lock(this->mutex);
     this->serverVersion = "";
+    this->serverApiVersion = 0;
 
     this->Disconnect();
 
@@ -341,20 +525,19 @@ void WebSocketClient::InvalidatePendingQueries() {
     }
 
     this->messageIdToQuery.clear();
+    this->batchIdToMessageIds.clear();
 }
 
 void WebSocketClient::SendPendingQueries() {
     std::unique_lock<decltype(this->mutex)> lock(this->mutex);
 
+    std::vector<std::pair<std::string, Query>> pending;
     for (auto& kv : this->messageIdToQuery) {
-        auto messageId = kv.first;
-        auto query = kv.second;
-        if (query) {
-            this->rawClient->Send(
-                this->connection,
-                createSendRawQueryRequest(query->SerializeQuery(), messageId));
+        if (kv.second) {
+            pending.push_back({ kv.first, kv.second });
         }
     }
+    this->SendQueries(pending);
 }
 
 void WebSocketClient::SetState(State state) {
@@ -365,6 +548,7 @@ void WebSocketClient::SetState(State state) {
         switch (state) {
             case State::Disconnected:
                 this->connection.reset();
+                this->partialResponses.clear();
                 this->InvalidatePendingQueries();
                 break;
             case State::Connected:
@@ -40,6 +40,7 @@
 #include <musikcore/runtime/IMessageQueue.h>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 #include <atomic>
 #include <memory>
 
@@ -110,6 +111,11 @@ namespace musik { namespace core { namespace net {
 
             std::string EnqueueQuery(Query query);
 
+            /* enqueues multiple queries at once. if the server supports it, they
+            are sent in a single batch request, and answered in a single frame.
+            returns a message id for each input query; empty if it failed. */
+            std::vector<std::string> EnqueueQueries(const std::vector<Query>& queries);
+
             void SetMessageQueue(musik::core::runtime::IMessageQueue* messageQueue);
 
             /* IMessageTarget */
@@ -119,6 +125,8 @@ namespace musik { namespace core { namespace net {
             void SetState(State state);
             void InvalidatePendingQueries();
             void SendPendingQueries();
+            void SendQueries(const std::vector<std::pair<std::string, Query>>& queries);
+            void FailUnansweredQueries(const std::string& batchId);
             void SetDisconnected(ConnectionError errorCode);
 
             ClientPtr rawClient;
@@ -129,9 +137,12 @@ namespace musik { namespace core { namespace net {
             bool useTls{ false };
             std::string uri, password;
             std::unordered_map<std::string, Query> messageIdToQuery;
+            std::unordered_map<std::string, std::vector<std::string>> batchIdToMessageIds;
+            std::unordered_map<std::string, std::string> partialResponses;
             std::atomic<bool> quit{ false };
             ConnectionError connectionError{ ConnectionError::None };
             std::string serverVersion;
+            int serverApiVersion{ 0 };
             State state{ State::Disconnected };
             Listener* listener{ nullptr };
             musik::core::runtime::IMessageQueue* messageQueue;
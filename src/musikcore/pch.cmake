@@ -22,9 +22,11 @@ target_precompile_headers(musikcore
     "$<$<COMPILE_LANGUAGE:CXX>:audio/IStream.h>"
     "$<$<COMPILE_LANGUAGE:CXX>:audio/ITransport.h>"
     "$<$<COMPILE_LANGUAGE:CXX>:audio/MasterTransport.h>"
+    "$<$<COMPILE_LANGUAGE:CXX>:audio/Mixer.h>"
     "$<$<COMPILE_LANGUAGE:CXX>:audio/Outputs.h>"
     "$<$<COMPILE_LANGUAGE:CXX>:audio/PlaybackService.h>"
     "$<$<COMPILE_LANGUAGE:CXX>:audio/Player.h>"
+    "$<$<COMPILE_LANGUAGE:CXX>:audio/Resampler.h>"
     "$<$<COMPILE_LANGUAGE:CXX>:audio/Stream.h>"
     "$<$<COMPILE_LANGUAGE:CXX>:audio/Streams.h>"
     "$<$<COMPILE_LANGUAGE:CXX>:audio/Visualizer.h>"
@@ -35,6 +37,7 @@ target_precompile_headers(musikcore
     "$<$<COMPILE_LANGUAGE:CXX>:debug.h>"
     "$<$<COMPILE_LANGUAGE:CXX>:io/DataStreamFactory.h>"
     "$<$<COMPILE_LANGUAGE:CXX>:io/LocalFileStream.h>"
+    "$<$<COMPILE_LANGUAGE:CXX>:io/MappedFileStream.h>"
     "$<$<COMPILE_LANGUAGE:CXX>:library/IIndexer.h>"
     "$<$<COMPILE_LANGUAGE:CXX>:library/ILibrary.h>"
     "$<$<COMPILE_LANGUAGE:CXX>:library/Indexer.h>"
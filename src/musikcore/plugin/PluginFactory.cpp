@@ -86,6 +86,23 @@ PluginFactory::~PluginFactory() {
     plugins.clear();
 }
 
+void* PluginFactory::ResolveSymbol(Descriptor& descriptor, const std::string& name) {
+    /* note: callers hold this->mutex */
+    auto it = descriptor.symbols.find(name);
+    if (it != descriptor.symbols.end()) {
+        return it->second;
+    }
+
+#ifdef WIN32
+    void* symbol = (void*) GetProcAddress((HMODULE)(descriptor.nativeHandle), name.c_str());
+#else
+    void* symbol = dlsym(descriptor.nativeHandle, name.c_str());
+#endif
+
+    descriptor.symbols[name] = symbol;
+    return symbol;
+}
+
 void PluginFactory::LoadPlugins() {
 #ifdef WIN32
     {
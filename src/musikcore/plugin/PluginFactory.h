@@ -43,6 +43,7 @@
 #include <string>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 
 #ifdef WIN32
     #define STDCALL(fp) (__stdcall* fp)()
@@ -81,11 +82,8 @@ namespace musik { namespace core {
                 for (std::shared_ptr<Descriptor> descriptor : this->plugins) {
                     if (functionName == "GetPlugin" || prefs->GetBool(descriptor->key.c_str(), true)) { /* enabled */
                         PluginInterfaceCall funcPtr =
-#ifdef WIN32
-                            (PluginInterfaceCall) GetProcAddress((HMODULE)(descriptor->nativeHandle), functionName.c_str());
-#else
-                            (PluginInterfaceCall)dlsym(descriptor->nativeHandle, functionName.c_str());
-#endif
+                            (PluginInterfaceCall) this->ResolveSymbol(*descriptor, functionName);
+
                         if (funcPtr) {
                             T* result = funcPtr();
 
@@ -121,12 +119,8 @@ namespace musik { namespace core {
 
                 for (std::shared_ptr<Descriptor> descriptor : this->plugins) {
                     if (prefs->GetBool(descriptor->key.c_str(), true)) { /* if enabled by prefs */
-                        T funcPtr =
-#ifdef WIN32
-                            (T) GetProcAddress((HMODULE)(descriptor->nativeHandle), functionName.c_str());
-#else
-                            (T)dlsym(descriptor->nativeHandle, functionName.c_str());
-#endif
+                        T funcPtr = (T) this->ResolveSymbol(*descriptor, functionName);
+
                         if (funcPtr) {
                             handler(descriptor->plugin, funcPtr);
                         }
@@ -154,11 +148,15 @@ namespace musik { namespace core {
                 void* nativeHandle;
                 std::string filename;
                 std::string key;
+                /* exported symbols are looked up once per plugin, then cached
+                here; null entries mean "not exported". */
+                std::unordered_map<std::string, void*> symbols;
             };
 
             PluginFactory();
             ~PluginFactory();
             void LoadPlugins();
+            void* ResolveSymbol(Descriptor& descriptor, const std::string& name);
 
             std::vector<std::shared_ptr<Descriptor> > plugins;
             std::mutex mutex;
@@ -42,6 +42,10 @@ namespace musik { namespace core { namespace sdk {
         public:
             virtual void Release() = 0;
             virtual bool Process(IBuffer* buffer) = 0;
+            /* instances are pooled and reused across streams. Reset() is called
+            before an instance is handed to a new stream, and should discard
+            any audio history (delay lines, filter state) from the last one. */
+            virtual void Reset() = 0;
     };
 
 } } }
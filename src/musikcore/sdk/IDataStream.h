@@ -59,6 +59,13 @@ namespace musik { namespace core { namespace sdk {
             virtual const char* Type() = 0;
             virtual const char* Uri() = 0;
             virtual bool CanPrefetch() = 0;
+            /* zero-copy reads for streams that can expose their contents
+            directly, e.g. memory mapped files. on success `window` points at
+            up to `maxBytes` contiguous bytes at the current position, the
+            position is advanced past them, and the byte count is returned.
+            the window remains valid until the stream is closed. streams that
+            don't support this return -1; callers should fall back to Read(). */
+            virtual PositionType ReadWindow(const void** window, PositionType maxBytes) = 0;
     };
 
 } } }
\ No newline at end of file
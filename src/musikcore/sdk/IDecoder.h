@@ -48,6 +48,13 @@ namespace musik { namespace core { namespace sdk {
             virtual bool Open(IDataStream *stream) = 0;
             virtual bool Exhausted() = 0;
             virtual void SetPreferredSampleRate(int rate) = 0;
+            /* optional: decode directly into caller-owned memory, skipping the
+            intermediate IBuffer. writes at most `maxSamples` interleaved samples
+            in the format (rate, channels) of the last GetBuffer() call. returns
+            the number of samples written, or 0 once the stream is exhausted.
+            decoders that don't support this return -1, and the caller falls back
+            to GetBuffer(). */
+            virtual long DecodeInto(float* target, long maxSamples) = 0;
     };
 
 } } }
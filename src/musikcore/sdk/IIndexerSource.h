@@ -66,6 +66,22 @@ namespace musik { namespace core { namespace sdk {
             virtual bool HasStableIds() = 0;
 
             virtual int SourceId() = 0;
+
+            /* shared directory walk. sources that index files found under the
+            library paths can return a comma separated list of extensions
+            here (e.g. "nsf,spc"). the indexer will then call ScanFile() for
+            every matching file it finds during its own walk, possibly from
+            several threads at once, after OnBeforeScan() but before Scan();
+            such sources should not walk the paths again in Scan(). return
+            an empty string to do all of the work in Scan().
+
+            note writes made from ScanFile() are committed along with the
+            indexer's own, periodically during the walk, so returning
+            ScanRollback from Scan() only rolls back the writes Scan() made
+            itself. */
+            virtual const char* ScanFileExtensions() = 0;
+
+            virtual void ScanFile(IIndexerWriter* indexer, const char* path) = 0;
     };
 
     namespace indexer {
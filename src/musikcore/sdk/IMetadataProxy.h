@@ -148,6 +148,10 @@ namespace musik { namespace core { namespace sdk {
                 int* resultSize) = 0;
 
             virtual void Release() = 0;
+
+            /* sdk v27 */
+            virtual ITrackList* QueryTracksByIds(
+                const int64_t* trackIds, size_t trackIdCount) = 0;
     };
 
 } } }
@@ -59,6 +59,12 @@ namespace musik { namespace core { namespace sdk {
             virtual IDeviceList* GetDeviceList() = 0;
             virtual bool SetDefaultDevice(const char* deviceId) = 0;
             virtual IDevice* GetDefaultDevice() = 0;
+            /* the number of times the output ran out of samples to play while
+            it was playing (underruns), and the number of times the audio
+            server reported that it missed a deadline (xruns). outputs that
+            can't detect one or both should return zero. */
+            virtual size_t GetUnderrunCount() = 0;
+            virtual size_t GetXrunCount() = 0;
     };
 
 } } }
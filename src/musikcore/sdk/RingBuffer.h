@@ -0,0 +1,138 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2021 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <string.h>
+
+namespace musik { namespace core { namespace sdk {
+
+    /* a wait-free, single-producer, single-consumer ring of samples. it's
+    intended to be used as the handoff between the thread that calls
+    IOutput::Play() and an audio server's real-time callback: the producer
+    only calls Write() and Flush(), the consumer only calls Read(). neither
+    side ever blocks or allocates. */
+    template <typename T>
+    class RingBuffer {
+        public:
+            RingBuffer(size_t minimumCapacity) {
+                size_t capacity = 1;
+                while (capacity < minimumCapacity) {
+                    capacity <<= 1;
+                }
+                this->data.resize(capacity);
+                this->mask = capacity - 1;
+            }
+
+            RingBuffer(const RingBuffer&) = delete;
+            RingBuffer& operator=(const RingBuffer&) = delete;
+
+            size_t Capacity() const {
+                return this->data.size();
+            }
+
+            size_t Readable() const {
+                return
+                    this->writeIndex.load(std::memory_order_acquire) -
+                    this->readIndex.load(std::memory_order_acquire);
+            }
+
+            size_t Writable() const {
+                return this->Capacity() - this->Readable();
+            }
+
+            /* producer: copies up to `count` items into the ring and returns
+            the number of items actually written. */
+            size_t Write(const T* source, size_t count) {
+                const size_t write = this->writeIndex.load(std::memory_order_relaxed);
+                const size_t read = this->readIndex.load(std::memory_order_acquire);
+                const size_t available = this->Capacity() - (write - read);
+                if (count > available) {
+                    count = available;
+                }
+                const size_t offset = write & this->mask;
+                const size_t first = std::min(count, this->Capacity() - offset);
+                memcpy(&this->data[offset], source, first * sizeof(T));
+                memcpy(&this->data[0], source + first, (count - first) * sizeof(T));
+                this->writeIndex.store(write + count, std::memory_order_release);
+                return count;
+            }
+
+            /* consumer: copies up to `count` items out of the ring and returns
+            the number of items actually read. */
+            size_t Read(T* target, size_t count) {
+                size_t read = this->readIndex.load(std::memory_order_relaxed);
+                const size_t write = this->writeIndex.load(std::memory_order_acquire);
+
+                /* if the producer asked us to discard everything it had written
+                up to a certain point, skip ahead before reading */
+                const size_t flush = this->flushIndex.exchange(kNoFlush, std::memory_order_acquire);
+                if (flush != kNoFlush && flush - read <= write - read) {
+                    read = flush;
+                }
+
+                const size_t available = write - read;
+                if (count > available) {
+                    count = available;
+                }
+                const size_t offset = read & this->mask;
+                const size_t first = std::min(count, this->Capacity() - offset);
+                memcpy(target, &this->data[offset], first * sizeof(T));
+                memcpy(target + first, &this->data[0], (count - first) * sizeof(T));
+                this->readIndex.store(read + count, std::memory_order_release);
+                return count;
+            }
+
+            /* producer: asks the consumer to drop everything that has been
+            written so far. takes effect the next time Read() is called. */
+            void Flush() {
+                this->flushIndex.store(
+                    this->writeIndex.load(std::memory_order_relaxed),
+                    std::memory_order_release);
+            }
+
+        private:
+            static constexpr size_t kNoFlush = (size_t) -1;
+
+            std::vector<T> data;
+            size_t mask{ 0 };
+            std::atomic<size_t> readIndex{ 0 };
+            std::atomic<size_t> writeIndex{ 0 };
+            std::atomic<size_t> flushIndex{ kNoFlush };
+    };
+
+} } }
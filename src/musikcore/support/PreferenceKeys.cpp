@@ -84,6 +84,13 @@ namespace musik { namespace core { namespace prefs {
     const std::string keys::AsyncTrackListQueries = "AsyncTrackListQueries";
     const std::string keys::PiggyEnabled = "PiggyEnabled";
     const std::string keys::PiggyHostname = "PiggyHostname";
+    const std::string keys::VisualizerFftSize = "VisualizerFftSize";
+    const std::string keys::VisualizerBandLayout = "VisualizerBandLayout";
+    const std::string keys::VisualizerBandCount = "VisualizerBandCount";
+    const std::string keys::VisualizerFrameRate = "VisualizerFrameRate";
+    const std::string keys::MemoryMapLocalFiles = "MemoryMapLocalFiles";
+    const std::string keys::ResamplerSampleRate = "ResamplerSampleRate";
+    const std::string keys::ResamplerQuality = "ResamplerQuality";
 
 } } }
 
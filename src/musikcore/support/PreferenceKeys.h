@@ -88,6 +88,13 @@ namespace musik { namespace core { namespace prefs {
         extern const std::string AsyncTrackListQueries;
         extern const std::string PiggyEnabled;
         extern const std::string PiggyHostname;
+        extern const std::string VisualizerFftSize;
+        extern const std::string VisualizerBandLayout;
+        extern const std::string VisualizerBandCount;
+        extern const std::string VisualizerFrameRate;
+        extern const std::string MemoryMapLocalFiles;
+        extern const std::string ResamplerSampleRate;
+        extern const std::string ResamplerQuality;
     }
 
 } } }
@@ -0,0 +1,479 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <musikcore/debug.h>
+#include <musikcore/library/Indexer.h>
+#include <musikcore/library/LocalLibrary.h>
+#include <musikcore/library/LocalLibraryConstants.h>
+#include <musikcore/library/query/AlbumListQuery.h>
+#include <musikcore/library/query/CategoryListQuery.h>
+#include <musikcore/library/query/SearchTrackListQuery.h>
+#include <musikcore/library/query/TrackMetadataBatchQuery.h>
+#include <musikcore/library/track/TrackList.h>
+#include <musikcore/plugin/Plugins.h>
+#include <musikcore/support/Common.h>
+
+/* headless benchmark for the library: generates a synthetic corpus of tagged
+wav stubs, indexes it into an isolated library, then times a full scan, a
+no-op rescan, and the query families the clients lean on hardest. intended
+for comparing db and schema changes at 10k, 100k and 1M tracks. */
+
+using namespace musik::core;
+using namespace musik::core::library;
+using namespace musik::core::library::query;
+
+namespace fs = std::filesystem;
+
+using Clock = std::chrono::steady_clock;
+
+static const char* CORPUS_MARKER = "corpus.txt";
+
+static const std::vector<std::string> WORDS = {
+    "amber", "blue", "cold", "dark", "echo", "fire", "glass", "heart",
+    "iron", "jade", "kite", "light", "moon", "night", "ocean", "paper",
+    "quiet", "river", "silver", "tide", "under", "velvet", "winter", "yellow",
+    "zero", "atlas", "bloom", "cloud", "dream", "ember", "fable", "ghost"
+};
+
+struct CorpusOptions {
+    size_t tracks{ 10000 };
+    size_t tracksPerAlbum{ 10 };
+    size_t albumsPerArtist{ 5 };
+    size_t genres{ 25 };
+};
+
+struct Timing {
+    std::string name;
+    size_t rows{ 0 };
+    std::vector<double> ms;
+};
+
+static std::string word(size_t seed) {
+    /* cheap deterministic scramble so titles don't sort in generation order */
+    seed = (seed * 2654435761u) ^ (seed >> 7);
+    return WORDS[seed % WORDS.size()];
+}
+
+static void appendU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out += (char) ((value >> (i * 8)) & 0xff);
+    }
+}
+
+static void appendU16(std::string& out, uint16_t value) {
+    out += (char) (value & 0xff);
+    out += (char) ((value >> 8) & 0xff);
+}
+
+static void appendInfo(std::string& out, const char* id, const std::string& value) {
+    /* zero terminated, padded to an even length */
+    std::string data = value + '\0';
+    if (data.size() & 1) {
+        data += '\0';
+    }
+    out.append(id, 4);
+    appendU32(out, (uint32_t) data.size());
+    out += data;
+}
+
+static bool writeWave(
+    const fs::path& path,
+    const std::string& title,
+    const std::string& artist,
+    const std::string& album,
+    const std::string& genre,
+    size_t track,
+    size_t year)
+{
+    const uint16_t channels = 2, bitsPerSample = 16;
+    const uint32_t sampleRate = 44100, frames = 44; /* keep 1M track corpora small */
+    const uint16_t blockAlign = channels * bitsPerSample / 8;
+
+    std::string info = "INFO";
+    appendInfo(info, "INAM", title);
+    appendInfo(info, "IART", artist);
+    appendInfo(info, "IPRD", album);
+    appendInfo(info, "IGNR", genre);
+    appendInfo(info, "IPRT", std::to_string(track));
+    appendInfo(info, "ICRD", std::to_string(year));
+
+    std::string body = "WAVE";
+    body += "fmt ";
+    appendU32(body, 16);
+    appendU16(body, 1); /* pcm */
+    appendU16(body, channels);
+    appendU32(body, sampleRate);
+    appendU32(body, sampleRate * blockAlign);
+    appendU16(body, blockAlign);
+    appendU16(body, bitsPerSample);
+    body += "LIST";
+    appendU32(body, (uint32_t) info.size());
+    body += info;
+    body += "data";
+    appendU32(body, frames * blockAlign);
+    body.append(frames * blockAlign, '\0');
+
+    std::string riff = "RIFF";
+    appendU32(riff, (uint32_t) body.size());
+    riff += body;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(riff.data(), riff.size());
+    return out.good();
+}
+
+static std::string corpusKey(const CorpusOptions& options) {
+    return u8fmt("%zu %zu %zu %zu",
+        options.tracks, options.tracksPerAlbum, options.albumsPerArtist, options.genres);
+}
+
+static bool generateCorpus(const fs::path& root, const CorpusOptions& options) {
+    /* reuse a previously generated corpus if it has the same shape; writing
+    a million files takes a while. */
+    std::error_code ec;
+    const std::string key = corpusKey(options);
+    {
+        std::ifstream marker(root / CORPUS_MARKER);
+        std::string existing;
+        if (marker.good() && std::getline(marker, existing) && existing == key) {
+            return true;
+        }
+    }
+
+    /* only ever delete a directory we generated ourselves (i.e. one that has
+    our marker in it). anything else may be the user's music. */
+    if (fs::exists(root / CORPUS_MARKER, ec)) {
+        fs::remove_all(root, ec);
+    }
+    else if (fs::exists(root, ec) && !fs::is_empty(root, ec)) {
+        fprintf(stderr, "refusing to generate a corpus in non-empty directory %s\n",
+            root.u8string().c_str());
+        return false;
+    }
+
+    /* claim the directory before writing anything, so a partially generated
+    corpus can be cleaned up by the next run. */
+    fs::create_directories(root, ec);
+    {
+        std::ofstream marker(root / CORPUS_MARKER, std::ios::trunc);
+        if (!marker.good()) {
+            fprintf(stderr, "failed to create %s\n", root.u8string().c_str());
+            return false;
+        }
+    }
+
+    const size_t tracksPerArtist = options.tracksPerAlbum * options.albumsPerArtist;
+
+    for (size_t i = 0; i < options.tracks; i++) {
+        const size_t artistIndex = i / tracksPerArtist;
+        const size_t albumIndex = (i / options.tracksPerAlbum) % options.albumsPerArtist;
+        const size_t trackIndex = i % options.tracksPerAlbum;
+
+        const std::string artist = u8fmt("%s %s %zu",
+            word(artistIndex).c_str(), word(artistIndex + 1).c_str(), artistIndex);
+        const std::string album = u8fmt("%s of %s %zu",
+            word(i / options.tracksPerAlbum).c_str(), word(artistIndex + 3).c_str(), albumIndex);
+        const std::string title = u8fmt("%s %s %s",
+            word(i).c_str(), word(i + 5).c_str(), word(i + 11).c_str());
+        const std::string genre = u8fmt("genre %zu",
+            (artistIndex * 7) % std::max((size_t) 1, options.genres));
+
+        const fs::path dir = root /
+            u8fmt("%06zu", artistIndex) /
+            u8fmt("%02zu", albumIndex);
+
+        if (trackIndex == 0) {
+            fs::create_directories(dir, ec);
+        }
+
+        const fs::path file = dir / u8fmt("%02zu.wav", trackIndex + 1);
+        if (!writeWave(file, title, artist, album, genre, trackIndex + 1, 1970 + artistIndex % 50)) {
+            fprintf(stderr, "failed to write %s\n", file.u8string().c_str());
+            return false;
+        }
+    }
+
+    std::ofstream marker(root / CORPUS_MARKER, std::ios::trunc);
+    marker << key << "\n";
+    return marker.good();
+}
+
+class SyncWaiter : public sigslot::has_slots<> {
+    public:
+        SyncWaiter(IIndexer* indexer): indexer(indexer) {
+            indexer->Finished.connect(this, &SyncWaiter::OnFinished);
+        }
+
+        double Run(IIndexer::SyncType type) {
+            const auto start = Clock::now();
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->finished = false;
+            }
+            this->indexer->Schedule(type);
+            std::unique_lock<std::mutex> lock(this->mutex);
+            while (!this->finished) {
+                this->condition.wait(lock);
+            }
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        int Count() const {
+            return this->count;
+        }
+
+    private:
+        void OnFinished(int count) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->count = count;
+            this->finished = true;
+            this->condition.notify_all();
+        }
+
+        IIndexer* indexer;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool finished{ false };
+        int count{ 0 };
+};
+
+template <typename T>
+static Timing timeQuery(
+    ILibraryPtr library,
+    const std::string& name,
+    int iterations,
+    std::function<std::shared_ptr<T>()> create,
+    std::function<size_t(T&)> rows)
+{
+    Timing timing;
+    timing.name = name;
+    for (int i = 0; i < iterations; i++) {
+        auto query = create();
+        const auto start = Clock::now();
+        library->EnqueueAndWait(query, kWaitIndefinite);
+        timing.ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        if (query->GetStatus() == db::IQuery::Finished) {
+            timing.rows = rows(*query);
+        }
+    }
+    return timing;
+}
+
+static double median(std::vector<double> values) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+static void printHelp() {
+    printf(
+        "usage: musikcore_library_bench [options]\n\n"
+        "  --tracks <n>             number of tracks to generate (default 10000)\n"
+        "  --tracks-per-album <n>   (default 10)\n"
+        "  --albums-per-artist <n>  (default 5)\n"
+        "  --genres <n>             (default 25)\n"
+        "  --corpus <dir>           where to generate the corpus; must be empty or a\n"
+        "                           previously generated corpus, which is reused if\n"
+        "                           its shape matches (default: a temp directory)\n"
+        "  --library-id <n>         id of the scratch library; must not be a real\n"
+        "                           library (default 9001)\n"
+        "  --iterations <n>         runs per query (default 5)\n"
+        "  --batch <n>              track ids per metadata batch query (default 500)\n"
+        "  --json                   print results as json\n"
+        "  --verbose                log to the console\n");
+}
+
+int main(int argc, char* argv[]) {
+    CorpusOptions options;
+    bool json = false, verbose = false;
+    int libraryId = 9001, iterations = 5;
+    size_t batchSize = 500;
+    std::string corpus;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--json") { json = true; }
+        else if (arg == "--verbose") { verbose = true; }
+        else if (arg == "--tracks" && hasValue) { options.tracks = std::max(1, atoi(argv[++i])); }
+        else if (arg == "--tracks-per-album" && hasValue) { options.tracksPerAlbum = std::max(1, atoi(argv[++i])); }
+        else if (arg == "--albums-per-artist" && hasValue) { options.albumsPerArtist = std::max(1, atoi(argv[++i])); }
+        else if (arg == "--genres" && hasValue) { options.genres = std::max(1, atoi(argv[++i])); }
+        else if (arg == "--corpus" && hasValue) { corpus = argv[++i]; }
+        else if (arg == "--library-id" && hasValue) { libraryId = atoi(argv[++i]); }
+        else if (arg == "--iterations" && hasValue) { iterations = std::max(1, atoi(argv[++i])); }
+        else if (arg == "--batch" && hasValue) { batchSize = std::max(1, atoi(argv[++i])); }
+        else { printHelp(); return arg == "--help" || arg == "-h" ? 0 : 1; }
+    }
+
+    if (libraryId < 2) {
+        /* 0 and 1 are the default local and remote libraries */
+        fprintf(stderr, "refusing to use library id %d\n", libraryId);
+        return 1;
+    }
+
+    if (corpus.empty()) {
+        corpus = (fs::temp_directory_path() /
+            u8fmt("musikcore_library_bench_%zu", options.tracks)).u8string();
+    }
+
+    if (verbose) {
+        musik::debug::Start({ new musik::debug::ConsoleBackend() });
+    }
+
+    const fs::path corpusPath = fs::u8path(corpus);
+
+    auto start = Clock::now();
+    if (!generateCorpus(corpusPath, options)) {
+        return 1;
+    }
+    const double generateMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    /* start from an empty database every time, but don't touch a library
+    directory we didn't create */
+    std::error_code ec;
+    const fs::path libraryPath = fs::u8path(GetDataDirectory() + std::to_string(libraryId));
+    if (fs::exists(libraryPath / CORPUS_MARKER, ec)) {
+        fs::remove_all(libraryPath, ec);
+    }
+    else if (fs::exists(libraryPath, ec) && !fs::is_empty(libraryPath, ec)) {
+        fprintf(stderr, "library id %d is already in use, pick another with --library-id\n", libraryId);
+        return 1;
+    }
+
+    plugin::Init();
+
+    std::vector<Timing> results;
+    std::vector<std::pair<std::string, std::vector<Indexer::SyncTiming>>> syncs;
+    int indexed = 0;
+
+    {
+        ILibraryPtr library = LocalLibrary::Create("bench", libraryId, nullptr);
+        std::ofstream(libraryPath / CORPUS_MARKER) << "bench\n";
+        auto indexer = dynamic_cast<Indexer*>(library->Indexer());
+
+        SyncWaiter waiter(library->Indexer());
+        library->Indexer()->AddPath(corpusPath.u8string());
+
+        waiter.Run(IIndexer::SyncType::All);
+        indexed = waiter.Count();
+        syncs.push_back({ "full_scan", indexer->GetLastSyncTimings() });
+
+        waiter.Run(IIndexer::SyncType::All);
+        syncs.push_back({ "noop_rescan", indexer->GetLastSyncTimings() });
+
+        const std::string filter = WORDS[1];
+
+        results.push_back(timeQuery<SearchTrackListQuery>(library, "search_tracks_all", iterations,
+            [&]() { return std::make_shared<SearchTrackListQuery>(library, QueryBase::MatchType::Substring, "", TrackSortType::Album); },
+            [](SearchTrackListQuery& q) { return q.GetResult()->Count(); }));
+
+        results.push_back(timeQuery<SearchTrackListQuery>(library, "search_tracks_filtered", iterations,
+            [&]() { return std::make_shared<SearchTrackListQuery>(library, QueryBase::MatchType::Substring, filter, TrackSortType::Title); },
+            [](SearchTrackListQuery& q) { return q.GetResult()->Count(); }));
+
+        for (auto field : { constants::Track::ARTIST, constants::Track::ALBUM, constants::Track::GENRE }) {
+            results.push_back(timeQuery<CategoryListQuery>(library, std::string("category_") + field, iterations,
+                [&]() { return std::make_shared<CategoryListQuery>(QueryBase::MatchType::Substring, field); },
+                [](CategoryListQuery& q) { return q.GetResult()->Count(); }));
+        }
+
+        results.push_back(timeQuery<CategoryListQuery>(library, "category_artist_filtered", iterations,
+            [&]() { return std::make_shared<CategoryListQuery>(QueryBase::MatchType::Substring, constants::Track::ARTIST, filter); },
+            [](CategoryListQuery& q) { return q.GetResult()->Count(); }));
+
+        results.push_back(timeQuery<AlbumListQuery>(library, "albums_all", iterations,
+            [&]() { return std::make_shared<AlbumListQuery>(); },
+            [](AlbumListQuery& q) { return q.GetResult()->Count(); }));
+
+        results.push_back(timeQuery<AlbumListQuery>(library, "albums_filtered", iterations,
+            [&]() { return std::make_shared<AlbumListQuery>(filter); },
+            [](AlbumListQuery& q) { return q.GetResult()->Count(); }));
+
+        /* metadata batches are what the track list views page in */
+        std::unordered_set<int64_t> ids;
+        {
+            auto all = std::make_shared<SearchTrackListQuery>(
+                library, QueryBase::MatchType::Substring, "", TrackSortType::Album);
+            library->EnqueueAndWait(all, kWaitIndefinite);
+            if (all->GetStatus() == db::IQuery::Finished) {
+                auto tracks = all->GetResult();
+                const size_t stride = std::max((size_t) 1, tracks->Count() / batchSize);
+                for (size_t i = 0; i < tracks->Count() && ids.size() < batchSize; i += stride) {
+                    ids.insert(tracks->GetId(i));
+                }
+            }
+        }
+
+        results.push_back(timeQuery<TrackMetadataBatchQuery>(library, "track_metadata_batch", iterations,
+            [&]() { return std::make_shared<TrackMetadataBatchQuery>(ids, library); },
+            [](TrackMetadataBatchQuery& q) { return q.Result().size(); }));
+
+        library->Close();
+    }
+
+    plugin::Shutdown();
+
+    if (json) {
+        printf("{\n");
+        printf("  \"tracks\": %zu,\n  \"indexed\": %d,\n  \"generate_ms\": %.1f,\n",
+            options.tracks, indexed, generateMs);
+        printf("  \"syncs\": {\n");
+        for (size_t i = 0; i < syncs.size(); i++) {
+            printf("    \"%s\": {", syncs[i].first.c_str());
+            auto& phases = syncs[i].second;
+            for (size_t j = 0; j < phases.size(); j++) {
+                printf(" \"%s\": %.1f%s", phases[j].phase.c_str(),
+                    phases[j].milliseconds, j + 1 < phases.size() ? "," : " ");
+            }
+            printf("}%s\n", i + 1 < syncs.size() ? "," : "");
+        }
+        printf("  },\n  \"queries\": [\n");
+        for (size_t i = 0; i < results.size(); i++) {
+            auto& r = results[i];
+            printf(
+                "    { \"name\": \"%s\", \"rows\": %zu, \"median_ms\": %.2f, \"min_ms\": %.2f, \"max_ms\": %.2f }%s\n",
+                r.name.c_str(), r.rows, median(r.ms),
+                *std::min_element(r.ms.begin(), r.ms.end()),
+                *std::max_element(r.ms.begin(), r.ms.end()),
+                i + 1 < results.size() ? "," : "");
+        }
+        printf("  ]\n}\n");
+    }
+    else {
+        printf("tracks: %zu, indexed: %d, corpus generated in %.1fms\n\n",
+            options.tracks, indexed, generateMs);
+        for (auto& sync : syncs) {
+            printf("%s\n", sync.first.c_str());
+            for (auto& phase : sync.second) {
+                printf("  %-24s %12.1fms\n", phase.phase.c_str(), phase.milliseconds);
+            }
+        }
+        printf("\n%-28s %10s %12s %12s %12s\n", "query", "rows", "median ms", "min ms", "max ms");
+        for (auto& r : results) {
+            printf("%-28s %10zu %12.2f %12.2f %12.2f\n",
+                r.name.c_str(), r.rows, median(r.ms),
+                *std::min_element(r.ms.begin(), r.ms.end()),
+                *std::max_element(r.ms.begin(), r.ms.end()));
+        }
+    }
+
+    if (verbose) {
+        musik::debug::Shutdown();
+    }
+
+    return indexed > 0 ? 0 : 2;
+}
@@ -0,0 +1,554 @@
+#ifdef WIN32
+#include <Windows.h>
+#else
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <musikcore/audio/CrossfadeTransport.h>
+#include <musikcore/audio/Outputs.h>
+#include <musikcore/audio/Player.h>
+#include <musikcore/debug.h>
+#include <musikcore/plugin/PluginFactory.h>
+#include <musikcore/plugin/Plugins.h>
+#include <musikcore/support/PreferenceKeys.h>
+#include <musikcore/support/Preferences.h>
+#include <musikcore/sdk/IOutput.h>
+
+/* headless benchmark for the playback pipeline: drives Player (or
+CrossfadeTransport) over a corpus of local files using the null output in
+zero sleep mode, so buffers are consumed as fast as the decoder and dsps can
+produce them. reports throughput, per-buffer latency, allocations and cpu. */
+
+using namespace musik::core;
+using namespace musik::core::audio;
+using namespace musik::core::sdk;
+
+using Clock = std::chrono::steady_clock;
+
+static const std::string NULLOUT_PLUGIN_GUID = "0d45a986-24f1-4253-9fc2-b432353a1eea";
+static const std::string NULLOUT_OUTPUT_NAME = "Null";
+static const char* NULLOUT_ZERO_SLEEP = "zero_sleep";
+
+/* allocation counting. note on windows this only sees allocations made by
+this executable's crt, not those made by musikcore or the plugins. */
+
+static std::atomic<size_t> allocationCount{ 0 };
+
+static void* countedAlloc(size_t size) noexcept {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void* operator new(size_t size) {
+    void* p = countedAlloc(size);
+    if (!p) { throw std::bad_alloc(); }
+    return p;
+}
+
+void* operator new[](size_t size) {
+    void* p = countedAlloc(size);
+    if (!p) { throw std::bad_alloc(); }
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+
+static double processCpuSeconds() {
+#ifdef WIN32
+    FILETIME created, exited, kernel, user;
+    if (GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) {
+        auto toSeconds = [](const FILETIME& ft) {
+            ULARGE_INTEGER value;
+            value.LowPart = ft.dwLowDateTime;
+            value.HighPart = ft.dwHighDateTime;
+            return (double) value.QuadPart / 10000000.0;
+        };
+        return toSeconds(kernel) + toSeconds(user);
+    }
+    return 0.0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return
+        (double) usage.ru_utime.tv_sec + (double) usage.ru_utime.tv_usec / 1000000.0 +
+        (double) usage.ru_stime.tv_sec + (double) usage.ru_stime.tv_usec / 1000000.0;
+#endif
+}
+
+struct Stats {
+    std::string uri;
+    bool failed{ false };
+    size_t buffers{ 0 };
+    double audioSeconds{ 0.0 };
+    double wallSeconds{ 0.0 };
+    double cpuSeconds{ 0.0 };
+    size_t allocations{ 0 };
+    std::vector<double> latencyMicros; /* time between consecutive buffers */
+
+    void Add(const Stats& other) {
+        this->failed = this->failed || other.failed;
+        this->buffers += other.buffers;
+        this->audioSeconds += other.audioSeconds;
+        this->wallSeconds += other.wallSeconds;
+        this->cpuSeconds += other.cpuSeconds;
+        this->allocations += other.allocations;
+        this->latencyMicros.insert(
+            this->latencyMicros.end(),
+            other.latencyMicros.begin(),
+            other.latencyMicros.end());
+    }
+};
+
+/* wraps the real null output and records a timestamp every time the player
+hands it a buffer. since the device itself consumes buffers instantly, the
+gaps between calls are the time it took to decode and process each one. */
+class BenchOutput : public IOutput {
+    public:
+        BenchOutput(IOutput* device): device(device) {
+        }
+
+        void Bind(Stats* stats) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->stats = stats;
+            this->last = Clock::time_point();
+        }
+
+        OutputState Play(IBuffer* buffer, IBufferProvider* provider) override {
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                if (this->stats) {
+                    const auto now = Clock::now();
+                    if (this->last != Clock::time_point()) {
+                        this->stats->latencyMicros.push_back((double)
+                            std::chrono::duration_cast<std::chrono::microseconds>(now - this->last).count());
+                    }
+                    this->last = now;
+                    this->stats->buffers++;
+                    if (buffer->Channels() > 0 && buffer->SampleRate() > 0) {
+                        this->stats->audioSeconds +=
+                            (double) buffer->Samples() / buffer->Channels() / buffer->SampleRate();
+                    }
+                }
+            }
+            return this->device->Play(buffer, provider);
+        }
+
+        void Release() override { }
+        void Pause() override { this->device->Pause(); }
+        void Resume() override { this->device->Resume(); }
+        void SetVolume(double volume) override { this->device->SetVolume(volume); }
+        double GetVolume() override { return this->device->GetVolume(); }
+        void Stop() override { this->device->Stop(); }
+        void Drain() override { this->device->Drain(); }
+        double Latency() override { return this->device->Latency(); }
+        const char* Name() override { return this->device->Name(); }
+        int GetDefaultSampleRate() override { return this->device->GetDefaultSampleRate(); }
+        IDeviceList* GetDeviceList() override { return nullptr; }
+        bool SetDefaultDevice(const char* deviceId) override { return false; }
+        IDevice* GetDefaultDevice() override { return nullptr; }
+        size_t GetUnderrunCount() override { return 0; }
+        size_t GetXrunCount() override { return 0; }
+
+    private:
+        IOutput* device;
+        std::mutex mutex;
+        Stats* stats{ nullptr };
+        Clock::time_point last;
+};
+
+class PlayerWaiter : public Player::EventListener {
+    public:
+        void OnPlayerStarted(Player* player) override {
+            this->Signal([this] { this->started = true; });
+        }
+
+        void OnPlayerFinished(Player* player) override {
+            this->Signal([this] { this->finished = true; });
+        }
+
+        void OnPlayerOpenFailed(Player* player) override {
+            this->Signal([this] { this->failed = true; });
+        }
+
+        void OnPlayerDestroying(Player* player) override {
+            this->Signal([this] { this->destroyed = true; });
+        }
+
+        void WaitForEnd() {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->condition.wait(lock, [this] {
+                return this->finished || this->failed || this->destroyed; });
+        }
+
+        void WaitForDestroyed() {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->condition.wait(lock, [this] { return this->destroyed; });
+        }
+
+        bool Failed() {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            return this->failed || !this->started;
+        }
+
+    private:
+        template <typename T> void Signal(T update) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            update();
+            this->condition.notify_all();
+        }
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool started{ false }, finished{ false }, failed{ false }, destroyed{ false };
+};
+
+static Stats runPlayer(const std::string& uri, std::shared_ptr<BenchOutput> output) {
+    Stats stats;
+    stats.uri = uri;
+
+    PlayerWaiter waiter;
+    output->Bind(&stats);
+
+    const size_t allocations = allocationCount.load();
+    const double cpu = processCpuSeconds();
+    const auto start = Clock::now();
+
+    Player* player = Player::Create(uri, output, Player::DestroyMode::NoDrain, &waiter);
+    player->Play();
+    waiter.WaitForEnd();
+
+    stats.wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    stats.cpuSeconds = processCpuSeconds() - cpu;
+    stats.allocations = allocationCount.load() - allocations;
+    stats.failed = waiter.Failed();
+
+    /* the player deletes itself once it's done; make sure it's gone before
+    the waiter goes out of scope. */
+    waiter.WaitForDestroyed();
+    output->Bind(nullptr);
+
+    return stats;
+}
+
+/* plays the corpus back-to-back through the crossfading transport (and the
+in-process mixer). per-buffer latency isn't available here, since the mixer,
+not the player, feeds the device; audio duration comes from the per-file pass,
+so throughput ignores the overlap between tracks. */
+class CrossfadeRunner : public sigslot::has_slots<> {
+    public:
+        CrossfadeRunner(const std::vector<std::string>& files): files(files) {
+        }
+
+        Stats Run() {
+            Stats stats;
+            stats.uri = "<crossfade>";
+
+            CrossfadeTransport transport;
+            transport.StreamEvent.connect(this, &CrossfadeRunner::OnStreamEvent);
+            transport.PlaybackEvent.connect(this, &CrossfadeRunner::OnPlaybackEvent);
+
+            const size_t allocations = allocationCount.load();
+            const double cpu = processCpuSeconds();
+            const auto start = Clock::now();
+
+            transport.Start(this->files[0], ITransport::Gain(), ITransport::StartMode::Immediate);
+
+            /* transport events are raised on player threads, sometimes with
+            the transport's own lock held; queue the next track from here. */
+            while (true) {
+                std::string next;
+
+                {
+                    std::unique_lock<std::mutex> lock(this->mutex);
+                    this->condition.wait(lock, [this] {
+                        return this->stopped || this->next.size(); });
+
+                    if (this->stopped) {
+                        break;
+                    }
+
+                    std::swap(next, this->next);
+                }
+
+                transport.PrepareNextTrack(next, ITransport::Gain());
+            }
+
+            stats.wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+            stats.cpuSeconds = processCpuSeconds() - cpu;
+            stats.allocations = allocationCount.load() - allocations;
+            stats.failed = this->failed;
+
+            transport.StreamEvent.disconnect(this);
+            transport.PlaybackEvent.disconnect(this);
+            transport.Stop();
+
+            return stats;
+        }
+
+    private:
+        void OnStreamEvent(StreamState state, std::string uri) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            if (state == StreamState::Playing &&
+                this->current < this->files.size() &&
+                uri == this->files[this->current])
+            {
+                if (++this->current < this->files.size()) {
+                    this->next = this->files[this->current];
+                    this->condition.notify_all();
+                }
+            }
+            else if (state == StreamState::OpenFailed) {
+                this->failed = true;
+            }
+        }
+
+        void OnPlaybackEvent(PlaybackState state) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            if (state == PlaybackState::Stopped) {
+                this->stopped = true;
+                this->condition.notify_all();
+            }
+        }
+
+        std::vector<std::string> files;
+        std::string next;
+        size_t current{ 0 };
+        bool failed{ false }, stopped{ false };
+        std::mutex mutex;
+        std::condition_variable condition;
+};
+
+static double percentile(std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    const size_t index = std::min(sorted.size() - 1, (size_t) (p * (sorted.size() - 1) + 0.5));
+    return sorted[index];
+}
+
+static void printRow(Stats& stats, bool json, bool last) {
+    std::sort(stats.latencyMicros.begin(), stats.latencyMicros.end());
+
+    const double realtime = stats.wallSeconds > 0.0 ? stats.audioSeconds / stats.wallSeconds : 0.0;
+    const double allocationsPerBuffer = stats.buffers ? (double) stats.allocations / stats.buffers : 0.0;
+    const double cpuPercent = stats.audioSeconds > 0.0 ? 100.0 * stats.cpuSeconds / stats.audioSeconds : 0.0;
+    const double p50 = percentile(stats.latencyMicros, 0.50);
+    const double p90 = percentile(stats.latencyMicros, 0.90);
+    const double p99 = percentile(stats.latencyMicros, 0.99);
+    const double max = stats.latencyMicros.size() ? stats.latencyMicros.back() : 0.0;
+
+    if (json) {
+        std::string uri;
+        for (char c : stats.uri) {
+            if (c == '"' || c == '\\') {
+                uri += '\\';
+            }
+            uri += c;
+        }
+        printf(
+            "    { \"uri\": \"%s\", \"failed\": %s, \"buffers\": %zu, \"audio_seconds\": %.3f, "
+            "\"wall_seconds\": %.3f, \"cpu_seconds\": %.3f, \"realtime\": %.2f, "
+            "\"cpu_percent_of_realtime\": %.3f, \"allocations_per_buffer\": %.2f, "
+            "\"latency_us\": { \"p50\": %.0f, \"p90\": %.0f, \"p99\": %.0f, \"max\": %.0f } }%s\n",
+            uri.c_str(), stats.failed ? "true" : "false", stats.buffers, stats.audioSeconds,
+            stats.wallSeconds, stats.cpuSeconds, realtime, cpuPercent, allocationsPerBuffer,
+            p50, p90, p99, max, last ? "" : ",");
+    }
+    else {
+        printf(
+            "%-40.40s %8zu %9.1fx %7.3f%% %8.2f %8.0f %8.0f %8.0f %8.0f%s\n",
+            stats.uri.size() > 40 ? stats.uri.substr(stats.uri.size() - 40).c_str() : stats.uri.c_str(),
+            stats.buffers, realtime, cpuPercent, allocationsPerBuffer,
+            p50, p90, p99, max, stats.failed ? "  FAILED" : "");
+    }
+}
+
+static void printHelp() {
+    printf(
+        "usage: musikcore_bench [options] <file or directory> [...]\n\n"
+        "  --crossfade    also play the corpus through CrossfadeTransport\n"
+        "  --repeat <n>   play each file n times (default 1)\n"
+        "  --json         print results as json\n"
+        "  --verbose      log to the console\n\n"
+        "cpu is process cpu time as a percentage of the audio's duration;\n"
+        "latency is the time between consecutive buffers, in microseconds.\n");
+}
+
+static std::vector<std::string> collectFiles(const std::vector<std::string>& paths) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> result;
+    for (auto& path : paths) {
+        std::error_code ec;
+        if (fs::is_directory(fs::u8path(path), ec)) {
+            std::vector<std::string> files;
+            for (auto& entry : fs::recursive_directory_iterator(fs::u8path(path), ec)) {
+                if (entry.is_regular_file(ec)) {
+                    files.push_back(entry.path().u8string());
+                }
+            }
+            std::sort(files.begin(), files.end());
+            result.insert(result.end(), files.begin(), files.end());
+        }
+        else {
+            result.push_back(path);
+        }
+    }
+    return result;
+}
+
+/* the bench selects the null output and puts it in zero sleep mode. those
+settings are written to a throwaway data directory instead of the user's, so
+a crash or ctrl-c can't leave the real player configured to be silent. */
+class ScratchDataDirectory {
+    public:
+        ScratchDataDirectory() {
+            namespace fs = std::filesystem;
+            std::error_code ec;
+            const auto suffix = std::to_string(
+                std::chrono::system_clock::now().time_since_epoch().count());
+            this->path = fs::temp_directory_path(ec) / ("musikcore_bench_" + suffix);
+            if (!ec && fs::create_directories(this->path, ec)) {
+#ifdef WIN32
+                SetEnvironmentVariableW(L"APPDATA", this->path.wstring().c_str());
+#else
+                setenv("XDG_CONFIG_HOME", this->path.u8string().c_str(), 1);
+#endif
+                this->created = true;
+            }
+        }
+
+        ~ScratchDataDirectory() {
+            /* only ever the directory we just created above */
+            if (this->created) {
+                std::error_code ec;
+                std::filesystem::remove_all(this->path, ec);
+            }
+        }
+
+        bool Created() const noexcept { return this->created; }
+
+    private:
+        std::filesystem::path path;
+        bool created{ false };
+};
+
+int main(int argc, char* argv[]) {
+    bool crossfade = false, json = false, verbose = false;
+    int repeat = 1;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--crossfade") { crossfade = true; }
+        else if (arg == "--json") { json = true; }
+        else if (arg == "--verbose") { verbose = true; }
+        else if (arg == "--repeat" && i + 1 < argc) { repeat = std::max(1, atoi(argv[++i])); }
+        else if (arg == "--help" || arg == "-h") { printHelp(); return 0; }
+        else { paths.push_back(arg); }
+    }
+
+    const std::vector<std::string> files = collectFiles(paths);
+
+    if (files.empty()) {
+        printHelp();
+        return 1;
+    }
+
+    if (verbose) {
+        musik::debug::Start({ new musik::debug::ConsoleBackend() });
+    }
+
+    ScratchDataDirectory scratch;
+    if (!scratch.Created()) {
+        fprintf(stderr, "unable to create a temporary data directory\n");
+        return 1;
+    }
+
+    plugin::Init();
+
+    /* put the null output in zero sleep mode for the duration of the run */
+    auto nullout = PluginFactory::Instance().QueryGuid(NULLOUT_PLUGIN_GUID);
+    if (!nullout) {
+        fprintf(stderr, "the nullout plugin was not found\n");
+        return 1;
+    }
+
+    auto nulloutPrefs = Preferences::ForPlugin(nullout->Name());
+    nulloutPrefs->SetBool(NULLOUT_ZERO_SLEEP, true);
+
+    IOutput* device = outputs::GetUnmanagedOutput(NULLOUT_OUTPUT_NAME);
+    auto output = std::make_shared<BenchOutput>(device);
+
+    std::vector<Stats> results;
+    Stats total;
+    total.uri = "<total>";
+
+    for (int r = 0; r < repeat; r++) {
+        for (auto& file : files) {
+            results.push_back(runPlayer(file, output));
+            total.Add(results.back());
+        }
+    }
+
+    if (crossfade) {
+        /* CrossfadeTransport always plays through the selected output */
+        auto playbackPrefs = Preferences::ForComponent(prefs::components::Playback);
+        playbackPrefs->SetString(prefs::keys::OutputPlugin, NULLOUT_OUTPUT_NAME.c_str());
+
+        Stats stats = CrossfadeRunner(files).Run();
+        for (size_t i = 0; i < files.size(); i++) {
+            stats.audioSeconds += results[i].audioSeconds;
+            stats.buffers += results[i].buffers; /* approximate */
+        }
+        results.push_back(stats);
+    }
+
+    if (json) {
+        printf("{\n  \"results\": [\n");
+        for (auto& stats : results) {
+            printRow(stats, true, false);
+        }
+        printRow(total, true, true);
+        printf("  ]\n}\n");
+    }
+    else {
+        printf(
+            "%-40s %8s %10s %8s %8s %8s %8s %8s %8s\n",
+            "file", "buffers", "realtime", "cpu", "allocs", "p50us", "p90us", "p99us", "maxus");
+        for (auto& stats : results) {
+            printRow(stats, false, false);
+        }
+        printRow(total, false, true);
+    }
+
+    device->Release();
+
+    plugin::Shutdown();
+
+    if (verbose) {
+        musik::debug::Shutdown();
+    }
+
+    return total.failed ? 2 : 0;
+}
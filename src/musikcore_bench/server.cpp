@@ -0,0 +1,668 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef WIN32
+#include <dirent.h>
+#endif
+
+#include <musikcore/net/RawWebSocketClient.h>
+#include <musikcore/library/query/CategoryListQuery.h>
+#include <musikcore/library/LocalLibraryConstants.h>
+#include <musikcore/sdk/HttpClient.h>
+#include <musikcore/support/Common.h>
+
+#pragma warning(push, 0)
+#include <nlohmann/json.hpp>
+#pragma warning(pop)
+
+/* load generator for the server plugin: simulates a number of authenticated
+remotes issuing browse, query and play queue requests over the websocket
+api, alongside parallel /audio (optionally transcoded) and /thumbnail
+downloads over http. reports latency percentiles per request type,
+throughput, and the resident set size of the server process. */
+
+using namespace musik::core;
+using namespace musik::core::net;
+using namespace musik::core::library;
+using namespace musik::core::library::query;
+using json = nlohmann::json;
+
+using Clock = std::chrono::steady_clock;
+
+static const std::vector<std::string> FILTERS = {
+    "", "", "", "a", "e", "the", "blue", "love", "night", "mo"
+};
+
+struct Options {
+    std::string host{ "127.0.0.1" };
+    int wsPort{ 7905 };
+    int httpPort{ 7906 };
+    std::string password;
+    int remotes{ 8 };
+    int downloaders{ 4 };
+    int seconds{ 30 };
+    int thinkMs{ 0 };
+    double transcodeRatio{ 0.25 };
+    int bitrate{ 192 };
+    std::string format{ "mp3" };
+    int thumbnailSize{ 300 };
+    long pid{ 0 };
+    bool json{ false };
+};
+
+/* latency and byte counts, keyed by request type */
+class Recorder {
+    public:
+        void Record(const std::string& name, double ms, size_t bytes = 0) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            auto& entry = this->entries[name];
+            entry.ms.push_back(ms);
+            entry.bytes += bytes;
+        }
+
+        void Error(const std::string& name) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->entries[name].errors++;
+        }
+
+        struct Entry {
+            std::vector<double> ms;
+            size_t bytes{ 0 };
+            size_t errors{ 0 };
+        };
+
+        std::map<std::string, Entry> Snapshot() {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            return this->entries;
+        }
+
+    private:
+        std::mutex mutex;
+        std::map<std::string, Entry> entries;
+};
+
+/* tracks and thumbnails discovered by the remotes, consumed by the downloaders */
+class TrackPool {
+    public:
+        void Add(const std::string& externalId, int64_t thumbnailId) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            if (this->externalIds.size() < 10000 && externalId.size()) {
+                this->externalIds.push_back(externalId);
+            }
+            if (this->thumbnailIds.size() < 10000 && thumbnailId > 0) {
+                this->thumbnailIds.push_back(thumbnailId);
+            }
+        }
+
+        bool Next(std::mt19937& rng, std::string& externalId, int64_t& thumbnailId) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            if (this->externalIds.empty()) {
+                return false;
+            }
+            externalId = this->externalIds[rng() % this->externalIds.size()];
+            thumbnailId = this->thumbnailIds.empty()
+                ? 0 : this->thumbnailIds[rng() % this->thumbnailIds.size()];
+            return true;
+        }
+
+    private:
+        std::mutex mutex;
+        std::vector<std::string> externalIds;
+        std::vector<int64_t> thumbnailIds;
+};
+
+static std::atomic<bool> running{ true };
+
+class Remote {
+    public:
+        using Connection = RawWebSocketClient::Connection;
+        using Message = RawWebSocketClient::Message;
+
+        Remote(int index, const Options& options, Recorder& recorder, TrackPool& pool)
+        : index(index)
+        , options(options)
+        , recorder(recorder)
+        , pool(pool)
+        , rng(index * 7919 + 1) {
+            this->client = std::make_unique<RawWebSocketClient>(this->io);
+            this->client->SetMode(RawWebSocketClient::Mode::PlainText);
+
+            this->client->SetOpenHandler([this](Connection connection) {
+                this->connection = connection;
+                this->Send("authenticate", {
+                    { "password", this->options.password }
+                });
+            });
+
+            this->client->SetFailHandler([this](Connection connection) {
+                this->recorder.Error("connect");
+            });
+
+            this->client->SetCloseHandler([this](Connection connection) {
+                if (running) {
+                    this->recorder.Error("closed_by_server");
+                }
+            });
+
+            this->client->SetMessageHandler([this](Connection connection, Message message) {
+                this->OnMessage(message->get_payload());
+            });
+        }
+
+        ~Remote() {
+            this->Stop();
+            /* must be destroyed before the io_service */
+            this->client.reset();
+        }
+
+        void Start() {
+            this->client->Connect(u8fmt("ws://%s:%d",
+                this->options.host.c_str(), this->options.wsPort));
+            this->thread = std::make_unique<std::thread>([this]() {
+                this->client->Run();
+            });
+        }
+
+        void Stop() {
+            if (this->thread) {
+                this->io.stop();
+                this->thread->join();
+                this->thread.reset();
+            }
+        }
+
+    private:
+        void Send(const std::string& name, json&& options) {
+            const std::string id = u8fmt("bench-%d-%zu", this->index, this->nextId++);
+            json request = {
+                { "name", name },
+                { "type", "request" },
+                { "id", id },
+                { "device_id", u8fmt("musikcore-server-bench-%d", this->index) },
+                { "options", std::move(options) }
+            };
+            this->pendingName = name;
+            this->pendingId = id;
+            this->pendingStart = Clock::now();
+            this->client->Send(this->connection, request.dump());
+        }
+
+        void OnMessage(const std::string& payload) {
+            json response;
+            try {
+                response = json::parse(payload);
+            }
+            catch (...) {
+                this->recorder.Error(this->pendingName);
+                return;
+            }
+
+            /* invalid requests are answered with an id of "invalid" */
+            const std::string id = response.value("id", "");
+            const bool matches = id == this->pendingId ||
+                (id == "invalid" && response.value("name", "") == this->pendingName);
+
+            if (response.value("type", "") != "response" || !matches) {
+                return; /* broadcasts */
+            }
+
+            const double ms = std::chrono::duration<double, std::milli>(
+                Clock::now() - this->pendingStart).count();
+
+            auto& options = response["options"];
+            const bool failed =
+                (options.is_object() && options.find("error") != options.end()) ||
+                (options.is_object() && options.value("success", true) == false) ||
+                (this->pendingName == "authenticate" && !options.value("authenticated", false));
+
+            if (failed) {
+                this->recorder.Error(this->pendingName);
+            }
+            else {
+                this->recorder.Record(this->pendingName, ms, payload.size());
+                this->Harvest(options);
+            }
+
+            if (this->pendingName == "authenticate" && failed) {
+                return; /* the server will close the connection */
+            }
+
+            if (this->options.thinkMs > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(this->options.thinkMs));
+            }
+
+            if (running) {
+                this->SendNext();
+            }
+        }
+
+        void Harvest(json& options) {
+            if (!options.is_object()) {
+                return;
+            }
+            auto data = options.find("data");
+            if (data == options.end() || !data->is_array()) {
+                return;
+            }
+            const bool albums = options.value("category", "") == constants::Track::ALBUM;
+            for (auto& item : *data) {
+                if (!item.is_object()) {
+                    continue;
+                }
+                if (albums) {
+                    if (this->albumIds.size() < 1000) {
+                        this->albumIds.push_back(item.value<int64_t>("id", 0));
+                    }
+                }
+                else if (item.find("external_id") != item.end()) {
+                    this->pool.Add(
+                        item.value("external_id", ""),
+                        item.value<int64_t>("thumbnail_id", 0));
+                }
+            }
+            if (this->pendingName == "query_tracks") {
+                this->trackCount = options.value<int64_t>("count", this->trackCount);
+            }
+        }
+
+        void SendNext() {
+            const std::string& filter = FILTERS[this->rng() % FILTERS.size()];
+            const int limit = 50;
+            const int64_t offset = this->trackCount > limit
+                ? (int64_t) (this->rng() % (this->trackCount - limit)) : 0;
+
+            switch (this->step++ % 8) {
+                case 0:
+                    this->Send("query_category", { { "category", "artist" }, { "filter", filter } });
+                    break;
+                case 1:
+                    this->Send("query_albums", { { "filter", filter } });
+                    break;
+                case 2:
+                    this->Send("query_tracks", { { "filter", filter }, { "limit", limit }, { "offset", offset } });
+                    break;
+                case 3:
+                    if (this->albumIds.size()) {
+                        this->Send("query_tracks_by_category", {
+                            { "category", "album" },
+                            { "id", this->albumIds[this->rng() % this->albumIds.size()] },
+                            { "limit", limit },
+                            { "offset", 0 }
+                        });
+                    }
+                    else {
+                        this->Send("query_category", { { "category", "genre" } });
+                    }
+                    break;
+                case 4:
+                    this->Send("query_play_queue_tracks", { { "limit", limit }, { "offset", 0 } });
+                    break;
+                case 5:
+                    this->Send("get_playback_overview", json::object());
+                    break;
+                case 6: {
+                    /* what the integrated remote library client sends */
+                    CategoryListQuery query(
+                        QueryBase::MatchType::Substring, constants::Track::ALBUM, filter);
+                    this->Send("send_raw_query", { { "raw_query_data", query.SerializeQuery() } });
+                    break;
+                }
+                default:
+                    this->Send("query_play_queue_tracks", { { "count_only", true } });
+                    break;
+            }
+        }
+
+        int index;
+        const Options& options;
+        Recorder& recorder;
+        TrackPool& pool;
+        std::mt19937 rng;
+        asio::io_service io;
+        std::unique_ptr<RawWebSocketClient> client;
+        std::unique_ptr<std::thread> thread;
+        Connection connection;
+        size_t nextId{ 0 };
+        size_t step{ 0 };
+        int64_t trackCount{ 0 };
+        std::vector<int64_t> albumIds;
+        std::string pendingName, pendingId;
+        Clock::time_point pendingStart;
+};
+
+/* HttpClient output stream that just counts bytes and notes the first one */
+struct CountingStream {
+    size_t bytes{ 0 };
+    Clock::time_point firstByte;
+
+    void write(const char* data, size_t size) {
+        if (!this->bytes && size) {
+            this->firstByte = Clock::now();
+        }
+        this->bytes += size;
+    }
+};
+
+using BenchHttpClient = musik::core::sdk::HttpClient<CountingStream>;
+
+class Downloader {
+    public:
+        Downloader(int index, const Options& options, Recorder& recorder, TrackPool& pool)
+        : index(index)
+        , options(options)
+        , recorder(recorder)
+        , pool(pool)
+        , rng(index * 104729 + 3) {
+        }
+
+        ~Downloader() {
+            this->Stop();
+        }
+
+        void Start() {
+            this->thread = std::make_unique<std::thread>([this]() { this->ThreadProc(); });
+        }
+
+        void Stop() {
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                if (this->active) {
+                    this->active->Cancel();
+                }
+            }
+            if (this->thread) {
+                this->thread->join();
+                this->thread.reset();
+            }
+        }
+
+    private:
+        void ThreadProc() {
+            const std::string base = u8fmt("http://%s:%d", options.host.c_str(), options.httpPort);
+            std::uniform_real_distribution<double> coin(0.0, 1.0);
+
+            while (running) {
+                std::string externalId;
+                int64_t thumbnailId = 0;
+                if (!this->pool.Next(this->rng, externalId, thumbnailId)) {
+                    /* wait for the remotes to discover some tracks */
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                    continue;
+                }
+
+                std::string escaped = externalId;
+                if (CURL* curl = curl_easy_init()) {
+                    char* encoded = curl_easy_escape(curl, externalId.c_str(), (int) externalId.size());
+                    if (encoded) {
+                        escaped = encoded;
+                        curl_free(encoded);
+                    }
+                    curl_easy_cleanup(curl);
+                }
+
+                if (coin(this->rng) < this->options.transcodeRatio) {
+                    this->Fetch("audio_transcoded", u8fmt("%s/audio/external_id/%s?bitrate=%d&format=%s",
+                        base.c_str(), escaped.c_str(), this->options.bitrate, this->options.format.c_str()));
+                }
+                else {
+                    this->Fetch("audio", u8fmt("%s/audio/external_id/%s", base.c_str(), escaped.c_str()));
+                }
+
+                if (thumbnailId > 0 && running) {
+                    this->Fetch("thumbnail", u8fmt("%s/thumbnail/%lld?size=%d",
+                        base.c_str(), (long long) thumbnailId, this->options.thumbnailSize));
+                }
+            }
+        }
+
+        void Fetch(const std::string& name, const std::string& url) {
+            auto client = BenchHttpClient::Create(CountingStream());
+            client->Url(url)
+                .Mode(BenchHttpClient::Thread::Current)
+                .Decorator([this](CURL* curl) {
+                    curl_easy_setopt(curl, CURLOPT_USERNAME, "default");
+                    curl_easy_setopt(curl, CURLOPT_PASSWORD, this->options.password.c_str());
+                });
+
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->active = client;
+            }
+
+            const auto start = Clock::now();
+            int status = 0;
+            CURLcode code = CURLE_OK;
+            client->Run([&status, &code](BenchHttpClient* caller, int httpStatus, CURLcode curlCode) {
+                status = httpStatus;
+                code = curlCode;
+            });
+
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->active.reset();
+            }
+
+            const auto& stream = client->Stream();
+            if (code == CURLE_OK && status == 200 && stream.bytes) {
+                /* time to first byte; the total is implied by throughput */
+                this->recorder.Record(name, std::chrono::duration<double, std::milli>(
+                    stream.firstByte - start).count(), stream.bytes);
+            }
+            else if (running) {
+                this->recorder.Error(name);
+            }
+        }
+
+        int index;
+        const Options& options;
+        Recorder& recorder;
+        TrackPool& pool;
+        std::mt19937 rng;
+        std::mutex mutex;
+        std::shared_ptr<BenchHttpClient> active;
+        std::unique_ptr<std::thread> thread;
+};
+
+#ifndef WIN32
+static long findServerPid() {
+    long result = 0;
+    if (DIR* proc = opendir("/proc")) {
+        while (dirent* entry = readdir(proc)) {
+            const long pid = atol(entry->d_name);
+            if (pid > 0) {
+                std::ifstream comm(std::string("/proc/") + entry->d_name + "/comm");
+                std::string name;
+                if (std::getline(comm, name) && name == "musikcubed") {
+                    result = pid;
+                    break;
+                }
+            }
+        }
+        closedir(proc);
+    }
+    return result;
+}
+
+static size_t residentKb(long pid) {
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.find("VmRSS:") == 0) {
+            return (size_t) atol(line.c_str() + 6);
+        }
+    }
+    return 0;
+}
+#else
+static long findServerPid() { return 0; }
+static size_t residentKb(long pid) { return 0; }
+#endif
+
+static double percentile(std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    const size_t index = std::min(sorted.size() - 1, (size_t) (p * (sorted.size() - 1) + 0.5));
+    return sorted[index];
+}
+
+static void printHelp() {
+    printf(
+        "usage: musikcore_server_bench [options]\n\n"
+        "  --host <host>            server host (default 127.0.0.1)\n"
+        "  --ws-port <port>         websocket port (default 7905)\n"
+        "  --http-port <port>       http port (default 7906)\n"
+        "  --password <password>    server password\n"
+        "  --remotes <n>            simulated websocket remotes (default 8)\n"
+        "  --downloads <n>          parallel http downloaders (default 4)\n"
+        "  --seconds <n>            duration of the run (default 30)\n"
+        "  --think <ms>             delay between a remote's requests (default 0)\n"
+        "  --transcode <ratio>      fraction of audio downloads to transcode (default 0.25)\n"
+        "  --bitrate <kbps>         transcoder bitrate (default 192)\n"
+        "  --format <format>        transcoder format (default mp3)\n"
+        "  --pid <pid>              server pid for rss sampling (default: find musikcubed)\n"
+        "  --json                   print results as json\n\n"
+        "websocket latency is request to response; http latency is time to first\n"
+        "byte. throughput is payload bytes per second over the whole run.\n");
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--json") { options.json = true; }
+        else if (arg == "--host" && hasValue) { options.host = argv[++i]; }
+        else if (arg == "--ws-port" && hasValue) { options.wsPort = atoi(argv[++i]); }
+        else if (arg == "--http-port" && hasValue) { options.httpPort = atoi(argv[++i]); }
+        else if (arg == "--password" && hasValue) { options.password = argv[++i]; }
+        else if (arg == "--remotes" && hasValue) { options.remotes = std::max(0, atoi(argv[++i])); }
+        else if (arg == "--downloads" && hasValue) { options.downloaders = std::max(0, atoi(argv[++i])); }
+        else if (arg == "--seconds" && hasValue) { options.seconds = std::max(1, atoi(argv[++i])); }
+        else if (arg == "--think" && hasValue) { options.thinkMs = std::max(0, atoi(argv[++i])); }
+        else if (arg == "--transcode" && hasValue) { options.transcodeRatio = atof(argv[++i]); }
+        else if (arg == "--bitrate" && hasValue) { options.bitrate = atoi(argv[++i]); }
+        else if (arg == "--format" && hasValue) { options.format = argv[++i]; }
+        else if (arg == "--pid" && hasValue) { options.pid = atol(argv[++i]); }
+        else { printHelp(); return arg == "--help" || arg == "-h" ? 0 : 1; }
+    }
+
+    if (!options.pid) {
+        options.pid = findServerPid();
+    }
+
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    Recorder recorder;
+    TrackPool pool;
+
+    std::vector<std::unique_ptr<Remote>> remotes;
+    std::vector<std::unique_ptr<Downloader>> downloaders;
+
+    const size_t rssStart = options.pid ? residentKb(options.pid) : 0;
+    size_t rssPeak = rssStart;
+
+    const auto start = Clock::now();
+
+    for (int i = 0; i < options.remotes; i++) {
+        remotes.push_back(std::make_unique<Remote>(i, options, recorder, pool));
+        remotes.back()->Start();
+    }
+
+    for (int i = 0; i < options.downloaders; i++) {
+        downloaders.push_back(std::make_unique<Downloader>(i, options, recorder, pool));
+        downloaders.back()->Start();
+    }
+
+    const auto end = start + std::chrono::seconds(options.seconds);
+    while (Clock::now() < end) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        if (options.pid) {
+            rssPeak = std::max(rssPeak, residentKb(options.pid));
+        }
+    }
+
+    running = false;
+
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    const size_t rssEnd = options.pid ? residentKb(options.pid) : 0;
+
+    for (auto& downloader : downloaders) {
+        downloader->Stop();
+    }
+    for (auto& remote : remotes) {
+        remote->Stop();
+    }
+
+    auto results = recorder.Snapshot();
+
+    if (options.json) {
+        printf("{\n");
+        printf("  \"remotes\": %d,\n  \"downloaders\": %d,\n  \"seconds\": %.2f,\n",
+            options.remotes, options.downloaders, elapsed);
+        printf("  \"server_rss_kb\": { \"pid\": %ld, \"start\": %zu, \"peak\": %zu, \"end\": %zu },\n",
+            options.pid, rssStart, rssPeak, rssEnd);
+        printf("  \"requests\": [\n");
+        size_t i = 0;
+        for (auto& it : results) {
+            auto& ms = it.second.ms;
+            std::sort(ms.begin(), ms.end());
+            printf(
+                "    { \"name\": \"%s\", \"count\": %zu, \"errors\": %zu, \"per_second\": %.2f, "
+                "\"mb_per_second\": %.3f, \"latency_ms\": { \"p50\": %.2f, \"p90\": %.2f, "
+                "\"p99\": %.2f, \"max\": %.2f } }%s\n",
+                it.first.c_str(), ms.size(), it.second.errors, ms.size() / elapsed,
+                it.second.bytes / elapsed / (1024.0 * 1024.0),
+                percentile(ms, 0.50), percentile(ms, 0.90), percentile(ms, 0.99),
+                ms.size() ? ms.back() : 0.0,
+                ++i < results.size() ? "," : "");
+        }
+        printf("  ]\n}\n");
+    }
+    else {
+        printf("%d remotes, %d downloaders, %.1fs\n", options.remotes, options.downloaders, elapsed);
+        if (options.pid) {
+            printf("server rss (pid %ld): start %zukb, peak %zukb, end %zukb\n\n",
+                options.pid, rssStart, rssPeak, rssEnd);
+        }
+        else {
+            printf("server rss: unavailable (pass --pid)\n\n");
+        }
+        printf("%-26s %8s %7s %9s %9s %9s %9s %9s %9s\n",
+            "request", "count", "errors", "req/s", "MB/s", "p50ms", "p90ms", "p99ms", "maxms");
+        for (auto& it : results) {
+            auto& ms = it.second.ms;
+            std::sort(ms.begin(), ms.end());
+            printf("%-26s %8zu %7zu %9.1f %9.3f %9.2f %9.2f %9.2f %9.2f\n",
+                it.first.c_str(), ms.size(), it.second.errors, ms.size() / elapsed,
+                it.second.bytes / elapsed / (1024.0 * 1024.0),
+                percentile(ms, 0.50), percentile(ms, 0.90), percentile(ms, 0.99),
+                ms.size() ? ms.back() : 0.0);
+        }
+    }
+
+    downloaders.clear();
+    remotes.clear();
+
+    curl_global_cleanup();
+
+    size_t errors = 0;
+    for (auto& it : results) {
+        errors += it.second.errors;
+    }
+
+    return errors ? 2 : 0;
+}
@@ -68,7 +68,7 @@ static int getIntFromTextInput(TextInput& input, int defaultValue = -1) {
 static inline int longestStringLength(const std::vector<std::string>&& keys) {
     int max = 0;
     for (auto& str: keys) {
-        int len = narrow_cast<int>(u8cols(_TSTR(str)));
+        int len = narrow_cast<int>(text::Width(_TSTR(str)));
         max = len > max ? len : max;
     }
     return max;
@@ -95,7 +95,7 @@ void RemoteLibrarySettingsLayout::OnLayout() {
      });
 
     const int checkboxWidth = narrow_cast<int>(
-        u8cols(_TSTR("settings_library_type_remote_use_tls")) + 4);
+        text::Width(_TSTR("settings_library_type_remote_use_tls")) + 4);
 
     int const cx = this->GetWidth();
     int const inputWidth = std::min((int) 32, (int) (cx - labelWidth - 1));
@@ -114,19 +114,19 @@ void RemoteLibrarySettingsLayout::OnLayout() {
     this->transcoderCheckbox->MoveAndResize(
         0,
         y,
-        narrow_cast<int>(u8cols(this->transcoderCheckbox->GetText())) + 4,
+        narrow_cast<int>(text::Width(this->transcoderCheckbox->GetText())) + 4,
         1);
 
     this->transcoderFormatDropdown->MoveAndResize(
         R(this->transcoderCheckbox) + 1,
         y,
-        narrow_cast<int>(u8cols(this->transcoderFormatDropdown->GetText())),
+        narrow_cast<int>(text::Width(this->transcoderFormatDropdown->GetText())),
         1);
 
     this->transcoderBitrateDropdown->MoveAndResize(
         R(this->transcoderFormatDropdown) + 1,
         y,
-        narrow_cast<int>(u8cols(this->transcoderBitrateDropdown->GetText())),
+        narrow_cast<int>(text::Width(this->transcoderBitrateDropdown->GetText())),
         1);
 }
 
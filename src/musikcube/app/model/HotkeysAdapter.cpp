@@ -60,7 +60,7 @@ Entry HotkeysAdapter::GetEntry(ScrollableWindow* window, size_t index) {
     auto key = Hotkeys::Get(id);
 
     int width = window->GetContentWidth();
-    int avail = std::max(0, width - int(u8cols(name)) - 1 - 1);
+    int avail = std::max(0, width - int(text::Width(name)) - 1 - 1);
 
     auto value = " " + name + " " + text::Align(key + " ", text::AlignRight, avail);
 
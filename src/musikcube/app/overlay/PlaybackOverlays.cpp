@@ -186,7 +186,7 @@ void PlaybackOverlays::ShowOutputDeviceOverlay(std::function<void()> callback) {
             const std::string name = deviceList->At(i)->Name();
             adapter->AddEntry(name);
 
-            width = std::max(width, u8cols(name));
+            width = std::max(width, text::Width(name));
 
             if (name == currentDeviceName) {
                 selectedIndex = i + 1;
@@ -62,7 +62,7 @@ using namespace cursespp;
 #define ARROW std::string("> ")
 
 #define RIGHT(x) (x->GetX() + x->GetWidth())
-#define TEXT_WIDTH(x) ((int) u8cols(x->GetText()))
+#define TEXT_WIDTH(x) ((int) text::Width(x->GetText()))
 #define INVALID_PREAMP_GAIN -999.9f
 #define MIN_PREAMP_GAIN -20.0f
 #define MAX_PREAMP_GAIN 20.0f
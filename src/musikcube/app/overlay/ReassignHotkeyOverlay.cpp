@@ -94,7 +94,7 @@ void ReassignHotkeyOverlay::RecalculateSize() {
     auto preferredWidth = _DIMEN("reassign_hotkey_overlay_width", DEFAULT_WIDTH);
     auto name = Hotkeys::Name(this->id);
 
-    this->width = std::max(int(u8cols(name) + 4), preferredWidth);
+    this->width = std::max(int(text::Width(name) + 4), preferredWidth);
     this->width = std::max(0, std::min(Screen::GetWidth(), this->width));
     this->height = std::max(0, std::min(Screen::GetHeight() - 2, DEFAULT_HEIGHT));
     this->y = VERTICAL_PADDING;
@@ -67,7 +67,7 @@ static const char* KEY_PASSWORD = "password";
 #define DEFAULT_WIDTH 45
 
 #define RIGHT(x) (x->GetX() + x->GetWidth())
-#define TEXT_WIDTH(x) ((int) u8cols(x->GetText()))
+#define TEXT_WIDTH(x) ((int) text::Width(x->GetText()))
 
 using Callback = ServerOverlay::Callback;
 using Prefs = ServerOverlay::Prefs;
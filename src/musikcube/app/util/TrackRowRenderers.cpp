@@ -245,7 +245,7 @@ namespace NowPlaying {
             kDurationColWidth -
             kAlbumColWidth -
             kArtistColWidth -
-            narrow_cast<int>(u8cols(rating)) -
+            narrow_cast<int>(text::Width(rating)) -
             (4 * 3); /* 3 = spacing */
 
         titleWidth = std::max(0, titleWidth);
@@ -43,7 +43,7 @@ namespace musik { namespace cube { namespace windowutil {
         if (window && mouseEvent->y == -1) {
             auto title = window->GetFrameTitle();
             /* the title will be in the format "- title -". this check is kludgy. */
-            if (mouseEvent->x > 0 && mouseEvent->x < u8cols(title) + 3) {
+            if (mouseEvent->x > 0 && mouseEvent->x < text::Width(title) + 3) {
                 return true;
             }
         }
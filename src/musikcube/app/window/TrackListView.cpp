@@ -74,6 +74,9 @@ we assume he's not paying attention, and will automatically scroll
 the view to the playing track if it's invisible. */
 static const milliseconds AUTO_SCROLL_COOLDOWN = milliseconds(60000LL);
 
+/* a few pages worth of formatted rows; cleared when exceeded */
+static const size_t MAX_CACHED_ROWS = 1024;
+
 static inline milliseconds now() noexcept {
     return duration_cast<milliseconds>(system_clock::now().time_since_epoch());
 }
@@ -108,6 +111,7 @@ void TrackListView::SelectFirstTrack() {
 void TrackListView::SetTrackNumType(TrackRowRenderers::TrackNumType type) {
     if (this->trackNumType != type) {
         this->trackNumType = type;
+        this->adapter->InvalidateRows();
         this->OnAdapterChanged();
     }
 }
@@ -117,6 +121,7 @@ void TrackListView::SetRowRenderer(TrackRowRenderers::Renderer renderer) {
         throw std::runtime_error("invalid Renderer supplied to TrackListView::SetRowRenderer");
     }
     this->renderer = renderer;
+    this->adapter->InvalidateRows();
 }
 
 void TrackListView::OnTrackListWindowCached(const musik::core::TrackList* track, size_t from, size_t to) {
@@ -131,6 +136,7 @@ void TrackListView::OnQueryCompleted(IQuery* query) {
 
             this->SetTrackListAndUpateEventHandlers(this->query->GetResult());
             this->AdjustTrackListCacheWindowSize();
+            this->adapter->InvalidateRows();
             this->headers.Set(this->query->GetHeaders(), this->query->GetDurations());
             this->lastQueryHash = this->query->GetQueryHash();
 
@@ -172,11 +178,13 @@ void TrackListView::Reset() {
     this->query.reset();
     this->tracks = std::make_shared<TrackList>(this->library);
     this->headers.Reset();
+    this->adapter->InvalidateRows();
     this->OnAdapterChanged();
 }
 
 void TrackListView::InvalidateData() {
     this->tracks->ClearCache();
+    this->adapter->InvalidateRows();
     this->OnAdapterChanged();
 }
 
@@ -229,6 +237,7 @@ void TrackListView::SetTrackListAndUpateEventHandlers(std::shared_ptr<TrackList>
         this->tracks->WindowCached.disconnect(this);
     }
     this->tracks = trackList;
+    this->adapter->InvalidateRows();
     if (this->tracks) {
         this->tracks->WindowCached.connect(this, &TrackListView::OnTrackListWindowCached);
     }
@@ -260,6 +269,16 @@ void TrackListView::OnDimensionsChanged() {
     ListWindow::OnDimensionsChanged();
 }
 
+void TrackListView::OnVisibilityChanged(bool visible) {
+    ListWindow::OnVisibilityChanged(visible);
+
+    /* rows depend on display preferences (e.g. the rating column) that may
+    have changed while we were hidden. */
+    if (!visible) {
+        this->adapter->InvalidateRows();
+    }
+}
+
 bool TrackListView::OnEntryActivated(size_t index) {
     if (headers.HeaderAt(this->GetSelectedIndex())) {
         TrackPtr track = this->GetSelectedTrack();
@@ -549,11 +568,26 @@ IScrollAdapter::EntryPtr TrackListView::Adapter::GetEntry(cursespp::ScrollableWi
         attrs = Color::TextDisabled;
     }
 
-    std::string text = parent.renderer(
-        track, rawIndex, this->GetWidth(), parent.trackNumType);
+    const size_t width = this->GetWidth();
+    const auto state = track->GetMetadataState();
+
+    auto cached = this->rows.find(rawIndex);
+    if (cached == this->rows.end() ||
+        cached->second.track != track ||
+        cached->second.state != state ||
+        cached->second.width != width)
+    {
+        if (this->rows.size() >= MAX_CACHED_ROWS) {
+            this->rows.clear();
+        }
+
+        std::string text = parent.renderer(track, rawIndex, width, parent.trackNumType);
+        cached = this->rows.insert_or_assign(
+            rawIndex, CachedRow { track, state, width, std::move(text) }).first;
+    }
 
     auto entry = std::make_shared<TrackListEntry>(
-        text, narrow_cast<int>(trackIndex), RowType::Track);
+        cached->second.text, narrow_cast<int>(trackIndex), RowType::Track);
 
     entry->SetAttrs(attrs);
 
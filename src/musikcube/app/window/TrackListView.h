@@ -49,6 +49,8 @@
 
 #include <app/util/TrackRowRenderers.h>
 
+#include <unordered_map>
+
 namespace musik {
     namespace cube {
         class TrackListView:
@@ -99,6 +101,7 @@ namespace musik {
                 bool OnEntryActivated(size_t index) override;
                 bool OnEntryContextMenu(size_t index) override;
                 void OnDimensionsChanged() override;
+                void OnVisibilityChanged(bool visible) override;
 
                 void OnTrackListWindowCached(
                     const musik::core::TrackList* track, size_t from, size_t to);
@@ -133,9 +136,22 @@ namespace musik {
                         size_t GetEntryCount() noexcept override;
                         EntryPtr GetEntry(cursespp::ScrollableWindow* window, size_t index) override;
 
+                        void InvalidateRows() noexcept { this->rows.clear(); }
+
                     private:
+                        /* formatted track rows, keyed by adapter index. formatting
+                        (column alignment, ellipsizing) is comparatively expensive,
+                        and most redraws only change the highlighted rows. */
+                        struct CachedRow {
+                            TrackPtr track;
+                            musik::core::sdk::MetadataState state;
+                            size_t width;
+                            std::string text;
+                        };
+
                         TrackListView &parent;
                         IScrollAdapter::ScrollPosition spos;
+                        std::unordered_map<size_t, CachedRow> rows;
                 };
 
             private:
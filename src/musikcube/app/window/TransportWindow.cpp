@@ -185,7 +185,7 @@ void TransportWindow::DisplayCache::Reset() {
 size_t TransportWindow::DisplayCache::Columns(const std::string& str) {
     auto it = stringToColumns.find(str);
     if (it == stringToColumns.end()) {
-        stringToColumns[str] = u8cols(str);
+        stringToColumns[str] = text::Width(str);
     }
     return stringToColumns[str];
 }
@@ -208,15 +208,15 @@ void TransportWindow::DisplayCache::Update(ITransport& transport, TrackPtr track
         if (this->track) {
             title = this->track->GetString(constants::Track::TITLE);
             title = title.size() ? title : Strings.EMPTY_SONG;
-            titleCols = narrow_cast<int>(u8cols(title));
+            titleCols = narrow_cast<int>(text::Width(title));
 
             album = this->track->GetString(constants::Track::ALBUM);
             album = album.size() ? album : Strings.EMPTY_ALBUM;
-            albumCols = narrow_cast<int>(u8cols(album));
+            albumCols = narrow_cast<int>(text::Width(album));
 
             artist = this->track->GetString(constants::Track::ARTIST);
             artist = artist.size() ? artist : Strings.EMPTY_ARTIST;
-            artistCols = narrow_cast<int>(u8cols(artist));
+            artistCols = narrow_cast<int>(text::Width(artist));
         }
     }
 
@@ -242,7 +242,7 @@ void TransportWindow::DisplayCache::Update(ITransport& transport, TrackPtr track
             totalTime = "∞";
         }
 
-        totalTimeCols = (int) u8cols(totalTime);
+        totalTimeCols = (int) text::Width(totalTime);
     }
 }
 
@@ -706,11 +706,11 @@ void TransportWindow::Update(TimeMode timeMode) {
 
     if (muted) {
         volume = Strings.MUTED;
-        this->volumePos.Set(0, narrow_cast<int>(u8cols(Strings.MUTED)));
+        this->volumePos.Set(0, narrow_cast<int>(text::Width(Strings.MUTED)));
     }
     else {
         volume = Strings.VOLUME;
-        this->volumePos.Set(narrow_cast<int>(u8cols(Strings.VOLUME)), 11);
+        this->volumePos.Set(narrow_cast<int>(text::Width(Strings.VOLUME)), 11);
 
         for (int i = 0; i < 11; i++) {
             volume += (i == thumbOffset) ? "■" : "─";
@@ -786,8 +786,8 @@ void TransportWindow::Update(TimeMode timeMode) {
     int const escapedPercentSignWidth = (muted ? 0 : 1); /* 1 for escaped percent sign when not muted */
     int const bottomRowControlsWidth =
         displayCache.Columns(volume) - escapedPercentSignWidth +
-        (replayGainEnabled ? (narrow_cast<int>(u8cols(replayGain)) + 4) : 0) +  /* [] brackets */
-        narrow_cast<int>(u8cols(currentTime)) + 1 + /* +1 for space padding */
+        (replayGainEnabled ? (narrow_cast<int>(text::Width(replayGain)) + 4) : 0) +  /* [] brackets */
+        narrow_cast<int>(text::Width(currentTime)) + 1 + /* +1 for space padding */
         /* timer track with thumb */
         1 + displayCache.totalTimeCols + /* +1 for space padding */
         displayCache.Columns(repeatModeLabel);
@@ -824,19 +824,19 @@ void TransportWindow::Update(TimeMode timeMode) {
         checked_wprintw(c, "]  ");
     }
 
-    currentTimePos.Set(getcurx(c), 1, u8cols(currentTime));
+    currentTimePos.Set(getcurx(c), 1, text::Width(currentTime));
     ON(c, currentTimeAttrs); /* blink if paused */
     checked_wprintw(c, "%s ", currentTime.c_str());
     OFF(c, currentTimeAttrs);
 
     ON(c, timerAttrs);
-    this->timeBarPos.Set(getcurx(c), narrow_cast<int>(u8cols(timerTrack)));
+    this->timeBarPos.Set(getcurx(c), narrow_cast<int>(text::Width(timerTrack)));
     checked_waddstr(c, timerTrack.c_str()); /* may be a very long string */
     checked_wprintw(c, " %s", displayCache.totalTime.c_str());
     OFF(c, timerAttrs);
 
     ON(c, repeatAttrs);
-    this->repeatPos.Set(getcurx(c), narrow_cast<int>(u8cols(repeatModeLabel)));
+    this->repeatPos.Set(getcurx(c), narrow_cast<int>(text::Width(repeatModeLabel)));
     checked_wprintw(c, "%s", repeatModeLabel.c_str());
     OFF(c, repeatAttrs);
 
@@ -70,11 +70,13 @@ static App* instance = nullptr;
 #ifndef WIN32
 static void hangupHandler(int signal) {
     disconnected = true;
+    Window::WakeUp();
 }
 
 static void resizedHandler(int signal) {
     endwin(); /* required in *nix because? */
     resized = true;
+    Window::WakeUp();
 }
 
 static std::string getEnvironmentVariable(const std::string& name) {
@@ -509,7 +511,7 @@ void App::Run(ILayoutPtr layout) {
     }
 #endif
 
-    int64_t ch;
+    int64_t ch = ERR;
     std::string kn;
 
     this->state.input = nullptr;
@@ -532,6 +534,15 @@ void App::Run(ILayoutPtr layout) {
             goto process;
         }
 
+#ifndef WIN32
+        /* sleep until there's input, a signal, or a message is due. if the
+        last read returned a key, skip the wait: curses may have already
+        buffered more input than is left in the descriptor. */
+        if (ch == ERR && !resized) {
+            Window::WaitForEvents(fileno(stdin));
+        }
+#endif
+
         if (this->state.input && this->state.focused->GetContent()) {
             /* if the focused window is an input, allow it to draw a cursor */
             WINDOW *c = this->state.focused->GetContent();
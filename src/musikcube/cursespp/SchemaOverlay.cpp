@@ -183,7 +183,7 @@ class SchemaAdapter: public ScrollAdapterBase {
             std::string name = entry->name;
             std::string value = stringValueFor(prefs, entry);
             int width = window->GetContentWidth();
-            int avail = std::max(0, width - int(u8cols(name)) - 1 - 1);
+            int avail = std::max(0, width - int(text::Width(name)) - 1 - 1);
             auto display = " " + name + " " + text::Align(value + " ", text::AlignRight, avail);
 
             auto result = std::make_shared<SingleLineEntry>(text::Ellipsize(display, width));
@@ -37,6 +37,7 @@
 #include <cursespp/ScrollableWindow.h>
 #include <cursespp/MultiLineEntry.h>
 #include <cursespp/ListWindow.h>
+#include <cursespp/Text.h>
 
 using namespace cursespp;
 
@@ -52,6 +53,9 @@ ScrollAdapterBase::~ScrollAdapterBase() {
 }
 
 void ScrollAdapterBase::SetDisplaySize(size_t width, size_t height) {
+    if (width != this->width || height != this->height) {
+        this->lastDrawn.clear();
+    }
     this->width = width;
     this->height = height;
 }
@@ -116,7 +120,18 @@ void ScrollAdapterBase::DrawPage(ScrollableWindow* scrollable, size_t index, Scr
         return;
     }
 
-    werase(window);
+    /* if the window hasn't been erased or recreated since our last draw, and
+    nothing else has resized it, we only need to write lines that changed.
+    otherwise start from scratch. */
+    if (this->drawnWindow != scrollable ||
+        this->drawnGeneration != scrollable->GetContentGeneration() ||
+        this->lastDrawn.size() != this->height)
+    {
+        werase(window);
+        this->lastDrawn.assign(this->height, DrawnLine());
+        this->drawnWindow = scrollable;
+        this->drawnGeneration = scrollable->GetContentGeneration();
+    }
 
     std::deque<EntryPtr> visible;
     size_t drawnLines = 0;
@@ -133,7 +148,6 @@ void ScrollAdapterBase::DrawPage(ScrollableWindow* scrollable, size_t index, Scr
         for (size_t e = 0; e < visible.size(); e++) {
             EntryPtr entry = visible.at(e);
             size_t count = entry->GetLineCount();
-            wmove(window, drawnLines, 0);
 
             for (size_t i = 0; i < count && drawnLines < this->height; i++) {
                 Color attrs = Color::Default;
@@ -146,12 +160,8 @@ void ScrollAdapterBase::DrawPage(ScrollableWindow* scrollable, size_t index, Scr
                     attrs = entry->GetAttrs(i);
                 }
 
-                if (attrs != -1) {
-                    wattron(window, attrs);
-                }
-
                 std::string line = entry->GetLine(i);
-                size_t len = u8cols(line);
+                size_t len = text::Width(line);
 
                 /* pad with empty spaces to the end of the line. this allows us to
                 do highlight rows. this should probably be configurable. */
@@ -161,11 +171,28 @@ void ScrollAdapterBase::DrawPage(ScrollableWindow* scrollable, size_t index, Scr
                     line += std::string(remain, ' ');
                 }
 
-                /* string is padded above, we don't need a \n */
-                checked_wprintw(window, "%s", line.c_str());
+                DrawnLine& drawn = this->lastDrawn[drawnLines];
+
+                if (drawn.attrs != (int64_t) attrs || drawn.value != line) {
+                    wmove(window, drawnLines, 0);
+
+                    if (!drawn.value.empty()) {
+                        wclrtoeol(window);
+                    }
 
-                if (attrs != -1) {
-                    wattroff(window, attrs);
+                    if (attrs != -1) {
+                        wattron(window, attrs);
+                    }
+
+                    /* string is padded above, we don't need a \n */
+                    checked_wprintw(window, "%s", line.c_str());
+
+                    if (attrs != -1) {
+                        wattroff(window, attrs);
+                    }
+
+                    drawn.value = std::move(line);
+                    drawn.attrs = attrs;
                 }
 
                 ++drawnLines;
@@ -173,6 +200,16 @@ void ScrollAdapterBase::DrawPage(ScrollableWindow* scrollable, size_t index, Scr
         }
     }
 
+    /* blank out anything left over from the previous draw */
+    for (size_t i = drawnLines; i < this->height; i++) {
+        DrawnLine& drawn = this->lastDrawn[i];
+        if (!drawn.value.empty()) {
+            wmove(window, i, 0);
+            wclrtoeol(window);
+            drawn = DrawnLine();
+        }
+    }
+
     result.visibleEntryCount = visible.size();
     result.firstVisibleEntryIndex = topIndex;
     result.lineCount = drawnLines;
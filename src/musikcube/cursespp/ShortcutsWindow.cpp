@@ -88,7 +88,7 @@ size_t ShortcutsWindow::CalculateLeftPadding() {
 
     for (size_t i = 0; i < this->entries.size(); i++) {
         auto e = this->entries[i];
-        padding -= u8cols(e->key) + u8cols(e->description) + 5;
+        padding -= text::Width(e->key) + text::Width(e->description) + 5;
     }
 
     if (padding < 0) {
@@ -223,13 +223,13 @@ void ShortcutsWindow::OnRedraw() {
 
         /* calculate the offset and width, this is used for mouse
         click handling! */
-        size_t width = u8cols(key + value);
+        size_t width = text::Width(key + value);
         e->position.offset = currentX;
         e->position.width = width;
         currentX += 1 + width; /* 1 is the extra leading space */
 
         /* draw the shortcut key */
-        size_t len = u8cols(key);
+        size_t len = text::Width(key);
         if (len > remaining) {
             key = text::Ellipsize(key, remaining);
             len = remaining;
@@ -246,7 +246,7 @@ void ShortcutsWindow::OnRedraw() {
         }
 
         /* draw the description */
-        len = u8cols(value);
+        len = text::Width(value);
         if (len > remaining) {
             value = text::Ellipsize(value, remaining);
             len = remaining;
@@ -36,53 +36,170 @@
 #include <cursespp/curses_config.h>
 #include <cursespp/Text.h>
 
-#include <math.h>
-
 #include <unordered_map>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 
-#define PAD(str, count) for (size_t i = 0; i < count; i++) { str += " "; }
+#ifdef WIN32
+    #include <wcwidth.h>
+    #define platform_wcwidth(c) mk_wcwidth((wchar_t) c)
+#else
+    #include <wchar.h>
+    #define platform_wcwidth(c) wcwidth((wchar_t) c)
+#endif
 
-namespace cursespp {
-    namespace text {
-        std::string Truncate(const std::string& str, size_t len) {
-            /* not a simple substr anymore, gotta deal with multi-byte
-            characters... */
-            if (u8cols(str) > len) {
-                auto prev = str.begin();
-                auto it = str.begin();
-                auto end = str.end();
-
-                size_t cols = 0;
-                while (cols <= len && it != str.end()) {
-                    prev = it;
-
-                    try {
-                        utf8::next(it, end);
-                    }
-                    catch (...) {
-                        /* invalid encoding, just treat as a single char */
-                        ++it;
-                    }
+/* returned by decode() for malformed sequences; each bad byte is treated as
+a single column-wide character. */
+static const uint32_t INVALID_CODEPOINT = 0xffffffff;
+
+/* widths for the basic multilingual plane are computed once, the first time a
+non-ascii character is measured. by then the ui has called setlocale(), which
+wcwidth() depends on. */
+class BmpWidthTable {
+    public:
+        BmpWidthTable() {
+            for (uint32_t c = 0; c < 0x10000; c++) {
+                widths[c] = (int8_t) platform_wcwidth(c);
+            }
+        }
 
-                    cols += u8cols(std::string(prev, it));
-                }
+        int8_t widths[0x10000];
+};
+
+static inline size_t codepointWidth(uint32_t c) {
+    int width;
+
+    if (c < 0x10000) {
+        static const BmpWidthTable table;
+        width = table.widths[c];
+    }
+    else if (c == INVALID_CODEPOINT) {
+        width = 1;
+    }
+    else {
+#ifdef WIN32
+        /* wchar_t is 16 bits here; cover emoji and the cjk ideograph planes */
+        width = ((c >= 0x1f300 && c <= 0x1faff) || (c >= 0x20000 && c <= 0x3fffd)) ? 2 : 1;
+#else
+        width = wcwidth((wchar_t) c);
+#endif
+    }
+
+    /* non-printable characters (-1) are counted as a single column, like curses
+    would for most of them. combining characters are zero-width. */
+    return (width < 0) ? 1 : (size_t) width;
+}
 
-                return std::string(str.begin(), prev);
+/* decodes the utf8 character at the specified position, returning the number
+of bytes consumed. never reads past the end of the buffer. */
+static inline size_t decode(const unsigned char* s, size_t remain, uint32_t& c) {
+    const unsigned char lead = s[0];
+    size_t count;
+
+    if (lead < 0x80) { c = lead; return 1; }
+    else if ((lead & 0xe0) == 0xc0) { count = 2; c = lead & 0x1f; }
+    else if ((lead & 0xf0) == 0xe0) { count = 3; c = lead & 0x0f; }
+    else if ((lead & 0xf8) == 0xf0) { count = 4; c = lead & 0x07; }
+    else { c = INVALID_CODEPOINT; return 1; }
+
+    if (count > remain) {
+        c = INVALID_CODEPOINT;
+        return 1;
+    }
+
+    for (size_t i = 1; i < count; i++) {
+        if ((s[i] & 0xc0) != 0x80) {
+            c = INVALID_CODEPOINT;
+            return 1;
+        }
+        c = (c << 6) | (s[i] & 0x3f);
+    }
+
+    return count;
+}
+
+/* returns the number of leading bytes that are plain ascii, checking a word
+at a time. ascii characters are always a single column wide. */
+static inline size_t asciiPrefix(const unsigned char* s, size_t size) {
+    static const uint64_t HIGH_BITS = 0x8080808080808080ULL;
+    size_t i = 0;
+    while (i + sizeof(uint64_t) <= size) {
+        uint64_t word;
+        memcpy(&word, s + i, sizeof(word));
+        if (word & HIGH_BITS) {
+            break;
+        }
+        i += sizeof(uint64_t);
+    }
+    while (i < size && s[i] < 0x80) {
+        ++i;
+    }
+    return i;
+}
+
+/* single pass over the string: stops before the first character that would
+exceed maxCols. returns the byte offset, and the width of the prefix. */
+static size_t measure(const std::string& str, size_t maxCols, size_t& cols) {
+    const unsigned char* s = (const unsigned char*) str.data();
+    const size_t size = str.size();
+    size_t i = 0;
+    cols = 0;
+
+    while (i < size) {
+        /* fast path: a run of ascii characters */
+        if (s[i] < 0x80) {
+            size_t run = asciiPrefix(s + i, std::min(size - i, maxCols - cols));
+            if (run == 0) {
+                break; /* no columns left */
             }
+            i += run;
+            cols += run;
+            continue;
+        }
 
-            return str;
+        uint32_t c;
+        const size_t bytes = decode(s + i, size - i, c);
+        const size_t width = codepointWidth(c);
+
+        if (cols + width > maxCols) {
+            break;
         }
 
-        std::string Ellipsize(const std::string& str, size_t len) {
-            if (u8cols(str) > len) {
-                std::string trunc = Truncate(str, len - 2);
+        i += bytes;
+        cols += width;
+    }
 
-                size_t tlen = u8cols(trunc);
-                for (size_t i = tlen; i < len; i++) {
-                    trunc += ".";
-                }
+    return i;
+}
 
+namespace cursespp {
+    namespace text {
+        size_t Width(const std::string& str) {
+            size_t cols;
+            measure(str, SIZE_MAX, cols);
+            return cols;
+        }
+
+        size_t OffsetForWidth(const std::string& str, size_t width, size_t* cols) {
+            size_t measured;
+            const size_t offset = measure(str, width, measured);
+            if (cols) {
+                *cols = measured;
+            }
+            return offset;
+        }
+
+        std::string Truncate(const std::string& str, size_t len) {
+            return str.substr(0, OffsetForWidth(str, len));
+        }
+
+        std::string Ellipsize(const std::string& str, size_t len) {
+            if (OffsetForWidth(str, len) < str.size()) {
+                size_t cols;
+                const size_t offset = OffsetForWidth(str, len > 2 ? len - 2 : 0, &cols);
+                std::string trunc = str.substr(0, offset);
+                trunc.append(len - cols, '.');
                 return trunc;
             }
 
@@ -90,15 +207,14 @@ namespace cursespp {
         }
 
         std::string Align(const std::string& str, TextAlign align, size_t cx) {
-            size_t len = u8cols(str);
+            size_t len;
 
-            if (len > cx) {
+            if (OffsetForWidth(str, cx, &len) < str.size()) {
                 return Ellipsize(str, cx);
             }
             else if (align == AlignLeft) {
-                size_t pad = cx - len;
                 std::string left = str;
-                PAD(left, pad);
+                left.append(cx - len, ' ');
                 return left;
             }
             else {
@@ -109,9 +225,10 @@ namespace cursespp {
                 size_t rightPad = cx - (leftPad + len);
 
                 std::string padded;
-                PAD(padded, leftPad);
+                padded.reserve(str.size() + leftPad + rightPad);
+                padded.append(leftPad, ' ');
                 padded += str;
-                PAD(padded, rightPad);
+                padded.append(rightPad, ' ');
                 return padded;
             }
         }
@@ -148,12 +265,9 @@ namespace cursespp {
             size_t width,
             std::vector<std::string>& output)
         {
-            size_t len = u8cols(line);
-            size_t count = (int)ceil((float)len / (float)width);
-
             /* easy case: the line fits on a single line! */
 
-            if (count <= 1) {
+            if (OffsetForWidth(line, width) == line.size()) {
                 output.push_back(line);
             }
 
@@ -173,38 +287,28 @@ namespace cursespp {
 
                 std::vector<std::string> sanitizedWords;
                 for (size_t i = 0; i < words.size(); i++) {
-                    std::string word = words.at(i);
-                    size_t len = u8cols(word);
+                    std::string& word = words.at(i);
 
                     /* this word is fine, it'll easily fit on its own line of necessary */
 
-                    if (width >= len) {
-                        sanitizedWords.push_back(word);
+                    if (OffsetForWidth(word, width) == word.size()) {
+                        sanitizedWords.push_back(std::move(word));
                     }
 
-                    /* otherwise, the word needs to be broken into multiple lines. */
+                    /* otherwise, the word needs to be broken into multiple lines,
+                    each as many columns wide as will fit. */
 
                     else {
-                        std::string accum;
-
-                        /* ugh, we gotta split on UTF8 characters, not actual characters.
-                        this makes things a bit more difficult... we iterate over the string
-                        one displayable character at a time, and break it apart into separate
-                        lines as necessary. */
-
-                        std::string::iterator begin = word.begin();
-                        std::string::iterator end = word.begin();
-                        int count = 0;
-                        bool done = false;
-                        while (end != word.end()) {
-                            utf8::unchecked::next(end);
-                            ++count;
-
-                            if (count == width || end == word.end()) {
-                                sanitizedWords.push_back(std::string(begin, end));
-                                begin = end;
-                                count = 0;
+                        while (word.size()) {
+                            size_t offset = OffsetForWidth(word, width);
+                            if (offset == 0) {
+                                /* a single character wider than the line; emit it
+                                on its own to ensure we make progress. */
+                                uint32_t c;
+                                offset = decode((const unsigned char*) word.data(), word.size(), c);
                             }
+                            sanitizedWords.push_back(word.substr(0, offset));
+                            word.erase(0, offset);
                         }
                     }
                 }
@@ -218,8 +322,8 @@ namespace cursespp {
                 size_t accumLength = 0;
 
                 for (size_t i = 0; i < sanitizedWords.size(); i++) {
-                    std::string word = sanitizedWords.at(i);
-                    size_t wordLength = u8cols(word);
+                    std::string& word = sanitizedWords.at(i);
+                    size_t wordLength = Width(word);
                     size_t extra = (i != 0);
 
                     /* we have enough space for this new word. accumulate it. */
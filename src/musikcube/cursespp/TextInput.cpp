@@ -38,6 +38,7 @@
 #include <cursespp/Screen.h>
 #include <cursespp/Colors.h>
 #include <cursespp/TextInput.h>
+#include <cursespp/Text.h>
 
 using namespace cursespp;
 
@@ -91,7 +92,7 @@ void TextInput::OnRedraw() {
 
     std::string trimmed;
     const int contentWidth = GetContentWidth();
-    const size_t columns = u8cols(buffer);
+    const size_t columns = text::Width(buffer);
 
     /* if the string is larger than our width, we gotta trim it for
     display purposes... */
@@ -107,7 +108,7 @@ void TextInput::OnRedraw() {
         const int64_t color = Color(Color::TextDisabled);
         wattron(c, color);
         wmove(c, 0, 0);
-        checked_waddstr(c, u8substr(hintText, 0, contentWidth).c_str());
+        checked_waddstr(c, text::Truncate(hintText, contentWidth).c_str());
         wattroff(c, color);
     }
     else {
@@ -138,7 +139,7 @@ size_t TextInput::Length() noexcept {
 size_t TextInput::Position() {
     /* note we return the COLUMN offset, not the physical or logical
     character offset! */
-    return u8cols(u8substr(this->buffer, 0, this->position));
+    return text::Width(u8substr(this->buffer, 0, this->position));
 }
 
 bool TextInput::Write(const std::string& key) {
@@ -158,7 +159,7 @@ bool TextInput::Write(const std::string& key) {
         }
         else {
             if (truncate) {
-                const int cols = narrow_cast<int>(u8cols(this->buffer));
+                const int cols = narrow_cast<int>(text::Width(this->buffer));
                 if (cols >= this->GetWidth()) {
                     return false;
                 }
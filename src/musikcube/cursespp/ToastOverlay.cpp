@@ -98,7 +98,7 @@ void ToastOverlay::ProcessMessage(IMessage &message) {
 }
 
 void ToastOverlay::RecalculateSize() {
-    int cols = (int) u8cols(this->title);
+    int cols = (int) text::Width(this->title);
     this->width = std::min(cols + 4, (Screen::GetWidth() * 4) / 5);
     this->titleLines = text::BreakLines(this->title, this->width - 4);
     this->height = std::min((int) this->titleLines.size() + 2, Screen::GetHeight() - 4);
@@ -45,9 +45,18 @@
 #include <musikcore/runtime/MessageQueue.h>
 
 #include <cassert>
+#include <chrono>
+#include <algorithm>
+
+#ifndef WIN32
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 using namespace cursespp;
 using namespace musik::core::runtime;
+using namespace std::chrono;
 
 static int NEXT_ID = 0;
 
@@ -57,7 +66,41 @@ static Window* top = nullptr;
 static Window* focused = nullptr;
 static bool cursorVisible = false;
 
+#ifndef WIN32
+/* posting a message writes a byte to a pipe that the main loop polls on, so
+it can sleep until there's something to do instead of waking up periodically
+to check the queue. */
+static int wakeupPipe[2] = { -1, -1 };
+
+static class PollableMessageQueue : public MessageQueue {
+    public:
+        PollableMessageQueue() {
+            if (pipe(wakeupPipe) == 0) {
+                for (int i = 0; i < 2; i++) {
+                    fcntl(wakeupPipe[i], F_SETFL, fcntl(wakeupPipe[i], F_GETFL) | O_NONBLOCK);
+                    fcntl(wakeupPipe[i], F_SETFD, FD_CLOEXEC);
+                }
+            }
+        }
+
+        void Post(IMessagePtr message, int64_t delayMs = 0) override {
+            MessageQueue::Post(message, delayMs);
+            Window::WakeUp();
+        }
+
+        void Broadcast(IMessagePtr message, int64_t delayMs = 0) override {
+            MessageQueue::Broadcast(message, delayMs);
+            Window::WakeUp();
+        }
+
+        int64_t NextMessageTime() noexcept {
+            return this->GetNextMessageTime();
+        }
+} messageQueue;
+#else
 static MessageQueue messageQueue;
+#endif
+
 static std::shared_ptr<INavigationKeys> keys;
 
 #if defined(DEBUG) || defined(_DEBUG)
@@ -169,6 +212,43 @@ IMessageQueue& Window::MessageQueue() {
     return messageQueue;
 }
 
+#ifndef WIN32
+void Window::WakeUp() {
+    if (wakeupPipe[1] != -1) {
+        const char c = 0;
+        /* if the pipe is full the main loop is already awake; nothing to do */
+        (void) !write(wakeupPipe[1], &c, 1);
+    }
+}
+
+void Window::WaitForEvents(int inputFd) {
+    int timeoutMs = -1; /* no messages: wait for input or a wakeup */
+
+    const int64_t next = messageQueue.NextMessageTime();
+    if (next > 0) {
+        const int64_t now = duration_cast<milliseconds>(
+            system_clock::now().time_since_epoch()).count();
+        timeoutMs = (int) std::min((int64_t) INT_MAX, std::max((int64_t) 0, next - now));
+    }
+
+    struct pollfd fds[2];
+    fds[0].fd = inputFd;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    fds[1].fd = wakeupPipe[0];
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+
+    /* EINTR (e.g. SIGWINCH) is treated like any other wakeup */
+    if (poll(fds, wakeupPipe[0] != -1 ? 2 : 1, timeoutMs) > 0 && fds[1].revents) {
+        char drain[64];
+        while (read(wakeupPipe[0], drain, sizeof(drain)) > 0) {
+            /* discard; we only care that something happened */
+        }
+    }
+}
+#endif
+
 Window::Window(IWindow *parent) {
     this->frame = this->content = 0;
     this->framePanel = this->contentPanel = 0;
@@ -189,6 +269,7 @@ Window::Window(IWindow *parent) {
     this->focusOrder = -1;
     this->id = NEXT_ID++;
     this->badBounds = false;
+    this->contentGeneration = 0;
     Window::MessageQueue().Register(this);
 }
 
@@ -425,8 +506,10 @@ void Window::Redraw() {
 #if defined(__FreeBSD__) || (NCURSES_VERSION_PATCH >= 20200301)
             /* but depending on curses version we'll get redraw artifacts if we do or don't
             repaint the background. the changelog mentions changes to wbkgd() and wbkgrnd()
-            at revision 20200301, but it's unclear if this is the actual root cause or not. */
-            this->RepaintBackground();
+            at revision 20200301, but it's unclear if this is the actual root cause or not.
+            the background is reapplied either way, but the content is only erased if the
+            window won't redraw all of it anyway, so unchanged lines can be skipped. */
+            this->RepaintBackground(!this->RedrawsAllContent());
 #endif
             this->OnRedraw();
             this->Invalidate();
@@ -539,7 +622,7 @@ void Window::DrawFrameAndTitle() {
     this->DecorateFrame();
 }
 
-void Window::RepaintBackground() {
+void Window::RepaintBackground(bool eraseContent) {
     ASSERT_MAIN_THREAD();
 
     bool focused = IsFocused();
@@ -555,7 +638,10 @@ void Window::RepaintBackground() {
     }
 
     if (this->content) {
-        werase(this->content);
+        if (eraseContent) {
+            werase(this->content);
+            ++this->contentGeneration;
+        }
         wbkgd_internal(this->content, focused ? this->focusedContentColor : this->contentColor);
     }
 
@@ -859,6 +945,7 @@ void Window::Destroy() {
     this->framePanel = this->contentPanel = 0;
     this->content = this->frame = 0;
     this->isDirty = true;
+    ++this->contentGeneration;
 
     this->NotifyVisibilityChange(false);
 }
@@ -894,6 +981,7 @@ void Window::Clear() {
     if (this->content) {
         werase(this->content);
         wmove(this->content, 0, 0);
+        ++this->contentGeneration;
     }
 
     bool focused = this->IsFocused();
@@ -39,6 +39,7 @@
 #include <cursespp/IScrollAdapter.h>
 #include <functional>
 #include <deque>
+#include <vector>
 
 namespace cursespp {
     class ScrollAdapterBase : public IScrollAdapter {
@@ -71,7 +72,17 @@ namespace cursespp {
             size_t GetHeight() noexcept { return this->height; }
 
         private:
+            /* what was last written to each line of the window; DrawPage()
+            only emits lines that differ. an empty value means a blank line. */
+            struct DrawnLine {
+                std::string value;
+                int64_t attrs{ -1 };
+            };
+
             size_t width, height;
             ItemDecorator decorator;
+            std::vector<DrawnLine> lastDrawn;
+            ScrollableWindow* drawnWindow{ nullptr };
+            size_t drawnGeneration{ 0 };
     };
 }
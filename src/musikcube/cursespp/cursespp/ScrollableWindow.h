@@ -62,6 +62,7 @@ namespace cursespp {
             void Focus() override;
             void Blur() override;
             void OnRedraw() override;
+            bool RedrawsAllContent() override { return !!this->adapter; }
 
             /* IMouseHandler */
             bool ProcessMouseEvent(const IMouseHandler::Event& event) override;
@@ -45,6 +45,15 @@ namespace cursespp {
             AlignRight
         };
 
+        /* number of terminal columns needed to display the utf8 string */
+        size_t Width(const std::string& str);
+
+        /* byte offset of the end of the longest prefix of str that fits in the
+        specified number of columns. if cols is non-null it receives the width
+        of that prefix. only scans as far as it needs to. */
+        size_t OffsetForWidth(const std::string& str, size_t width, size_t* cols = nullptr);
+
+        std::string Truncate(const std::string& str, size_t len);
         std::string Ellipsize(const std::string& str, size_t len);
         std::string Align(const std::string& str, TextAlign align, size_t len);
         std::vector<std::string> BreakLines(const std::string& line, size_t width);
@@ -63,7 +63,7 @@ namespace cursespp {
             /* virtual methods we define */
             virtual void SetBold(bool bold);
             virtual bool IsBold() noexcept { return this->bold; }
-            virtual size_t Length() { return u8cols(this->buffer); }
+            virtual size_t Length() { return text::Width(this->buffer); }
             virtual void SetText(const std::string& value);
             virtual void SetText(const std::string& value, const text::TextAlign alignment);
             virtual std::string GetText() { return this->buffer; }
@@ -48,7 +48,9 @@
     #endif
     #define REDRAW_DEBOUNCE_MS 100
 #else
-    #define IDLE_TIMEOUT_MS 75
+    /* the main loop sleeps in poll() until there's input or a message to
+    dispatch (see Window::WaitForEvents()), so reads never need to block. */
+    #define IDLE_TIMEOUT_MS 0
     #define REDRAW_DEBOUNCE_MS 100
 #endif
 
@@ -77,6 +79,15 @@ namespace cursespp {
             static void SetNavigationKeys(std::shared_ptr<INavigationKeys> keys);
             static musik::core::runtime::IMessageQueue& MessageQueue();
 
+#ifndef WIN32
+            /* blocks until inputFd is readable, the next message in the queue
+            is due, or WakeUp() is called. */
+            static void WaitForEvents(int inputFd);
+
+            /* interrupts WaitForEvents(). async-signal-safe. */
+            static void WakeUp();
+#endif
+
             /* IWindow */
             void SetParent(IWindow* parent) override;
 
@@ -139,6 +150,10 @@ namespace cursespp {
 
             bool HasBadBounds() noexcept { return this->badBounds; }
 
+            /* changes every time the content window is erased or recreated. used
+            to determine if previously drawn lines are still on screen. */
+            size_t GetContentGeneration() const noexcept { return this->contentGeneration; }
+
             /* IMouseHandler */
             bool ProcessMouseEvent(const IMouseHandler::Event& mouseEvent) override;
 
@@ -155,7 +170,7 @@ namespace cursespp {
             void Recreate();
             void Clear();
             void DrawFrameAndTitle();
-            void RepaintBackground();
+            void RepaintBackground(bool eraseContent = true);
             void RecreateForUpdatedDimensions();
             void DestroyIfBadBounds();
             bool IsParentVisible();
@@ -169,6 +184,11 @@ namespace cursespp {
             virtual void OnVisibilityChanged(bool visible);
             virtual void OnFocusChanged(bool focused);
             virtual void OnRedraw();
+
+            /* windows whose OnRedraw() rewrites (or clears) every line of the
+            content area themselves can return true; a redraw then doesn't
+            erase the content window first. */
+            virtual bool RedrawsAllContent() { return false; }
             virtual void OnAddedToParent(IWindow* newParent);
             virtual void OnRemovedFromParent(IWindow* oldParent);
 
@@ -182,6 +202,7 @@ namespace cursespp {
             WINDOW* content;
             bool badBounds;
             bool drawFrame;
+            size_t contentGeneration;
             bool isVisibleInParent, isDirty;
             int focusOrder;
             int id;
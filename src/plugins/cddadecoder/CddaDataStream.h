@@ -66,6 +66,7 @@ class CddaDataStream : public IDataStream {
         const char* Type() override;
         const char* Uri() override;
         bool CanPrefetch() noexcept override { return false; }
+        PositionType ReadWindow(const void** window, PositionType maxBytes) noexcept override { return -1; }
 
         int GetChannelCount();
 
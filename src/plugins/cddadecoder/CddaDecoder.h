@@ -51,6 +51,7 @@ class CddaDecoder : public IDecoder {
         bool GetBuffer(IBuffer *buffer) override;
         bool Exhausted() noexcept override { return this->exhausted; }
         void SetPreferredSampleRate(int rate) override { }
+        long DecodeInto(float* target, long maxSamples) override { return -1; }
 
     private:
         CddaDataStream* data;
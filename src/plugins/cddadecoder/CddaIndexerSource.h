@@ -66,6 +66,13 @@ class CddaIndexerSource :
         bool HasStableIds() noexcept override { return true; }
         bool NeedsTrackScan() noexcept override { return true; }
 
+        /* discs aren't found on disk, so we don't take part in the walk */
+        const char* ScanFileExtensions() noexcept override { return ""; }
+
+        void ScanFile(
+            musik::core::sdk::IIndexerWriter* indexer,
+            const char* path) noexcept override { }
+
         /* CddaDataModel::EventListener */
         void OnAudioDiscInsertedOrRemoved() override;
 
@@ -75,6 +75,8 @@ class CoreAudioOut : public musik::core::sdk::IOutput {
         bool SetDefaultDevice(const char* deviceId) override;
         musik::core::sdk::IDevice* GetDefaultDevice() override;
         int GetDefaultSampleRate() override { return -1; }
+        size_t GetUnderrunCount() override { return 0; }
+        size_t GetXrunCount() override { return 0; }
 
         void NotifyBufferCompleted(BufferContext *context);
 
@@ -227,6 +227,57 @@ bool FfmpegDecoder::GetBuffer(IBuffer *buffer) {
     return false;
 }
 
+long FfmpegDecoder::DecodeInto(float* target, long maxSamples) {
+    /* the resampler (and therefore the output format) is set up by the
+    first call to GetBuffer(); until then, the caller needs to use it. */
+    if (!this->ioContext || !this->resampler || this->channels <= 0) {
+        return -1;
+    }
+
+    const int maxFrames = (int) (maxSamples / this->channels);
+
+    if (maxFrames <= 0) {
+        return -1;
+    }
+
+    /* same as GetBuffer(), but never returns an empty buffer: keep going
+    until there's something to hand back, or we hit the end. */
+    const int minFrames = FFMIN(maxFrames, this->preferredFrameSize);
+
+    while (true) {
+        if (!this->eof && av_audio_fifo_size(this->outputFifo) < minFrames) {
+            if (!this->RefillFifoQueue()) {
+                this->FlushAndFinalizeDecoder();
+                this->DrainResamplerToFifoQueue();
+                this->eof = true;
+            }
+        }
+
+        const int fifoSize = av_audio_fifo_size(this->outputFifo);
+
+        if (fifoSize >= minFrames || (this->eof && fifoSize > 0)) {
+            void* outData = (void*) target;
+            const int framesRead = av_audio_fifo_read(
+                this->outputFifo, &outData, FFMIN(fifoSize, maxFrames));
+
+            if (framesRead < 0) {
+                logAvError("av_audio_fifo_read", framesRead);
+                break;
+            }
+
+            return (long) framesRead * this->channels;
+        }
+
+        if (this->eof) {
+            break;
+        }
+    }
+
+    ::debug->Info(TAG, "finished decoding.");
+    this->exhausted = true;
+    return 0;
+}
+
 double FfmpegDecoder::GetDuration() {
     return this->duration;
 }
@@ -72,6 +72,7 @@ class FfmpegDecoder: public musik::core::sdk::IDecoder {
         bool Open(musik::core::sdk::IDataStream *stream) override;
         bool Exhausted() override;
         void SetPreferredSampleRate(int rate) override { this->preferredSampleRate = rate; }
+        long DecodeInto(float* target, long maxSamples) override;
 
         IDataStream* Stream() { return this->stream; }
 
@@ -127,3 +127,7 @@ const char* GmeDataStream::Uri() {
 bool GmeDataStream::CanPrefetch() {
     return this->stream->CanPrefetch();
 }
+
+PositionType GmeDataStream::ReadWindow(const void** window, PositionType maxBytes) {
+    return this->stream->ReadWindow(window, maxBytes);
+}
@@ -79,8 +79,20 @@ bool GmeDecoder::Open(musik::core::sdk::IDataStream *stream) {
     }
 
     auto dataLength = stream->Length();
-    const char* data = new char[dataLength];
-    if (stream->Read((void*) data, dataLength) == dataLength) {
+
+    /* memory mapped streams can hand us the file's contents directly, no
+    need for an intermediate copy; gme_open_data() makes its own anyway. */
+    const void* window = nullptr;
+    char* copy = nullptr;
+    musik::core::sdk::PositionType count = stream->ReadWindow(&window, dataLength);
+    if (count == -1) {
+        copy = new char[dataLength];
+        count = stream->Read((void*) copy, dataLength);
+        window = copy;
+    }
+
+    const char* data = static_cast<const char*>(window);
+    if (count == dataLength) {
         if (!gme_open_data(data, dataLength, &this->gme, SAMPLE_RATE)) {
             int trackNum = this->stream->GetTrackNumber();
 
@@ -140,7 +152,7 @@ bool GmeDecoder::Open(musik::core::sdk::IDataStream *stream) {
             this->totalSamples = (int)(this->length * SAMPLE_RATE * CHANNELS);
         }
     }
-    delete[] data;
+    delete[] copy;
     return this->gme != nullptr;
 }
 
@@ -56,6 +56,7 @@ class GmeDecoder: public musik::core::sdk::IDecoder {
         bool Open(musik::core::sdk::IDataStream *stream) override;
         bool Exhausted() override;
         void SetPreferredSampleRate(int rate) override { }
+        long DecodeInto(float* target, long maxSamples) override { return -1; }
 
     private:
         GmeDataStream* stream { nullptr };
@@ -79,28 +79,8 @@ ScanResult GmeIndexerSource::Scan(
         this->paths.insert(fs::canonicalizePath(std::string(indexerPaths[i])));
     }
 
-    auto checkFile = [this, indexer](const std::string& path) {
-        if (canHandle(path)) {
-            try {
-                this->UpdateMetadata(path, this, indexer);
-            }
-            catch (...) {
-                std::string error = str::Format("error reading metadata for %s", path.c_str());
-                debug->Error(PLUGIN_NAME, error.c_str());
-            }
-        }
-    };
-
-    auto checkInterrupt = [this]() -> bool {
-        return this->interrupt;
-    };
-
-    for (auto& path : this->paths) {
-        if (!this->interrupt) {
-            fs::scanDirectory(std::string(path), checkFile, checkInterrupt);
-        }
-    }
-
+    /* files were handed to us by the indexer's directory walk, via
+    ScanFile(), before we were called. */
     indexer->CommitProgress(this, this->filesIndexed);
 
     return ScanCommit;
@@ -110,6 +90,29 @@ void GmeIndexerSource::Interrupt() {
     this->interrupt = true;
 }
 
+const char* GmeIndexerSource::ScanFileExtensions() {
+    if (this->extensions.empty()) {
+        for (auto& format : FORMATS) {
+            this->extensions += (this->extensions.size() ? "," : "") + format.substr(1);
+        }
+    }
+    return this->extensions.c_str();
+}
+
+void GmeIndexerSource::ScanFile(IIndexerWriter* indexer, const char* path) {
+    if (this->interrupt) {
+        return;
+    }
+
+    try {
+        this->UpdateMetadata(std::string(path), this, indexer);
+    }
+    catch (...) {
+        std::string error = str::Format("error reading metadata for %s", path);
+        debug->Error(PLUGIN_NAME, error.c_str());
+    }
+}
+
 void GmeIndexerSource::ScanTrack(
     IIndexerWriter* indexer,
     ITagStore* tagStore,
@@ -148,6 +151,8 @@ void GmeIndexerSource::UpdateMetadata(
     IIndexerSource* source,
     IIndexerWriter* indexer)
 {
+    size_t tracks = 0;
+
     /* only need to do this check once, and it's relatively expensive because
     it requires a db read. cache we've already done it. */
     int modifiedTime = fs::getLastModifiedTime(fn);
@@ -160,6 +165,7 @@ void GmeIndexerSource::UpdateMetadata(
         gme_err_t err = gme_open_file(fn.c_str(), &data, gme_info_only);
         if (err) {
             debug->Error(PLUGIN_NAME, str::Format("error opening %s", fn.c_str()).c_str());
+            std::unique_lock<std::mutex> lock(this->mutex);
             invalidFiles.insert(fn);
         }
         else {
@@ -232,7 +238,7 @@ void GmeIndexerSource::UpdateMetadata(
                 gme_free_info(info);
                 indexer->Save(source, track, externalId.c_str());
                 track->Release();
-                ++tracksIndexed;
+                ++tracks;
             }
         }
 
@@ -240,8 +246,17 @@ void GmeIndexerSource::UpdateMetadata(
     }
 
     /* we commit progress every so often */
-    if (++this->filesIndexed % 300 == 0) {
-        indexer->CommitProgress(this, this->filesIndexed + this->tracksIndexed);
-        this->filesIndexed = this->tracksIndexed = 0;
+    size_t updated = 0;
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->tracksIndexed += tracks;
+        if (++this->filesIndexed % 300 == 0) {
+            updated = this->filesIndexed + this->tracksIndexed;
+            this->filesIndexed = this->tracksIndexed = 0;
+        }
+    }
+
+    if (updated) {
+        indexer->CommitProgress(this, (unsigned) updated);
     }
 }
\ No newline at end of file
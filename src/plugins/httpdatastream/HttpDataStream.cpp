@@ -46,6 +46,7 @@
 #include <algorithm>
 #include <string>
 #include <mutex>
+#include <map>
 #include <unordered_map>
 #include <unordered_set>
 #include <chrono>
@@ -77,12 +78,14 @@ static IPreferences* prefs;
 static std::atomic<int64_t> nextInstanceId(duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count());
 
 static const int kDefaultMaxCacheFiles = 35;
+static const int kDefaultMaxCacheSizeMegabytes = 1024;
 static const int kDefaultPreCacheSizeBytes = 524288; /*2^19 */
 static const int kDefaultChunkSizeBytes = 131072; /* 2^17 */
 static const int kDefaultConnectionTimeoutSeconds = 15;
 static const int kDefaultReadTimeoutSeconds = 30;
 
 static const std::string kMaxCacheFiles = "max_cache_files";
+static const std::string kMaxCacheSizeMegabytesKey = "max_cache_size_mb";
 static const std::string kPreCacheBufferSizeBytesKey = "precache_buffer_size_bytes";
 static const std::string kChunkSizeBytesKey = "chunk_size_bytes";
 static const std::string kConnectionTimeoutSecondsKey = "connection_timeout_seconds";
@@ -108,6 +111,7 @@ extern "C" DLLEXPORT void SetPreferences(IPreferences * prefs) {
 extern "C" DLLEXPORT musik::core::sdk::ISchema * GetSchema() {
     auto schema = new TSchema<>();
     schema->AddInt(kMaxCacheFiles, kDefaultMaxCacheFiles);
+    schema->AddInt(kMaxCacheSizeMegabytesKey, kDefaultMaxCacheSizeMegabytes, 16);
     schema->AddInt(kPreCacheBufferSizeBytesKey, kDefaultPreCacheSizeBytes, 32768);
     schema->AddInt(kChunkSizeBytesKey, kDefaultChunkSizeBytes, 32768);
     schema->AddInt(kConnectionTimeoutSecondsKey, kDefaultConnectionTimeoutSeconds, 1);
@@ -155,12 +159,15 @@ class FileReadStream {
 
         void Reset() {
             this->interrupted = false;
-            this->length = 0;
+            this->extents.clear();
 
             if (this->file) {
                 fseek(this->file, 0, SEEK_END);
-                this->length = (PositionType) ftell(this->file);
+                const PositionType length = (PositionType) ftell(this->file);
                 fseek(this->file, 0, SEEK_SET);
+                if (length > 0) {
+                    this->extents[0] = length;
+                }
             }
         }
 
@@ -170,21 +177,114 @@ class FileReadStream {
             this->underflow.notify_all();
         }
 
-        void Add(PositionType length) {
+        /* marks [offset, offset + length) as downloaded, coalescing with any
+        adjacent or overlapping extents. */
+        void Add(PositionType offset, PositionType length) {
             std::unique_lock<std::mutex> lock(this->mutex);
-            this->length += length;
+
+            if (length <= 0) {
+                return;
+            }
+
+            PositionType start = offset, end = offset + length;
+
+            auto it = this->extents.upper_bound(start);
+            if (it != this->extents.begin()) {
+                auto prev = std::prev(it);
+                if (prev->second >= start) {
+                    start = prev->first;
+                    end = std::max(end, prev->second);
+                    it = this->extents.erase(prev);
+                }
+            }
+
+            while (it != this->extents.end() && it->first <= end) {
+                end = std::max(end, it->second);
+                it = this->extents.erase(it);
+            }
+
+            this->extents[start] = end;
             this->underflow.notify_all();
         }
 
-        void Completed() {
+        void SetLength(PositionType length) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->maxLength = length;
+            this->underflow.notify_all();
+        }
+
+        /* restores the state of a resumed partial download */
+        void Restore(const LruDiskCache::Extents& extents, PositionType length) {
             std::unique_lock<std::mutex> lock(this->mutex);
+            this->extents.clear();
+            for (auto& extent : extents) {
+                this->extents[(PositionType) extent.first] = (PositionType) extent.second;
+            }
             this->maxLength = length;
+            this->sparse = true;
+        }
+
+        LruDiskCache::Extents Extents() {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            LruDiskCache::Extents result;
+            for (auto& extent : this->extents) {
+                result[extent.first] = extent.second;
+            }
+            return result;
+        }
+
+        /* forgets everything that was downloaded; the file is about to be
+        rewritten sequentially from the beginning. */
+        void Discard() {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->extents.clear();
+            this->maxLength = -1;
+            this->sparse = false;
+            this->underflow.notify_all();
+        }
+
+        void SetSparse(bool sparse) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->sparse = sparse;
+        }
+
+        void Completed() {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->maxLength = this->ContiguousEnd(0);
+            this->underflow.notify_all();
+        }
+
+        bool Available(PositionType position) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            return this->ContiguousEnd(position) > position;
+        }
+
+        /* finds the first missing byte range at or after `hint`, wrapping
+        around to the beginning of the file. `to` is inclusive, or -1 if the
+        hole extends to the end of the file. returns false if there are no
+        holes left. */
+        bool NextHole(PositionType hint, PositionType total, PositionType& from, PositionType& to) {
+            std::unique_lock<std::mutex> lock(this->mutex);
+
+            for (PositionType start : { std::max((PositionType) 0, hint), (PositionType) 0 }) {
+                PositionType position = std::max(start, this->ContiguousEnd(start));
+                if (position < total) {
+                    auto next = this->extents.upper_bound(position);
+                    from = position;
+                    to = (next == this->extents.end()) ? -1 : next->first - 1;
+                    return true;
+                }
+            }
+
+            return false;
         }
 
         PositionType Read(void* buffer, PositionType readBytes) {
             std::unique_lock<std::mutex> lock(this->mutex);
-            while (this->Position() >= this->length && !this->Eof() && !this->interrupted) {
+            PositionType end = this->ContiguousEnd(this->Position());
+            while (end <= this->Position() && !this->Eof() && !this->interrupted) {
                 this->underflow.wait(lock);
+                end = this->ContiguousEnd(this->Position());
             }
 
             if (this->interrupted || this->Eof()) {
@@ -192,15 +292,26 @@ class FileReadStream {
             }
 
             clearerr(this->file);
-            const int available = this->length - this->Position();
-            const unsigned actualReadBytes = std::max(0, std::min(available, (int) readBytes));
+            const PositionType available = end - this->Position();
+            const size_t actualReadBytes = (size_t) std::max((PositionType) 0, std::min(available, readBytes));
             return (PositionType) fread(buffer, 1, actualReadBytes, this->file);
         }
 
         bool SetPosition(PositionType position) {
             std::unique_lock<std::mutex> lock(this->mutex);
-            while (position > this->length && !this->Eof() && !this->interrupted) {
-                this->underflow.wait(lock);
+
+            /* if the server supports range requests the region will be filled
+            in out of order; Read() will wait for it. otherwise wait for the
+            sequential download to catch up. */
+            if (this->sparse && this->maxLength > 0) {
+                if (position > this->maxLength) {
+                    return false;
+                }
+            }
+            else {
+                while (position > this->ContiguousEnd(0) && !this->Eof() && !this->interrupted) {
+                    this->underflow.wait(lock);
+                }
             }
 
             /* if we've been interrupted, or we know we're at EOF and have been asked
@@ -221,11 +332,26 @@ class FileReadStream {
             return this->maxLength > 0 && this->Position() >= this->maxLength;
         }
 
+        /* end of the downloaded extent containing `position`, or `position`
+        itself if it hasn't been downloaded yet. */
+        PositionType ContiguousEnd(PositionType position) {
+            auto it = this->extents.upper_bound(position);
+            if (it != this->extents.begin()) {
+                --it;
+                if (it->second > position) {
+                    return it->second;
+                }
+            }
+            return position;
+        }
+
         FILE* file;
-        PositionType length, maxLength;
+        PositionType maxLength;
+        std::map<PositionType, PositionType> extents; /* start -> end (exclusive) */
         std::condition_variable underflow;
         std::mutex mutex;
         bool interrupted;
+        bool sparse{ false };
 };
 
 HttpDataStream::HttpDataStream() {
@@ -267,13 +393,17 @@ bool HttpDataStream::Open(const char *rawUri, OpenFlags flags) {
     this->precacheSizeBytes = prefs->GetInt(kPreCacheBufferSizeBytesKey.c_str(), kDefaultPreCacheSizeBytes);
     this->chunkSizeBytes = prefs->GetInt(kChunkSizeBytesKey.c_str(), kDefaultChunkSizeBytes);
     this->maxCacheFiles = prefs->GetInt(kMaxCacheFiles.c_str(), kDefaultMaxCacheFiles);
+    const int maxCacheSizeMegabytes = prefs->GetInt(kMaxCacheSizeMegabytesKey.c_str(), kDefaultMaxCacheSizeMegabytes);
 
     std::unordered_map<std::string, std::string> requestHeaders;
 
     {
         std::unique_lock<std::mutex> lock(this->stateMutex);
 
-        diskCache.Init(cachePath, this->maxCacheFiles);
+        diskCache.Init(
+            cachePath,
+            (size_t) std::max(1, this->maxCacheFiles),
+            (uint64_t) std::max(1, maxCacheSizeMegabytes) * 1024 * 1024);
 
         this->httpUri = rawUri;
 
@@ -309,7 +439,30 @@ bool HttpDataStream::Open(const char *rawUri, OpenFlags flags) {
             }
         }
 
-        this->ResetFileHandles();
+        /* if a previous download of this file was interrupted, pick it up
+        where it left off; the download thread will only request the ranges
+        that are still missing. */
+        std::string partialType, partialValidator;
+        size_t partialLength = 0;
+        LruDiskCache::Extents extents;
+        if (diskCache.Resume(id, this->instanceId, partialType, partialLength, partialValidator, extents)) {
+            this->writeFile = diskCache.Open(id, this->instanceId, "r+b");
+            if (this->writeFile) {
+                this->reader = std::make_shared<FileReadStream>(this->httpUri, this->instanceId);
+                this->reader->Restore(extents, (PositionType) partialLength);
+                this->length = this->resumedLength = partialLength;
+                this->validator = partialValidator;
+                this->rangesSupported = true;
+                if (!this->type.size()) {
+                    this->type = partialType;
+                }
+                this->resumed = true;
+            }
+        }
+
+        if (!this->resumed) {
+            this->ResetFileHandles();
+        }
     }
 
     if (this->writeFile && this->reader) {
@@ -358,22 +511,22 @@ bool HttpDataStream::Open(const char *rawUri, OpenFlags flags) {
         curl_easy_setopt(this->curlEasy, CURLOPT_SSL_VERIFYPEER, 0);
         curl_easy_setopt(this->curlEasy, CURLOPT_SSL_VERIFYHOST, 0);
 
-        /* append parsed headers, if any */
-        if (requestHeaders.size()) {
-            for (auto& kv : requestHeaders) {
-                auto header = kv.first + ": " + kv.second;
-                this->curlHeaders = curl_slist_append(this->curlHeaders, header.c_str());
-            }
-            curl_easy_setopt(this->curlEasy, CURLOPT_HTTPHEADER, this->curlHeaders);
+        /* parsed headers, if any, are sent with every request */
+        for (auto& kv : requestHeaders) {
+            this->requestHeaders.push_back(kv.first + ": " + kv.second);
         }
 
         /* start downloading... */
         this->state = State::Downloading;
         downloadThread = std::make_shared<std::thread>(&HttpDataStream::ThreadProc, this);
 
-        /* wait until we have a few hundred k of data */
-        std::unique_lock<std::mutex> lock(this->stateMutex);
-        startedContition.wait(lock);
+        /* wait until we have a few hundred k of data. if we're resuming we
+        also wait, even if we already have the beginning of the file, until
+        the server confirms it hasn't changed. */
+        {
+            std::unique_lock<std::mutex> lock(this->stateMutex);
+            startedContition.wait(lock);
+        }
 
         return this->state != State::Error;
     }
@@ -400,38 +553,142 @@ void HttpDataStream::ResetFileHandles() {
     }
 }
 
+void HttpDataStream::DiscardPartial() {
+    this->resumed = false;
+    this->validated = false;
+    this->validator.clear();
+    this->length = 0;
+    this->rangesSupported = false;
+    this->transferStart = 0;
+    this->writeCursor = 0;
+    this->written = 0;
+    this->reader->Discard();
+}
+
+void HttpDataStream::UpdateRequestHeaders(bool rangeRequest) {
+    if (this->curlHeaders) {
+        curl_slist_free_all(this->curlHeaders);
+        this->curlHeaders = nullptr;
+    }
+
+    for (auto& header : this->requestHeaders) {
+        this->curlHeaders = curl_slist_append(this->curlHeaders, header.c_str());
+    }
+
+    /* if the file changed since we downloaded what we've got, the server will
+    send all of it instead of the range */
+    if (rangeRequest && this->validator.size()) {
+        this->curlHeaders = curl_slist_append(
+            this->curlHeaders, ("If-Range: " + this->validator).c_str());
+    }
+
+    curl_easy_setopt(this->curlEasy, CURLOPT_HTTPHEADER, this->curlHeaders);
+}
+
+bool HttpDataStream::NextTransferRange(PositionType& from, PositionType& to) {
+    const PositionType seek = this->seekTo.exchange(-1);
+    const PositionType total = (PositionType) this->length;
+
+    if (this->rangesSupported && total > 0) {
+        /* start where the reader is waiting, then fill any holes that were
+        skipped over in the background. */
+        return this->reader->NextHole(seek, total, from, to);
+    }
+
+    /* no range support: one sequential transfer from the beginning. */
+    from = 0;
+    to = -1;
+    return true;
+}
+
 void HttpDataStream::ThreadProc() {
     if (this->curlEasy) {
         static const int kMaxRetries = 10;
         int retryCount = 0; /* note: weighted based on failure type */
         while (this->state != State::Downloaded && !this->interrupted) {
+            PositionType from = 0, to = -1;
+            if (!this->NextTransferRange(from, to)) {
+                /* every byte has been downloaded */
+                this->state = State::Downloaded;
+                this->reader->Completed();
+                break;
+            }
+
+            this->transferStart = from;
+            this->writeCursor = from;
+            this->written = 0;
+            this->responseStatus = 0;
+            fseek(this->writeFile, from, SEEK_SET);
+
+            std::string range;
+            if (from > 0 || to >= 0) {
+                range = std::to_string(from) + "-" + (to >= 0 ? std::to_string(to) : "");
+            }
+
+            curl_easy_setopt(this->curlEasy, CURLOPT_RANGE, range.size() ? range.c_str() : nullptr);
+            this->UpdateRequestHeaders(range.size() > 0);
+
             auto const curlCode = curl_easy_perform(this->curlEasy);
             long httpStatusCode = 0;
             curl_easy_getinfo(this->curlEasy, CURLINFO_RESPONSE_CODE, &httpStatusCode);
-            if (httpStatusCode == 200) {
-                this->state = curlCode != CURLE_OK
-                    ? State::Aborted
-                    : State::Downloaded;
-
-                if (this->reader) {
-                    if (this->written > 0) {
-                        this->reader->Add(this->written);
-                        this->written = 0;
+
+            if (this->discardPartial) {
+                /* the resumed partial download doesn't match the remote file
+                anymore; start over from scratch. */
+                this->discardPartial = false;
+                this->DiscardPartial();
+                continue;
+            }
+
+            if (this->reader && this->written > 0) {
+                this->reader->Add(this->writeCursor - this->written, this->written);
+                this->written = 0;
+            }
+
+            if (curlCode == CURLE_ABORTED_BY_CALLBACK) {
+                /* we killed the transfer ourselves, either to service a seek
+                or because we're being closed. this may happen before any
+                response headers arrive, so it can't go through the status
+                code checks below, and it's never worth retrying. */
+                this->state = this->interrupted ? State::Aborted : State::Downloading;
+                continue;
+            }
+
+            if (httpStatusCode == 200 || httpStatusCode == 206) {
+                if (curlCode == CURLE_OK) {
+                    if (this->transferStart == 0 && to < 0 && !this->rangesSupported) {
+                        /* a complete sequential download */
+                        this->state = State::Downloaded;
+                        if (this->reader) {
+                            this->reader->Completed();
+                        }
+                    }
+                    else {
+                        this->state = State::Downloading;
                     }
-                    this->reader->Completed();
                 }
+                else if (this->seekTo >= 0) {
+                    /* aborted to service a seek; pick up at the new offset */
+                    this->state = State::Downloading;
+                }
+                else {
+                    this->state = State::Aborted;
+                }
+            }
+            else if (httpStatusCode == 416 && range.size()) {
+                /* the server doesn't want to do ranges for this resource */
+                this->rangesSupported = false;
+                this->reader->SetSparse(false);
             }
             else {
                 if (httpStatusCode == 429) { /* too many requests */
-                     this->state = State::Retrying;
+                    this->state = State::Retrying;
                     retryCount += 1;
                     sleepMs(5000);
                 }
                 else if ((httpStatusCode < 400 || httpStatusCode >= 500) && retryCount < kMaxRetries) {
-                    {
-                        std::unique_lock<std::mutex> lock(this->stateMutex);
-                        this->ResetFileHandles();
-                    }
+                    /* downloaded extents are tracked, so a retry just resumes
+                    wherever data is still missing. */
                     this->state = State::Retrying;
                     retryCount += 2;
                     sleepMs(2000);
@@ -463,6 +720,11 @@ void HttpDataStream::ThreadProc() {
 }
 
 bool HttpDataStream::Close() {
+    if (this->closed) {
+        return true;
+    }
+
+    this->closed = true;
     this->Interrupt();
 
     /* wait for the download thread to stop, this will ensure file writes have
@@ -475,16 +737,26 @@ bool HttpDataStream::Close() {
     }
 
     /* need to close the reader so we can perform the filesystem operations below */
+    LruDiskCache::Extents extents;
+    if (this->reader && this->rangesSupported) {
+        extents = this->reader->Extents();
+    }
     this->reader.reset();
 
-    /* if we just downloaded the file let's rename it to its final name; if the
-    download failed, let's delete the temp file. */
+    /* if we just downloaded the file let's rename it to its final name. if we
+    only got part of it, and the server can fill in the rest with range
+    requests, keep it around so it can be resumed later. otherwise, delete
+    the temp file. */
     auto id = cacheId(this->httpUri);
     if (this->state == State::Downloaded) {
         diskCache.Finalize(id, this->instanceId, this->Type());
     }
     else if (this->state != State::Cached) {
-        diskCache.Delete(id, this->instanceId);
+        if (this->state == State::Error || extents.empty() ||
+            !diskCache.Suspend(id, this->instanceId, this->Type(), this->length, this->validator, extents))
+        {
+            diskCache.Delete(id, this->instanceId);
+        }
     }
 
     return true;
@@ -502,7 +774,26 @@ PositionType HttpDataStream::Read(void* buffer, PositionType readBytes) {
 
 bool HttpDataStream::SetPosition(PositionType position) {
     auto reader = this->reader;
-    return reader ? reader->SetPosition(position) : 0;
+
+    if (!reader) {
+        return false;
+    }
+
+    /* if the target hasn't been downloaded and the current transfer won't
+    reach it soon, redirect the download there instead of waiting for it to
+    catch up. */
+    if (this->rangesSupported &&
+        this->state != State::Downloaded &&
+        this->state != State::Cached &&
+        !reader->Available(position))
+    {
+        const PositionType cursor = this->writeCursor;
+        if (position < cursor || position > cursor + this->precacheSizeBytes) {
+            this->seekTo = position;
+        }
+    }
+
+    return reader->SetPosition(position);
 }
 
 bool HttpDataStream::Seekable() {
@@ -538,10 +829,11 @@ size_t HttpDataStream::CurlWriteCallback(char *ptr, size_t size, size_t nmemb, v
     const size_t result = fwrite(ptr, size, nmemb, stream->writeFile);
     fflush(stream->writeFile); /* normally we wouldn't want to do this, but it ensures
      data written is available immediately to any simultaneous readers */
-    stream->written += result;
+    stream->written += (long) result;
+    stream->writeCursor += (PositionType) result;
 
     if (stream->written >= stream->chunkSizeBytes) {
-        stream->reader->Add(stream->written);
+        stream->reader->Add(stream->writeCursor - stream->written, stream->written);
         stream->written = 0;
     }
 
@@ -561,10 +853,92 @@ size_t HttpDataStream::CurlReadHeaderCallback(char *buffer, size_t size, size_t
 
     std::string header(buffer, size * nitems);
 
+    if (header.find("HTTP/") == 0) {
+        /* status line. note there may be more than one if we're redirected */
+        auto parts = str::Split(header, " ");
+        stream->responseStatus = parts.size() > 1 ? std::atol(parts[1].c_str()) : 0;
+        if (stream->responseStatus == 200 && stream->transferStart > 0) {
+            /* we asked for a range but the server is sending the whole thing
+            (possibly because it changed, see If-Range); stop asking, and
+            write from the beginning of the file. */
+            stream->rangesSupported = false;
+            stream->reader->Discard();
+            stream->transferStart = 0;
+            stream->writeCursor = 0;
+            fseek(stream->writeFile, 0, SEEK_SET);
+        }
+        stream->acceptRanges = stream->estimatedLength = false;
+        stream->responseValidator.clear();
+        return size * nitems;
+    }
+
+    if (header == "\r\n" || header == "\n") {
+        /* end of headers; now that we know the length we can decide whether
+        or not to download out of order. */
+        const bool success = stream->responseStatus == 200 || stream->responseStatus == 206;
+
+        if (success && stream->resumed && !stream->validated) {
+            /* bytes from a previous session are only good if this is a partial
+            response for the same version, and length, of the file. */
+            if (stream->responseStatus != 206 ||
+                stream->responseValidator != stream->validator ||
+                stream->length != stream->resumedLength)
+            {
+                stream->discardPartial = true;
+                return 0; /* aborts the transfer */
+            }
+            stream->validated = true;
+            stream->startedContition.notify_all();
+        }
+
+        if (success && (stream->responseStatus == 200 || stream->validator.empty())) {
+            stream->validator = stream->responseValidator;
+        }
+
+        if (success && stream->acceptRanges && !stream->estimatedLength && stream->length > 0) {
+            if (!stream->rangesSupported) {
+                stream->rangesSupported = true;
+                stream->reader->SetSparse(true);
+            }
+            stream->reader->SetLength((PositionType) stream->length);
+        }
+        return size * nitems;
+    }
+
     std::string key, value;
     if (parseHeader(header, key, value)) {
         if (key == "Content-Length") {
-            stream->length = std::atoi(value.c_str());
+            /* for 206 responses this is the length of the range, not the file */
+            if (stream->responseStatus != 206) {
+                stream->length = std::atoi(value.c_str());
+            }
+        }
+        else if (key == "Content-Range") {
+            /* bytes <from>-<to>/<total>; a partial response implies range support */
+            const size_t slash = value.find('/');
+            if (slash != std::string::npos && slash + 1 < value.size() && value[slash + 1] != '*') {
+                stream->length = (size_t) std::atol(value.substr(slash + 1).c_str());
+                stream->acceptRanges = true;
+            }
+        }
+        else if (key == "Accept-Ranges") {
+            stream->acceptRanges = (value == "bytes");
+        }
+        else if (key == "ETag") {
+            /* If-Range only works with strong etags */
+            if (value.find("W/") != 0) {
+                stream->responseValidator = value;
+            }
+        }
+        else if (key == "Last-Modified") {
+            /* only used if there's no (strong) etag */
+            if (stream->responseValidator.empty() || stream->responseValidator[0] != '"') {
+                stream->responseValidator = value;
+            }
+        }
+        else if (key == "X-musikcube-Estimated-Content-Length") {
+            /* on-demand transcodes can't be seeked into on the server side */
+            stream->estimatedLength = true;
         }
         else if (key == "Content-Type") {
             if (!stream->type.size()) {
@@ -580,7 +954,7 @@ int HttpDataStream::CurlTransferCallback(
     void *ptr, curl_off_t downTotal, curl_off_t downNow, curl_off_t upTotal, curl_off_t upNow)
 {
     HttpDataStream* stream = static_cast<HttpDataStream*>(ptr);
-    if (stream->interrupted) {
+    if (stream->interrupted || (stream->seekTo >= 0 && stream->rangesSupported)) {
         return -1; /* kill the stream */
     }
     return 0; /* ok! */
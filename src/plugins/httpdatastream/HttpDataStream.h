@@ -41,6 +41,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <vector>
 
 using namespace musik::core::sdk;
 
@@ -71,6 +72,7 @@ class HttpDataStream : public IDataStream {
         const char* Uri() override;
         void Interrupt() override;
         bool CanPrefetch() override;
+        PositionType ReadWindow(const void** window, PositionType maxBytes) override { return -1; }
 
     private:
         enum class State {
@@ -86,6 +88,9 @@ class HttpDataStream : public IDataStream {
 
         void ThreadProc();
         void ResetFileHandles();
+        void DiscardPartial();
+        void UpdateRequestHeaders(bool rangeRequest);
+        bool NextTransferRange(PositionType& from, PositionType& to);
 
         static size_t CurlWriteCallback(char *ptr, size_t size, size_t nmemb, void *userdata);
         static size_t CurlReadHeaderCallback(char *buffer, size_t size, size_t nitems, void *userdata);
@@ -104,12 +109,33 @@ class HttpDataStream : public IDataStream {
 
         std::atomic<long> written, totalWritten;
         std::atomic<bool> interrupted;
+
+        /* range request support: `seekTo` is set by SetPosition() when the
+        reader jumps outside of the region currently being downloaded; the
+        transfer is aborted and restarted at the requested offset. */
+        std::atomic<bool> rangesSupported{ false };
+        std::atomic<PositionType> seekTo{ -1 };
+        std::atomic<PositionType> writeCursor{ 0 };
+        PositionType transferStart{ 0 };
+        long responseStatus{ 0 };
+        bool acceptRanges{ false }, estimatedLength{ false };
         std::atomic<State> state;
 
+        /* `validator` is the etag (or last-modified date) of the bytes in the
+        temp file, and is sent with range requests via If-Range. the bytes of
+        a resumed partial download aren't trusted until the first response
+        confirms both the validator and the total length. */
+        std::string validator, responseValidator;
+        std::vector<std::string> requestHeaders;
+        size_t resumedLength{ 0 };
+        bool resumed{ false }, validated{ false };
+        std::atomic<bool> discardPartial{ false };
+
         std::mutex stateMutex;
         std::condition_variable startedContition;
         std::shared_ptr<std::thread> downloadThread;
         std::shared_ptr<FileReadStream> reader;
         int precacheSizeBytes, chunkSizeBytes, maxCacheFiles;
         int64_t instanceId;
+        bool closed{ false };
 };
\ No newline at end of file
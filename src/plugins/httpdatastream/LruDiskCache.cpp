@@ -40,10 +40,19 @@
 
 #include <algorithm>
 #include <filesystem>
+#include <fstream>
+#include <vector>
 #include <chrono>
 
+#pragma warning(push, 0)
+#include <../../3rdparty/include/nlohmann/json.hpp>
+#pragma warning(pop)
+
 const std::string PREFIX = "musikcube";
 const std::string TEMP_EXTENSION = ".tmp";
+const std::string PARTIAL_EXTENSION = ".part";
+const std::string INDEX_FILENAME = "index.json";
+const int INDEX_VERSION = 1;
 
 namespace fs = std::filesystem;
 using namespace musik::core::sdk;
@@ -54,34 +63,28 @@ static std::string tempFilename(const std::string& root, size_t id, int64_t inst
     return root + "/" + PREFIX + "_" + std::to_string(id) + "_" + std::to_string(instanceId) + TEMP_EXTENSION;
 }
 
+static std::string partialFilename(const std::string& root, size_t id) {
+    return root + "/" + PREFIX + "_" + std::to_string(id) + PARTIAL_EXTENSION;
+}
+
 static std::string finalFilename(const std::string& root, size_t id, std::string type) {
     str::ReplaceAll(type, "/", "-");
     return root + "/" + PREFIX + "_" + std::to_string(id) + "_" + type;
 }
 
-static bool isTemp(const fs::path& path) {
-    return path.extension().u8string() == TEMP_EXTENSION;
-}
-
-static bool isTemp(const std::string& path) {
-    return isTemp(fs::path(fs::u8path(path)));
+static bool hasExtension(const fs::path& path, const std::string& extension) {
+    return path.extension().u8string() == extension;
 }
 
-static std::filesystem::file_time_type touch(const std::string& path) {
-    auto fsPath = fs::u8path(path);
-    try {
-        std::chrono::time_point now = fs::file_time_type::clock::now();
-        fs::last_write_time(fsPath, now);
-    }
-    catch (...) {
-    }
-
-    return fs::last_write_time(fsPath);
+static uint64_t fileSize(const std::string& path) {
+    std::error_code ec;
+    auto size = fs::file_size(fs::u8path(path), ec);
+    return ec ? 0 : (uint64_t) size;
 }
 
 static bool rm(const std::string& path) {
     try {
-        return fs::remove(fs::path(path));
+        return fs::remove(fs::u8path(path));
     }
     catch (...) {
 
@@ -94,40 +97,92 @@ static bool rm(const fs::path& p) {
     return rm(p.u8string());
 }
 
+static bool mv(const std::string& from, const std::string& to) {
+    std::error_code ec;
+    fs::rename(fs::u8path(from), fs::u8path(to), ec);
+    return !ec;
+}
+
 LruDiskCache::LruDiskCache()
 : maxEntries(10)
-, initialized(false) {
+, maxBytes(UINT64_MAX)
+, totalBytes(0)
+, initialized(false)
+, indexDirty(false) {
+
+}
 
+LruDiskCache::~LruDiskCache() {
+    /* recency changes from cache hits are only written when something else
+    changes the index; make sure the latest order survives a clean exit. */
+    Lock lock(this->stateMutex);
+    if (this->initialized && this->indexDirty) {
+        this->SaveIndex();
+    }
 }
 
-void LruDiskCache::Init(const std::string& root, size_t maxEntries) {
+void LruDiskCache::Init(const std::string& root, size_t maxEntries, uint64_t maxBytes) {
     Lock lock(this->stateMutex);
 
     if (!this->initialized) {
         this->initialized = true;
         this->root = root;
         this->maxEntries = maxEntries;
+        this->maxBytes = maxBytes;
+
+        /* temp files belong to streams from a previous session that didn't
+        shut down cleanly; we don't know which ranges they contain, so they
+        can't be resumed. */
+        this->Purge();
 
-        this->Purge(); /* always purge partial files on startup */
+        /* restore recency order, and any resumable partial downloads, from the
+        index. then pick up completed files that aren't in it (e.g. the index
+        was lost, or the cache was written by an older version). */
+        this->LoadIndex();
 
-        /* index all the completed files... */
+        std::vector<EntryPtr> unindexed;
         std::error_code ec;
         fs::directory_iterator end;
         fs::directory_iterator file(fs::u8path(this->root), ec);
 
         while (file != end) {
             if (!is_directory(file->status())) {
-                if (!isTemp(file->path())) {
-                    auto entry = LruDiskCache::Parse(file->path());
-                    if (entry) {
-                        this->cached.push_back(entry);
+                auto const path = file->path();
+                if (hasExtension(path, PARTIAL_EXTENSION)) {
+                    auto entry = LruDiskCache::Parse(path);
+                    if (!entry || this->index.find(entry->id) == this->index.end()) {
+                        rm(path); /* partial without extents, unusable */
+                    }
+                }
+                else if (path.filename().u8string() != INDEX_FILENAME) {
+                    auto entry = LruDiskCache::Parse(path);
+                    if (entry && this->index.find(entry->id) == this->index.end()) {
+                        unindexed.push_back(entry);
                     }
                 }
             }
             ++file;
         }
 
-        this->SortAndPrune();
+        std::vector<std::pair<fs::file_time_type, EntryPtr>> byTime;
+        for (auto& entry : unindexed) {
+            std::error_code timeEc;
+            byTime.push_back({ fs::last_write_time(fs::u8path(entry->path), timeEc), entry });
+        }
+
+        std::sort(byTime.begin(), byTime.end(), [](auto& a, auto& b) {
+            return a.first > b.first;
+        });
+
+        for (auto& it : byTime) {
+            auto entry = it.second;
+            this->lru.push_back(entry);
+            this->index[entry->id] = std::prev(this->lru.end());
+            this->totalBytes += entry->bytes;
+        }
+
+        this->Prune();
+        this->SaveIndex();
     }
 }
 
@@ -140,7 +195,7 @@ void LruDiskCache::Purge() {
 
     while (file != end) {
         if (!is_directory(file->status())) {
-            if (isTemp(file->path())) {
+            if (hasExtension(file->path(), TEMP_EXTENSION)) {
                 rm(file->path());
             }
         }
@@ -150,15 +205,28 @@ void LruDiskCache::Purge() {
 
 LruDiskCache::EntryPtr LruDiskCache::Parse(const fs::path& path) {
     std::string fn = path.stem().u8string() + path.extension().u8string();
+
+    if (hasExtension(path, TEMP_EXTENSION)) {
+        return EntryPtr();
+    }
+
+    bool partial = hasExtension(path, PARTIAL_EXTENSION);
+    if (partial) {
+        fn = path.stem().u8string();
+    }
+
     std::vector<std::string> parts = str::Split(fn, "_");
-    if (parts.size() == 3 && parts[0] == PREFIX) {
+    if (parts.size() == (partial ? 2 : 3) && parts[0] == PREFIX) {
         try {
             auto entry = std::shared_ptr<Entry>(new Entry());
             entry->id = std::stoull(parts[1].c_str());
             entry->path = path.u8string();
-            entry->type = parts[2];
-            entry->time = fs::last_write_time(path);
-            str::ReplaceAll(entry->type, "-", "/");
+            entry->partial = partial;
+            entry->bytes = fileSize(entry->path);
+            if (!partial) {
+                entry->type = parts[2];
+                str::ReplaceAll(entry->type, "-", "/");
+            }
             return entry;
         }
         catch (...) {
@@ -169,6 +237,144 @@ LruDiskCache::EntryPtr LruDiskCache::Parse(const fs::path& path) {
     return EntryPtr();
 }
 
+void LruDiskCache::LoadIndex() {
+    Lock lock(this->stateMutex);
+
+    try {
+        std::ifstream in(fs::u8path(this->root + "/" + INDEX_FILENAME));
+        if (!in.is_open()) {
+            return;
+        }
+
+        nlohmann::json json;
+        in >> json;
+
+        if (json.value("version", 0) != INDEX_VERSION) {
+            return;
+        }
+
+        for (auto& item : json["entries"]) {
+            auto entry = std::shared_ptr<Entry>(new Entry());
+            entry->id = item.value("id", (uint64_t) 0);
+            entry->type = item.value("type", "");
+            entry->partial = item.value("partial", false);
+            entry->length = item.value("length", (size_t) 0);
+            entry->validator = item.value("validator", "");
+            entry->path = entry->partial
+                ? partialFilename(this->root, entry->id)
+                : finalFilename(this->root, entry->id, entry->type);
+
+            if (entry->partial) {
+                for (auto& extent : item["extents"]) {
+                    entry->extents[extent[0].get<int64_t>()] = extent[1].get<int64_t>();
+                }
+            }
+
+            if (this->index.find(entry->id) != this->index.end() ||
+                !fs::exists(fs::u8path(entry->path)))
+            {
+                continue; /* duplicate, or the file is gone */
+            }
+
+            entry->bytes = fileSize(entry->path);
+            this->lru.push_back(entry);
+            this->index[entry->id] = std::prev(this->lru.end());
+            this->totalBytes += entry->bytes;
+        }
+    }
+    catch (...) {
+        /* corrupt index; whatever we managed to read is still valid, and the
+        remaining files will be picked up by the directory scan. */
+    }
+}
+
+void LruDiskCache::SaveIndex() {
+    Lock lock(this->stateMutex);
+
+    this->indexDirty = false;
+
+    nlohmann::json entries = nlohmann::json::array();
+
+    for (auto& entry : this->lru) {
+        nlohmann::json item = {
+            { "id", entry->id },
+            { "type", entry->type },
+            { "partial", entry->partial },
+        };
+
+        if (entry->partial) {
+            nlohmann::json extents = nlohmann::json::array();
+            for (auto& extent : entry->extents) {
+                extents.push_back({ extent.first, extent.second });
+            }
+            item["length"] = entry->length;
+            item["validator"] = entry->validator;
+            item["extents"] = extents;
+        }
+
+        entries.push_back(item);
+    }
+
+    nlohmann::json json = {
+        { "version", INDEX_VERSION },
+        { "entries", entries }
+    };
+
+    /* write to a temp file and move it into place so a crash mid-write
+    doesn't leave a truncated index behind. */
+    const std::string fn = this->root + "/" + INDEX_FILENAME;
+    const std::string tmp = fn + TEMP_EXTENSION;
+
+    {
+        std::ofstream out(fs::u8path(tmp), std::ios::out | std::ios::trunc);
+        if (!out.is_open()) {
+            return;
+        }
+        out << json.dump();
+    }
+
+    if (!mv(tmp, fn)) {
+        rm(fn);
+        mv(tmp, fn);
+    }
+}
+
+void LruDiskCache::Insert(EntryPtr entry) {
+    this->Remove(entry->id, false);
+    this->lru.push_front(entry);
+    this->index[entry->id] = this->lru.begin();
+    this->totalBytes += entry->bytes;
+    this->Prune();
+}
+
+void LruDiskCache::Remove(uint64_t id, bool deleteFile) {
+    auto it = this->index.find(id);
+    if (it != this->index.end()) {
+        auto entry = *it->second;
+        this->totalBytes -= std::min(this->totalBytes, entry->bytes);
+        this->lru.erase(it->second);
+        this->index.erase(it);
+        if (deleteFile) {
+            rm(entry->path);
+        }
+    }
+}
+
+void LruDiskCache::Prune() {
+    /* evict from the tail until we're within both budgets, but always keep
+    the newest entry. if the victim can't be removed (e.g. it's open on
+    Windows) stop; we'll try again the next time something is added. */
+    while (this->lru.size() > 1 &&
+        (this->lru.size() > this->maxEntries || this->totalBytes > this->maxBytes))
+    {
+        auto entry = this->lru.back();
+        if (fs::exists(fs::u8path(entry->path)) && !rm(entry->path)) {
+            break;
+        }
+        this->Remove(entry->id, false);
+    }
+}
+
 bool LruDiskCache::Finalize(size_t id, int64_t instanceId, std::string type) {
     Lock lock(stateMutex);
 
@@ -176,42 +382,121 @@ bool LruDiskCache::Finalize(size_t id, int64_t instanceId, std::string type) {
         type = "unknown";
     }
 
-    fs::path src(tempFilename(this->root, instanceId, id));
-    fs::path dst(finalFilename(this->root, id, type));
+    const std::string src = tempFilename(this->root, id, instanceId);
+    const std::string dst = finalFilename(this->root, id, type);
 
-    if (fs::exists(src)) {
-        if (fs::exists(dst)) {
+    if (fs::exists(fs::u8path(src))) {
+        this->Remove(id, true);
+
+        if (fs::exists(fs::u8path(dst))) {
             if (!rm(dst)) {
                 return false;
             }
         }
 
-        try {
-            fs::rename(src, dst);
-        }
-        catch (...) {
+        if (!mv(src, dst)) {
             return false;
         }
 
-        auto entry = LruDiskCache::Parse(dst);
+        auto entry = LruDiskCache::Parse(fs::u8path(dst));
         if (entry) {
-            this->cached.push_back(entry);
-            this->SortAndPrune();
+            this->Insert(entry);
+            this->SaveIndex();
         }
     }
 
     return true;
 }
 
-bool LruDiskCache::Cached(size_t id) {
+bool LruDiskCache::Suspend(
+    size_t id,
+    int64_t instanceId,
+    const std::string& type,
+    size_t length,
+    const std::string& validator,
+    const Extents& extents)
+{
     Lock lock(stateMutex);
 
-    auto end = this->cached.end();
-    auto it = std::find_if(this->cached.begin(), end, [id](EntryPtr entry) {
-        return entry->id == id;
-    });
+    const std::string src = tempFilename(this->root, id, instanceId);
+    const std::string dst = partialFilename(this->root, id);
 
-    return it != end;
+    /* without a validator there's no way to tell if the remote file changed
+    before we resume, so it's not worth keeping */
+    if (extents.empty() || validator.empty() || length == 0 || !fs::exists(fs::u8path(src))) {
+        rm(src);
+        return false;
+    }
+
+    this->Remove(id, true);
+    rm(dst);
+
+    if (!mv(src, dst)) {
+        rm(src);
+        return false;
+    }
+
+    auto entry = std::shared_ptr<Entry>(new Entry());
+    entry->id = id;
+    entry->path = dst;
+    entry->type = type;
+    entry->partial = true;
+    entry->length = length;
+    entry->validator = validator;
+    entry->extents = extents;
+    entry->bytes = fileSize(dst);
+
+    this->Insert(entry);
+    this->SaveIndex();
+
+    return true;
+}
+
+bool LruDiskCache::Resume(
+    size_t id,
+    int64_t instanceId,
+    std::string& type,
+    size_t& length,
+    std::string& validator,
+    Extents& extents)
+{
+    Lock lock(stateMutex);
+
+    auto it = this->index.find(id);
+    if (it == this->index.end() || !(*it->second)->partial) {
+        return false;
+    }
+
+    auto entry = *it->second;
+
+    if (entry->validator.empty() || entry->length == 0) {
+        /* found by the directory scan, or written by an older version */
+        this->Remove(id, true);
+        this->SaveIndex();
+        return false;
+    }
+
+    /* the partial file becomes this stream's temp file; it leaves the index
+    until it's either finalized or suspended again. */
+    this->Remove(id, false);
+    this->SaveIndex();
+
+    if (!mv(entry->path, tempFilename(this->root, id, instanceId))) {
+        rm(entry->path);
+        return false;
+    }
+
+    type = entry->type;
+    length = entry->length;
+    validator = entry->validator;
+    extents = entry->extents;
+    return true;
+}
+
+bool LruDiskCache::Cached(size_t id) {
+    Lock lock(stateMutex);
+    auto it = this->index.find(id);
+    return it != this->index.end() && !(*it->second)->partial;
 }
 
 FILE* LruDiskCache::Open(size_t id, int64_t instanceId, const std::string& mode) {
@@ -223,24 +508,28 @@ FILE* LruDiskCache::Open(size_t id, int64_t instanceId, const std::string& mode)
 FILE* LruDiskCache::Open(size_t id, int64_t instanceId, const std::string& mode, std::string& type, size_t& len) {
     Lock lock(stateMutex);
 
-    auto end = this->cached.end();
-    auto it = std::find_if(this->cached.begin(), end, [id](EntryPtr entry) {
-        return entry->id == id;
-    });
+    auto it = this->index.find(id);
 
     FILE* result = nullptr;
 
-    if (it != end) {
-        result = fopen((*it)->path.c_str(), mode.c_str());
+    if (it != this->index.end() && !(*it->second)->partial) {
+        auto entry = *it->second;
+
+        result = fopen(entry->path.c_str(), mode.c_str());
 
         if (result) {
-            type = (*it)->type;
+            type = entry->type;
             fseek(result, 0, SEEK_END);
             len = (size_t) ftell(result);
             fseek(result, 0, SEEK_SET);
+            this->Touch(id);
+        }
+        else {
+            /* unreadable; drop it from the index, but leave the file alone
+            in case it's still in use. the next Init() will rescan it. */
+            this->Remove(id, false);
+            this->SaveIndex();
         }
-
-        this->Touch(id);
     }
 
     if (result) {
@@ -255,62 +544,28 @@ FILE* LruDiskCache::Open(size_t id, int64_t instanceId, const std::string& mode,
     }
 
     /* open the file and return it regardless of cache status. */
-    return fopen(tempFilename(this->root, instanceId, id).c_str(), mode.c_str());
+    return fopen(tempFilename(this->root, id, instanceId).c_str(), mode.c_str());
 }
 
 void LruDiskCache::Delete(size_t id, int64_t instanceId) {
     Lock lock(stateMutex);
 
-    auto it = this->cached.begin();
-    while (it != this->cached.end()) {
-        if ((*it)->id == id) {
-            rm((*it)->path);
-            return;
-        }
-        else {
-            ++it;
-        }
-    }
-
+    /* only the caller's own temp file is removed. indexed entries are shared
+    by every stream for this id, so another instance may still be reading
+    one; they only go away via Prune() or when they can't be opened. */
     rm(tempFilename(this->root, id, instanceId));
 }
 
-void LruDiskCache::SortAndPrune() {
+void LruDiskCache::Touch(size_t id) {
     Lock lock(this->stateMutex);
 
-    std::sort( /* sort by access time */
-        this->cached.begin(),
-        this->cached.end(),
-        [](EntryPtr e1, EntryPtr e2) {
-            return e1->time > e2->time;
-        });
+    auto it = this->index.find(id);
+    if (it != this->index.end() && it->second != this->lru.begin()) {
+        /* O(1): move to the front of the list, iterators stay valid */
+        this->lru.splice(this->lru.begin(), this->lru, it->second);
 
-    /* prune old entries */
-    int count = (int) this->cached.size();
-    int extras = count - this->maxEntries;
-    for (int i = 0; i < extras; i++) {
-        auto entry = this->cached.back();
-        if (rm(entry->path)) {
-            this->cached.pop_back();
-        }
+        /* don't write the index on the read path; it's persisted along with
+        the next insert, eviction or removal, or at shutdown. */
+        this->indexDirty = true;
     }
 }
-
-void LruDiskCache::Touch(size_t id) {
-    Lock lock(this->stateMutex);
-
-    auto end = this->cached.end();
-    auto it = std::find_if(this->cached.begin(), end, [id](EntryPtr entry) {
-        return entry->id == id;
-    });
-
-    if (it != end) {
-        auto e = (*it);
-        fs::path p(e->path);
-        if (fs::exists(p)) {
-            e->time = touch(p.u8string());
-            this->SortAndPrune();
-            return;
-        }
-    }
-}
\ No newline at end of file
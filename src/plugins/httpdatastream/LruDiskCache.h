@@ -32,17 +32,24 @@
 //
 //////////////////////////////////////////////////////////////////////////////
 
+#pragma once
+
 #include <string>
-#include <vector>
+#include <list>
+#include <map>
+#include <unordered_map>
 #include <mutex>
 #include <memory>
-#include <ctime>
 #include <cstdint>
 #include <filesystem>
 
 class LruDiskCache {
     public:
+        /* downloaded byte ranges of a partial file: start -> end (exclusive) */
+        using Extents = std::map<int64_t, int64_t>;
+
         LruDiskCache();
+        ~LruDiskCache();
 
         void Purge();
 
@@ -53,27 +60,46 @@ class LruDiskCache {
         void Delete(size_t id, int64_t instanceId);
         void Touch(size_t id);
 
-        void Init(const std::string& root, size_t maxEntries);
+        /* partial downloads. Suspend() keeps an unfinished temp file around,
+        along with the ranges that were downloaded and the validator (etag or
+        last-modified) of the response they came from, so a later Resume()
+        can pick up where it left off if the remote file hasn't changed. */
+        bool Suspend(size_t id, int64_t instanceId, const std::string& type, size_t length, const std::string& validator, const Extents& extents);
+        bool Resume(size_t id, int64_t instanceId, std::string& type, size_t& length, std::string& validator, Extents& extents);
+
+        void Init(const std::string& root, size_t maxEntries, uint64_t maxBytes);
 
     private:
         struct Entry {
             uint64_t id;
             std::string path;
             std::string type;
-            std::filesystem::file_time_type time;
+            uint64_t bytes{ 0 };
+            bool partial{ false };
+            size_t length{ 0 };
+            std::string validator;
+            Extents extents;
         };
 
         using EntryPtr = std::shared_ptr<Entry>;
-        using EntryList = std::vector<EntryPtr>;
+        using EntryList = std::list<EntryPtr>; /* most recently used first */
+        using EntryMap = std::unordered_map<uint64_t, EntryList::iterator>;
 
-        void SortAndPrune();
+        void Insert(EntryPtr entry);
+        void Remove(uint64_t id, bool deleteFile);
+        void Prune();
+        void LoadIndex();
+        void SaveIndex();
 
         static std::shared_ptr<Entry> Parse(const std::filesystem::path& path);
 
         std::recursive_mutex stateMutex;
 
         bool initialized;
+        bool indexDirty;
         size_t maxEntries;
-        EntryList cached;
+        uint64_t maxBytes, totalBytes;
+        EntryList lru;
+        EntryMap index;
         std::string root;
 };
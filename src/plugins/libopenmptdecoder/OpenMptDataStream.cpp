@@ -127,3 +127,7 @@ const char* OpenMptDataStream::Uri() {
 bool OpenMptDataStream::CanPrefetch() {
     return this->stream->CanPrefetch();
 }
+
+PositionType OpenMptDataStream::ReadWindow(const void** window, PositionType maxBytes) {
+    return this->stream->ReadWindow(window, maxBytes);
+}
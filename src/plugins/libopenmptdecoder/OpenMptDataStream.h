@@ -62,6 +62,7 @@ class OpenMptDataStream: public musik::core::sdk::IDataStream {
         virtual const char* Type() override;
         virtual const char* Uri() override;
         virtual bool CanPrefetch() override;
+        virtual PositionType ReadWindow(const void** window, PositionType maxBytes) override;
 
         bool Parse(const char* uri);
         int GetTrackNumber() { return this->trackNumber; }
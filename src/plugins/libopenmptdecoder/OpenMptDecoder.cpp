@@ -36,6 +36,7 @@
 #include "OpenMptDataStream.h"
 #include <musikcore/sdk/IDebug.h>
 #include <cassert>
+#include <algorithm>
 
 using namespace musik::core::sdk;
 
@@ -106,14 +107,27 @@ bool OpenMptDecoder::Open(musik::core::sdk::IDataStream *stream) {
         this->isWrappedStream = true; /* we need to clean it up later */
     }
 
-    openmpt_stream_callbacks callbacks = { 0 };
-    callbacks.read = readCallback;
-    callbacks.seek = seekCallback;
-    callbacks.tell = tellCallback;
+    /* memory mapped streams can give us the whole file without copying it
+    through the stream callbacks first. */
+    const void* window = nullptr;
+    const PositionType length = mptStream->Length();
+    if (length > 0 && mptStream->ReadWindow(&window, length) == length) {
+        this->module = openmpt_module_create_from_memory2(
+            window, (size_t) length, logCallback,
+            nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+    }
+    else {
+        mptStream->SetPosition(0); /* in case we got a partial window */
 
-    this->module = openmpt_module_create2(
-        callbacks, this, logCallback,
-        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+        openmpt_stream_callbacks callbacks = { 0 };
+        callbacks.read = readCallback;
+        callbacks.seek = seekCallback;
+        callbacks.tell = tellCallback;
+
+        this->module = openmpt_module_create2(
+            callbacks, this, logCallback,
+            nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+    }
 
     if (this->module) {
         int track = mptStream->GetTrackNumber();
@@ -164,6 +178,26 @@ bool OpenMptDecoder::GetBuffer(IBuffer *target) {
     return false;
 }
 
+long OpenMptDecoder::DecodeInto(float* target, long maxSamples) {
+    if (this->module) {
+        const size_t samplesPerChannel = (size_t) std::min(
+            (long) kSamplesPerChannel, maxSamples / (long) kChannels);
+
+        if (samplesPerChannel == 0) {
+            return -1;
+        }
+
+        size_t samplesWritten = openmpt_module_read_interleaved_float_stereo(
+            this->module,
+            (int32_t) kSampleRate,
+            samplesPerChannel,
+            target);
+
+        return (long) samplesWritten * kChannels;
+    }
+    return 0;
+}
+
 bool OpenMptDecoder::Exhausted() {
     if (this->module) {
         return openmpt_module_get_position_seconds(this->module) >= this->GetDuration();
@@ -54,6 +54,7 @@ class OpenMptDecoder: public musik::core::sdk::IDecoder {
         bool Open(musik::core::sdk::IDataStream* stream) override;
         bool Exhausted() override;
         void SetPreferredSampleRate(int rate) override { }
+        long DecodeInto(float* target, long maxSamples) override;
 
         musik::core::sdk::IDataStream* Stream() { return this->stream; }
 
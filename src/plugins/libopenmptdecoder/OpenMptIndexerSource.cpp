@@ -87,28 +87,8 @@ ScanResult OpenMptIndexerSource::Scan(
         this->paths.insert(fs::canonicalizePath(std::string(indexerPaths[i])));
     }
 
-    auto checkFile = [this, indexer](const std::string& path) {
-        if (isFileSupported(path)) {
-            try {
-                this->UpdateMetadata(path, this, indexer);
-            }
-            catch (...) {
-                std::string error = str::Format("error reading metadata for %s", path.c_str());
-                debug->Error(PLUGIN_NAME.c_str(), error.c_str());
-            }
-        }
-    };
-
-    auto checkInterrupt = [this]() -> bool {
-        return this->interrupt;
-    };
-
-    for (auto& path : this->paths) {
-        if (!this->interrupt) {
-            fs::scanDirectory(std::string(path), checkFile, checkInterrupt);
-        }
-    }
-
+    /* files were handed to us by the indexer's directory walk, via
+    ScanFile(), before we were called. */
     indexer->CommitProgress(this, this->filesIndexed);
 
     return ScanCommit;
@@ -118,6 +98,31 @@ void OpenMptIndexerSource::Interrupt() {
     this->interrupt = true;
 }
 
+const char* OpenMptIndexerSource::ScanFileExtensions() {
+    if (this->extensions.empty()) {
+        const char* supported = openmpt_get_supported_extensions();
+        if (supported) {
+            this->extensions = str::ReplaceAllCopy(std::string(supported), ";", ",");
+            openmpt_free_string(supported);
+        }
+    }
+    return this->extensions.c_str();
+}
+
+void OpenMptIndexerSource::ScanFile(IIndexerWriter* indexer, const char* path) {
+    if (this->interrupt) {
+        return;
+    }
+
+    try {
+        this->UpdateMetadata(std::string(path), this, indexer);
+    }
+    catch (...) {
+        std::string error = str::Format("error reading metadata for %s", path);
+        debug->Error(PLUGIN_NAME.c_str(), error.c_str());
+    }
+}
+
 void OpenMptIndexerSource::ScanTrack(
     IIndexerWriter* indexer,
     ITagStore* tagStore,
@@ -169,6 +174,8 @@ void OpenMptIndexerSource::UpdateMetadata(
     IIndexerSource* source,
     IIndexerWriter* indexer)
 {
+    size_t tracks = 0;
+
     /* only need to do this check once, and it's relatively expensive because
     it requires a db read. cache we've already done it. */
     int modifiedTime = fs::getLastModifiedTime(fn);
@@ -185,7 +192,8 @@ void OpenMptIndexerSource::UpdateMetadata(
 
             if (!module) {
                 debug->Error(PLUGIN_NAME.c_str(), str::Format("error opening %s", fn.c_str()).c_str());
-                invalidFiles.insert(fn);
+                std::unique_lock<std::mutex> lock(this->mutex);
+            invalidFiles.insert(fn);
             }
             else {
                 std::string directory = fs::getDirectory(fn);
@@ -237,7 +245,7 @@ void OpenMptIndexerSource::UpdateMetadata(
 
                         indexer->Save(source, track, externalId.c_str());
                         track->Release();
-                        ++tracksIndexed;
+                        ++tracks;
                     }
                 }
 
@@ -250,8 +258,17 @@ void OpenMptIndexerSource::UpdateMetadata(
     }
 
     /* we commit progress every so often */
-    if (++this->filesIndexed % 300 == 0) {
-        indexer->CommitProgress(this, this->filesIndexed + this->tracksIndexed);
-        this->filesIndexed = this->tracksIndexed = 0;
+    size_t updated = 0;
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->tracksIndexed += tracks;
+        if (++this->filesIndexed % 300 == 0) {
+            updated = this->filesIndexed + this->tracksIndexed;
+            this->filesIndexed = this->tracksIndexed = 0;
+        }
+    }
+
+    if (updated) {
+        indexer->CommitProgress(this, (unsigned) updated);
     }
 }
@@ -39,6 +39,8 @@
 #include <functional>
 #include <set>
 #include <map>
+#include <mutex>
+#include <string>
 #include <atomic>
 
 class OpenMptIndexerSource: public musik::core::sdk::IIndexerSource {
@@ -68,14 +70,22 @@ class OpenMptIndexerSource: public musik::core::sdk::IIndexerSource {
 
         virtual bool HasStableIds() { return true; }
 
+        virtual const char* ScanFileExtensions();
+
+        virtual void ScanFile(
+            musik::core::sdk::IIndexerWriter* indexer,
+            const char* path);
+
     private:
         void UpdateMetadata(
             std::string fn,
             musik::core::sdk::IIndexerSource* source,
             musik::core::sdk::IIndexerWriter* indexer);
 
+        std::mutex mutex; /* ScanFile() may be called concurrently */
         std::set<std::string> invalidFiles;
         std::set<std::string> paths;
+        std::string extensions;
         size_t filesIndexed, tracksIndexed;
         std::atomic<bool> interrupt { false };
 };
\ No newline at end of file
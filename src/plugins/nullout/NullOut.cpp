@@ -51,15 +51,18 @@ using namespace musik::core::sdk;
 
 #define PREF_MULTIPLIER "playback_speed_multiplier"
 #define PREF_DEFAULT_SAMPLE_RATE "default_sample_rate"
+#define PREF_ZERO_SLEEP "zero_sleep"
 
 static int defaultSampleRate = 48000;
 static float speedMultiplier = 1.0f;
+static bool zeroSleep = false;
 static IPreferences* prefs = nullptr;
 
-static void reloadMultiplier() {
+static void reloadPreferences() {
     if (::prefs) {
         ::speedMultiplier = (float)prefs->GetDouble(PREF_MULTIPLIER, speedMultiplier);
         ::defaultSampleRate = prefs->GetInt(PREF_DEFAULT_SAMPLE_RATE, defaultSampleRate);
+        ::zeroSleep = prefs->GetBool(PREF_ZERO_SLEEP, zeroSleep);
     }
 }
 
@@ -71,12 +74,14 @@ extern "C" DLLEXPORT musik::core::sdk::ISchema* GetSchema() {
     auto schema = new TSchema<>();
     schema->AddDouble(PREF_MULTIPLIER, 1.0, 2, 0.25, 1000.0);
     schema->AddInt(PREF_DEFAULT_SAMPLE_RATE, defaultSampleRate, 4096, 192000);
+    schema->AddBool(PREF_ZERO_SLEEP, zeroSleep);
     return schema;
 }
 
 NullOut::NullOut() {
     this->volume = 1.0f;
     this->state = StateStopped;
+    reloadPreferences();
 }
 
 NullOut::~NullOut() {
@@ -91,7 +96,7 @@ void NullOut::Pause() {
 }
 
 void NullOut::Resume() {
-    reloadMultiplier();
+    reloadPreferences();
     this->state = StatePlaying;
 }
 
@@ -128,9 +133,14 @@ OutputState NullOut::Play(IBuffer *buffer, IBufferProvider *provider) {
         return OutputState::InvalidState;
     }
 
-    /* order of operations matters, otherwise overflow. */
-    int micros = ((buffer->Samples() * 1000) / buffer->SampleRate() * 1000) / buffer->Channels();
-    usleep((long)((float) micros / speedMultiplier));
+    /* in zero sleep mode buffers are consumed as fast as they're produced;
+    used to benchmark the decode and dsp pipeline. */
+    if (!zeroSleep) {
+        /* order of operations matters, otherwise overflow. */
+        int micros = ((buffer->Samples() * 1000) / buffer->SampleRate() * 1000) / buffer->Channels();
+        usleep((long)((float) micros / speedMultiplier));
+    }
+
     provider->OnBufferProcessed(buffer);
     return OutputState::BufferWritten;
 }
@@ -62,6 +62,8 @@ class NullOut : public IOutput {
         bool SetDefaultDevice(const char* deviceId) override;
         IDevice* GetDefaultDevice() override;
         int GetDefaultSampleRate() override;
+        size_t GetUnderrunCount() override { return 0; }
+        size_t GetXrunCount() override { return 0; }
 
     private:
         enum State {
@@ -131,49 +131,70 @@ void PipeWireOut::OnDrained(void* data) {
 }
 
 void PipeWireOut::OnStreamProcess(void* data) {
+    /* this runs on PipeWire's real-time thread, so it must not lock, allocate,
+    or log. samples come from the ring; if there aren't enough we pad with
+    silence and count an underrun. */
     PipeWireOut* self = static_cast<PipeWireOut*>(data);
+    RingBuffer<float>* ring = self->ring.get();
 
-    {
-        std::unique_lock<std::recursive_mutex> lock(self->mutex);
-
-        if (self->state != State::Playing) {
-            return;
-        }
+    if (!ring) {
+        return;
+    }
 
-        OutBufferContext& outContext = self->outBufferContext;
+    /* don't hand PipeWire any more buffers while draining so it can tell
+    when everything has been played. */
+    if (self->draining && ring->Readable() == 0) {
+        return;
+    }
 
-        if (!outContext.Valid()) {
-            outContext.Initialize(pw_stream_dequeue_buffer(self->pwStream));
-            if (!outContext.Valid()) {
-                // std::cerr << "[PipeWire] no more output buffers available to fill\n";
-                return;
-            }
+    pw_buffer* outBuffer = pw_stream_dequeue_buffer(self->pwStream);
+    if (!outBuffer) {
+        /* the graph asked for data, but all of our buffers are still queued;
+        we've fallen behind. */
+        if (self->state == State::Playing) {
+            ++self->xruns;
         }
+        return;
+    }
 
-        uint32_t channelCount;
-
-        while (outContext.remaining > 0 && !self->buffers.empty()) {
-            //std::cerr << "[PipeWire] " << outContext.remaining << " bytes still need to be filled...\n";
-
-            InBufferContext* inContext = self->buffers.front();
-            channelCount = (uint32_t) inContext->buffer->Channels();
-            uint32_t inBufferSize = (uint32_t) inContext->buffer->Bytes();
-            uint32_t bytesToCopy = std::min(outContext.remaining, inContext->remaining);
+    spa_data& outData = outBuffer->buffer->datas[0];
+    const uint32_t channelCount = (uint32_t) self->channelCount;
+    const uint32_t stride = SAMPLE_SIZE_BYTES * channelCount;
+    uint32_t frames = 0;
 
-            if (outContext.remaining >= inContext->remaining) {
-                self->buffers.pop_front();
-                self->bufferCondition.notify_all();
+    if (outData.data && stride > 0) {
+        frames = outData.maxsize / stride;
+#if PW_CHECK_VERSION(0, 3, 49)
+        if (outBuffer->requested > 0 && outBuffer->requested < frames) {
+            frames = (uint32_t) outBuffer->requested;
+        }
+#endif
+        const size_t wanted = (size_t) frames * channelCount;
+        float* samples = static_cast<float*>(outData.data);
+        size_t read = 0;
+
+        if (self->state == State::Playing) {
+            read = ring->Read(samples, wanted);
+
+            /* running dry before we've received any samples, or at the tail
+            end of a drain, is expected and doesn't count. */
+            if (read < wanted && self->primed && !self->draining) {
+                ++self->underruns;
+            }
+            if (read > 0) {
+                self->primed = true;
             }
-
-            memcpy(outContext.writePtr, inContext->readPtr, bytesToCopy);
-            inContext->Advance(bytesToCopy); /* will `delete this` if emptied */
-            outContext.Advance(bytesToCopy);
         }
 
-        if (outContext.remaining == 0) {
-            outContext.Finalize(self->pwStream, SAMPLE_SIZE_BYTES * channelCount);
+        if (read < wanted) {
+            memset(samples + read, 0, (wanted - read) * SAMPLE_SIZE_BYTES);
         }
     }
+
+    outData.chunk->offset = 0;
+    outData.chunk->stride = stride;
+    outData.chunk->size = frames * stride;
+    pw_stream_queue_buffer(self->pwStream, outBuffer);
 }
 
 PipeWireOut::PipeWireOut() {
@@ -223,31 +244,29 @@ void PipeWireOut::SetVolume(double volume) {
     std::unique_lock<std::recursive_mutex> lock(this->mutex);
     if (this->pwThreadLoop && this->pwStream) {
         pw_thread_loop_lock(this->pwThreadLoop);
-        float* channelVolumes = new float[this->channelCount];
-        for (long i = 0; i < this->channelCount; i++) {
-            channelVolumes[i] = volume;
-        }
+        std::vector<float> channelVolumes((size_t) this->channelCount, (float) volume);
         pw_stream_set_control(
             this->pwStream,
             SPA_PROP_channelVolumes,
             this->channelCount,
-            channelVolumes,
+            channelVolumes.data(),
             0);
-        delete[] channelVolumes;
         pw_thread_loop_unlock(this->pwThreadLoop);
     }
     this->volume = volume;
 }
 
 double PipeWireOut::GetVolume() {
-    std::unique_lock<std::recursive_mutex> lock(this->mutex);
     return this->volume;
 }
 
 void PipeWireOut::Stop() {
     std::unique_lock<std::recursive_mutex> lock(this->mutex);
-    this->DiscardInputBuffers();
     this->state = State::Stopped;
+    this->primed = false;
+    if (this->ring) {
+        this->ring->Flush();
+    }
     if (this->pwThreadLoop && this->pwStream) {
         pw_thread_loop_lock(this->pwThreadLoop);
         pw_stream_set_active(this->pwStream, false);
@@ -256,25 +275,25 @@ void PipeWireOut::Stop() {
     }
 }
 
-void PipeWireOut::DiscardInputBuffers() {
-    std::unique_lock<std::recursive_mutex> lock(this->mutex);
-    for (auto& buffer : this->buffers) {
-        buffer->Discard();
-    }
-    this->buffers.clear();
-    this->bufferCondition.notify_all();
-}
-
 void PipeWireOut::Drain() {
     std::unique_lock<std::recursive_mutex> lock(this->mutex);
-    while (this->buffers.size()) {
-        bufferCondition.wait(lock);
-    }
-    if (this->pwThreadLoop && this->pwStream) {
+    if (this->pwThreadLoop && this->pwStream && this->ring) {
+        while (this->ring && this->ring->Readable() > 0 && this->state == State::Playing) {
+            /* unlocked so Stop(), Pause() and SetVolume() aren't held up */
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            lock.lock();
+        }
+        if (this->state == State::Stopped || !this->pwThreadLoop || !this->pwStream) {
+            return;
+        }
+        this->draining = true;
         pw_thread_loop_lock(this->pwThreadLoop);
         pw_stream_flush(this->pwStream, true);
         pw_thread_loop_unlock(this->pwThreadLoop);
         drainCondition.wait_for(lock, std::chrono::milliseconds(10000));
+        this->draining = false;
+        this->primed = false;
     }
 }
 
@@ -311,9 +330,6 @@ void PipeWireOut::StopPipeWire() {
         pw_thread_loop_stop(this->pwThreadLoop);
 
         if (this->pwStream) {
-            this->outBufferContext.Finalize(
-                this->pwStream,
-                SAMPLE_SIZE_BYTES * this->channelCount);
             pw_stream_destroy(this->pwStream);
             this->pwStream = nullptr;
         }
@@ -322,6 +338,7 @@ void PipeWireOut::StopPipeWire() {
         this->pwThreadLoop = nullptr;
     }
 
+    this->ring.reset();
     this->initialized = false;
     this->channelCount = 0;
     this->sampleRate = 0;
@@ -388,9 +405,17 @@ bool PipeWireOut::StartPipeWire(IBuffer* buffer) {
                 SPA_PARAM_BUFFERS_size, SPA_POD_Int(pwOutputBufferSize * SAMPLE_SIZE_BYTES * buffer->Channels()),
                 SPA_PARAM_BUFFERS_stride, SPA_POD_Int(SAMPLE_SIZE_BYTES * audioInfo.channels));
 
+            /* our ring holds at least `output_buffer_count` input buffers
+            worth of samples. it's allocated here, before the stream is
+            connected, so the real-time thread never sees it change. */
+            size_t ringSamples = std::max((size_t) 2, this->maxInternalBuffers) * (size_t) buffer->Samples();
+            this->ring.reset(new RingBuffer<float>(ringSamples));
+            this->primed = false;
+
             pw_stream_flags streamFlags = (pw_stream_flags)(
                 PW_STREAM_FLAG_AUTOCONNECT |
-                PW_STREAM_FLAG_MAP_BUFFERS);
+                PW_STREAM_FLAG_MAP_BUFFERS |
+                PW_STREAM_FLAG_RT_PROCESS);
 
             result = pw_stream_connect(
                 this->pwStream,
@@ -454,22 +479,32 @@ OutputState PipeWireOut::Play(IBuffer *buffer, IBufferProvider *provider) {
         return OutputState::InvalidState;
     }
 
-    {
-        std::unique_lock<std::recursive_mutex> lock(this->mutex);
-        if (this->buffers.size() >= maxInternalBuffers) {
-            return OutputState::BufferFull;
-        }
-        this->buffers.push_back(new InBufferContext(buffer, provider));
-        bufferCondition.notify_all();
+    const size_t samples = (size_t) buffer->Samples();
+    const size_t writable = this->ring->Writable();
+
+    if (writable < samples) {
+        /* ask to be called back once roughly enough space has been freed */
+        const long samplesPerSecond = this->sampleRate * this->channelCount;
+        return (OutputState) std::max(1L, (long) (((samples - writable) * 1000) / samplesPerSecond));
     }
 
+    /* the samples are copied into the ring, so the buffer can be returned
+    to the provider right away. Latency() accounts for what's queued. */
+    this->ring->Write(buffer->BufferPointer(), samples);
+    provider->OnBufferProcessed(buffer);
     return OutputState::BufferWritten;
 }
 
 double PipeWireOut::Latency() {
     /* CAL TODO: i see how to set latency, but not a good way to query
-    PipeWire to see what it actually is */
-    return 0.0;
+    PipeWire to see what it actually is, so this only accounts for the
+    samples we've buffered ourselves. */
+    std::unique_lock<std::recursive_mutex> lock(this->mutex);
+    const long samplesPerSecond = this->sampleRate * this->channelCount;
+    if (!this->ring || samplesPerSecond <= 0) {
+        return 0.0;
+    }
+    return (double) this->ring->Readable() / (double) samplesPerSecond;
 }
 
 void PipeWireOut::RefreshDeviceList() {
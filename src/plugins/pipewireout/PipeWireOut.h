@@ -35,11 +35,12 @@
 #pragma once
 
 #include <musikcore/sdk/IOutput.h>
+#include <musikcore/sdk/RingBuffer.h>
 #include <pipewire/pipewire.h>
 #include <atomic>
 #include <thread>
 #include <mutex>
-#include <deque>
+#include <memory>
 #include <vector>
 #include <condition_variable>
 
@@ -67,11 +68,12 @@ class PipeWireOut : public IOutput {
         bool SetDefaultDevice(const char* deviceId) override;
         IDevice* GetDefaultDevice() override;
         int GetDefaultSampleRate() override { return -1; }
+        size_t GetUnderrunCount() override { return this->underruns; }
+        size_t GetXrunCount() override { return this->xruns; }
 
     private:
         bool StartPipeWire(IBuffer* buffer);
         void StopPipeWire();
-        void DiscardInputBuffers();
         void RefreshDeviceList();
 
         static void OnCoreDone(
@@ -105,73 +107,6 @@ class PipeWireOut : public IOutput {
 
         static void OnDrained(void* userdata);
 
-        struct InBufferContext {
-            InBufferContext(IBuffer* buffer, IBufferProvider* provider) {
-                this->buffer = buffer; this->provider = provider;
-                this->readPtr = (char*) buffer->BufferPointer();
-                this->remaining = (uint32_t) buffer->Bytes();
-            }
-            void Advance(int count) {
-                bool release = count >= remaining;
-                this->remaining -= count;
-                this->readPtr += count;
-                if (release) {
-                    this->provider->OnBufferProcessed(this->buffer);
-                    delete this;
-                }
-            }
-            void Discard() {
-                this->provider->OnBufferProcessed(this->buffer);
-                delete this;
-            }
-            IBuffer* buffer{nullptr};
-            IBufferProvider* provider{nullptr};
-            uint32_t remaining{0};
-            char* readPtr;
-        };
-
-        struct OutBufferContext {
-            void Initialize(pw_buffer* buffer) {
-                this->buffer = buffer;
-                if (buffer) {
-                    struct spa_buffer* spaBuffer = buffer->buffer;
-                    this->writePtr = (char*) spaBuffer->datas[0].data;
-                    this->remaining = spaBuffer->datas[0].maxsize;
-                    this->total = this->remaining;
-                }
-                else {
-                    this->Reset();
-                }
-            }
-            void Reset() {
-                this->buffer = nullptr;
-                this->writePtr = nullptr;
-                this->remaining = 0;
-                this->total = 0;
-            }
-            void Advance(int count) {
-                this->remaining -= count;
-                this->writePtr += count;
-            }
-            void Finalize(pw_stream* stream, uint32_t stride) {
-                if (this->Valid()) {
-                    spa_data& data = this->buffer->buffer->datas[0];
-                    data.chunk->offset = 0;
-                    data.chunk->stride = stride;
-                    data.chunk->size = this->total - this->remaining;
-                    pw_stream_queue_buffer(stream, this->buffer);
-                    this->Reset();
-                }
-            }
-            bool Valid() {
-                return this->buffer != nullptr;
-            }
-            pw_buffer* buffer{nullptr};
-            uint32_t remaining{0};
-            uint32_t total{0};
-            char* writePtr{nullptr};
-        };
-
         class Device: public musik::core::sdk::IDevice {
             public:
                 Device(const std::string& id, const std::string& name) {
@@ -282,16 +217,23 @@ class PipeWireOut : public IOutput {
             Stopped, Paused, Playing, Shutdown
         };
 
-        std::deque<InBufferContext*> buffers;
+        /* everything below is shared with OnStreamProcess(), which runs on
+        PipeWire's real-time thread and must never block: samples are handed
+        off through a wait-free ring, and state is communicated via atomics.
+        the mutex only serializes the non-real-time control methods. */
+        std::unique_ptr<RingBuffer<float>> ring;
         std::recursive_mutex mutex;
         std::atomic<bool> initialized{false};
         std::atomic<State> state{State::Stopped};
-        std::condition_variable_any bufferCondition, drainCondition;
-        double volume{1.0};
+        std::atomic<bool> draining{false};
+        std::atomic<bool> primed{false};
+        std::atomic<size_t> underruns{0};
+        std::atomic<size_t> xruns{0};
+        std::atomic<double> volume{1.0};
+        std::condition_variable_any drainCondition;
         pw_stream_events pwStreamEvents;
         pw_thread_loop* pwThreadLoop{nullptr};
         pw_stream* pwStream{nullptr};
-        OutBufferContext outBufferContext;
         long channelCount{0};
         long sampleRate{0};
         size_t maxInternalBuffers{0};
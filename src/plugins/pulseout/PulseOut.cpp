@@ -39,6 +39,8 @@
 #include <pulse/pulseaudio.h>
 #include <pulse/thread-mainloop.h>
 #include <math.h>
+#include <chrono>
+#include <thread>
 #include <vector>
 
 using namespace musik::core::sdk;
@@ -51,6 +53,10 @@ static musik::core::sdk::IPreferences* prefs = nullptr;
 #define PREF_FORCE_LINEAR_VOLUME "force_linear_volume"
 #define PREF_DEVICE_ID "device_id"
 
+/* how much audio we'll buffer on our side of the handoff, in addition to
+whatever PulseAudio buffers itself. */
+#define RING_BUFFER_MILLISECONDS 500
+
 class PulseDevice : public musik::core::sdk::IDevice {
     public:
         PulseDevice(const std::string& id, const std::string& name) {
@@ -139,6 +145,46 @@ PulseOut::~PulseOut() {
     this->CloseDevice();
 }
 
+size_t PulseOut::OnFill(void* data, size_t bytes, void* userdata) {
+    /* runs on PulseAudio's mainloop thread: no locks, no allocations. */
+    PulseOut* self = static_cast<PulseOut*>(userdata);
+    musik::core::sdk::RingBuffer<float>* ring = self->ring.get();
+
+    if (!ring || self->state != StatePlaying) {
+        self->starved = true;
+        return 0;
+    }
+
+    const size_t channels = (size_t) std::max(1, self->channels);
+    size_t wanted = bytes / sizeof(float);
+    wanted -= wanted % channels;
+
+    const size_t read = ring->Read(static_cast<float*>(data), wanted);
+
+    if (read < wanted) {
+        /* Play() will kick the stream once more samples are available */
+        self->starved = true;
+        /* pulse routinely asks for more than the ring holds, so a short read
+        is normal; only coming up completely empty is an underrun. */
+        if (read == 0 && self->primed && !self->draining) {
+            ++self->underruns;
+        }
+    }
+
+    if (read > 0) {
+        self->primed = true;
+    }
+
+    return read * sizeof(float);
+}
+
+void PulseOut::OnUnderflow(void* userdata) {
+    PulseOut* self = static_cast<PulseOut*>(userdata);
+    if (self->state == StatePlaying && self->primed && !self->draining) {
+        ++self->xruns;
+    }
+}
+
 void PulseOut::CloseDevice() {
     Lock lock(this->stateMutex);
     if (this->audioConnection) {
@@ -148,6 +194,7 @@ void PulseOut::CloseDevice() {
         pa_blocking_flush(this->audioConnection, &error);
         pa_blocking_free(this->audioConnection);
         this->audioConnection = nullptr;
+        this->ring.reset();
         this->rate = 0;
         this->channels = 0;
     }
@@ -158,7 +205,21 @@ void PulseOut::Drain() {
 
     if (this->state != StateStopped && this->audioConnection) {
         std::cerr << "draining...\n";
+
+        while (this->ring && this->ring->Readable() > 0 && this->state == StatePlaying) {
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            lock.lock();
+        }
+
+        if (this->state == StateStopped || !this->audioConnection) {
+            return;
+        }
+
+        this->draining = true;
         pa_blocking_drain(this->audioConnection, 0);
+        this->draining = false;
+        this->primed = false;
         std::cerr << "drained...\n";
     }
 }
@@ -291,6 +352,21 @@ void PulseOut::OpenDevice(musik::core::sdk::IBuffer* buffer) {
         if (this->audioConnection) {
             this->rate = buffer->SampleRate();
             this->channels = buffer->Channels();
+
+            const size_t ringSamples = std::max(
+                (size_t) buffer->Samples() * 2,
+                (size_t) (buffer->SampleRate() * buffer->Channels() * RING_BUFFER_MILLISECONDS / 1000));
+
+            this->ring.reset(new musik::core::sdk::RingBuffer<float>(ringSamples));
+            this->starved = true;
+            this->primed = false;
+
+            pa_blocking_set_callbacks(
+                this->audioConnection,
+                &PulseOut::OnFill,
+                &PulseOut::OnUnderflow,
+                this);
+
             this->state = StatePlaying;
             this->linearVolume = ::prefs->GetBool(PREF_FORCE_LINEAR_VOLUME, false);
             this->SetVolume(this->volume);
@@ -306,16 +382,21 @@ void PulseOut::Release() {
 void PulseOut::Stop() {
     Lock lock(this->stateMutex);
     if (this->audioConnection) {
-        pa_blocking_flush(this->audioConnection, 0);
         this->state = StateStopped;
+        this->primed = false;
+        this->ring->Flush();
+        pa_blocking_flush(this->audioConnection, 0);
     }
 }
 
 void PulseOut::Pause() {
     Lock lock(this->stateMutex);
     if (this->audioConnection) {
-        pa_blocking_flush(this->audioConnection, 0);
         this->state = StatePaused;
+        this->primed = false;
+        this->ring->Flush();
+        pa_blocking_flush(this->audioConnection, 0);
+        pa_blocking_cork(this->audioConnection, 1, 0);
     }
 }
 
@@ -323,6 +404,8 @@ void PulseOut::Resume() {
     Lock lock(this->stateMutex);
     if (this->audioConnection) {
         this->state = StatePlaying;
+        this->starved = true;
+        pa_blocking_cork(this->audioConnection, 0, 0);
     }
 }
 
@@ -369,11 +452,22 @@ OutputState PulseOut::Play(IBuffer *buffer, IBufferProvider* provider) {
             this->SetVolume(this->volume);
         }
 
-        pa_blocking_write(
-            this->audioConnection,
-            buffer->BufferPointer(),
-            buffer->Samples() * sizeof(float),
-            &error);
+        const size_t samples = (size_t) buffer->Samples();
+        const size_t writable = this->ring->Writable();
+
+        if (writable < samples) {
+            /* ask to be called back once roughly enough space has been freed */
+            const long samplesPerSecond = (long) this->rate * this->channels;
+            return (OutputState) std::max(1L, (long) (((samples - writable) * 1000) / samplesPerSecond));
+        }
+
+        this->ring->Write(buffer->BufferPointer(), samples);
+
+        /* if the server asked for more than we had last time, it won't ask
+        again until it gets it, so push what we have now. */
+        if (this->starved.exchange(false)) {
+            pa_blocking_kick(this->audioConnection, &error);
+        }
 
         if (error > 0) {
             this->CloseDevice();
@@ -394,5 +488,8 @@ double PulseOut::Latency() {
 
     int error = 0;
     unsigned long long latency = pa_blocking_get_latency(this->audioConnection, &error);
-    return (double) latency / 1000000.0; /* microseconds to seconds */
+    const double buffered = this->ring
+        ? (double) this->ring->Readable() / (double) (this->rate * this->channels)
+        : 0.0;
+    return buffered + (double) latency / 1000000.0; /* microseconds to seconds */
 }
@@ -37,7 +37,10 @@
 
 #include <musikcore/sdk/IOutput.h>
 #include <musikcore/sdk/IDevice.h>
+#include <musikcore/sdk/RingBuffer.h>
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include "pulse_blocking_stream.h"
 
@@ -67,6 +70,8 @@ class PulseOut : public musik::core::sdk::IOutput {
         bool SetDefaultDevice(const char* deviceId) override;
         musik::core::sdk::IDevice* GetDefaultDevice() override;
         int GetDefaultSampleRate() override { return -1; }
+        size_t GetUnderrunCount() override { return this->underruns; }
+        size_t GetXrunCount() override { return this->xruns; }
 
     private:
         enum State {
@@ -79,9 +84,22 @@ class PulseOut : public musik::core::sdk::IOutput {
         void CloseDevice();
         std::string GetPreferredDeviceId();
 
+        static size_t OnFill(void* data, size_t bytes, void* userdata);
+        static void OnUnderflow(void* userdata);
+
+        /* samples are handed to PulseAudio's mainloop thread through a
+        wait-free ring; OnFill() and OnUnderflow() only touch the ring and
+        the atomics below, never stateMutex. */
+        std::unique_ptr<musik::core::sdk::RingBuffer<float>> ring;
+        std::atomic<bool> starved{false};
+        std::atomic<bool> draining{false};
+        std::atomic<bool> primed{false};
+        std::atomic<size_t> underruns{0};
+        std::atomic<size_t> xruns{0};
+
         std::recursive_mutex stateMutex;
         pa_blocking* audioConnection;
-        State state;
+        std::atomic<State> state;
         int channels, rate;
         double volume;
         bool volumeUpdated;
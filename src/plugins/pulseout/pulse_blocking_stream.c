@@ -46,6 +46,10 @@ struct pa_blocking {
     int hw_volume;
 
     int operation_success;
+
+    pa_blocking_fill_cb fill_cb;
+    pa_blocking_underflow_cb underflow_cb;
+    void *callback_userdata;
 };
 
 #define CHECK_VALIDITY_RETURN_ANY(rerror, expression, error, ret)       \
@@ -129,13 +133,50 @@ static void stream_state_cb(pa_stream *s, void * userdata) {
     }
 }
 
+/* called with the mainloop lock held. asks the fill callback for as much
+data as the server can currently accept. */
+static void stream_fill(pa_blocking *p) {
+    size_t writable = pa_stream_writable_size(p->stream);
+
+    while (writable > 0 && writable != (size_t) -1) {
+        void *data = NULL;
+        size_t length = writable, filled;
+
+        if (pa_stream_begin_write(p->stream, &data, &length) < 0 || !data || !length)
+            break;
+
+        filled = p->fill_cb(data, length, p->callback_userdata);
+
+        if (!filled) {
+            pa_stream_cancel_write(p->stream);
+            break;
+        }
+
+        if (pa_stream_write(p->stream, data, filled, NULL, 0LL, PA_SEEK_RELATIVE) < 0)
+            break;
+
+        writable = pa_stream_writable_size(p->stream);
+    }
+}
+
 static void stream_request_cb(pa_stream *s, size_t length, void *userdata) {
     pa_blocking *p = userdata;
     assert(p);
 
+    if (p->fill_cb && p->direction == PA_STREAM_PLAYBACK)
+        stream_fill(p);
+
     pa_threaded_mainloop_signal(p->mainloop, 0);
 }
 
+static void stream_underflow_cb(pa_stream *s, void *userdata) {
+    pa_blocking *p = userdata;
+    assert(p);
+
+    if (p->underflow_cb)
+        p->underflow_cb(p->callback_userdata);
+}
+
 static void stream_latency_update_cb(pa_stream *s, void *userdata) {
     pa_blocking *p = userdata;
 
@@ -230,6 +271,7 @@ pa_blocking* pa_blocking_new(
     pa_stream_set_read_callback(p->stream, stream_request_cb, p);
     pa_stream_set_write_callback(p->stream, stream_request_cb, p);
     pa_stream_set_latency_update_callback(p->stream, stream_latency_update_cb, p);
+    pa_stream_set_underflow_callback(p->stream, stream_underflow_cb, p);
 
     if (dir == PA_STREAM_PLAYBACK)
         r = pa_stream_connect_playback(p->stream, dev, attr,
@@ -343,6 +385,40 @@ unlock_and_fail:
     return -1;
 }
 
+void pa_blocking_set_callbacks(
+    pa_blocking *p,
+    pa_blocking_fill_cb fill_cb,
+    pa_blocking_underflow_cb underflow_cb,
+    void *userdata)
+{
+    assert(p);
+
+    pa_threaded_mainloop_lock(p->mainloop);
+    p->fill_cb = fill_cb;
+    p->underflow_cb = underflow_cb;
+    p->callback_userdata = userdata;
+    pa_threaded_mainloop_unlock(p->mainloop);
+}
+
+int pa_blocking_kick(pa_blocking *p, int *rerror) {
+    assert(p);
+
+    CHECK_VALIDITY_RETURN_ANY(rerror, p->direction == PA_STREAM_PLAYBACK, PA_ERR_BADSTATE, -1);
+    CHECK_VALIDITY_RETURN_ANY(rerror, p->fill_cb, PA_ERR_BADSTATE, -1);
+
+    pa_threaded_mainloop_lock(p->mainloop);
+    CHECK_DEAD_GOTO(p, rerror, unlock_and_fail);
+
+    stream_fill(p);
+
+    pa_threaded_mainloop_unlock(p->mainloop);
+    return 0;
+
+unlock_and_fail:
+    pa_threaded_mainloop_unlock(p->mainloop);
+    return -1;
+}
+
 int pa_blocking_read(pa_blocking *p, void*data, size_t length, int *rerror) {
     assert(p);
 
@@ -484,6 +560,40 @@ unlock_and_fail:
     return -1;
 }
 
+int pa_blocking_cork(pa_blocking *p, int cork, int *rerror) {
+    pa_operation *o = NULL;
+
+    assert(p);
+
+    pa_threaded_mainloop_lock(p->mainloop);
+    CHECK_DEAD_GOTO(p, rerror, unlock_and_fail);
+
+    o = pa_stream_cork(p->stream, cork, success_cb, p);
+    CHECK_SUCCESS_GOTO(p, rerror, o, unlock_and_fail);
+
+    p->operation_success = 0;
+    while (pa_operation_get_state(o) == PA_OPERATION_RUNNING) {
+        pa_threaded_mainloop_wait(p->mainloop);
+        CHECK_DEAD_GOTO(p, rerror, unlock_and_fail);
+    }
+    CHECK_SUCCESS_GOTO(p, rerror, p->operation_success, unlock_and_fail);
+
+    pa_operation_unref(o);
+    pa_threaded_mainloop_unlock(p->mainloop);
+
+    return 0;
+
+unlock_and_fail:
+
+    if (o) {
+        pa_operation_cancel(o);
+        pa_operation_unref(o);
+    }
+
+    pa_threaded_mainloop_unlock(p->mainloop);
+    return -1;
+}
+
 pa_usec_t pa_blocking_get_latency(pa_blocking *p, int *rerror) {
     pa_usec_t t;
 
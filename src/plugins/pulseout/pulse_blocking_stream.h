@@ -35,6 +35,15 @@ PA_C_DECL_BEGIN
  * An opaque simple connection object */
 typedef struct pa_blocking pa_blocking;
 
+/** Called from the mainloop thread (with its lock held) when the server can
+ * accept more playback data. Fill at most \a bytes of \a data and return the
+ * number of bytes written; returning 0 means nothing is available right now.
+ * Must not block. */
+typedef size_t (*pa_blocking_fill_cb)(void *data, size_t bytes, void *userdata);
+
+/** Called from the mainloop thread when the server ran out of data to play. */
+typedef void (*pa_blocking_underflow_cb)(void *userdata);
+
 /** Create a new connection to the server. */
 pa_blocking* pa_blocking_new(
     const char *server,                 /**< Server name, or NULL for default */
@@ -54,6 +63,22 @@ void pa_blocking_free(pa_blocking *s);
 /** Write some data to the server. */
 int pa_blocking_write(pa_blocking *s, const void *data, size_t bytes, int *error);
 
+/** Switch a playback stream from blocking writes to pulling data through
+ * \a fill_cb whenever the server requests it. \a underflow_cb may be NULL. */
+void pa_blocking_set_callbacks(
+    pa_blocking *p,
+    pa_blocking_fill_cb fill_cb,
+    pa_blocking_underflow_cb underflow_cb,
+    void *userdata);
+
+/** Invoke the fill callback right away if the server is waiting for data.
+ * Use this after new data becomes available following a fill callback that
+ * returned short. */
+int pa_blocking_kick(pa_blocking *p, int *error);
+
+/** Pause (cork = 1) or resume (cork = 0) playback on the server. */
+int pa_blocking_cork(pa_blocking *p, int cork, int *error);
+
 /** Wait until all data already written is played by the daemon. */
 int pa_blocking_drain(pa_blocking *s, int *error);
 
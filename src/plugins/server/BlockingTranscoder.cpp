@@ -33,6 +33,8 @@
 //////////////////////////////////////////////////////////////////////////////
 
 #include "BlockingTranscoder.h"
+#include "DecodePipeline.h"
+#include "Transcoder.h"
 #include "Util.h"
 #include <filesystem>
 #include <algorithm>
@@ -40,6 +42,7 @@
 
 #define BUFFER_SIZE 8192
 #define SAMPLES_PER_BUFFER BUFFER_SIZE / 4 /* sizeof(float) */
+#define PIPELINE_BUFFER_COUNT 16
 
 static std::atomic<int> activeCount(0);
 
@@ -70,6 +73,7 @@ BlockingTranscoder::BlockingTranscoder(
 BlockingTranscoder::~BlockingTranscoder() {
     --activeCount;
     this->Cleanup();
+    Transcoder::NotifySlotAvailable();
 }
 
 void BlockingTranscoder::Cleanup() {
@@ -98,47 +102,54 @@ bool BlockingTranscoder::Transcode() {
         return false;
     }
 
-    IBuffer* pcmBuffer = this->context.environment->GetBuffer(SAMPLES_PER_BUFFER);
-
     bool result = false;
 
-    if (decoder->GetBuffer(pcmBuffer)) {
-        bool initialized = encoder->Initialize(
-            this->output,
-            pcmBuffer->SampleRate(),
-            pcmBuffer->Channels(),
-            this->bitrate);
+    {
+        /* decode on a background thread, encode on this one. */
+        DecodePipeline pipeline(
+            this->context, decoder, SAMPLES_PER_BUFFER, PIPELINE_BUFFER_COUNT);
+
+        IBuffer* pcmBuffer = pipeline.Next();
 
-        if (initialized) {
-            this->encoder->Encode(pcmBuffer);
-            while (!interrupted && decoder->GetBuffer(pcmBuffer)) {
+        if (pcmBuffer) {
+            bool initialized = encoder->Initialize(
+                this->output,
+                pcmBuffer->SampleRate(),
+                pcmBuffer->Channels(),
+                this->bitrate);
+
+            if (initialized) {
                 this->encoder->Encode(pcmBuffer);
-                std::this_thread::yield();
-            }
+                pipeline.Recycle(pcmBuffer);
 
-            if (decoder->Exhausted()) {
-                this->encoder->Finalize();
-                this->output->Release();
-                this->output = nullptr;
-                std::error_code ec;
-                std::fs::rename(
-                    std::fs::u8path(this->tempFilename),
-                    std::fs::u8path(this->finalFilename),
-                    ec);
-                if (ec) {
-                    std::fs::remove(
+                while (!interrupted && (pcmBuffer = pipeline.Next()) != nullptr) {
+                    this->encoder->Encode(pcmBuffer);
+                    pipeline.Recycle(pcmBuffer);
+                }
+
+                if (!interrupted && pipeline.Exhausted()) {
+                    this->encoder->Finalize();
+                    this->output->Release();
+                    this->output = nullptr;
+                    std::error_code ec;
+                    std::fs::rename(
                         std::fs::u8path(this->tempFilename),
+                        std::fs::u8path(this->finalFilename),
                         ec);
-                }
-                else {
-                    result = true;
+                    if (ec) {
+                        std::fs::remove(
+                            std::fs::u8path(this->tempFilename),
+                            ec);
+                    }
+                    else {
+                        result = true;
+                    }
                 }
             }
         }
     }
 
     decoder->Release();
-    pcmBuffer->Release();
 
     this->Cleanup();
 
@@ -49,6 +49,9 @@ namespace defaults {
     static const bool use_ipv6 = false;
     static const bool transcoder_synchronous = false;
     static const bool transcoder_synchronous_fallback = false;
+    static const int thumbnail_memory_cache_size_mb = 16;
+    static const int snapshot_memory_cache_size_mb = 8;
+    static const bool websocket_compression = true;
 }
 
 namespace prefs {
@@ -61,6 +64,9 @@ namespace prefs {
     static const std::string transcoder_max_active_count = "transcoder_max_active_count";
     static const std::string transcoder_synchronous = "transcoder_synchronous";
     static const std::string transcoder_synchronous_fallback = "transcoder_synchronous_fallback";
+    static const std::string thumbnail_memory_cache_size_mb = "thumbnail_memory_cache_size_mb";
+    static const std::string snapshot_memory_cache_size_mb = "snapshot_memory_cache_size_mb";
+    static const std::string websocket_compression = "websocket_compression";
 }
 
 namespace message {
@@ -69,6 +75,7 @@ namespace message {
     static const std::string device_id = "device_id";
     static const std::string type = "type";
     static const std::string options = "options";
+    static const std::string chunked = "chunked";
 }
 
 namespace key {
@@ -144,6 +151,17 @@ namespace key {
     static const std::string enabled = "enabled";
     static const std::string bands = "bands";
     static const std::string time = "time";
+    static const std::string entries = "entries";
+    static const std::string unique_lists = "unique_lists";
+    static const std::string bytes = "bytes";
+    static const std::string max_bytes = "max_bytes";
+    static const std::string hits = "hits";
+    static const std::string misses = "misses";
+    static const std::string deduplicated = "deduplicated";
+    static const std::string evicted = "evicted";
+    static const std::string expired = "expired";
+    static const std::string requests = "requests";
+    static const std::string responses = "responses";
 }
 
 namespace value {
@@ -209,6 +227,8 @@ namespace request {
     static const std::string set_transport_type = "set_transport_type";
     static const std::string snapshot_play_queue = "snapshot_play_queue";
     static const std::string invalidate_play_queue_snapshot = "invalidate_play_queue_snapshot";
+    static const std::string get_snapshot_stats = "get_snapshot_stats";
+    static const std::string batch = "batch";
 }
 
 namespace fragment {
@@ -247,4 +267,4 @@ static auto TRANSPORT_TYPE_TO_STRING = std::unordered_map<musik::core::sdk::Tran
     { musik::core::sdk::TransportType::Crossfade, "crossfade" },
 });
 
-static const int ApiVersion = 20;
+static const int ApiVersion = 23;
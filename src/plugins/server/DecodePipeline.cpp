@@ -0,0 +1,137 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2021 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "DecodePipeline.h"
+
+using namespace musik::core::sdk;
+
+DecodePipeline::DecodePipeline(
+    Context& context,
+    IDecoder* decoder,
+    size_t samplesPerBuffer,
+    size_t bufferCount)
+{
+    this->decoder = decoder;
+    for (size_t i = 0; i < bufferCount; i++) {
+        IBuffer* buffer = context.environment->GetBuffer(samplesPerBuffer);
+        this->buffers.push_back(buffer);
+        this->free.push_back(buffer);
+    }
+}
+
+DecodePipeline::~DecodePipeline() {
+    this->Stop();
+    for (auto buffer : this->buffers) {
+        buffer->Release();
+    }
+}
+
+void DecodePipeline::Stop() {
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->stopped = true;
+        this->bufferFree.notify_all();
+        this->bufferReady.notify_all();
+    }
+
+    if (this->thread && this->thread->joinable()) {
+        this->thread->join();
+    }
+}
+
+IBuffer* DecodePipeline::Next() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    /* started lazily so streams that are opened but never read (e.g. to
+    check their length) don't spin up a thread */
+    if (!this->thread && !this->stopped) {
+        this->thread.reset(new std::thread(&DecodePipeline::ThreadProc, this));
+    }
+
+    while (this->ready.empty() && !this->finished && !this->stopped) {
+        this->bufferReady.wait(lock);
+    }
+
+    if (this->ready.empty() || this->stopped) {
+        return nullptr;
+    }
+
+    IBuffer* buffer = this->ready.front();
+    this->ready.pop_front();
+    return buffer;
+}
+
+void DecodePipeline::Recycle(IBuffer* buffer) {
+    if (buffer) {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->free.push_back(buffer);
+        this->bufferFree.notify_one();
+    }
+}
+
+bool DecodePipeline::Exhausted() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    return this->exhausted;
+}
+
+void DecodePipeline::ThreadProc() {
+    while (true) {
+        IBuffer* buffer = nullptr;
+
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            while (this->free.empty() && !this->stopped) {
+                this->bufferFree.wait(lock);
+            }
+            if (this->stopped) {
+                return;
+            }
+            buffer = this->free.front();
+            this->free.pop_front();
+        }
+
+        bool decoded = this->decoder->GetBuffer(buffer);
+
+        std::unique_lock<std::mutex> lock(this->mutex);
+        if (!decoded) {
+            this->free.push_back(buffer);
+            this->finished = true;
+            this->exhausted = this->decoder->Exhausted();
+            this->bufferReady.notify_all();
+            return;
+        }
+        this->ready.push_back(buffer);
+        this->bufferReady.notify_one();
+    }
+}
@@ -0,0 +1,81 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2021 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Context.h"
+#include <musikcore/sdk/IDecoder.h>
+#include <musikcore/sdk/IBuffer.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* decodes on a background thread into a small, fixed pool of pcm buffers so
+the caller can encode one buffer while the next one is being decoded. the
+caller takes filled buffers via Next() and hands them back via Recycle().
+the decoder is not owned; it must outlive the pipeline. */
+class DecodePipeline {
+    public:
+        using IBuffer = musik::core::sdk::IBuffer;
+        using IDecoder = musik::core::sdk::IDecoder;
+
+        DecodePipeline(
+            Context& context,
+            IDecoder* decoder,
+            size_t samplesPerBuffer,
+            size_t bufferCount);
+
+        ~DecodePipeline();
+
+        /* blocks until a decoded buffer is available. returns nullptr once the
+        decoder has no more data (see Exhausted()) or the pipeline was stopped */
+        IBuffer* Next();
+        void Recycle(IBuffer* buffer);
+        bool Exhausted();
+        void Stop();
+
+    private:
+        void ThreadProc();
+
+        IDecoder* decoder;
+        std::mutex mutex;
+        std::condition_variable bufferFree, bufferReady;
+        std::vector<IBuffer*> buffers;
+        std::deque<IBuffer*> free, ready;
+        std::unique_ptr<std::thread> thread;
+        bool stopped{ false }, finished{ false }, exhausted{ false };
+};
@@ -37,6 +37,7 @@
 #include "Util.h"
 #include "Transcoder.h"
 #include "TranscodingAudioDataStream.h"
+#include "ThumbnailResizer.h"
 
 #include <musikcore/sdk/ITrack.h>
 #include <musikcore/sdk/String.h>
@@ -49,6 +50,10 @@
 #include <string>
 #include <cstdlib>
 #include <filesystem>
+#include <set>
+#include <chrono>
+#include <climits>
+#include <memory>
 
 #include <fcntl.h>
 #include <stdio.h>
@@ -87,9 +92,36 @@ std::unordered_map<std::string, std::string> CONTENT_TYPE_MAP = {
     { ".mpp", "audio/x-musepack" },
     { ".ape", "audio/monkeys-audio" },
     { ".wma", "audio/x-ms-wma" },
-    { ".jpg", "image/jpeg" }
+    { ".jpg", "image/jpeg" },
+    { ".webp", "image/webp" }
 };
 
+struct TranscodePreset {
+    const char* format;
+    size_t bitrate;
+};
+
+/* named transcoding presets, selected with `?preset=<name>`. explicit
+`format` and `bitrate` parameters take precedence over the preset's values.
+the opus and aac presets are encoded on-the-fly with low startup latency,
+and are a good fit for remote listeners on slow or metered links. */
+static const std::unordered_map<std::string, TranscodePreset> TRANSCODE_PRESETS = {
+    { "opus-low", { "opus", 32 } },
+    { "opus", { "opus", 64 } },
+    { "opus-high", { "opus", 128 } },
+    { "aac", { "aac", 128 } },
+    { "mp3", { "mp3", 192 } },
+};
+
+/* requested thumbnail sizes are rounded up to one of these so we only ever
+generate and persist a handful of variants per image. anything larger than
+the biggest bucket is served at its original size. */
+static const std::vector<int> THUMBNAIL_SIZE_BUCKETS = { 64, 128, 256, 512, 1024 };
+
+static std::mutex thumbnailMutex;
+static std::condition_variable waitForThumbnail;
+static std::set<std::string> runningThumbnailResizes;
+
 struct Range {
     size_t from;
     size_t to;
@@ -247,6 +279,111 @@ static std::string getStringUrlParam(
     return stringValue ? std::string(stringValue) : defaultValue;
 }
 
+static int resolveThumbnailSize(size_t requested) {
+    if (requested > 0) {
+        for (int bucket : THUMBNAIL_SIZE_BUCKETS) {
+            if ((size_t) bucket >= requested) {
+                return bucket;
+            }
+        }
+    }
+    return 0; /* original */
+}
+
+static ThumbnailResizer::Format resolveThumbnailFormat(
+    MHD_Connection* connection, bool sized, bool& negotiated)
+{
+    using Format = ThumbnailResizer::Format;
+
+    negotiated = false;
+
+    std::string format = str::ToLowerCopy(getStringUrlParam(connection, "format", ""));
+    if (format == "webp") {
+        return ThumbnailResizer::WebpSupported() ? Format::Webp : Format::Jpeg;
+    }
+    else if (format.size()) {
+        return Format::Jpeg;
+    }
+
+    /* no explicit format; if the client is requesting a resized variant, check
+    the Accept header to see if it'll take webp. un-sized requests always return
+    the original image so older clients see exactly what they used to. */
+    if (sized && ThumbnailResizer::WebpSupported()) {
+        negotiated = true;
+        const char* accept = MHD_lookup_connection_value(
+            connection, MHD_HEADER_KIND, "Accept");
+        if (accept && std::string(accept).find("image/webp") != std::string::npos) {
+            return Format::Webp;
+        }
+    }
+
+    return Format::Jpeg;
+}
+
+static std::string thumbnailEtag(const std::string& filename, const std::string& variant, size_t& size) {
+    std::error_code ec;
+    const std::fs::path path = std::fs::u8path(filename);
+    size = (size_t) std::fs::file_size(path, ec);
+    if (ec) {
+        size = 0;
+        return "";
+    }
+    auto modified = std::chrono::duration_cast<std::chrono::seconds>(
+        std::fs::last_write_time(path, ec).time_since_epoch()).count();
+    return str::Format("\"%s-%zx-%llx\"", variant.c_str(), size, (long long) modified);
+}
+
+static bool etagMatches(MHD_Connection* connection, const std::string& etag) {
+    const char* ifNoneMatch = MHD_lookup_connection_value(
+        connection, MHD_HEADER_KIND, "If-None-Match");
+    if (ifNoneMatch && etag.size()) {
+        std::string value(ifNoneMatch);
+        return str::Trim(value) == "*" || value.find(etag) != std::string::npos;
+    }
+    return false;
+}
+
+static bool isThumbnailVariantCurrent(const std::string& original, const std::string& variant) {
+    std::error_code ec;
+    auto variantTime = std::fs::last_write_time(std::fs::u8path(variant), ec);
+    if (ec) {
+        return false;
+    }
+    auto originalTime = std::fs::last_write_time(std::fs::u8path(original), ec);
+    return !ec && variantTime >= originalTime;
+}
+
+/* generates the resized variant if it doesn't exist (or is older than the
+original). if another connection is already generating the same variant, we
+wait for it to finish instead of doing the work twice. */
+static bool ensureThumbnailVariant(
+    const std::string& original,
+    const std::string& variant,
+    int size,
+    ThumbnailResizer::Format format)
+{
+    {
+        std::unique_lock<std::mutex> lock(thumbnailMutex);
+        while (runningThumbnailResizes.find(variant) != runningThumbnailResizes.end()) {
+            waitForThumbnail.wait(lock);
+        }
+        if (isThumbnailVariantCurrent(original, variant)) {
+            return true;
+        }
+        runningThumbnailResizes.insert(variant);
+    }
+
+    bool success = ThumbnailResizer::Resize(original, variant, size, format);
+
+    {
+        std::unique_lock<std::mutex> lock(thumbnailMutex);
+        runningThumbnailResizes.erase(variant);
+        waitForThumbnail.notify_all();
+    }
+
+    return success;
+}
+
 static bool isAuthenticated(MHD_Connection *connection, Context& context) {
     const char* disableAuth = std::getenv(ENVIRONMENT_DISABLE_HTTP_SERVER_AUTH);
     if (disableAuth && std::string(disableAuth) == "1") {
@@ -324,6 +461,13 @@ bool HttpServer::Start() {
             1,                                          /* enable address reuse */
             MHD_OPTION_END);                            /* terminal option */
 
+        int thumbnailCacheSizeMb = context.prefs->GetInt(
+            prefs::thumbnail_memory_cache_size_mb.c_str(),
+            defaults::thumbnail_memory_cache_size_mb);
+
+        this->thumbnailCache.Reset();
+        this->thumbnailCache.SetMaxBytes((size_t) std::max(0, thumbnailCacheSizeMb) * 1024 * 1024);
+
         this->running = (httpServer != nullptr);
         return running;
     }
@@ -422,12 +566,22 @@ int HttpServer::HandleAudioTrackRequest(
     MHD_Connection *connection,
     std::vector<std::string>& pathParts)
 {
-    size_t bitrate = getUnsignedUrlParam(connection, "bitrate", 0);
-    int maxActiveTranscoders = server->context.prefs->GetInt(
-        prefs::transcoder_max_active_count.c_str(),
-        defaults::transcoder_max_active_count);
+    const TranscodePreset* preset = nullptr;
+    auto presetIt = TRANSCODE_PRESETS.find(
+        str::ToLowerCopy(getStringUrlParam(connection, "preset", "")));
+
+    if (presetIt != TRANSCODE_PRESETS.end()) {
+        preset = &presetIt->second;
+    }
 
-    if (bitrate != 0 && Transcoder::GetActiveCount() >= maxActiveTranscoders) {
+    size_t bitrate = getUnsignedUrlParam(connection, "bitrate", preset ? preset->bitrate : 0);
+
+    /* each connection has its own thread, so queue up behind the running
+    transcoders instead of turning the request away immediately. the slot
+    stays reserved until we return, by which point the transcoder (if any)
+    is counted as active. */
+    Transcoder::SlotReservation slot;
+    if (bitrate != 0 && !slot.Wait(server->context)) {
         response = MHD_create_response_from_buffer(0, nullptr, MHD_RESPMEM_PERSISTENT);
         return MHD_HTTP_TOO_MANY_REQUESTS;
     }
@@ -457,7 +611,7 @@ int HttpServer::HandleAudioTrackRequest(
         std::string format;
 
         if (bitrate != 0) {
-            format = getStringUrlParam(connection, "format", "mp3");
+            format = getStringUrlParam(connection, "format", preset ? preset->format : "mp3");
         }
 
         IDataStream* file = (bitrate == 0)
@@ -608,33 +762,109 @@ int HttpServer::HandleThumbnailRequest(
     MHD_Connection* connection,
     std::vector<std::string>& pathParts)
 {
+    using Format = ThumbnailResizer::Format;
+
     int status = MHD_HTTP_NOT_FOUND;
 
     char pathBuffer[4096];
     server->context.environment->GetPath(PathType::Library, pathBuffer, sizeof(pathBuffer));
 
     if (strlen(pathBuffer)) {
-        std::string path = std::string(pathBuffer) + "thumbs/" + pathParts.at(1) + ".jpg";
-        IDataStream* file = server->context.environment->GetDataStream(path.c_str(), OpenFlags::Read);
+        const std::string thumbsPath = std::string(pathBuffer) + "thumbs/";
+        const std::string original = thumbsPath + pathParts.at(1) + ".jpg";
 
-        if (file) {
-            long length = file->Length();
+        if (!std::fs::exists(std::fs::u8path(original))) {
+            return status;
+        }
 
-            response = MHD_create_response_from_callback(
-                length == 0 ? MHD_SIZE_UNKNOWN : length + 1,
-                4096,
-                &fileReadCallback,
-                parseRange(file, nullptr),
-                &fileFreeCallback);
+        /* /thumbnail/<id>?size=<pixels>&format=<jpg|webp> */
+        bool negotiated = false;
+        const int size = resolveThumbnailSize(getUnsignedUrlParam(connection, "size", 0));
+        const Format format = resolveThumbnailFormat(connection, size > 0, negotiated);
+
+        std::string path = original;
+        std::string variant = "original";
+
+        if (size > 0 || format != Format::Jpeg) {
+            const std::string extension = (format == Format::Webp) ? "webp" : "jpg";
+            variant = std::to_string(size) + extension;
+            const std::string resized = thumbsPath + pathParts.at(1) +
+                "_" + std::to_string(size) + "." + extension;
+
+            if (ensureThumbnailVariant(original, resized, size > 0 ? size : INT_MAX, format)) {
+                path = resized;
+            }
+            else {
+                variant = "original";
+#ifdef ENABLE_DEBUG
+                server->context.debug->Warning(TAG, str::Format("failed to resize %s", original.c_str()).c_str());
+#endif
+            }
+        }
+
+        size_t fileSize = 0;
+        const std::string etag = thumbnailEtag(path, variant, fileSize);
+        const std::string type = contentType(path);
+
+        if (etagMatches(connection, etag)) {
+            response = MHD_create_response_from_buffer(0, nullptr, MHD_RESPMEM_PERSISTENT);
+            status = MHD_HTTP_NOT_MODIFIED;
+        }
+        else {
+            auto cached = server->thumbnailCache.Get(path, etag);
+
+            if (!cached) {
+                IDataStream* file = server->context.environment->GetDataStream(path.c_str(), OpenFlags::Read);
+                if (file) {
+                    long length = file->Length();
+                    if (length > 0 && (size_t) length <= server->thumbnailCache.MaxEntryBytes()) {
+                        auto entry = std::make_shared<ThumbnailCache::Entry>();
+                        entry->data.resize((size_t) length);
+                        entry->etag = etag;
+                        entry->contentType = type;
+                        if (file->Read(&entry->data[0], length) == length) {
+                            server->thumbnailCache.Put(path, entry);
+                            cached = entry;
+                        }
+                        file->Release();
+                    }
+                    else {
+                        /* too big to cache, stream it from disk */
+                        response = MHD_create_response_from_callback(
+                            length == 0 ? MHD_SIZE_UNKNOWN : length + 1,
+                            4096,
+                            &fileReadCallback,
+                            parseRange(file, nullptr),
+                            &fileFreeCallback);
+
+                        if (!response) {
+                            file->Release();
+                        }
+                    }
+                }
+            }
+
+            if (cached) {
+                response = MHD_create_response_from_buffer(
+                    cached->data.size(),
+                    (void*) cached->data.c_str(),
+                    MHD_RESPMEM_MUST_COPY);
+            }
 
             if (response) {
-                MHD_add_response_header(response, "Cache-Control", "public, max-age=31536000");
-                MHD_add_response_header(response, "Content-Type", contentType(path).c_str());
-                MHD_add_response_header(response, "Server", "musikcube server");
+                MHD_add_response_header(response, "Content-Type", type.c_str());
                 status = MHD_HTTP_OK;
             }
-            else {
-                file->Release();
+        }
+
+        if (response) {
+            MHD_add_response_header(response, "Cache-Control", "public, max-age=31536000");
+            MHD_add_response_header(response, "Server", "musikcube server");
+            if (etag.size()) {
+                MHD_add_response_header(response, "ETag", etag.c_str());
+            }
+            if (negotiated) {
+                MHD_add_response_header(response, "Vary", "Accept");
             }
         }
     }
@@ -41,6 +41,7 @@ extern "C" {
 }
 
 #include "Context.h"
+#include "ThumbnailCache.h"
 #include <condition_variable>
 #include <mutex>
 #include <vector>
@@ -88,6 +89,7 @@ class HttpServer {
 
         struct MHD_Daemon *httpServer;
         Context& context;
+        ThumbnailCache thumbnailCache;
         volatile bool running;
         std::condition_variable exitCondition;
         std::mutex exitMutex;
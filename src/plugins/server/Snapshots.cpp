@@ -33,14 +33,30 @@
 //////////////////////////////////////////////////////////////////////////////
 
 #include "Snapshots.h"
+#include "Constants.h"
+#include <musikcore/sdk/String.h>
 #include <chrono>
 #include <algorithm>
 
-using TrackList = Snapshots::TrackList;
+using namespace musik::core::sdk;
 using namespace std::chrono;
 
+using TrackList = Snapshots::TrackList;
+using IdList = Snapshots::IdList;
+
 static const int64_t SIX_HOURS_MILLIS = 1000 * 60 * 60 * 6;
 
+/* rough per-entry and per-list bookkeeping overhead (map node, list node,
+shared_ptr control block, vector header) used for memory accounting. */
+static const size_t ENTRY_OVERHEAD_BYTES = 128;
+static const size_t LIST_OVERHEAD_BYTES = 64;
+
+static const char* TAG = "Snapshots";
+
+/* track metadata is resolved in aligned windows of this many ids, so a page
+of a large snapshot only loads the rows around it. */
+static const size_t RESOLVE_WINDOW_SIZE = 500;
+
 static inline int64_t now() {
     return duration_cast<milliseconds>(
         system_clock::now().time_since_epoch()).count();
@@ -54,49 +70,240 @@ static inline bool expired(int64_t expiry) {
     return now() >= expiry;
 }
 
+static inline size_t listBytes(const IdList& ids) {
+    return LIST_OVERHEAD_BYTES + ids->size() * sizeof(int64_t);
+}
+
+static inline size_t entryBytes(const std::string& key) {
+    return ENTRY_OVERHEAD_BYTES + key.size();
+}
+
+static size_t hashIds(const std::vector<int64_t>& ids) {
+    /* FNV-1a over the raw ids */
+    uint64_t hash = 14695981039346656037ULL;
+    for (int64_t id : ids) {
+        hash ^= (uint64_t) id;
+        hash *= 1099511628211ULL;
+    }
+    return (size_t) (hash ^ ids.size());
+}
+
+/* a lightweight, read-only ITrackList view over a shared id array. the
+track list keeps the array alive, so it remains valid even if the snapshot
+it came from is removed or evicted while a request is using it. track
+metadata is resolved with a single batch query per window of ids, and only
+the most recently used window is kept. */
+class SnapshotTrackList : public ITrackList {
+    public:
+        SnapshotTrackList(IdList ids, IMetadataProxy* metadataProxy)
+        : ids(ids), metadataProxy(metadataProxy), resolved(nullptr), resolvedOffset(0) {
+        }
+
+        virtual ~SnapshotTrackList() {
+            if (resolved) {
+                resolved->Release();
+            }
+        }
+
+        virtual void Release() override {
+            delete this;
+        }
+
+        virtual size_t Count() const override {
+            return ids->size();
+        }
+
+        virtual int64_t GetId(size_t index) const override {
+            return (index < ids->size()) ? (*ids)[index] : -1;
+        }
+
+        virtual int IndexOf(int64_t id) const override {
+            auto it = std::find(ids->begin(), ids->end(), id);
+            return (it == ids->end()) ? -1 : (int) (it - ids->begin());
+        }
+
+        virtual ITrack* GetTrack(size_t index) const override {
+            if (index < ids->size() && metadataProxy) {
+                const size_t offset = index - (index % RESOLVE_WINDOW_SIZE);
+                if (!resolved || offset != resolvedOffset) {
+                    if (resolved) {
+                        resolved->Release();
+                    }
+                    const size_t count = std::min(RESOLVE_WINDOW_SIZE, ids->size() - offset);
+                    resolved = metadataProxy->QueryTracksByIds(ids->data() + offset, count);
+                    resolvedOffset = offset;
+                }
+                if (resolved) {
+                    return resolved->GetTrack(index - offset);
+                }
+            }
+            return nullptr;
+        }
+
+    private:
+        IdList ids;
+        IMetadataProxy* metadataProxy;
+        mutable ITrackList* resolved;
+        mutable size_t resolvedOffset;
+};
+
+Snapshots::Snapshots(Context& context)
+: context(context) {
+    this->stats = { };
+    this->stats.maxBytes = (size_t) defaults::snapshot_memory_cache_size_mb * 1024 * 1024;
+}
+
 Snapshots::~Snapshots() {
     Reset();
 }
 
 TrackList* Snapshots::Get(const std::string& key) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->PruneExpired();
     auto it = this->cache.find(key);
     if (it != this->cache.end()) {
-        this->cache[key] = CacheKey(it->second.tracks, expiry());
-        return it->second.tracks;
+        it->second.expiry = expiry();
+        this->lru.splice(this->lru.begin(), this->lru, it->second.position);
+        ++this->stats.hits;
+        return new SnapshotTrackList(it->second.ids, context.metadataProxy);
     }
+    ++this->stats.misses;
     return nullptr;
 }
 
 void Snapshots::Put(const std::string& key, TrackList* tracks) {
-    this->Prune();
-    this->Remove(key);
-    this->cache[key] = CacheKey(tracks, expiry());
+    if (!tracks) {
+        return;
+    }
+
+    /* copy the ids out before we take the lock; this may be slow for
+    large lists, and doesn't touch any of our state. */
+    std::vector<int64_t> ids;
+    ids.reserve(tracks->Count());
+    for (size_t i = 0; i < tracks->Count(); i++) {
+        ids.push_back(tracks->GetId(i));
+    }
+    tracks->Release();
+
+    const size_t hash = hashIds(ids);
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->PruneExpired();
+    this->RemoveEntry(key);
+
+    IdList shared = this->Intern(std::move(ids), hash);
+    this->lru.push_front(key);
+    this->cache[key] = { shared, hash, expiry(), this->lru.begin() };
+    this->stats.bytes += entryBytes(key);
+    this->stats.entries = this->cache.size();
+
+    this->Evict();
 }
 
 void Snapshots::Remove(const std::string& key) {
-    this->Prune();
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->RemoveEntry(key);
+    this->PruneExpired();
+}
+
+void Snapshots::Prune() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->PruneExpired();
+}
+
+void Snapshots::Reset() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->cache.clear();
+    this->lru.clear();
+    this->interned.clear();
+    this->stats.entries = 0;
+    this->stats.uniqueLists = 0;
+    this->stats.bytes = 0;
+}
+
+void Snapshots::SetMaxBytes(size_t maxBytes) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->stats.maxBytes = maxBytes;
+    this->Evict();
+}
+
+Snapshots::Stats Snapshots::GetStats() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    return this->stats;
+}
+
+IdList Snapshots::Intern(std::vector<int64_t>&& ids, size_t hash) {
+    auto& bucket = this->interned[hash];
+    for (auto& shared : bucket) {
+        if (*shared.ids == ids) {
+            ++shared.refs;
+            ++this->stats.deduplicated;
+            return shared.ids;
+        }
+    }
+
+    IdList result = std::make_shared<const std::vector<int64_t>>(std::move(ids));
+    bucket.push_back({ result, 1 });
+    this->stats.bytes += listBytes(result);
+    ++this->stats.uniqueLists;
+    return result;
+}
+
+void Snapshots::Unintern(const IdList& ids, size_t hash) {
+    auto bucketIt = this->interned.find(hash);
+    if (bucketIt != this->interned.end()) {
+        auto& bucket = bucketIt->second;
+        for (auto it = bucket.begin(); it != bucket.end(); ++it) {
+            if (it->ids == ids) {
+                if (--it->refs == 0) {
+                    this->stats.bytes -= listBytes(it->ids);
+                    --this->stats.uniqueLists;
+                    bucket.erase(it);
+                    if (bucket.empty()) {
+                        this->interned.erase(bucketIt);
+                    }
+                }
+                return;
+            }
+        }
+    }
+}
+
+void Snapshots::RemoveEntry(const std::string& key) {
     auto it = this->cache.find(key);
     if (it != this->cache.end()) {
-        it->second.tracks->Release();
+        this->Unintern(it->second.ids, it->second.hash);
+        this->stats.bytes -= entryBytes(key);
+        this->lru.erase(it->second.position);
         this->cache.erase(it);
+        this->stats.entries = this->cache.size();
     }
 }
 
-void Snapshots::Prune() {
-    auto it = this->cache.begin();
-    while (it != this->cache.end()) {
-        if (expired(it->second.expiry)) {
-            it->second.tracks->Release();
-            it = this->cache.erase(it);
-            continue;
+void Snapshots::PruneExpired() {
+    std::vector<std::string> expiredKeys;
+    for (auto& it : this->cache) {
+        if (expired(it.second.expiry)) {
+            expiredKeys.push_back(it.first);
         }
-        ++it;
+    }
+    for (auto& key : expiredKeys) {
+        this->RemoveEntry(key);
+        ++this->stats.expired;
     }
 }
 
-void Snapshots::Reset() {
-    for (auto it : cache) {
-        it.second.tracks->Release();
+void Snapshots::Evict() {
+    /* always keep the most recent entry, even if it alone exceeds the budget;
+    otherwise a device with a huge play queue could never snapshot it. */
+    while (this->stats.bytes > this->stats.maxBytes && this->lru.size() > 1) {
+        const std::string key = this->lru.back();
+        this->RemoveEntry(key);
+        ++this->stats.evicted;
+
+        if (context.debug) {
+            context.debug->Info(TAG, str::Format(
+                "evicted snapshot for %s, %zu bytes in use", key.c_str(), this->stats.bytes).c_str());
+        }
     }
-    this->cache.clear();
-}
\ No newline at end of file
+}
@@ -34,37 +34,77 @@
 
 #pragma once
 
+#include "Context.h"
 #include <musikcore/sdk/ITrackList.h>
-#include <map>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+/* per-device play queue snapshots. snapshots only store track ids; lists with
+identical contents (e.g. many phones snapshotting the same play queue) share
+a single immutable id array. entries expire after a period of inactivity, and
+the least recently used entries are evicted when the memory budget is hit. */
 class Snapshots {
     public:
         using TrackList = musik::core::sdk::ITrackList;
+        using IdList = std::shared_ptr<const std::vector<int64_t>>;
 
+        struct Stats {
+            size_t entries;
+            size_t uniqueLists;
+            size_t bytes;
+            size_t maxBytes;
+            size_t hits;
+            size_t misses;
+            size_t deduplicated;
+            size_t evicted;
+            size_t expired;
+        };
+
+        Snapshots(Context& context);
         ~Snapshots();
 
+        /* returns a new instance that must be Release()'d by the caller, or
+        nullptr if there's no snapshot for the specified key */
         TrackList* Get(const std::string& key);
+
+        /* copies the ids out of the specified list, then releases it */
         void Put(const std::string& key, TrackList* tracks);
+
         void Remove(const std::string& key);
         void Prune();
         void Reset();
+        void SetMaxBytes(size_t maxBytes);
+        Stats GetStats();
 
     private:
-        struct CacheKey {
-            CacheKey(): CacheKey(nullptr, 0) {
-            }
-            CacheKey(const CacheKey& ck) {
-                this->tracks = ck.tracks;
-                this->expiry = ck.expiry;
-            }
-            CacheKey(TrackList* tl, int64_t ex) {
-                this->tracks = tl;
-                this->expiry = ex;
-            }
-            TrackList* tracks;
+        using KeyList = std::list<std::string>;
+
+        struct Entry {
+            IdList ids;
+            size_t hash;
             int64_t expiry;
+            KeyList::iterator position;
+        };
+
+        struct SharedList {
+            IdList ids;
+            size_t refs;
         };
 
-        std::map<std::string, CacheKey> cache;
-};
\ No newline at end of file
+        IdList Intern(std::vector<int64_t>&& ids, size_t hash);
+        void Unintern(const IdList& ids, size_t hash);
+        void RemoveEntry(const std::string& key);
+        void PruneExpired();
+        void Evict();
+
+        Context& context;
+        std::mutex mutex;
+        KeyList lru;
+        std::unordered_map<std::string, Entry> cache;
+        std::unordered_map<size_t, std::vector<SharedList>> interned;
+        Stats stats;
+};
@@ -0,0 +1,110 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2021 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "ThumbnailCache.h"
+
+/* individual thumbnails larger than maxBytes / ENTRY_DIVISOR are streamed from
+disk instead of being cached; this prevents a couple huge embedded cover scans
+from flushing everything else out of the cache. */
+static const size_t ENTRY_DIVISOR = 8;
+static const size_t DEFAULT_MAX_BYTES = 16 * 1024 * 1024;
+
+using EntryPtr = ThumbnailCache::EntryPtr;
+
+ThumbnailCache::ThumbnailCache()
+: maxBytes(DEFAULT_MAX_BYTES)
+, totalBytes(0) {
+}
+
+EntryPtr ThumbnailCache::Get(const std::string& key, const std::string& etag) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    auto it = this->cache.find(key);
+    if (it != this->cache.end()) {
+        /* the file backing this entry changed on disk since we cached it;
+        drop it and let the caller reload. */
+        if (it->second.entry->etag != etag) {
+            this->Remove(key);
+            return EntryPtr();
+        }
+        this->lru.splice(this->lru.begin(), this->lru, it->second.position);
+        return it->second.entry;
+    }
+    return EntryPtr();
+}
+
+void ThumbnailCache::Put(const std::string& key, EntryPtr entry) {
+    if (!entry || entry->data.size() > this->MaxEntryBytes()) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->Remove(key);
+    this->lru.push_front(key);
+    this->cache[key] = { entry, this->lru.begin() };
+    this->totalBytes += entry->data.size();
+    this->Evict();
+}
+
+void ThumbnailCache::SetMaxBytes(size_t maxBytes) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->maxBytes = maxBytes;
+    this->Evict();
+}
+
+size_t ThumbnailCache::MaxEntryBytes() const {
+    return this->maxBytes / ENTRY_DIVISOR;
+}
+
+void ThumbnailCache::Reset() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->cache.clear();
+    this->lru.clear();
+    this->totalBytes = 0;
+}
+
+void ThumbnailCache::Remove(const std::string& key) {
+    auto it = this->cache.find(key);
+    if (it != this->cache.end()) {
+        this->totalBytes -= it->second.entry->data.size();
+        this->lru.erase(it->second.position);
+        this->cache.erase(it);
+    }
+}
+
+void ThumbnailCache::Evict() {
+    while (this->totalBytes > this->maxBytes && this->lru.size()) {
+        const std::string key = this->lru.back();
+        this->Remove(key);
+    }
+}
@@ -0,0 +1,80 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2021 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/* a small, byte-bounded LRU cache used to keep hot thumbnails in memory so
+the http server doesn't have to hit the disk for every album grid cell. */
+class ThumbnailCache {
+    public:
+        struct Entry {
+            std::string data;
+            std::string etag;
+            std::string contentType;
+        };
+
+        using EntryPtr = std::shared_ptr<const Entry>;
+
+        ThumbnailCache();
+
+        EntryPtr Get(const std::string& key, const std::string& etag);
+        void Put(const std::string& key, EntryPtr entry);
+        void SetMaxBytes(size_t maxBytes);
+        void Reset();
+
+        size_t MaxEntryBytes() const;
+
+    private:
+        using KeyList = std::list<std::string>;
+
+        struct CacheValue {
+            EntryPtr entry;
+            KeyList::iterator position;
+        };
+
+        void Remove(const std::string& key);
+        void Evict();
+
+        std::mutex mutex;
+        KeyList lru;
+        std::unordered_map<std::string, CacheValue> cache;
+        size_t maxBytes;
+        size_t totalBytes;
+};
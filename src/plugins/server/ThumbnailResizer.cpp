@@ -0,0 +1,431 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2021 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "ThumbnailResizer.h"
+
+extern "C" {
+    #pragma warning(push, 0)
+    #include <libavcodec/avcodec.h>
+    #include <libavutil/imgutils.h>
+    #include <libavutil/pixdesc.h>
+    #pragma warning(pop)
+}
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using Format = ThumbnailResizer::Format;
+
+static const int JPEG_QSCALE = 4; /* 2 (best) -> 31 (worst) */
+static const int WEBP_QUALITY = 80; /* 0 (worst) -> 100 (best) */
+
+/* an 8-bit image plane. stride is always equal to width. */
+struct Plane {
+    int width{ 0 };
+    int height{ 0 };
+    std::vector<uint8_t> data;
+
+    void Allocate(int width, int height, uint8_t fill = 0) {
+        this->width = width;
+        this->height = height;
+        this->data.assign((size_t) width * height, fill);
+    }
+};
+
+/* full-range (jpeg) Y, Cb, Cr planes. chroma planes may be subsampled. */
+struct Image {
+    Plane planes[3];
+};
+
+static bool readFile(const std::string& filename, std::string& data) {
+    std::ifstream in(fs::u8path(filename), std::ios::in | std::ios::binary);
+    if (in.good()) {
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return data.size() > 0;
+    }
+    return false;
+}
+
+static bool writeFile(const std::string& filename, const uint8_t* data, size_t size) {
+    /* write to a temp file first, then rename, so concurrent readers never
+    see a partially written thumbnail. */
+    const std::string tempFilename = filename + ".tmp";
+    {
+        std::ofstream out(fs::u8path(tempFilename), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out.good()) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(data), size);
+        if (!out.good()) {
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(fs::u8path(tempFilename), fs::u8path(filename), ec);
+    if (ec) {
+        fs::remove(fs::u8path(tempFilename), ec);
+        return false;
+    }
+    return true;
+}
+
+static AVCodecID sniffCodec(const std::string& data) {
+    if (data.size() >= 8 && data.compare(0, 4, "\x89PNG") == 0) {
+        return AV_CODEC_ID_PNG;
+    }
+    if (data.size() >= 12 && data.compare(0, 4, "RIFF") == 0 && data.compare(8, 4, "WEBP") == 0) {
+        return AV_CODEC_ID_WEBP;
+    }
+    if (data.size() >= 6 && data.compare(0, 4, "GIF8") == 0) {
+        return AV_CODEC_ID_GIF;
+    }
+    if (data.size() >= 2 && data.compare(0, 2, "BM") == 0) {
+        return AV_CODEC_ID_BMP;
+    }
+    return AV_CODEC_ID_MJPEG;
+}
+
+static AVFrame* decode(const std::string& data) {
+    AVFrame* result = nullptr;
+
+    auto codec = avcodec_find_decoder(sniffCodec(data));
+    if (!codec) {
+        return nullptr;
+    }
+
+    AVCodecContext* context = avcodec_alloc_context3(codec);
+    AVPacket* packet = av_packet_alloc();
+    AVFrame* frame = av_frame_alloc();
+
+    if (context && packet && frame &&
+        avcodec_open2(context, codec, nullptr) >= 0 &&
+        av_new_packet(packet, (int) data.size()) >= 0)
+    {
+        memcpy(packet->data, data.c_str(), data.size());
+        if (avcodec_send_packet(context, packet) >= 0) {
+            avcodec_send_packet(context, nullptr); /* flush */
+            if (avcodec_receive_frame(context, frame) >= 0) {
+                result = frame;
+                frame = nullptr;
+            }
+        }
+    }
+
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    avcodec_free_context(&context);
+
+    return result;
+}
+
+static inline uint8_t clamp(int value) {
+    return (uint8_t) std::min(255, std::max(0, value));
+}
+
+/* BT.601 full-range conversion, fixed point (16.16) */
+static inline void rgbToYuv(int r, int g, int b, uint8_t& y, uint8_t& u, uint8_t& v) {
+    y = clamp((19595 * r + 38470 * g + 7471 * b + 32768) >> 16);
+    u = clamp(((-11059 * r - 21709 * g + 32768 * b + 32768) >> 16) + 128);
+    v = clamp(((32768 * r - 27439 * g - 5329 * b + 32768) >> 16) + 128);
+}
+
+/* area-averaging downscale. every source pixel contributes to exactly one
+destination pixel, so the cost is linear in the size of the source. */
+static void scalePlane(
+    const uint8_t* src, int srcStride, int srcWidth, int srcHeight,
+    uint8_t* dst, int dstStride, int dstWidth, int dstHeight)
+{
+    for (int y = 0; y < dstHeight; y++) {
+        const int y0 = (int) ((int64_t) y * srcHeight / dstHeight);
+        const int y1 = std::max(y0 + 1, (int) ((int64_t) (y + 1) * srcHeight / dstHeight));
+        uint8_t* out = dst + (size_t) y * dstStride;
+        for (int x = 0; x < dstWidth; x++) {
+            const int x0 = (int) ((int64_t) x * srcWidth / dstWidth);
+            const int x1 = std::max(x0 + 1, (int) ((int64_t) (x + 1) * srcWidth / dstWidth));
+            uint32_t sum = 0;
+            for (int sy = y0; sy < y1; sy++) {
+                const uint8_t* in = src + (size_t) sy * srcStride;
+                for (int sx = x0; sx < x1; sx++) {
+                    sum += in[sx];
+                }
+            }
+            const uint32_t count = (uint32_t) ((y1 - y0) * (x1 - x0));
+            out[x] = (uint8_t) ((sum + count / 2) / count);
+        }
+    }
+}
+
+static void scalePlane(const Plane& src, Plane& dst) {
+    scalePlane(
+        src.data.data(), src.width, src.width, src.height,
+        dst.data.data(), dst.width, dst.width, dst.height);
+}
+
+/* converts whatever the decoder gave us into full-range YCbCr planes, then
+downscales into the output image. returns false for exotic pixel formats
+(high bit depth, float, etc); callers fall back to the original image. */
+static bool scale(const AVFrame* frame, Image& output, int width, int height) {
+    auto format = (AVPixelFormat) frame->format;
+    auto desc = av_pix_fmt_desc_get(format);
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_FLOAT))) {
+        return false;
+    }
+
+    for (int i = 0; i < desc->nb_components; i++) {
+        if (desc->comp[i].depth != 8) {
+            return false;
+        }
+    }
+
+    const int chromaWidth = (width + 1) / 2;
+    const int chromaHeight = (height + 1) / 2;
+    output.planes[0].Allocate(width, height);
+    output.planes[1].Allocate(chromaWidth, chromaHeight);
+    output.planes[2].Allocate(chromaWidth, chromaHeight);
+
+    const bool isPalette = !!(desc->flags & AV_PIX_FMT_FLAG_PAL);
+    const bool isRgb = !!(desc->flags & AV_PIX_FMT_FLAG_RGB);
+    const int colorComponents = std::min(3, (int) desc->nb_components);
+
+    /* one component per plane, no interleaving (i.e. not NV12, YUYV, etc) */
+    bool isPlanar = true;
+    for (int i = 0; i < colorComponents; i++) {
+        isPlanar = isPlanar && desc->comp[i].step == 1 && desc->comp[i].plane == i;
+    }
+
+    if (!isPalette && !isRgb && isPlanar && colorComponents != 2) {
+        /* planar YCbCr (or grayscale); scale each plane directly from the frame */
+        const bool limited = frame->color_range != AVCOL_RANGE_JPEG &&
+            format != AV_PIX_FMT_YUVJ420P &&
+            format != AV_PIX_FMT_YUVJ422P &&
+            format != AV_PIX_FMT_YUVJ444P &&
+            format != AV_PIX_FMT_YUVJ440P &&
+            format != AV_PIX_FMT_YUVJ411P &&
+            format != AV_PIX_FMT_GRAY8;
+
+        scalePlane(
+            frame->data[0], frame->linesize[0], frame->width, frame->height,
+            output.planes[0].data.data(), width, width, height);
+
+        if (colorComponents == 3) {
+            const int srcChromaWidth = AV_CEIL_RSHIFT(frame->width, desc->log2_chroma_w);
+            const int srcChromaHeight = AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h);
+            for (int i = 1; i < 3; i++) {
+                scalePlane(
+                    frame->data[i], frame->linesize[i], srcChromaWidth, srcChromaHeight,
+                    output.planes[i].data.data(), chromaWidth, chromaWidth, chromaHeight);
+            }
+        }
+        else {
+            output.planes[1].Allocate(chromaWidth, chromaHeight, 128);
+            output.planes[2].Allocate(chromaWidth, chromaHeight, 128);
+        }
+
+        if (limited) {
+            for (auto& y : output.planes[0].data) {
+                y = clamp(((y - 16) * 255 + 109) / 219);
+            }
+            for (int i = 1; i < 3; i++) {
+                for (auto& c : output.planes[i].data) {
+                    c = clamp(((c - 128) * 255 + 112) / 224 + 128);
+                }
+            }
+        }
+
+        return true;
+    }
+
+    if (!isPalette && (!isRgb || (desc->flags & AV_PIX_FMT_FLAG_PLANAR) || colorComponents < 3)) {
+        return false; /* e.g. GBRP or NV12; rare enough we don't bother */
+    }
+
+    /* packed rgb or palette: convert to 4:4:4 at the source resolution, then scale */
+    Plane full[3];
+    for (int i = 0; i < 3; i++) {
+        full[i].Allocate(frame->width, frame->height);
+    }
+
+    const uint32_t* palette = reinterpret_cast<const uint32_t*>(frame->data[1]);
+    const int step = desc->comp[0].step;
+
+    for (int y = 0; y < frame->height; y++) {
+        const uint8_t* row = frame->data[0] + (size_t) y * frame->linesize[0];
+        const size_t offset = (size_t) y * frame->width;
+        for (int x = 0; x < frame->width; x++) {
+            int r, g, b;
+            if (isPalette) {
+                const uint32_t argb = palette[row[x]];
+                r = (argb >> 16) & 0xff;
+                g = (argb >> 8) & 0xff;
+                b = argb & 0xff;
+            }
+            else {
+                const uint8_t* pixel = row + (size_t) x * step;
+                r = pixel[desc->comp[0].offset];
+                g = pixel[desc->comp[1].offset];
+                b = pixel[desc->comp[2].offset];
+            }
+            rgbToYuv(r, g, b,
+                full[0].data[offset + x],
+                full[1].data[offset + x],
+                full[2].data[offset + x]);
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        scalePlane(full[i], output.planes[i]);
+    }
+
+    return true;
+}
+
+static bool encode(const Image& image, Format format, std::vector<uint8_t>& result) {
+    const bool webp = (format == Format::Webp);
+
+    auto codec = avcodec_find_encoder(webp ? AV_CODEC_ID_WEBP : AV_CODEC_ID_MJPEG);
+    if (!codec) {
+        return false;
+    }
+
+    bool success = false;
+    AVCodecContext* context = avcodec_alloc_context3(codec);
+    AVPacket* packet = av_packet_alloc();
+    AVFrame* frame = av_frame_alloc();
+
+    if (context && packet && frame) {
+        const AVPixelFormat pixelFormat = webp ? AV_PIX_FMT_YUV420P : AV_PIX_FMT_YUVJ420P;
+
+        context->width = image.planes[0].width;
+        context->height = image.planes[0].height;
+        context->pix_fmt = pixelFormat;
+        context->color_range = webp ? AVCOL_RANGE_MPEG : AVCOL_RANGE_JPEG;
+        context->time_base = { 1, 25 };
+        context->flags |= AV_CODEC_FLAG_QSCALE;
+        context->global_quality = FF_QP2LAMBDA * (webp ? WEBP_QUALITY : JPEG_QSCALE);
+        context->strict_std_compliance = FF_COMPLIANCE_UNOFFICIAL;
+
+        frame->width = context->width;
+        frame->height = context->height;
+        frame->format = pixelFormat;
+        frame->quality = context->global_quality;
+
+        if (avcodec_open2(context, codec, nullptr) >= 0 && av_frame_get_buffer(frame, 0) >= 0) {
+            for (int i = 0; i < 3; i++) {
+                const Plane& plane = image.planes[i];
+                for (int y = 0; y < plane.height; y++) {
+                    const uint8_t* src = plane.data.data() + (size_t) y * plane.width;
+                    uint8_t* dst = frame->data[i] + (size_t) y * frame->linesize[i];
+                    if (webp) {
+                        /* libwebp expects limited range input */
+                        const int scale = (i == 0) ? 219 : 224;
+                        const int bias = (i == 0) ? 16 : 128;
+                        const int center = (i == 0) ? 0 : 128;
+                        for (int x = 0; x < plane.width; x++) {
+                            dst[x] = clamp(((src[x] - center) * scale + 127) / 255 + bias);
+                        }
+                    }
+                    else {
+                        memcpy(dst, src, plane.width);
+                    }
+                }
+            }
+
+            if (avcodec_send_frame(context, frame) >= 0) {
+                avcodec_send_frame(context, nullptr); /* flush */
+                if (avcodec_receive_packet(context, packet) >= 0 && packet->size > 0) {
+                    result.assign(packet->data, packet->data + packet->size);
+                    success = true;
+                }
+            }
+        }
+    }
+
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    avcodec_free_context(&context);
+
+    return success;
+}
+
+bool ThumbnailResizer::WebpSupported() {
+    return avcodec_find_encoder(AV_CODEC_ID_WEBP) != nullptr;
+}
+
+bool ThumbnailResizer::Resize(
+    const std::string& inputFilename,
+    const std::string& outputFilename,
+    int maxDimension,
+    Format format)
+{
+    if (maxDimension <= 0) {
+        return false;
+    }
+
+    std::string data;
+    if (!readFile(inputFilename, data)) {
+        return false;
+    }
+
+    AVFrame* frame = decode(data);
+    if (!frame) {
+        return false;
+    }
+
+    data.clear();
+    data.shrink_to_fit();
+
+    bool success = false;
+
+    if (frame->width > 0 && frame->height > 0) {
+        /* never upscale; just re-encode at the original dimensions */
+        const int longest = std::max(frame->width, frame->height);
+        const int target = std::min(maxDimension, longest);
+        const int width = std::max(1, (int) ((int64_t) frame->width * target / longest));
+        const int height = std::max(1, (int) ((int64_t) frame->height * target / longest));
+
+        Image image;
+        std::vector<uint8_t> encoded;
+        if (scale(frame, image, width, height) && encode(image, format, encoded)) {
+            success = writeFile(outputFilename, encoded.data(), encoded.size());
+        }
+    }
+
+    av_frame_free(&frame);
+
+    return success;
+}
@@ -48,6 +48,8 @@
 
 namespace fs = std::filesystem;
 
+#define SLOT_WAIT_TIMEOUT_SECONDS 30
+
 using namespace std::chrono;
 using namespace musik::core::sdk;
 
@@ -55,6 +57,10 @@ std::mutex transcoderMutex;
 std::condition_variable waitForTranscode;
 std::set<std::string> runningBlockingTranscoders;
 
+static std::mutex slotMutex;
+static std::condition_variable slotAvailable;
+static int reservedSlots = 0; /* guarded by slotMutex */
+
 static IEncoder* getEncoder(Context& context, const std::string& format) {
     std::string extension = "." + format;
     return context.environment->GetEncoder(extension.c_str());
@@ -236,7 +242,6 @@ IDataStream* Transcoder::TranscodeOnDemand(
         the storage disk */
         if (transcoderStream->Length() < 0) {
             transcoderStream->Release();
-            delete transcoderStream;
             transcoderStream = new TranscodingAudioDataStream(context, encoder, uri, bitrate, format);
         }
     }
@@ -281,7 +286,6 @@ IDataStream* Transcoder::TranscodeAndWait(
         we disallow waiting for them because they may never finish */
         if (transcoderStream->Length() < 0) {
             transcoderStream->Release();
-            delete transcoderStream;
             return nullptr;
         }
 
@@ -293,7 +297,7 @@ IDataStream* Transcoder::TranscodeAndWait(
 
         transcoderStream->Release();
         PruneTranscodeCache(context);
-        return context.environment->GetDataStream(uri.c_str(), OpenFlags::Read);
+        return context.environment->GetDataStream(expectedFilename.c_str(), OpenFlags::Read);
     }
     else {
         IBlockingEncoder* blockingEncoder = dynamic_cast<IBlockingEncoder*>(encoder);
@@ -345,4 +349,36 @@ IDataStream* Transcoder::TranscodeAndWait(
 
 int Transcoder::GetActiveCount() {
     return BlockingTranscoder::GetActiveCount() + TranscodingAudioDataStream::GetActiveCount();
-}
\ No newline at end of file
+}
+
+bool Transcoder::WaitForSlot(Context& context) {
+    int maxActive = context.prefs->GetInt(
+        prefs::transcoder_max_active_count.c_str(),
+        defaults::transcoder_max_active_count);
+
+    std::unique_lock<std::mutex> lock(slotMutex);
+    const bool available = slotAvailable.wait_for(
+        lock,
+        seconds(SLOT_WAIT_TIMEOUT_SECONDS),
+        [maxActive]() { return GetActiveCount() + reservedSlots < maxActive; });
+
+    if (available) {
+        ++reservedSlots;
+    }
+
+    return available;
+}
+
+void Transcoder::ReleaseSlot() {
+    std::unique_lock<std::mutex> lock(slotMutex);
+    if (reservedSlots > 0) {
+        --reservedSlots;
+    }
+    slotAvailable.notify_one();
+}
+
+void Transcoder::NotifySlotAvailable() {
+    /* one transcoder went away, so at most one waiter can proceed */
+    std::unique_lock<std::mutex> lock(slotMutex);
+    slotAvailable.notify_one();
+}
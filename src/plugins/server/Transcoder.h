@@ -66,6 +66,25 @@ class Transcoder {
 
         static int GetActiveCount();
 
+        /* blocks until fewer than `transcoder_max_active_count` transcoders are
+        running or reserved, then reserves a slot. returns false on timeout.
+        the reservation is held until ReleaseSlot(); release it once the
+        transcoder has been created (and is counted by GetActiveCount()), or
+        the request has been abandoned. */
+        static bool WaitForSlot(Context& context);
+        static void ReleaseSlot();
+        static void NotifySlotAvailable();
+
+        /* scoped WaitForSlot()/ReleaseSlot() */
+        class SlotReservation {
+            public:
+                SlotReservation(): reserved(false) { }
+                ~SlotReservation() { if (this->reserved) { ReleaseSlot(); } }
+                bool Wait(Context& context) { return (this->reserved = WaitForSlot(context)); }
+            private:
+                bool reserved;
+        };
+
     private:
         static IDataStream* TranscodeOnDemand(
             Context& context,
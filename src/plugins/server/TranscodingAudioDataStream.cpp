@@ -33,6 +33,7 @@
 //////////////////////////////////////////////////////////////////////////////
 
 #include "TranscodingAudioDataStream.h"
+#include "Transcoder.h"
 #include "Util.h"
 #include <algorithm>
 #include <atomic>
@@ -40,12 +41,15 @@
 
 #define BUFFER_SIZE 8192
 #define SAMPLES_PER_BUFFER BUFFER_SIZE / 4 /* sizeof(float) */
+#define PIPELINE_BUFFER_COUNT 16
+#define OUTPUT_FILE_BUFFER_SIZE (256 * 1024)
 
 static std::atomic<int> activeCount(0);
 
 namespace fs = std::filesystem;
 
 using PositionType = TranscodingAudioDataStream::PositionType;
+using IBuffer = musik::core::sdk::IBuffer;
 
 TranscodingAudioDataStream::TranscodingAudioDataStream(
     Context& context,
@@ -59,7 +63,7 @@ TranscodingAudioDataStream::TranscodingAudioDataStream(
     this->encoder = encoder;
     this->input = nullptr;
     this->decoder = nullptr;
-    this->pcmBuffer = nullptr;
+    this->pendingBuffer = nullptr;
     this->length = 0;
     this->position = 0;
     this->bitrate = bitrate;
@@ -73,7 +77,8 @@ TranscodingAudioDataStream::TranscodingAudioDataStream(
     if (this->input) {
         this->decoder = context.environment->GetDecoder(this->input);
         if (this->decoder) {
-            this->pcmBuffer = context.environment->GetBuffer(SAMPLES_PER_BUFFER);
+            this->pipeline.reset(new DecodePipeline(
+                context, this->decoder, SAMPLES_PER_BUFFER, PIPELINE_BUFFER_COUNT));
 
             /* note that we purposely under-estimate the content length by 1.0
             seconds; we do this because http clients seem to be more likely to be
@@ -108,11 +113,16 @@ TranscodingAudioDataStream::TranscodingAudioDataStream(
 #else
         this->outFile = fopen(tempFilename.c_str(), "wb");
 #endif
+        if (this->outFile) {
+            this->outFileBuffer.reset(new char[OUTPUT_FILE_BUFFER_SIZE]);
+            setvbuf(this->outFile, this->outFileBuffer.get(), _IOFBF, OUTPUT_FILE_BUFFER_SIZE);
+        }
     }
 }
 
 TranscodingAudioDataStream::~TranscodingAudioDataStream() {
     --activeCount;
+    Transcoder::NotifySlotAvailable();
 }
 
 bool TranscodingAudioDataStream::Open(const char *uri, OpenFlags flags) {
@@ -149,10 +159,10 @@ bool TranscodingAudioDataStream::Close() {
 }
 
 void TranscodingAudioDataStream::Dispose() {
-    if (this->pcmBuffer) {
-        this->pcmBuffer->Release();
-        this->pcmBuffer = nullptr;
-    }
+    /* stops and joins the decode thread; must happen before the decoder
+    is released. */
+    this->pendingBuffer = nullptr;
+    this->pipeline.reset();
 
     if (this->decoder) {
         this->decoder->Release();
@@ -188,7 +198,7 @@ void TranscodingAudioDataStream::Release() {
 }
 
 PositionType TranscodingAudioDataStream::Read(void *buffer, PositionType bytesToRead) {
-    if (this->eof || !this->pcmBuffer) {
+    if (this->eof || !this->pipeline) {
         return 0;
     }
 
@@ -199,59 +209,77 @@ PositionType TranscodingAudioDataStream::Read(void *buffer, PositionType bytesTo
 
     size_t bytesWritten = 0;
     char* dst = (char*) buffer;
-    bool hasBuffer = false;
 
-    /* init */
+    /* init. the buffer used to determine the output format is held on to
+    and encoded below. */
     if (!this->encoderInitialized) {
-        hasBuffer = this->decoder->GetBuffer(this->pcmBuffer);
-        if (hasBuffer) {
-            this->encoderInitialized = this->encoder->Initialize(
-                this->pcmBuffer->SampleRate(),
-                this->pcmBuffer->Channels(),
-                this->bitrate);
+        this->pendingBuffer = this->pipeline->Next();
+        if (!this->pendingBuffer) {
+            goto internal_error;
         }
-    }
 
-    /* see if we have some stuff left over from last time through... */
-    if (!spillover.empty()) {
-        size_t count = std::min(spillover.avail(), (size_t) bytesToRead);
-        memcpy(dst, spillover.pos(), count);
+        this->encoderInitialized = this->encoder->Initialize(
+            this->pendingBuffer->SampleRate(),
+            this->pendingBuffer->Channels(),
+            this->bitrate);
 
-        if (this->outFile) {
-            fwrite(spillover.pos(), 1, count, this->outFile);
+        if (!this->encoderInitialized) {
+            goto internal_error;
         }
-
-        spillover.inc(count);
-        bytesWritten += count;
     }
 
-    if (bytesWritten == bytesToRead) {
-        this->position += (PositionType) bytesWritten;
-        return (PositionType) bytesWritten; /* filled from the spillover... */
-    }
+    while (bytesWritten < (size_t) bytesToRead) {
+        /* see if we have some stuff left over from last time through... */
+        if (!spillover.empty()) {
+            size_t count = std::min(spillover.avail(), (size_t) bytesToRead - bytesWritten);
+            memcpy(dst + bytesWritten, spillover.pos(), count);
 
-    if (!hasBuffer) {
-        hasBuffer = this->decoder->GetBuffer(this->pcmBuffer);
-    }
+            if (this->outFile) {
+                fwrite(spillover.pos(), 1, count, this->outFile);
+            }
 
-    if (!hasBuffer && !decoder->Exhausted()) {
-        goto internal_error;
-    }
+            spillover.inc(count);
+            bytesWritten += count;
+            continue;
+        }
+
+        if (this->flushed) {
+            break;
+        }
+
+        /* the decode thread keeps the pipeline full while we encode here; once
+        it runs dry the decoder is either exhausted (flush the encoder) or
+        failed. */
+        IBuffer* pcmBuffer = this->pendingBuffer
+            ? this->pendingBuffer : this->pipeline->Next();
+
+        this->pendingBuffer = nullptr;
 
-    /* done with spillover. read new data... */
-    while (hasBuffer && bytesWritten < (size_t) bytesToRead) {
         char* encodedData = nullptr;
-        int encodedLength = encoder->Encode(this->pcmBuffer, &encodedData);
+        int encodedLength = 0;
+
+        if (pcmBuffer) {
+            encodedLength = this->encoder->Encode(pcmBuffer, &encodedData);
+            this->pipeline->Recycle(pcmBuffer);
+        }
+        else if (this->pipeline->Exhausted()) {
+            encodedLength = this->encoder->Flush(&encodedData);
+            this->flushed = true;
+        }
+        else {
+            goto internal_error;
+        }
 
         if (encodedLength < 0) {
             goto internal_error;
         }
 
-        /* write to the output buffer */
+        /* write to the output buffer. anything that doesn't fit is swapped
+        into the spillover buffer and returned the next time through. */
         if (encodedLength > 0) {
-            int toWrite = std::min(
-                encodedLength,
-                (int)(bytesToRead - bytesWritten));
+            size_t toWrite = std::min(
+                (size_t) encodedLength,
+                (size_t) bytesToRead - bytesWritten);
 
             memcpy(dst + bytesWritten, encodedData, toWrite);
 
@@ -261,54 +289,31 @@ PositionType TranscodingAudioDataStream::Read(void *buffer, PositionType bytesTo
 
             bytesWritten += toWrite;
 
-            /* if we have decoded bytes still available, that means the
-            output buffer is exhausted. swap it into the spillover buffer
-            so it can be finalized the next time through. */
-            if (encodedLength > toWrite) {
+            if ((size_t) encodedLength > toWrite) {
                 spillover.from(encodedData + toWrite, encodedLength - toWrite);
-                this->position += (PositionType) bytesWritten;
-                return (PositionType) bytesWritten;
             }
         }
-
-        /* if we get here we still need to write some more data to
-        the output buffer. get our next buffer of pcm data and go
-        through the loop again. */
-        hasBuffer =
-            ((size_t) bytesToRead > bytesWritten) &&
-            this->decoder->GetBuffer(this->pcmBuffer);
     }
 
     /* finalize */
-    if (bytesWritten == 0) {
-        char* encodedData = nullptr;
-        int encodedLength = this->encoder->Flush(&encodedData);
-
+    if (this->flushed && spillover.empty()) {
         this->eof = true;
 
-        if (encodedLength >= 0) {
-            memcpy(dst + bytesWritten, encodedData, encodedLength);
-
-            if (this->outFile) {
-                fwrite(encodedData, 1, encodedLength, this->outFile);
-                fclose(this->outFile);
-                this->outFile = nullptr;
+        if (this->outFile) {
+            fclose(this->outFile);
+            this->outFile = nullptr;
 
-                this->encoder->Finalize(this->tempFilename.c_str());
+            this->encoder->Finalize(this->tempFilename.c_str());
 
-                std::error_code ec;
-                fs::rename(
-                    fs::u8path(this->tempFilename),
-                    fs::u8path(this->finalFilename),
-                    ec);
-                if (ec) {
-                    fs::remove(fs::u8path(this->tempFilename), ec);
-                }
+            std::error_code ec;
+            fs::rename(
+                fs::u8path(this->tempFilename),
+                fs::u8path(this->finalFilename),
+                ec);
+            if (ec) {
+                fs::remove(fs::u8path(this->tempFilename), ec);
             }
         }
-        else {
-            goto internal_error;
-        }
     }
 
     this->position += (PositionType) bytesWritten;
@@ -316,10 +321,12 @@ PositionType TranscodingAudioDataStream::Read(void *buffer, PositionType bytesTo
 
 internal_error:
     this->eof = true;
-    fclose(this->outFile);
-    this->outFile = nullptr;
-    std::error_code ec;
-    fs::remove(fs::u8path(this->tempFilename), ec);
+    if (this->outFile) {
+        fclose(this->outFile);
+        this->outFile = nullptr;
+        std::error_code ec;
+        fs::remove(fs::u8path(this->tempFilename), ec);
+    }
     return 0;
 }
 
@@ -36,9 +36,11 @@
 #include <musikcore/sdk/IStreamingEncoder.h>
 #include <musikcore/sdk/DataBuffer.h>
 #include "Context.h"
+#include "DecodePipeline.h"
 #include <thread>
 #include <condition_variable>
 #include <mutex>
+#include <memory>
 #include <string>
 #include <stdio.h>
 
@@ -81,6 +83,7 @@ class TranscodingAudioDataStream : public musik::core::sdk::IDataStream {
         virtual const char* Type() override;
         virtual const char* Uri() override;
         virtual bool CanPrefetch() override;
+        virtual PositionType ReadWindow(const void** window, PositionType maxBytes) override { return -1; }
 
         static int GetActiveCount();
 
@@ -90,7 +93,8 @@ class TranscodingAudioDataStream : public musik::core::sdk::IDataStream {
         Context& context;
         musik::core::sdk::IDataStream* input;
         musik::core::sdk::IDecoder* decoder;
-        musik::core::sdk::IBuffer* pcmBuffer;
+        std::unique_ptr<DecodePipeline> pipeline;
+        musik::core::sdk::IBuffer* pendingBuffer;
         musik::core::sdk::IStreamingEncoder* encoder;
         DataBuffer<char> spillover;
         size_t bitrate;
@@ -98,8 +102,9 @@ class TranscodingAudioDataStream : public musik::core::sdk::IDataStream {
         std::mutex mutex;
         PositionType length, position;
         FILE* outFile;
+        std::unique_ptr<char[]> outFileBuffer;
         std::string tempFilename, finalFilename;
         std::string format;
-        bool interrupted{ false }, encoderInitialized{ false };
+        bool interrupted{ false }, encoderInitialized{ false }, flushed{ false };
         long detachTolerance;
 };
\ No newline at end of file
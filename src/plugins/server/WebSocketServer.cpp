@@ -48,12 +48,29 @@ using namespace musik::core::sdk;
 static int nextId = 0;
 static const char* TAG = "WebSocketServer";
 
+/* responses larger than this are split into multiple binary frames for
+clients that accept chunked responses. */
+static const size_t kResponseChunkBytes = 128 * 1024;
+
+/* tiny frames (acks, pings, broadcasts) aren't worth running through zlib */
+static const size_t kMinCompressedFrameBytes = 256;
+
 /* UTILITY METHODS */
 
 static std::string nextMessageId() {
     return str::Format("musikcube-server-%d", ++nextId);
 }
 
+static std::string responsePrefix(json& request) {
+    /* the beginning of a response envelope, up to and including the "options"
+    key. used when streaming responses instead of building them as json. */
+    return
+        "{\"" + message::name + "\":" + request[message::name].dump() +
+        ",\"" + message::id + "\":" + request[message::id].dump() +
+        ",\"" + message::type + "\":\"" + type::response + "\"" +
+        ",\"" + message::options + "\":";
+}
+
 static std::shared_ptr<char*> jsonToStringArray(const json& jsonArray) {
     char** result = nullptr;
     size_t count = 0;
@@ -127,6 +144,7 @@ static json getEnvironment(Context& context) {
 
 WebSocketServer::WebSocketServer(Context& context)
 : context(context)
+, snapshots(context)
 , running(false) {
 
 }
@@ -173,6 +191,14 @@ void WebSocketServer::ThreadProc() {
         const bool ipv6 = context.prefs->GetBool(
             prefs::use_ipv6.c_str(), defaults::use_ipv6);
 
+        const int snapshotCacheSizeMb = context.prefs->GetInt(
+            prefs::snapshot_memory_cache_size_mb.c_str(), defaults::snapshot_memory_cache_size_mb);
+
+        this->snapshots.SetMaxBytes((size_t) std::max(0, snapshotCacheSizeMb) * 1024 * 1024);
+
+        this->compressionEnabled = context.prefs->GetBool(
+            prefs::websocket_compression.c_str(), defaults::websocket_compression);
+
         wss->init_asio();
         wss->set_reuse_addr(true);
         wss->set_message_handler(std::bind(&WebSocketServer::OnMessage, this, wss.get(), ::_1, ::_2));
@@ -294,6 +320,10 @@ void WebSocketServer::HandleRequest(connection_hdl connection, json& request) {
 
         const json& options = request[message::options];
 
+        if (name == request::batch) {
+            this->RespondWithBatch(connection, request);
+            return;
+        }
         if (name == request::ping) {
             this->RespondWithSuccess(connection, request);
             return;
@@ -501,6 +531,10 @@ void WebSocketServer::HandleRequest(connection_hdl connection, json& request) {
             this->RespondWithSuccess(connection, request);
             return;
         }
+        else if (name == request::get_snapshot_stats) {
+            this->RespondWithSnapshotStats(connection, request);
+            return;
+        }
     }
 
     this->RespondWithInvalidRequest(connection, name, id);
@@ -519,7 +553,7 @@ void WebSocketServer::Broadcast(const std::string& name, json& options) {
     try {
         if (wss) {
             for (const auto &keyValue : this->connections) {
-                wss->send(keyValue.first, str.c_str(), websocketpp::frame::opcode::text);
+                this->SendFrame(keyValue.first, str, websocketpp::frame::opcode::text);
             }
         }
     }
@@ -528,6 +562,81 @@ void WebSocketServer::Broadcast(const std::string& name, json& options) {
     }
 }
 
+void WebSocketServer::Send(connection_hdl connection, json& message) {
+    if (this->batchResponses) {
+        this->batchResponses->push_back(std::move(message));
+    }
+    else {
+        ResponseStream(*this, connection, message.value(message::id, ""))
+            .Write(message.dump())
+            .Finish();
+    }
+}
+
+void WebSocketServer::SendFrame(
+    connection_hdl connection,
+    const std::string& payload,
+    websocketpp::frame::opcode::value opcode)
+{
+    /* compression is only applied if the client negotiated permessage-deflate
+    during the handshake; otherwise the flag is ignored. */
+    auto con = wss->get_con_from_hdl(connection);
+    auto frame = con->get_message(opcode, payload.size());
+    frame->append_payload(payload);
+    frame->set_compressed(this->compressionEnabled && payload.size() >= kMinCompressedFrameBytes);
+    con->send(frame);
+}
+
+WebSocketServer::ResponseStream::ResponseStream(
+    WebSocketServer& server, connection_hdl connection, const std::string& id)
+: server(server)
+, connection(connection)
+, id(id) {
+    this->chunked = server.chunkedResponses && !server.batchResponses && id.size();
+}
+
+WebSocketServer::ResponseStream& WebSocketServer::ResponseStream::Write(const std::string& data) {
+    size_t offset = 0;
+    if (this->chunked) {
+        while (this->buffer.size() + (data.size() - offset) >= kResponseChunkBytes) {
+            const size_t count = kResponseChunkBytes - this->buffer.size();
+            this->buffer.append(data, offset, count);
+            offset += count;
+            this->Flush(false);
+        }
+    }
+    this->buffer.append(data, offset, std::string::npos);
+    return *this;
+}
+
+WebSocketServer::ResponseStream& WebSocketServer::ResponseStream::Write(const char* data) {
+    return this->Write(std::string(data));
+}
+
+void WebSocketServer::ResponseStream::Flush(bool final) {
+    /* each chunk is a binary frame: "<id>\n<0|1>\n<data>", where the second
+    line is 1 for the last chunk. binary frames are used because a chunk
+    boundary may split a multi-byte utf8 sequence. */
+    std::string frame = this->id + (final ? "\n1\n" : "\n0\n");
+    frame.append(this->buffer);
+    this->buffer.clear();
+    this->server.SendFrame(this->connection, frame, websocketpp::frame::opcode::binary);
+    this->started = true;
+}
+
+void WebSocketServer::ResponseStream::Finish() {
+    if (this->server.batchResponses) {
+        this->server.batchResponses->push_back(json::parse(this->buffer));
+    }
+    else if (this->started) {
+        this->Flush(true);
+    }
+    else {
+        this->server.SendFrame(this->connection, this->buffer, websocketpp::frame::opcode::text);
+    }
+    this->buffer.clear();
+}
+
 void WebSocketServer::RespondWithOptions(connection_hdl connection, json& request, json& options) {
     json response = {
         { message::name, request[message::name] },
@@ -536,7 +645,7 @@ void WebSocketServer::RespondWithOptions(connection_hdl connection, json& reques
         { message::options, options }
     };
 
-    wss->send(connection, response.dump().c_str(), websocketpp::frame::opcode::text);
+    this->Send(connection, response);
 }
 
 void WebSocketServer::RespondWithOptions(connection_hdl connection, json& request, json&& options) {
@@ -547,7 +656,7 @@ void WebSocketServer::RespondWithOptions(connection_hdl connection, json& reques
         { message::options, options }
     };
 
-    wss->send(connection, response.dump().c_str(), websocketpp::frame::opcode::text);
+    this->Send(connection, response);
 }
 
 void WebSocketServer::RespondWithInvalidRequest(connection_hdl connection, const std::string& name, const std::string& id)
@@ -559,7 +668,7 @@ void WebSocketServer::RespondWithInvalidRequest(connection_hdl connection, const
         { message::options,{{ key::error, value::invalid }} }
     };
 
-    wss->send(connection, error.dump().c_str(), websocketpp::frame::opcode::text);
+    this->Send(connection, error);
 }
 
 void WebSocketServer::RespondWithSuccess(connection_hdl connection, json& request) {
@@ -577,7 +686,7 @@ void WebSocketServer::RespondWithSuccess(connection_hdl connection, const std::s
         { message::options, {{ key::success, true }} }
     };
 
-    wss->send(connection, success.dump().c_str(), websocketpp::frame::opcode::text);
+    this->Send(connection, success);
 }
 
 void WebSocketServer::RespondWithFailure(connection_hdl connection, json& request) {
@@ -588,7 +697,7 @@ void WebSocketServer::RespondWithFailure(connection_hdl connection, json& reques
         { message::options, {{ key::success, false }} }
     };
 
-    wss->send(connection, error.dump().c_str(), websocketpp::frame::opcode::text);
+    this->Send(connection, error);
 }
 
 void WebSocketServer::RespondWithSendRawQuery(connection_hdl connection, json& request) {
@@ -600,10 +709,24 @@ void WebSocketServer::RespondWithSendRawQuery(connection_hdl connection, json& r
     int responseSize = 0;
     if (context.metadataProxy->SendRawQuery(data.c_str(), allocator, &responseData, &responseSize)) {
         if (responseSize) {
-            this->RespondWithOptions(connection, request, { { key::raw_query_data, responseData } });
+            /* raw query results can be many megabytes; write the envelope
+            directly instead of copying the result through a json tree. */
+            std::string escaped = json(responseData).dump();
+            allocator.Free((void*) responseData);
+            responseData = nullptr;
+
+            ResponseStream(*this, connection, request[message::id])
+                .Write(responsePrefix(request))
+                .Write("{\"" + key::raw_query_data + "\":")
+                .Write(escaped)
+                .Write("}}")
+                .Finish();
+
             responded = true;
         }
-        allocator.Free((void*) responseData);
+        if (responseData) {
+            allocator.Free((void*) responseData);
+        }
     }
     if (!responded) {
         this->RespondWithFailure(connection, request);
@@ -662,36 +785,72 @@ bool WebSocketServer::RespondWithTracks(
             return true;
         }
         else {
-            json data = json::array();
+            this->RespondWithTrackRange(
+                connection,
+                request,
+                [tracks](size_t i) { return tracks->GetTrack(i); },
+                0,
+                tracks->Count(),
+                limit,
+                offset);
 
-            ITrack* track = nullptr;
-            for (size_t i = 0; i < tracks->Count(); i++) {
-                track = tracks->GetTrack(i);
+            tracks->Release();
 
-                if (idsOnly) {
-                    data.push_back(GetMetadataString(track, key::external_id));
-                }
-                else {
-                    data.push_back(this->ReadTrackMetadata(track));
-                }
+            return true;
+        }
+    }
 
-                track->Release();
-            }
+    return false;
+}
 
-            tracks->Release();
+void WebSocketServer::RespondWithTrackRange(
+    connection_hdl connection,
+    json& request,
+    std::function<ITrack*(size_t)> getTrack,
+    size_t from,
+    size_t to,
+    int limit,
+    int offset)
+{
+    /* track responses are the largest we send, so they are streamed one
+    track at a time instead of being built as a single json document. */
+    bool idsOnly = request[message::options].value(key::ids_only, false);
+    const size_t count = to > from ? to - from : 0;
+
+    json header = {
+        { key::count, count },
+        { key::limit, std::max(0, limit) },
+        { key::offset, offset },
+    };
 
-            this->RespondWithOptions(connection, request, {
-                { key::data, data },
-                { key::count, data.size() },
-                { key::limit, std::max(0, limit) },
-                { key::offset, offset },
-            });
+    std::string prefix = header.dump();
+    prefix.pop_back(); /* trailing '}', we're appending the data array */
 
-            return true;
+    ResponseStream stream(*this, connection, request[message::id]);
+    stream.Write(responsePrefix(request))
+        .Write(prefix)
+        .Write(",\"" + key::data + "\":[");
+
+    for (size_t i = from; i < to; i++) {
+        ITrack* track = getTrack(i);
+
+        if (i != from) {
+            stream.Write(",");
+        }
+
+        if (idsOnly) {
+            stream.Write(json(GetMetadataString(track, key::external_id)).dump());
+        }
+        else {
+            stream.Write(this->ReadTrackMetadata(track).dump());
+        }
+
+        if (track) {
+            track->Release();
         }
     }
 
-    return false;
+    stream.Write("]}}").Finish();
 }
 
 void WebSocketServer::GetLimitAndOffset(json& options, int& limit, int& offset) {
@@ -790,6 +949,9 @@ void WebSocketServer::RespondWithPlayQueueTracks(connection_hdl connection, json
         if (type == value::snapshot) {
             auto snapshot = snapshots.Get(request[message::device_id]);
             count = snapshot ? snapshot->Count() : 0;
+            if (snapshot) {
+                snapshot->Release();
+            }
         }
 
         this->RespondWithOptions(connection, request, {
@@ -798,12 +960,6 @@ void WebSocketServer::RespondWithPlayQueueTracks(connection_hdl connection, json
         });
     }
     else {
-        bool idsOnly = request[message::options].value(key::ids_only, false);
-
-        /* now add the tracks to the output. they will be Release()'d automatically
-        as soon as this scope ends. */
-        json data = json::array();
-
         if (type == value::live) {
             /* edit the playlist so it can be changed while we're getting the tracks
             out of it. only applicable for the "live" type. */
@@ -814,51 +970,42 @@ void WebSocketServer::RespondWithPlayQueueTracks(connection_hdl connection, json
                 to = std::min(to, offset + limit);
             }
 
-            for (int i = offset; i < to; i++) {
-                ITrack* track = context.playback->GetTrack(i);
-                if (idsOnly) {
-                    data.push_back(GetMetadataString(track, key::external_id));
-                }
-                else {
-                    data.push_back(this->ReadTrackMetadata(track));
-                }
-                if (track) {
-                    track->Release();
-                }
-            }
+            this->RespondWithTrackRange(
+                connection,
+                request,
+                [this](size_t i) { return context.playback->GetTrack(i); },
+                (size_t) offset,
+                (size_t) std::max(0, to),
+                limit,
+                offset);
 
             editor->Release();
         }
         else if (type == value::snapshot) {
             auto snapshot = snapshots.Get(request[message::device_id]);
-            if (snapshot) {
-                int to = (int) snapshot->Count();
+            int to = snapshot ? (int) snapshot->Count() : 0;
 
-                if (offset >= 0 && limit >= 0) {
-                    to = std::min(to, offset + limit);
-                }
+            if (offset >= 0 && limit >= 0) {
+                to = std::min(to, offset + limit);
+            }
 
-                for (int i = offset; i < to; i++) {
-                    ITrack* track = snapshot->GetTrack(i);
-                    if (idsOnly) {
-                        data.push_back(GetMetadataString(track, key::external_id));
-                    }
-                    else {
-                        data.push_back(this->ReadTrackMetadata(track));
-                    }
-                    if (track) {
-                        track->Release();
-                    }
-                }
+            this->RespondWithTrackRange(
+                connection,
+                request,
+                [snapshot](size_t i) { return snapshot->GetTrack(i); },
+                (size_t) offset,
+                (size_t) std::max(0, to),
+                limit,
+                offset);
+
+            if (snapshot) {
+                snapshot->Release();
             }
         }
-
-        this->RespondWithOptions(connection, request, {
-            { key::data, data },
-            { key::count, data.size() },
-            { key::limit, std::max(0, limit) },
-            { key::offset, offset },
-        });
+        else {
+            this->RespondWithTrackRange(
+                connection, request, nullptr, 0, 0, limit, offset);
+        }
     }
 }
 
@@ -1127,6 +1274,7 @@ void WebSocketServer::RespondWithPlaySnapshotTracks(connection_hdl connection, j
         }
 
         context.playback->Play(snapshot, index);
+        snapshot->Release();
 
         if (time > 0.0) {
             context.playback->SetPosition(time);
@@ -1518,11 +1666,78 @@ void WebSocketServer::RespondWithSetTransportType(connection_hdl connection, jso
 
 void WebSocketServer::RespondWithSnapshotPlayQueue(connection_hdl connection, json& request) {
     auto deviceId = request[message::device_id];
-    this->snapshots.Remove(deviceId);
     this->snapshots.Put(deviceId, context.playback->Clone());
     this->RespondWithSuccess(connection, request);
 }
 
+void WebSocketServer::RespondWithBatch(connection_hdl connection, json& request) {
+    /* a batch carries an array of regular requests. they are run in order,
+    back-to-back, and their responses are returned as an array in a single
+    frame. batches may not be nested. */
+    auto& options = request[message::options];
+    auto requestsIt = options.find(key::requests);
+
+    if (this->batchResponses || requestsIt == options.end() || !requestsIt->is_array()) {
+        this->RespondWithInvalidRequest(connection, request[message::name], request[message::id]);
+        return;
+    }
+
+    const std::string deviceId = request[message::device_id];
+
+    json responses = json::array();
+    this->batchResponses = &responses;
+
+    for (auto& subrequest : *requestsIt) {
+        std::string name, id;
+
+        try {
+            if (subrequest.is_object()) {
+                name = subrequest.value(message::name, "");
+                id = subrequest.value(message::id, "");
+                subrequest[message::type] = type::request;
+                if (subrequest.value(message::device_id, "").empty()) {
+                    subrequest[message::device_id] = deviceId;
+                }
+            }
+
+            if (name.empty() || id.empty() || name == request::batch) {
+                this->RespondWithInvalidRequest(connection, name, id);
+            }
+            else {
+                this->HandleRequest(connection, subrequest);
+            }
+        }
+        catch (std::exception& e) {
+            this->context.debug->Error(TAG, str::Format("batch request %s failed: %s", name.c_str(), e.what()).c_str());
+            this->RespondWithInvalidRequest(connection, name, id);
+        }
+        catch (...) {
+            this->RespondWithInvalidRequest(connection, name, id);
+        }
+    }
+
+    this->batchResponses = nullptr;
+
+    this->RespondWithOptions(connection, request, {
+        { key::responses, std::move(responses) }
+    });
+}
+
+void WebSocketServer::RespondWithSnapshotStats(connection_hdl connection, json& request) {
+    auto stats = this->snapshots.GetStats();
+    this->RespondWithOptions(connection, request, {
+        { key::entries, stats.entries },
+        { key::unique_lists, stats.uniqueLists },
+        { key::bytes, stats.bytes },
+        { key::max_bytes, stats.maxBytes },
+        { key::hits, stats.hits },
+        { key::misses, stats.misses },
+        { key::deduplicated, stats.deduplicated },
+        { key::evicted, stats.evicted },
+        { key::expired, stats.expired }
+    });
+}
+
 void WebSocketServer::RespondWithRemoveTracksFromPlaylist(connection_hdl connection, json& request) {
     auto& options = request[message::options];
     auto end = options.end();
@@ -1643,6 +1858,7 @@ void WebSocketServer::OnMessage(server* s, connection_hdl hdl, message_ptr msg)
         json data = json::parse(msg->get_payload());
         std::string type = data[message::type];
         if (type == type::request) {
+            this->chunkedResponses = data.value(message::chunked, false);
             this->HandleRequest(hdl, data);
         }
     }
@@ -47,6 +47,7 @@
 
 #include <mutex>
 #include <condition_variable>
+#include <functional>
 
 class WebSocketServer {
     public:
@@ -123,6 +124,37 @@ class WebSocketServer {
         Snapshots snapshots;
         volatile bool running;
 
+        /* non-null while a batch request is being processed; responses are
+        collected here and sent back to the client in a single frame. */
+        json* batchResponses{ nullptr };
+
+        /* per-message compression is enabled via prefs; chunked responses are
+        enabled per request by clients that know how to reassemble them. */
+        bool compressionEnabled{ true };
+        bool chunkedResponses{ false };
+
+        /* serializes a response incrementally. if the client accepts chunked
+        responses, large payloads are sent as a series of bounded binary frames
+        as they are produced. note that frames are handed to websocketpp as
+        soon as they're full, and responses are generated on the io thread,
+        so this bounds frame size, not the memory a response occupies while
+        it's being sent. */
+        class ResponseStream {
+            public:
+                ResponseStream(WebSocketServer& server, connection_hdl connection, const std::string& id);
+                ResponseStream& Write(const std::string& data);
+                ResponseStream& Write(const char* data);
+                void Finish();
+
+            private:
+                void Flush(bool final);
+
+                WebSocketServer& server;
+                connection_hdl connection;
+                std::string id, buffer;
+                bool chunked, started{ false };
+        };
+
         /* gross extra state */
         std::string lastPlaybackOverview;
 
@@ -131,6 +163,8 @@ class WebSocketServer {
         void HandleRequest(connection_hdl connection, json& request);
 
         void Broadcast(const std::string& name, json& options);
+        void Send(connection_hdl connection, json& message);
+        void SendFrame(connection_hdl connection, const std::string& payload, websocketpp::frame::opcode::value opcode);
         void RespondWithOptions(connection_hdl connection, json& request, json& options);
         void RespondWithOptions(connection_hdl connection, json& request, json&& options = json({}));
         void RespondWithInvalidRequest(connection_hdl connection, const std::string& name, const std::string& id);
@@ -142,6 +176,14 @@ class WebSocketServer {
         void RespondWithSetVolume(connection_hdl connection, json& request);
         void RespondWithPlaybackOverview(connection_hdl connection, json& request);
         bool RespondWithTracks(connection_hdl connection, json& request, ITrackList* tracks, int limit, int offset);
+        void RespondWithTrackRange(
+            connection_hdl connection,
+            json& request,
+            std::function<ITrack*(size_t)> getTrack,
+            size_t from,
+            size_t to,
+            int limit,
+            int offset);
         void RespondWithQueryTracks(connection_hdl connection, json& request);
         void RespondWithQueryTracksByExternalIds(connection_hdl connection, json& request);
         void RespondWithPlayQueueTracks(connection_hdl connection, json& request);
@@ -171,6 +213,8 @@ class WebSocketServer {
         void RespondWithSetTransportType(connection_hdl connection, json& request);
         void RespondWithSnapshotPlayQueue(connection_hdl connection, json& request);
         void RespondWithInvalidatePlayQueueSnapshot(connection_hdl connection, json& request);
+        void RespondWithSnapshotStats(connection_hdl connection, json& request);
+        void RespondWithBatch(connection_hdl connection, json& request);
 
         void BroadcastPlaybackOverview();
         void BroadcastPlayQueueChanged();
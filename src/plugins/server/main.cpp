@@ -187,6 +187,9 @@ extern "C" DLL_EXPORT void SetPreferences(musik::core::sdk::IPreferences* prefs)
         prefs->GetInt(prefs::transcoder_cache_count.c_str(), defaults::transcoder_cache_count);
         prefs->GetBool(prefs::transcoder_synchronous.c_str(), defaults::transcoder_synchronous);
         prefs->GetBool(prefs::transcoder_synchronous_fallback.c_str(), defaults::transcoder_synchronous_fallback);
+        prefs->GetInt(prefs::thumbnail_memory_cache_size_mb.c_str(), defaults::thumbnail_memory_cache_size_mb);
+        prefs->GetInt(prefs::snapshot_memory_cache_size_mb.c_str(), defaults::snapshot_memory_cache_size_mb);
+        prefs->GetBool(prefs::websocket_compression.c_str(), defaults::websocket_compression);
         prefs->Save();
     }
 
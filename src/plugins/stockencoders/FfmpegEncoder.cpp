@@ -43,6 +43,17 @@ using namespace musik::core::sdk;
 
 static const int IO_CONTEXT_BUFFER_SIZE = 4096;
 static const int DEFAULT_SAMPLE_RATE = 44100;
+static const int DEFAULT_FRAME_SIZE = 1024;
+
+/* big enough for a few decoder buffers worth of samples, so the fifos don't
+need to grow while encoding. */
+static const int FIFO_INITIAL_SAMPLES_PER_CHANNEL = 16384;
+
+/* streaming mode: cut ogg pages every 100ms instead of every second, and use
+20ms opus frames with constrained vbr so the output size stays close to the
+requested bitrate (clients are told the content length up front). */
+static const char* STREAMING_OGG_PAGE_DURATION_USEC = "100000";
+static const char* STREAMING_OPUS_FRAME_DURATION_MS = "20";
 static const char* TAG = "FfmpegEncoder";
 
 static std::map<std::string, AVCodecID> formatToCodec = {
@@ -147,6 +158,9 @@ static int writeCallback(void* opaque, uint8_t* buffer, int bufferSize) {
         auto count = encoder->Stream()->Write(buffer, (PositionType) bufferSize);
         return (count == bufferSize) ? count : AVERROR_EOF;
     }
+    else if (encoder && encoder->Output()) {
+        return encoder->Output()->append(reinterpret_cast<char*>(buffer), (size_t) bufferSize);
+    }
     return 0;
 }
 
@@ -190,15 +204,19 @@ static int64_t seekCallback(void* opaque, int64_t offset, int whence) {
 FfmpegEncoder::FfmpegEncoder(const std::string& format)
 : format(format) {
     this->isValid = false;
+    this->streaming = false;
+    this->out = nullptr;
     this->resampler = nullptr;
     this->outputContext = nullptr;
     this->outputCodec = nullptr;
     this->outputFrame = nullptr;
     this->resampledFrame = nullptr;
+    this->encodeFrame = nullptr;
     this->ioContext = nullptr;
     this->ioContextOutputBuffer = nullptr;
     this->outputFormatContext = nullptr;
     this->outputFifo = nullptr;
+    this->resampledFifo = nullptr;
     this->globalTimestamp = 0LL;
     this->inputChannelCount = 0;
     this->inputSampleRate = 0;
@@ -244,6 +262,10 @@ bool FfmpegEncoder::OpenOutputCodec(size_t rate, size_t channels, size_t bitrate
 
     this->outputFormatContext->pb = this->ioContext;
 
+    if (this->streaming) {
+        this->outputFormatContext->flags |= AVFMT_FLAG_FLUSH_PACKETS;
+    }
+
     auto it = formatToCodec.find(this->format);
     if (it == formatToCodec.end()) {
         logError("no codec for specified input format: " + this->format);
@@ -278,6 +300,8 @@ bool FfmpegEncoder::OpenOutputCodec(size_t rate, size_t channels, size_t bitrate
     this->outputContext->sample_fmt = resolveSampleFormat(this->outputCodec);
     this->outputContext->bit_rate = (int64_t) bitrate * 1000;
     this->outputContext->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+    this->outputContext->time_base.num = 1;
+    this->outputContext->time_base.den = this->outputContext->sample_rate;
 
     if (this->outputContext->sample_fmt == AV_SAMPLE_FMT_NONE) {
         logError("invalid sample format resolved.");
@@ -285,8 +309,9 @@ bool FfmpegEncoder::OpenOutputCodec(size_t rate, size_t channels, size_t bitrate
     }
 
     /* don't quite understand this bit; apparently it sets the sample rate
-    for the container(?) */
-    stream->time_base.den = (int) rate;
+    for the container(?). note this needs to be the encoder's rate, which
+    may differ from the input rate. */
+    stream->time_base.den = this->outputContext->sample_rate;
     stream->time_base.num = 1;
 
     /* also not clear about this, but it's taken from an ffmpeg example. TODO:
@@ -295,8 +320,16 @@ bool FfmpegEncoder::OpenOutputCodec(size_t rate, size_t channels, size_t bitrate
         this->outputContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
     }
 
+    AVDictionary* codecOptions = nullptr;
+    if (this->streaming && it->second == AV_CODEC_ID_OPUS) {
+        av_dict_set(&codecOptions, "frame_duration", STREAMING_OPUS_FRAME_DURATION_MS, 0);
+        av_dict_set(&codecOptions, "vbr", "constrained", 0);
+    }
+
     int error = avcodec_open2(
-        this->outputContext, this->outputCodec, nullptr);
+        this->outputContext, this->outputCodec, &codecOptions);
+
+    av_dict_free(&codecOptions);
 
     if (error < 0) {
         logAvError("avcodec_open2", error);
@@ -332,10 +365,16 @@ bool FfmpegEncoder::OpenOutputCodec(size_t rate, size_t channels, size_t bitrate
         return false;
     }
 
-    /* fifo buffer that will be used by the encoder */
-    this->outputFifo = av_audio_fifo_alloc(AV_SAMPLE_FMT_FLT, (int) channels, 1);
+    /* fifo buffers that will be used by the encoder: input samples are queued
+    in the first, and resampled output is queued in the second until there is
+    enough to fill a whole encoder frame. */
+    this->outputFifo = av_audio_fifo_alloc(
+        AV_SAMPLE_FMT_FLT, (int) channels, FIFO_INITIAL_SAMPLES_PER_CHANNEL);
+
+    this->resampledFifo = av_audio_fifo_alloc(
+        this->outputContext->sample_fmt, (int) channels, FIFO_INITIAL_SAMPLES_PER_CHANNEL);
 
-    if (!this->outputFifo) {
+    if (!this->outputFifo || !this->resampledFifo) {
         logError("av_audio_fifo_alloc");
         return false;
     }
@@ -353,14 +392,25 @@ bool FfmpegEncoder::OpenOutputContext() {
         this,
         readCallback,
         writeCallback,
-        seekCallback);
+        this->streaming ? nullptr : seekCallback);
 
     return this->ioContext != nullptr;
 }
 
 bool FfmpegEncoder::Initialize(IDataStream* out, size_t rate, size_t channels, size_t bitrate) {
     this->out = out;
+    this->streaming = false;
+    return this->InitializeInternal(rate, channels, bitrate);
+}
+
+bool FfmpegEncoder::InitializeStreaming(size_t rate, size_t channels, size_t bitrate) {
+    this->out = nullptr;
+    this->streaming = true;
+    this->output.reset();
+    return this->InitializeInternal(rate, channels, bitrate);
+}
 
+bool FfmpegEncoder::InitializeInternal(size_t rate, size_t channels, size_t bitrate) {
     if (this->OpenOutputContext()) {
         if (this->OpenOutputCodec(rate, channels, bitrate)) {
             if (this->WriteOutputHeader()) {
@@ -388,6 +438,10 @@ void FfmpegEncoder::Cleanup() {
         av_frame_free(&this->resampledFrame);
         this->resampledFrame = nullptr;
     }
+    if (this->encodeFrame) {
+        av_frame_free(&this->encodeFrame);
+        this->encodeFrame = nullptr;
+    }
     if (this->ioContext) {
         av_free(this->ioContext);
         this->ioContext = nullptr;
@@ -415,6 +469,10 @@ void FfmpegEncoder::Cleanup() {
         av_audio_fifo_free(this->outputFifo);
         this->outputFifo = nullptr;
     }
+    if (this->resampledFifo) {
+        av_audio_fifo_free(this->resampledFifo);
+        this->resampledFifo = nullptr;
+    }
 }
 
 void FfmpegEncoder::Release() {
@@ -429,6 +487,9 @@ bool FfmpegEncoder::Encode(const IBuffer* pcm) {
 
     if (this->WriteSamplesToFifo(pcm)) {
         if (this->ReadFromFifoAndWriteToOutput(false)) {
+            if (this->streaming) {
+                avio_flush(this->ioContext);
+            }
             return true;
         }
     }
@@ -453,7 +514,16 @@ bool FfmpegEncoder::WriteOutputTrailer() {
 }
 
 bool FfmpegEncoder::WriteOutputHeader() {
-    int error = avformat_write_header(this->outputFormatContext, nullptr);
+    AVDictionary* muxerOptions = nullptr;
+    if (this->streaming) {
+        /* only understood by the ogg muxer; ignored by the others. */
+        av_dict_set(&muxerOptions, "page_duration", STREAMING_OGG_PAGE_DURATION_USEC, 0);
+    }
+
+    int error = avformat_write_header(this->outputFormatContext, &muxerOptions);
+
+    av_dict_free(&muxerOptions);
+
     if (error < 0) {
         logAvError("avformat_write_header", error);
         return false;
@@ -466,15 +536,20 @@ bool FfmpegEncoder::WriteSamplesToFifo(const IBuffer* pcm) {
     const int samplesPerChannel = totalSamples / pcm->Channels();
     const uint8_t* inData = (const uint8_t*) pcm->BufferPointer();
 
-    int currentFifoSize = av_audio_fifo_size(this->outputFifo);
-    int error = av_audio_fifo_realloc(this->outputFifo, currentFifoSize + samplesPerChannel);
+    /* the fifo is drained after every write, so this should only ever happen
+    if the decoder hands us an unusually large buffer. */
+    if (av_audio_fifo_space(this->outputFifo) < samplesPerChannel) {
+        int error = av_audio_fifo_realloc(
+            this->outputFifo,
+            (av_audio_fifo_size(this->outputFifo) + samplesPerChannel) * 2);
 
-    if (error < 0) {
-        logAvError("av_audio_fifo_realloc", error);
-        return false;
+        if (error < 0) {
+            logAvError("av_audio_fifo_realloc", error);
+            return false;
+        }
     }
 
-    int samplesWritten = error = av_audio_fifo_write(
+    int samplesWritten = av_audio_fifo_write(
         this->outputFifo,
         (void**) &inData,
         samplesPerChannel);
@@ -488,14 +563,15 @@ bool FfmpegEncoder::WriteSamplesToFifo(const IBuffer* pcm) {
 }
 
 bool FfmpegEncoder::ReadFromFifoAndWriteToOutput(bool drain) {
-    int outputFrameSize = this->outputContext->frame_size;
-    int error = 0;
+    const int frameSize = this->outputContext->frame_size > 0
+        ? this->outputContext->frame_size : DEFAULT_FRAME_SIZE;
+
+    /* resample the input one encoder frame's worth at a time... */
     while (
-        av_audio_fifo_size(this->outputFifo) >= outputFrameSize ||
+        av_audio_fifo_size(this->outputFifo) >= frameSize ||
         (drain && av_audio_fifo_size(this->outputFifo) > 0)
     ) {
-        const int fifoSize = av_audio_fifo_size(this->outputFifo);
-        const int frameSize = FFMIN(fifoSize, outputFrameSize);
+        const int count = FFMIN(av_audio_fifo_size(this->outputFifo), frameSize);
 
         this->outputFrame = this->ReallocFrame(
             this->outputFrame,
@@ -503,42 +579,126 @@ bool FfmpegEncoder::ReadFromFifoAndWriteToOutput(bool drain) {
             frameSize,
             this->inputSampleRate);
 
-        int framesRead = av_audio_fifo_read(
-            this->outputFifo, (void **) outputFrame->data, frameSize);
+        if (!this->outputFrame) {
+            return false;
+        }
+
+        int samplesRead = av_audio_fifo_read(
+            this->outputFifo, (void **) this->outputFrame->extended_data, count);
 
-        if (framesRead < frameSize) {
+        if (samplesRead < count) {
             logError("av_audio_fifo_read read the incorrect number of samples");
             return false;
         }
 
-        this->resampledFrame = this->ReallocFrame(
-            this->resampledFrame,
+        if (!this->ResampleToFifo(this->outputFrame, count)) {
+            return false;
+        }
+    }
+
+    if (drain) {
+        this->FlushResampler();
+    }
+
+    /* ... then encode it. the resampler may produce a different number of
+    samples than it was given (e.g. 44.1k -> 48k for opus), so the encoder
+    frames are cut from the resampled fifo, not the input. */
+    if (!this->EncodeFromResampledFifo(drain)) {
+        return false;
+    }
+
+    if (drain) {
+        this->SendReceiveAndWriteFrame(nullptr);
+    }
+
+    return true;
+}
+
+bool FfmpegEncoder::ResampleToFifo(const AVFrame* input, int samplesPerChannel) {
+    const int capacity = swr_get_out_samples(this->resampler, samplesPerChannel);
+
+    if (capacity <= 0) {
+        return true;
+    }
+
+    this->resampledFrame = this->ReallocFrame(
+        this->resampledFrame,
+        this->outputContext->sample_fmt,
+        capacity,
+        this->outputContext->sample_rate);
+
+    if (!this->resampledFrame) {
+        return false;
+    }
+
+    int converted = swr_convert(
+        this->resampler,
+        this->resampledFrame->extended_data,
+        capacity,
+        input ? (const uint8_t**) input->extended_data : nullptr,
+        input ? samplesPerChannel : 0);
+
+    if (converted < 0) {
+        logAvError("swr_convert", converted);
+        return false;
+    }
+
+    if (converted > 0) {
+        int samplesWritten = av_audio_fifo_write(
+            this->resampledFifo,
+            (void**) this->resampledFrame->extended_data,
+            converted);
+
+        if (samplesWritten != converted) {
+            logError("av_audio_fifo_write wrote incorrect number of samples");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool FfmpegEncoder::EncodeFromResampledFifo(bool drain) {
+    const int frameSize = this->outputContext->frame_size > 0
+        ? this->outputContext->frame_size : DEFAULT_FRAME_SIZE;
+
+    while (
+        av_audio_fifo_size(this->resampledFifo) >= frameSize ||
+        (drain && av_audio_fifo_size(this->resampledFifo) > 0)
+    ) {
+        const int count = FFMIN(av_audio_fifo_size(this->resampledFifo), frameSize);
+
+        this->encodeFrame = this->ReallocFrame(
+            this->encodeFrame,
             this->outputContext->sample_fmt,
             frameSize,
             this->outputContext->sample_rate);
 
-        error = swr_convert_frame(
-            this->resampler,
-            this->resampledFrame,
-            this->outputFrame);
+        if (!this->encodeFrame) {
+            return false;
+        }
 
+        /* the encoder may still hold a reference to the last frame we sent */
+        int error = av_frame_make_writable(this->encodeFrame);
         if (error < 0) {
-            logAvError("swr_convert_frame", error);
+            logAvError("av_frame_make_writable", error);
             return false;
         }
 
-        error = this->SendReceiveAndWriteFrame(this->resampledFrame);
-        if (error == AVERROR(EAGAIN)) {
-            continue;
-        }
-        else if (error < 0) {
+        int samplesRead = av_audio_fifo_read(
+            this->resampledFifo, (void **) this->encodeFrame->extended_data, count);
+
+        if (samplesRead < count) {
+            logError("av_audio_fifo_read read the incorrect number of samples");
             return false;
         }
-    }
 
-    if (drain) {
-        this->FlushResampler();
-        this->SendReceiveAndWriteFrame(nullptr);
+        this->encodeFrame->nb_samples = count;
+
+        error = this->SendReceiveAndWriteFrame(this->encodeFrame);
+        if (error < 0 && error != AVERROR(EAGAIN) && error != AVERROR_EOF) {
+            return false;
+        }
     }
 
     return true;
@@ -565,6 +725,10 @@ int FfmpegEncoder::SendReceiveAndWriteFrame(AVFrame* frame) {
             outputPacket.pos = -1;
             error = avcodec_receive_packet(this->outputContext, &outputPacket);
             if (error >= 0) {
+                av_packet_rescale_ts(
+                    &outputPacket,
+                    this->outputContext->time_base,
+                    this->outputFormatContext->streams[0]->time_base);
                 error = av_write_frame(this->outputFormatContext, &outputPacket);
                 if (error < 0) {
                     logAvError("av_write_frame", error);
@@ -581,31 +745,9 @@ int FfmpegEncoder::SendReceiveAndWriteFrame(AVFrame* frame) {
 }
 
 void FfmpegEncoder::FlushResampler() {
-    int64_t bufferedFrames = swr_get_delay(
-        this->resampler, this->outputContext->sample_rate);
-
-    while (bufferedFrames > 0) {
-        this->resampledFrame = this->ReallocFrame(
-            this->resampledFrame,
-            this->outputContext->sample_fmt,
-            FFMIN((int) bufferedFrames, this->outputContext->frame_size),
-            this->outputContext->sample_rate);
-
-        int converted = swr_convert(
-            this->resampler,
-            this->resampledFrame->extended_data,
-            this->resampledFrame->nb_samples,
-            nullptr,
-            0);
-
-        if (converted > 0) {
-            this->SendReceiveAndWriteFrame(this->resampledFrame);
-            bufferedFrames -= converted;
-        }
-        else {
-            break;
-        }
-    }
+    /* whatever the resampler is still holding on to ends up in the
+    resampled fifo, and is encoded along with everything else. */
+    this->ResampleToFifo(nullptr, 0);
 }
 
 AVFrame* FfmpegEncoder::ReallocFrame(
@@ -614,7 +756,9 @@ AVFrame* FfmpegEncoder::ReallocFrame(
     int samplesPerChannel,
     int sampleRate)
 {
-    if (!original || original->nb_samples != samplesPerChannel) {
+    /* frames only ever grow; callers that need an exact sample count set
+    nb_samples themselves after filling the frame. */
+    if (!original || original->nb_samples < samplesPerChannel) {
         if (original) {
             av_frame_free(&original);
         }
@@ -67,24 +67,37 @@ class FfmpegEncoder : public musik::core::sdk::IBlockingEncoder {
         virtual bool Encode(const IBuffer* pcm) override;
         virtual void Finalize() override;
 
+        /* streaming mode: instead of writing to an IDataStream, muxed output
+        accumulates in memory (see Output()) and is flushed after every call to
+        Encode(). the output context is not seekable, and the encoder and muxer
+        are tuned for low startup latency. */
+        bool InitializeStreaming(size_t rate, size_t channels, size_t bitrate);
+
         IDataStream* Stream() { return this->out; }
+        DataBuffer<char>* Output() { return this->streaming ? &this->output : nullptr; }
 
     private:
         void Cleanup();
         bool OpenOutputCodec(size_t rate, size_t channels, size_t bitrate);
+        bool InitializeInternal(size_t rate, size_t channels, size_t bitrate);
         bool OpenOutputContext();
         bool WriteOutputHeader();
         bool WriteOutputTrailer();
         bool WriteSamplesToFifo(const IBuffer* pcm);
         bool ReadFromFifoAndWriteToOutput(bool drain);
+        bool ResampleToFifo(const AVFrame* input, int samplesPerChannel);
+        bool EncodeFromResampledFifo(bool drain);
         void FlushResampler();
         AVFrame* ReallocFrame(AVFrame* original, AVSampleFormat format, int samplesPerChannel, int sampleRate);
         int SendReceiveAndWriteFrame(AVFrame* frame);
 
         bool isValid;
+        bool streaming;
         IDataStream* out;
+        DataBuffer<char> output;
         int readBufferSize;
         AVAudioFifo* outputFifo;
+        AVAudioFifo* resampledFifo;
         AVCodecCompat* outputCodec;
         AVCodecContext* outputContext;
         AVFormatContext* outputFormatContext;
@@ -92,6 +105,7 @@ class FfmpegEncoder : public musik::core::sdk::IBlockingEncoder {
         void* ioContextOutputBuffer;
         AVFrame* outputFrame;
         AVFrame* resampledFrame;
+        AVFrame* encodeFrame;
         SwrContext* resampler;
         int64_t globalTimestamp;
         std::string format;
@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2021 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "FfmpegStreamingEncoder.h"
+
+using namespace musik::core::sdk;
+
+FfmpegStreamingEncoder::FfmpegStreamingEncoder(const std::string& format) {
+    this->encoder = new FfmpegEncoder(format);
+}
+
+void FfmpegStreamingEncoder::Release() {
+    this->encoder->Release();
+    this->encoder = nullptr;
+    delete this;
+}
+
+bool FfmpegStreamingEncoder::Initialize(size_t rate, size_t channels, size_t bitrate) {
+    return this->encoder->InitializeStreaming(rate, channels, bitrate);
+}
+
+int FfmpegStreamingEncoder::Encode(const IBuffer* pcm, char** data) {
+    if (pcm->Samples() == 0) {
+        return 0;
+    }
+    if (!this->encoder->Encode(pcm)) {
+        return -1;
+    }
+    /* note: the first call also returns the container header, which was
+    written during Initialize() */
+    return this->TakeOutput(data);
+}
+
+int FfmpegStreamingEncoder::Flush(char** data) {
+    this->encoder->Finalize();
+    return this->TakeOutput(data);
+}
+
+void FfmpegStreamingEncoder::Finalize(const char* uri) {
+    /* nothing to patch up after the fact; the trailer was already written
+    by Flush(). */
+}
+
+int FfmpegStreamingEncoder::TakeOutput(char** data) {
+    /* the bytes stay valid until the next call into the encoder, which is
+    what IStreamingEncoder promises callers. */
+    DataBuffer<char>* output = this->encoder->Output();
+    const int length = (int) output->avail();
+    *data = output->pos();
+    output->reset();
+    return length;
+}
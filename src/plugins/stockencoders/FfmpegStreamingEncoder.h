@@ -0,0 +1,60 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2021 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <musikcore/sdk/IStreamingEncoder.h>
+#include "FfmpegEncoder.h"
+#include <string>
+
+/* adapts FfmpegEncoder to IStreamingEncoder for containers that can be
+written front-to-back (ogg, adts), so the server can stream opus, vorbis and
+aac on demand instead of transcoding the whole file up front. */
+class FfmpegStreamingEncoder : public musik::core::sdk::IStreamingEncoder {
+    using IBuffer = musik::core::sdk::IBuffer;
+
+    public:
+        FfmpegStreamingEncoder(const std::string& format);
+
+        virtual void Release() override;
+        virtual bool Initialize(size_t rate, size_t channels, size_t bitrate) override;
+        virtual int Encode(const IBuffer* pcm, char** data) override;
+        virtual int Flush(char** data) override;
+        virtual void Finalize(const char* uri) override;
+
+    private:
+        int TakeOutput(char** data);
+
+        FfmpegEncoder* encoder;
+};
@@ -41,6 +41,7 @@
 #include "shared.h"
 #include "LameEncoder.h"
 #include "FfmpegEncoder.h"
+#include "FfmpegStreamingEncoder.h"
 
 #include <string>
 #include <algorithm>
@@ -78,6 +79,16 @@ static std::set<std::string> supportedFormats = {
     ".wv"
 };
 
+/* formats whose containers can be written without seeking, and can therefore
+be encoded on-the-fly via IStreamingEncoder. */
+static std::set<std::string> streamableFormats = {
+    ".ogg",
+    "audio/ogg",
+    ".opus",
+    ".aac",
+    "audio/aac"
+};
+
 static class Plugin : public IPlugin {
     public:
         Plugin() {
@@ -85,7 +96,7 @@ static class Plugin : public IPlugin {
 
         virtual void Release() { }
         virtual const char* Name() { return "Stock Encoders (lame + ffmpeg)"; }
-        virtual const char* Version() { return "0.7.0"; }
+        virtual const char* Version() { return "0.8.0"; }
         virtual const char* Author() { return "clangen"; }
         virtual const char* Guid() { return "d4d13803-a285-4481-ad1e-106131e0d523"; }
         virtual bool Configurable() { return false; }
@@ -110,6 +121,9 @@ static class EncoderFactory: public IEncoderFactory {
             if (isMp3(lowerType)) {
                 return new LameEncoder();
             }
+            else if (streamableFormats.find(lowerType) != streamableFormats.end()) {
+                return new FfmpegStreamingEncoder(lowerType);
+            }
             else if (supportedFormats.find(lowerType) != supportedFormats.end()) {
                 return new FfmpegEncoder(lowerType);
             }
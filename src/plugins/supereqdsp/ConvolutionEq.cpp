@@ -0,0 +1,702 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2021 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#include "ConvolutionEq.h"
+#include <musikcore/sdk/String.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define CONVOLUTION_EQ_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define CONVOLUTION_EQ_NEON
+#endif
+
+/* ooura's real fft, see supereq/Fftsg_fl.c. note the forward transform stores
+the conjugate spectrum; that's fine as long as every spectrum we multiply
+comes from the same transform. */
+extern "C" void rdft(int, int, float*, int*, float*);
+
+#define PI 3.14159265358979323846
+
+/* partition size, in frames. this is also the engine's base latency. */
+static const size_t BLOCK_SIZE = 256;
+static const size_t FFT_SIZE = BLOCK_SIZE * 2;
+
+/* BLOCK_SIZE + 1 bins, rounded up so the simd loops don't need a tail */
+static const size_t BIN_COUNT = BLOCK_SIZE + 4;
+
+static const double MAX_IMPULSE_RESPONSE_SECONDS = 10.0;
+
+/* filter spectra for each partition of each channel's impulse response. real
+and imaginary parts are stored in separate planes so the complex multiply-
+accumulate maps directly onto simd lanes. */
+struct ConvolutionEq::Kernel {
+    long sampleRate{ 0 };
+    int channels{ 0 };
+    size_t partitions{ 0 };
+    std::vector<std::vector<float>> real; /* [channel][partition * BIN_COUNT + bin] */
+    std::vector<std::vector<float>> imag;
+
+    /* zeroed storage for a delay line of `partitions` slots, [channel][slot *
+    BIN_COUNT + bin]. only allocated if the filter is longer than the delay
+    line the audio thread starts with; the audio thread swaps it in, and its
+    old delay line is freed along with the kernel, on the builder thread. */
+    std::vector<std::vector<float>> delayReal;
+    std::vector<std::vector<float>> delayImag;
+};
+
+struct ConvolutionEq::Channel {
+    std::vector<float> input; /* previous block followed by the current block */
+    std::vector<float> output; /* output for the block currently being filled */
+    std::vector<float> real; /* frequency-domain delay line, [slot * BIN_COUNT + bin] */
+    std::vector<float> imag;
+};
+
+static void initFft(size_t size, std::vector<int>& bits, std::vector<float>& table) {
+    bits.assign(2 + (size_t) ceil(sqrt(size / 2.0)), 0);
+    table.assign(size / 2, 0.0f);
+}
+
+/* ooura packs the nyquist bin's real part into a[1] */
+static inline void toSplit(const float* packed, size_t size, float* real, float* imag) {
+    const size_t half = size / 2;
+    real[0] = packed[0];
+    imag[0] = 0.0f;
+    for (size_t k = 1; k < half; k++) {
+        real[k] = packed[2 * k];
+        imag[k] = packed[2 * k + 1];
+    }
+    real[half] = packed[1];
+    imag[half] = 0.0f;
+}
+
+static inline void toPacked(const float* real, const float* imag, size_t size, float* packed) {
+    const size_t half = size / 2;
+    packed[0] = real[0];
+    packed[1] = real[half];
+    for (size_t k = 1; k < half; k++) {
+        packed[2 * k] = real[k];
+        packed[2 * k + 1] = imag[k];
+    }
+}
+
+/* y += x * h, over `count` complex values. `count` must be a multiple of 4. */
+static inline void multiplyAccumulate(
+    const float* xr, const float* xi,
+    const float* hr, const float* hi,
+    float* yr, float* yi,
+    size_t count)
+{
+#if defined(CONVOLUTION_EQ_SSE)
+    for (size_t i = 0; i < count; i += 4) {
+        const __m128 a = _mm_loadu_ps(xr + i);
+        const __m128 b = _mm_loadu_ps(xi + i);
+        const __m128 c = _mm_loadu_ps(hr + i);
+        const __m128 d = _mm_loadu_ps(hi + i);
+        const __m128 re = _mm_sub_ps(_mm_mul_ps(a, c), _mm_mul_ps(b, d));
+        const __m128 im = _mm_add_ps(_mm_mul_ps(a, d), _mm_mul_ps(b, c));
+        _mm_storeu_ps(yr + i, _mm_add_ps(_mm_loadu_ps(yr + i), re));
+        _mm_storeu_ps(yi + i, _mm_add_ps(_mm_loadu_ps(yi + i), im));
+    }
+#elif defined(CONVOLUTION_EQ_NEON)
+    for (size_t i = 0; i < count; i += 4) {
+        const float32x4_t a = vld1q_f32(xr + i);
+        const float32x4_t b = vld1q_f32(xi + i);
+        const float32x4_t c = vld1q_f32(hr + i);
+        const float32x4_t d = vld1q_f32(hi + i);
+        const float32x4_t re = vmlsq_f32(vmulq_f32(a, c), b, d);
+        const float32x4_t im = vmlaq_f32(vmulq_f32(a, d), b, c);
+        vst1q_f32(yr + i, vaddq_f32(vld1q_f32(yr + i), re));
+        vst1q_f32(yi + i, vaddq_f32(vld1q_f32(yi + i), im));
+    }
+#else
+    for (size_t i = 0; i < count; i++) {
+        yr[i] += xr[i] * hr[i] - xi[i] * hi[i];
+        yi[i] += xr[i] * hi[i] + xi[i] * hr[i];
+    }
+#endif
+}
+
+static inline size_t nextPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+/* ~20ms of filter, roughly the resolution supereq uses, but with a much more
+accurate response. this also keeps the added (half-length) latency low. note
+half the length is always a multiple of BLOCK_SIZE. */
+static size_t equalizerLength(long sampleRate) {
+    return std::max(BLOCK_SIZE * 2, nextPowerOfTwo((size_t) sampleRate / 48));
+}
+
+/* the unfiltered signal is delayed by this many blocks (on top of the one
+block of input buffering) to match the equalizer's latency. the delay line
+always holds at least this many blocks of history, plus the current one. */
+static size_t dryDelayBlocks(long sampleRate) {
+    return equalizerLength(sampleRate) / 2 / BLOCK_SIZE;
+}
+
+/* linear phase fir for the equalizer curve, designed by frequency sampling:
+gains are interpolated between bands on a log-frequency scale, transformed
+to a zero-phase impulse, centered, then windowed. */
+static std::vector<float> designEqualizer(const ConvolutionEq::Settings& settings, long sampleRate) {
+    const auto& frequencies = settings.frequencies;
+    const auto& gains = settings.gains;
+    const size_t bandCount = std::min(frequencies.size(), gains.size());
+
+    auto gainAt = [&](double hz) -> double {
+        double db = 0.0;
+        if (bandCount == 1 || (bandCount > 1 && hz <= frequencies[0])) {
+            db = gains[0];
+        }
+        else if (bandCount > 1 && hz >= frequencies[bandCount - 1]) {
+            db = gains[bandCount - 1];
+        }
+        else if (bandCount > 1) {
+            size_t i = 0;
+            while (i + 2 < bandCount && hz >= frequencies[i + 1]) {
+                ++i;
+            }
+            const double t = log(hz / frequencies[i]) / log(frequencies[i + 1] / frequencies[i]);
+            db = gains[i] + t * (gains[i + 1] - gains[i]);
+        }
+        return pow(10.0, db / 20.0);
+    };
+
+    const size_t length = equalizerLength(sampleRate);
+    const size_t half = length / 2;
+    const double hzPerBin = (double) sampleRate / length;
+
+    std::vector<float> h(length, 0.0f), table;
+    std::vector<int> bits;
+    initFft(length, bits, table);
+
+    h[0] = (float) gainAt(0.0);
+    h[1] = (float) gainAt(sampleRate / 2.0);
+    for (size_t k = 1; k < half; k++) {
+        h[2 * k] = (float) gainAt(k * hzPerBin);
+    }
+
+    rdft((int) length, -1, h.data(), bits.data(), table.data());
+
+    std::rotate(h.begin(), h.begin() + half, h.end());
+
+    const float scale = 2.0f / length;
+    for (size_t i = 0; i < length; i++) {
+        const double blackman = 0.42
+            - 0.5 * cos((2.0 * PI * i) / length)
+            + 0.08 * cos((4.0 * PI * i) / length);
+        h[i] *= (float) (scale * blackman);
+    }
+
+    return h;
+}
+
+static inline uint32_t readLe(const unsigned char* bytes, int count) {
+    uint32_t result = 0;
+    for (int i = count - 1; i >= 0; i--) {
+        result = (result << 8) | bytes[i];
+    }
+    return result;
+}
+
+/* minimal RIFF/WAVE reader: 16, 24 and 32 bit integer pcm, and 32 bit float */
+static bool loadWave(const std::string& path, long& sampleRate, std::vector<std::vector<float>>& output) {
+#ifdef WIN32
+    FILE* file = _wfopen(musik::core::sdk::str::u8to16(path.c_str()).c_str(), L"rb");
+#else
+    FILE* file = fopen(path.c_str(), "rb");
+#endif
+
+    if (!file) {
+        return false;
+    }
+
+    unsigned char header[12], chunk[8], format[40];
+    int formatTag = 0, channels = 0, bitsPerSample = 0;
+    std::vector<unsigned char> data;
+    sampleRate = 0;
+
+    if (fread(header, 1, 12, file) == 12 && !memcmp(header, "RIFF", 4) && !memcmp(header + 8, "WAVE", 4)) {
+        while (fread(chunk, 1, 8, file) == 8) {
+            const uint32_t size = readLe(chunk + 4, 4);
+            const long padded = (long) size + (size & 1);
+            if (!memcmp(chunk, "fmt ", 4) && size >= 16 && size <= sizeof(format)) {
+                if (fread(format, 1, size, file) != size) {
+                    break;
+                }
+                formatTag = (int) readLe(format, 2);
+                channels = (int) readLe(format + 2, 2);
+                sampleRate = (long) readLe(format + 4, 4);
+                bitsPerSample = (int) readLe(format + 14, 2);
+                if (formatTag == 0xFFFE && size >= 26) { /* WAVE_FORMAT_EXTENSIBLE */
+                    formatTag = (int) readLe(format + 24, 2);
+                }
+                fseek(file, padded - (long) size, SEEK_CUR);
+            }
+            else if (!memcmp(chunk, "data", 4)) {
+                data.resize(size);
+                data.resize(fread(data.data(), 1, size, file));
+                break;
+            }
+            else if (fseek(file, padded, SEEK_CUR) != 0) {
+                break;
+            }
+        }
+    }
+
+    fclose(file);
+
+    const int bytesPerSample = bitsPerSample / 8;
+    const bool supported =
+        (formatTag == 1 && (bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32)) ||
+        (formatTag == 3 && bitsPerSample == 32);
+
+    if (!supported || channels <= 0 || sampleRate <= 0 || data.empty()) {
+        return false;
+    }
+
+    const size_t frames = std::min(
+        data.size() / (bytesPerSample * channels),
+        (size_t) (sampleRate * MAX_IMPULSE_RESPONSE_SECONDS));
+
+    output.assign(channels, std::vector<float>(frames));
+
+    const unsigned char* in = data.data();
+    for (size_t i = 0; i < frames; i++) {
+        for (int c = 0; c < channels; c++) {
+            const uint32_t raw = readLe(in, bytesPerSample);
+            float value;
+            if (formatTag == 3) {
+                memcpy(&value, &raw, sizeof(float));
+            }
+            else {
+                const int shift = 32 - bitsPerSample; /* sign extend */
+                value = (float) ((int32_t) (raw << shift) / 2147483648.0);
+            }
+            output[c][i] = value;
+            in += bytesPerSample;
+        }
+    }
+
+    return true;
+}
+
+/* linear interpolation is plenty for room correction impulses, which are
+almost always supplied at a common rate anyway. */
+static std::vector<float> resample(const std::vector<float>& input, long from, long to) {
+    if (from == to || input.empty()) {
+        return input;
+    }
+
+    const double step = (double) from / to;
+    const size_t length = (size_t) (input.size() / step);
+    std::vector<float> output(length);
+    const float scale = (float) from / to; /* preserve the impulse's gain */
+    for (size_t i = 0; i < length; i++) {
+        const double position = i * step;
+        const size_t index = (size_t) position;
+        const float t = (float) (position - index);
+        const float a = input[index];
+        const float b = index + 1 < input.size() ? input[index + 1] : 0.0f;
+        output[i] = (a + t * (b - a)) * scale;
+    }
+    return output;
+}
+
+/* full linear convolution of two (potentially long) signals via a single
+large fft. only used on the builder thread. */
+static std::vector<float> convolve(const std::vector<float>& a, const std::vector<float>& b) {
+    const size_t length = a.size() + b.size() - 1;
+    const size_t size = nextPowerOfTwo(length);
+
+    std::vector<float> x(size, 0.0f), y(size, 0.0f), table;
+    std::vector<int> bits;
+    initFft(size, bits, table);
+
+    std::copy(a.begin(), a.end(), x.begin());
+    std::copy(b.begin(), b.end(), y.begin());
+    rdft((int) size, 1, x.data(), bits.data(), table.data());
+    rdft((int) size, 1, y.data(), bits.data(), table.data());
+
+    x[0] *= y[0];
+    x[1] *= y[1];
+    for (size_t k = 1; k < size / 2; k++) {
+        const float re = x[2 * k] * y[2 * k] - x[2 * k + 1] * y[2 * k + 1];
+        const float im = x[2 * k] * y[2 * k + 1] + x[2 * k + 1] * y[2 * k];
+        x[2 * k] = re;
+        x[2 * k + 1] = im;
+    }
+
+    rdft((int) size, -1, x.data(), bits.data(), table.data());
+
+    const float scale = 2.0f / size;
+    x.resize(length);
+    for (auto& value : x) {
+        value *= scale;
+    }
+
+    return x;
+}
+
+ConvolutionEq::ConvolutionEq(SettingsProvider provider)
+: provider(provider) {
+    this->accumulatorReal.resize(BIN_COUNT);
+    this->accumulatorImag.resize(BIN_COUNT);
+    this->fftWork.resize(FFT_SIZE);
+    this->fadeWork.resize(BLOCK_SIZE);
+    initFft(FFT_SIZE, this->fftBits, this->fftTable);
+    this->builder = new std::thread(std::bind(&ConvolutionEq::BuilderThreadLoop, this));
+}
+
+ConvolutionEq::~ConvolutionEq() {
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->quit = true;
+    }
+
+    this->condition.notify_all();
+    this->builder->join();
+    delete this->builder;
+}
+
+size_t ConvolutionEq::Latency(long sampleRate) {
+    return BLOCK_SIZE + equalizerLength(sampleRate) / 2;
+}
+
+void ConvolutionEq::Invalidate() {
+    this->generation.fetch_add(1);
+    this->condition.notify_all();
+}
+
+void ConvolutionEq::Reset(int channels, long sampleRate) {
+    this->channels = channels;
+    this->sampleRate = sampleRate;
+    this->active.reset();
+    this->previous.reset();
+    this->fading = false;
+    this->fill = 0;
+    this->head = 0;
+    this->dryDelay = dryDelayBlocks(sampleRate);
+    this->delayLineSize = this->dryDelay + 1;
+
+    /* this is the only place the audio thread sizes buffers, and it only
+    happens when the stream format changes. */
+    this->channelState.resize(channels);
+    for (auto& channel : this->channelState) {
+        channel.input.assign(FFT_SIZE, 0.0f);
+        channel.output.assign(BLOCK_SIZE, 0.0f);
+        channel.real.assign(this->delayLineSize * BIN_COUNT, 0.0f);
+        channel.imag.assign(this->delayLineSize * BIN_COUNT, 0.0f);
+    }
+
+    /* filters are designed for a specific format; ask for a new one and pass
+    audio through untouched (but delayed the same) until it's ready. */
+    this->requestedChannels.store(channels);
+    this->requestedSampleRate.store(sampleRate);
+    this->Invalidate();
+}
+
+void ConvolutionEq::Clear() {
+    this->previous.reset();
+    this->fading = false;
+    this->fill = 0;
+
+    for (auto& channel : this->channelState) {
+        std::fill(channel.input.begin(), channel.input.end(), 0.0f);
+        std::fill(channel.output.begin(), channel.output.end(), 0.0f);
+        std::fill(channel.real.begin(), channel.real.end(), 0.0f);
+        std::fill(channel.imag.begin(), channel.imag.end(), 0.0f);
+    }
+}
+
+void ConvolutionEq::GrowDelayLine(Kernel& kernel) {
+    const size_t size = kernel.partitions;
+    if (kernel.delayReal.size() != this->channelState.size()) {
+        return; /* shouldn't happen; Convolve() will truncate the filter */
+    }
+
+    /* keep history, oldest slot first, so the new filter has the full tail
+    available immediately. */
+    for (size_t c = 0; c < this->channelState.size(); c++) {
+        Channel& channel = this->channelState[c];
+        std::vector<float>& real = kernel.delayReal[c];
+        std::vector<float>& imag = kernel.delayImag[c];
+        for (size_t p = 0; p < this->delayLineSize; p++) {
+            const size_t from = ((this->head + this->delayLineSize - p) % this->delayLineSize) * BIN_COUNT;
+            const size_t to = (this->delayLineSize - 1 - p) * BIN_COUNT;
+            std::copy(&channel.real[from], &channel.real[from] + BIN_COUNT, &real[to]);
+            std::copy(&channel.imag[from], &channel.imag[from] + BIN_COUNT, &imag[to]);
+        }
+        channel.real.swap(real);
+        channel.imag.swap(imag);
+    }
+
+    this->head = this->delayLineSize - 1;
+    this->delayLineSize = size;
+}
+
+void ConvolutionEq::Convolve(const Channel& channel, const Kernel* kernel, size_t index, float* output) {
+    float* work = this->fftWork.data();
+
+    if (!kernel) {
+        /* no filter yet: the dry signal, with the same latency. the delay line
+        slot from `dryDelay` blocks ago holds the spectrum of that block (and
+        the one before it), so transforming it back recovers the input. */
+        const size_t slot = ((this->head + this->delayLineSize - this->dryDelay) % this->delayLineSize) * BIN_COUNT;
+        toPacked(&channel.real[slot], &channel.imag[slot], FFT_SIZE, work);
+        rdft((int) FFT_SIZE, -1, work, this->fftBits.data(), this->fftTable.data());
+        const float scale = 2.0f / FFT_SIZE;
+        for (size_t i = 0; i < BLOCK_SIZE; i++) {
+            output[i] = work[BLOCK_SIZE + i] * scale;
+        }
+        return;
+    }
+
+    float* real = this->accumulatorReal.data();
+    float* imag = this->accumulatorImag.data();
+    std::fill(this->accumulatorReal.begin(), this->accumulatorReal.end(), 0.0f);
+    std::fill(this->accumulatorImag.begin(), this->accumulatorImag.end(), 0.0f);
+
+    const auto& kernelReal = kernel->real[index % kernel->real.size()];
+    const auto& kernelImag = kernel->imag[index % kernel->imag.size()];
+    const size_t partitions = std::min(kernel->partitions, this->delayLineSize);
+
+    for (size_t p = 0; p < partitions; p++) {
+        const size_t slot = ((this->head + this->delayLineSize - p) % this->delayLineSize) * BIN_COUNT;
+        multiplyAccumulate(
+            &channel.real[slot], &channel.imag[slot],
+            &kernelReal[p * BIN_COUNT], &kernelImag[p * BIN_COUNT],
+            real, imag,
+            BIN_COUNT);
+    }
+
+    toPacked(real, imag, FFT_SIZE, work);
+    rdft((int) FFT_SIZE, -1, work, this->fftBits.data(), this->fftTable.data());
+
+    /* overlap-save: the first half is circular aliasing, discard it. the
+    inverse transform's scale is already folded into the kernel. */
+    std::copy(work + BLOCK_SIZE, work + FFT_SIZE, output);
+}
+
+void ConvolutionEq::ProcessBlock() {
+    this->head = (this->head + 1) % this->delayLineSize;
+
+    float* work = this->fftWork.data();
+
+    for (size_t c = 0; c < this->channelState.size(); c++) {
+        Channel& channel = this->channelState[c];
+
+        /* transform the latest two blocks into the delay line */
+        std::copy(channel.input.begin(), channel.input.end(), work);
+        rdft((int) FFT_SIZE, 1, work, this->fftBits.data(), this->fftTable.data());
+        const size_t slot = this->head * BIN_COUNT;
+        toSplit(work, FFT_SIZE, &channel.real[slot], &channel.imag[slot]);
+
+        this->Convolve(channel, this->active.get(), c, channel.output.data());
+
+        if (this->fading) {
+            /* one block linear crossfade from the old filter to the new one */
+            float* old = this->fadeWork.data();
+            this->Convolve(channel, this->previous.get(), c, old);
+            for (size_t i = 0; i < BLOCK_SIZE; i++) {
+                const float t = (float) (i + 1) / BLOCK_SIZE;
+                channel.output[i] = old[i] + t * (channel.output[i] - old[i]);
+            }
+        }
+
+        std::copy(&channel.input[BLOCK_SIZE], &channel.input[BLOCK_SIZE] + BLOCK_SIZE, &channel.input[0]);
+    }
+
+    /* the builder keeps its own reference, so this won't free on this thread */
+    this->previous.reset();
+    this->fading = false;
+}
+
+void ConvolutionEq::Process(float* samples, long frames, int channels, long sampleRate) {
+    if (channels <= 0 || frames <= 0 || sampleRate <= 0) {
+        return;
+    }
+
+    if (channels != this->channels || sampleRate != this->sampleRate) {
+        this->Reset(channels, sampleRate);
+    }
+
+    auto next = std::atomic_exchange(&this->pending, std::shared_ptr<Kernel>());
+    if (next && next->sampleRate == sampleRate && next->channels == channels) {
+        if (next->partitions > this->delayLineSize) {
+            this->GrowDelayLine(*next);
+        }
+        if (!this->fading) { /* a second swap within a block just replaces the target */
+            this->previous = this->active;
+            this->fading = true;
+        }
+        this->active = next;
+    }
+
+    size_t offset = 0;
+    while (offset < (size_t) frames) {
+        const size_t count = std::min((size_t) frames - offset, BLOCK_SIZE - this->fill);
+
+        for (int c = 0; c < channels; c++) {
+            Channel& channel = this->channelState[c];
+            float* input = &channel.input[BLOCK_SIZE + this->fill];
+            const float* output = &channel.output[this->fill];
+            float* interleaved = samples + (offset * channels) + c;
+            for (size_t i = 0; i < count; i++) {
+                input[i] = *interleaved;
+                *interleaved = output[i];
+                interleaved += channels;
+            }
+        }
+
+        this->fill += count;
+        offset += count;
+
+        if (this->fill == BLOCK_SIZE) {
+            this->ProcessBlock();
+            this->fill = 0;
+        }
+    }
+}
+
+void ConvolutionEq::BuilderThreadLoop() {
+    using Lock = std::unique_lock<std::mutex>;
+
+    std::vector<std::shared_ptr<Kernel>> published;
+    int built = -1;
+
+    while (true) {
+        {
+            Lock lock(this->mutex);
+
+            /* Invalidate() doesn't take the lock, so use a timeout as a safety net
+            against a missed wakeup. */
+            this->condition.wait_for(lock, std::chrono::milliseconds(250), [this, &built] {
+                return this->quit ||
+                    (this->generation.load() != built && this->requestedSampleRate.load() > 0);
+            });
+
+            if (this->quit) {
+                return;
+            }
+        }
+
+        /* release filters the audio thread no longer references */
+        published.erase(
+            std::remove_if(
+                published.begin(),
+                published.end(),
+                [](const std::shared_ptr<Kernel>& k) { return k.use_count() == 1; }),
+            published.end());
+
+        const int current = this->generation.load();
+        const long sampleRate = this->requestedSampleRate.load();
+        const int channels = this->requestedChannels.load();
+        if (current == built || sampleRate <= 0 || channels <= 0) {
+            continue;
+        }
+
+        const Settings settings = this->provider();
+        const std::vector<float> equalizer = designEqualizer(settings, sampleRate);
+
+        /* combine with the room correction impulse, if any. each channel of the
+        impulse is applied to the matching output channel (wrapping around). */
+        std::vector<std::vector<float>> responses;
+        long impulseRate = 0;
+        if (settings.impulseResponsePath.size() &&
+            loadWave(settings.impulseResponsePath, impulseRate, responses))
+        {
+            for (auto& response : responses) {
+                response = convolve(resample(response, impulseRate, sampleRate), equalizer);
+            }
+        }
+        else {
+            responses.assign(1, equalizer);
+        }
+
+        auto kernel = std::make_shared<Kernel>();
+        kernel->sampleRate = sampleRate;
+        kernel->channels = channels;
+        for (auto& response : responses) {
+            kernel->partitions = std::max(
+                kernel->partitions, (response.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+        }
+
+        if (kernel->partitions > dryDelayBlocks(sampleRate) + 1) {
+            kernel->delayReal.assign(channels, std::vector<float>(kernel->partitions * BIN_COUNT, 0.0f));
+            kernel->delayImag.assign(channels, std::vector<float>(kernel->partitions * BIN_COUNT, 0.0f));
+        }
+
+        std::vector<float> work(FFT_SIZE), table;
+        std::vector<int> bits;
+        initFft(FFT_SIZE, bits, table);
+
+        const float scale = 2.0f / FFT_SIZE; /* ooura's inverse isn't normalized */
+
+        for (auto& response : responses) {
+            kernel->real.emplace_back(kernel->partitions * BIN_COUNT, 0.0f);
+            kernel->imag.emplace_back(kernel->partitions * BIN_COUNT, 0.0f);
+            for (size_t p = 0; p < kernel->partitions; p++) {
+                const size_t start = std::min(response.size(), p * BLOCK_SIZE);
+                const size_t end = std::min(response.size(), start + BLOCK_SIZE);
+                std::fill(work.begin(), work.end(), 0.0f);
+                for (size_t i = start; i < end; i++) {
+                    work[i - start] = response[i] * scale;
+                }
+                rdft((int) FFT_SIZE, 1, work.data(), bits.data(), table.data());
+                toSplit(
+                    work.data(),
+                    FFT_SIZE,
+                    &kernel->real.back()[p * BIN_COUNT],
+                    &kernel->imag.back()[p * BIN_COUNT]);
+            }
+        }
+
+        built = current;
+        published.push_back(kernel);
+        std::atomic_store(&this->pending, kernel);
+    }
+}
@@ -0,0 +1,123 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2004-2021 musikcube team
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//    * Redistributions of source code must retain the above copyright notice,
+//      this list of conditions and the following disclaimer.
+//
+//    * Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in the
+//      documentation and/or other materials provided with the distribution.
+//
+//    * Neither the name of the author nor the names of other contributors may
+//      be used to endorse or promote products derived from this software
+//      without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* an equalizer engine based on uniformly partitioned, overlap-save fft
+convolution. the filter (the equalizer curve, optionally combined with a
+user-supplied impulse response for room correction) is designed and
+transformed on a background thread; the audio thread only runs the
+frequency-domain delay line and swaps in new filters, crossfading between
+the old and new output for one block so changes don't click. */
+class ConvolutionEq {
+    public:
+        struct Settings {
+            std::vector<double> frequencies; /* band centers, hz, ascending */
+            std::vector<double> gains; /* per band, db */
+            std::string impulseResponsePath; /* optional, .wav */
+        };
+
+        /* called on the builder thread whenever the filter needs to be
+        rebuilt, so it's fine for it to do blocking work. */
+        using SettingsProvider = std::function<Settings()>;
+
+        ConvolutionEq(SettingsProvider provider);
+        ~ConvolutionEq();
+
+        ConvolutionEq(const ConvolutionEq&) = delete;
+        ConvolutionEq& operator=(const ConvolutionEq&) = delete;
+
+        /* thread-safe; schedules a rebuild with fresh Settings */
+        void Invalidate();
+
+        /* processes interleaved samples in place, adding Latency() frames of
+        delay. the unfiltered signal (used until the first filter is ready)
+        is delayed by the same amount, so crossfading between it and a filter
+        doesn't mix signals that are out of alignment. */
+        void Process(float* samples, long frames, int channels, long sampleRate);
+
+        /* one partition, plus half the equalizer filter length */
+        static size_t Latency(long sampleRate);
+
+        /* audio thread only; discards buffered input and delay line history
+        but keeps the current filter, so the next Process() call starts from
+        silence without waiting for a rebuild. */
+        void Clear();
+
+    private:
+        struct Kernel;
+        struct Channel;
+
+        void Reset(int channels, long sampleRate);
+        void GrowDelayLine(Kernel& kernel);
+        void ProcessBlock();
+        void Convolve(const Channel& channel, const Kernel* kernel, size_t index, float* output);
+        void BuilderThreadLoop();
+
+        SettingsProvider provider;
+
+        /* audio thread state */
+        std::vector<Channel> channelState;
+        std::shared_ptr<Kernel> active, previous;
+        std::vector<float> accumulatorReal, accumulatorImag;
+        std::vector<float> fftWork, fftTable, fadeWork;
+        std::vector<int> fftBits;
+        bool fading{ false };
+        int channels{ 0 };
+        long sampleRate{ 0 };
+        size_t fill{ 0 };
+        size_t head{ 0 };
+        size_t delayLineSize{ 0 };
+        size_t dryDelay{ 0 }; /* in blocks */
+
+        /* shared with the builder thread */
+        std::shared_ptr<Kernel> pending;
+        std::atomic<int> requestedChannels{ 0 };
+        std::atomic<long> requestedSampleRate{ 0 };
+        std::atomic<int> generation{ 0 };
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool quit{ false };
+        std::thread* builder{ nullptr };
+};
@@ -45,6 +45,19 @@ using namespace musik::core::sdk;
 static IPreferences* prefs = nullptr;
 static std::atomic<int> currentState;
 
+/* a snapshot of the preferences the audio thread needs, refreshed whenever
+they change so Process() never has to read them. */
+static std::atomic<bool> enabled(false);
+static std::atomic<bool> useConvolution(true);
+static std::atomic<float> amplitudes[18];
+
+static const char* PREF_ENABLED = "enabled";
+static const char* PREF_ENGINE = "engine";
+static const char* PREF_IMPULSE_RESPONSE_PATH = "impulse_response_path";
+
+static const std::string ENGINE_CONVOLUTION = "convolution";
+static const std::string ENGINE_SUPEREQ = "supereq";
+
 static const std::vector<std::string> BANDS = {
     "65", "92", "131", "185", "262",
     "370", "523", "740", "1047", "1480",
@@ -52,16 +65,59 @@ static const std::vector<std::string> BANDS = {
     "11840", "16744", "22000",
 };
 
+static void loadPreferences() {
+    if (::prefs) {
+        ::enabled.store(::prefs->GetBool(PREF_ENABLED, false));
+        ::useConvolution.store(getPreferenceString<std::string>(
+            ::prefs, PREF_ENGINE, ENGINE_CONVOLUTION.c_str()) != ENGINE_SUPEREQ);
+        for (size_t i = 0; i < BANDS.size(); i++) {
+            double dB = ::prefs->GetDouble(BANDS[i].c_str(), 0.0);
+            ::amplitudes[i].store((float) pow(10, dB / 20.f));
+        }
+    }
+
+    /* bumped last; the audio thread reloads the snapshot when it changes */
+    currentState.fetch_add(1);
+}
+
 extern "C" DLLEXPORT void SetPreferences(IPreferences* prefs) {
     ::prefs = prefs;
+    loadPreferences();
+}
+
+extern "C" DLLEXPORT musik::core::sdk::ISchema* GetSchema() {
+    auto schema = new TSchema<>();
+    schema->AddEnum(PREF_ENGINE, { ENGINE_CONVOLUTION, ENGINE_SUPEREQ }, ENGINE_CONVOLUTION);
+    schema->AddString(PREF_IMPULSE_RESPONSE_PATH, "");
+    return schema;
+}
+
+/* called on the convolution engine's builder thread, never the audio thread */
+static ConvolutionEq::Settings loadConvolutionSettings() {
+    ConvolutionEq::Settings settings;
+    if (::prefs) {
+        for (auto& band : BANDS) {
+            settings.frequencies.push_back(std::stod(band));
+            settings.gains.push_back(::prefs->GetDouble(band.c_str(), 0.0));
+        }
+        settings.impulseResponsePath = getPreferenceString<std::string>(
+            ::prefs, PREF_IMPULSE_RESPONSE_PATH, "");
+    }
+    return settings;
 }
 
 void SuperEqDsp::NotifyChanged() {
-    currentState.fetch_add(1);
+    loadPreferences();
 }
 
 SuperEqDsp::SuperEqDsp() {
-    this->enabled = ::prefs && ::prefs->GetBool("enabled", false);
+    this->enabled = ::enabled.load();
+    this->useConvolution = ::useConvolution.load();
+    this->lastUpdated = ::currentState.load();
+
+    /* always create the convolution engine (and its builder thread) here, so
+    switching engines during playback never does it on the audio thread. */
+    this->convolution = new ConvolutionEq(&loadConvolutionSettings);
 }
 
 SuperEqDsp::~SuperEqDsp() {
@@ -69,50 +125,87 @@ SuperEqDsp::~SuperEqDsp() {
         equ_quit(this->supereq);
         delete this->supereq;
     }
+    delete this->convolution;
 }
 
 void SuperEqDsp::Release() {
     delete this;
 }
 
-bool SuperEqDsp::Process(IBuffer* buffer) {
-    int channels = buffer->Channels();
-    int current = ::currentState.load();
+void SuperEqDsp::Reset() {
+    if (this->supereq) {
+        equ_clearbuf(this->supereq);
+    }
+    this->convolution->Clear();
+}
 
-    if (!this->supereq || this->lastUpdated != current) {
-        this->enabled = ::prefs && ::prefs->GetBool("enabled", false);
-        this->lastUpdated = current;
+void SuperEqDsp::Reload() {
+    this->enabled = ::enabled.load();
+    this->useConvolution = ::useConvolution.load();
 
-        if (!this->supereq) {
-            this->supereq = new SuperEqState();
-            equ_init(this->supereq, 10, channels);
-        }
+    if (this->useConvolution) {
+        /* the new filter is designed on the engine's builder thread, and
+        crossfaded in once it's ready. */
+        this->convolution->Invalidate();
+    }
+    else {
+        this->supereqChanged = true;
+    }
+}
+
+void SuperEqDsp::UpdateSuperEq(IBuffer* buffer) {
+    if (!this->supereq) {
+        this->supereq = new SuperEqState();
+        equ_init(this->supereq, 10, buffer->Channels());
+    }
 
-        void *params = paramlist_alloc();
-        float bands[18];
+    void *params = paramlist_alloc();
+    float bands[18];
 
-        for (size_t i = 0; i < BANDS.size(); i++) {
-            double dB =  prefs->GetDouble(BANDS[i].c_str(), 0.0);
-            double amp = pow(10, dB / 20.f);
-            bands[i] = (float) amp;
-        }
+    for (size_t i = 0; i < BANDS.size(); i++) {
+        bands[i] = ::amplitudes[i].load();
+    }
+
+    equ_makeTable(
+        this->supereq,
+        bands,
+        params,
+        (float) buffer->SampleRate());
 
-        equ_makeTable(
-            this->supereq,
-            bands,
-            params,
-            (float) buffer->SampleRate());
+    paramlist_free(params);
+    this->supereqChanged = false;
+}
+
+bool SuperEqDsp::Process(IBuffer* buffer) {
+    int channels = buffer->Channels();
+    int current = ::currentState.load();
 
-        paramlist_free(params);
+    if (this->lastUpdated != current) {
+        this->lastUpdated = current;
+        this->Reload();
     }
 
     if (!this->enabled) {
         return false;
     }
 
+    if (this->useConvolution) {
+        this->convolution->Process(
+            buffer->BufferPointer(),
+            buffer->Samples() / channels,
+            channels,
+            buffer->SampleRate());
+
+        return true;
+    }
+
+    if (!this->supereq || this->supereqChanged) {
+        this->UpdateSuperEq(buffer);
+    }
+
     return equ_modifySamples_float(
         this->supereq,
         (char*) buffer->BufferPointer(),
         buffer->Samples() / channels,
         channels) != 0;
-}
\ No newline at end of file
+}
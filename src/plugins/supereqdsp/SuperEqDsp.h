@@ -36,6 +36,7 @@
 
 #include <musikcore/sdk/IDSP.h>
 #include "supereq/Equ.h"
+#include "ConvolutionEq.h"
 
 using namespace musik::core::sdk;
 
@@ -46,11 +47,18 @@ class SuperEqDsp : public IDSP {
 
         virtual void Release() override;
         virtual bool Process(IBuffer *buffer) override;
+        virtual void Reset() override;
 
         static void NotifyChanged();
 
     private:
+        void Reload();
+        void UpdateSuperEq(IBuffer* buffer);
+
         SuperEqState* supereq {nullptr};
+        ConvolutionEq* convolution {nullptr};
         int lastUpdated {0};
         bool enabled;
+        bool useConvolution {true};
+        bool supereqChanged {true};
 };
@@ -180,6 +180,12 @@ static inline bool replayGainValid(ReplayGain& rg) {
 }
 
 static inline void processAlbumArt(TagLib::List<TagLib::FLAC::Picture*> pictures, ITagStore* target) {
+    /* artwork is stored per album, and the indexer may already have it. this
+    must be called after the album and artist tags have been read. */
+    if (target->ContainsThumbnail()) {
+        return;
+    }
+
     for (auto picture : pictures) {
         if (picture->type() == TagLib::FLAC::Picture::FrontCover) {
             auto byteVector = picture->data();
@@ -304,9 +310,9 @@ bool TaglibMetadataReader::ReadGeneric(
             field list. if we're dealing with a straight-up Xiph tag, process it now */
             const auto xiphTag = dynamic_cast<TagLib::Ogg::XiphComment*>(tag);
             if (xiphTag) {
-                processAlbumArt(xiphTag->pictureList(), target);
                 this->ReadFromMap(xiphTag->fieldListMap(), target);
                 this->ExtractReplayGain(xiphTag->fieldListMap(), target);
+                processAlbumArt(xiphTag->pictureList(), target);
             }
 
             /* if this isn't a xiph tag, the file format may have some other custom
@@ -318,12 +324,12 @@ bool TaglibMetadataReader::ReadGeneric(
                 see if there's a xiph comment buried deep. */
                 auto flacFile = dynamic_cast<TagLib::FLAC::File*>(file.file());
                 if (flacFile) {
-                    processAlbumArt(flacFile->pictureList(), target);
                     if (flacFile->hasXiphComment()) {
                         this->ReadFromMap(flacFile->xiphComment()->fieldListMap(), target);
                         this->ExtractReplayGain(flacFile->xiphComment()->fieldListMap(), target);
                         handled = true;
                     }
+                    processAlbumArt(flacFile->pictureList(), target);
                 }
 
                 /* similarly, mp4 buries disc number and album artist. however, taglib does
@@ -71,6 +71,8 @@ class WasapiOut : public IOutput {
         bool SetDefaultDevice(const char* deviceId) override;
         IDevice* GetDefaultDevice() override;
         int GetDefaultSampleRate() override;
+        size_t GetUnderrunCount() override { return 0; }
+        size_t GetXrunCount() override { return 0; }
 
         void OnDeviceChanged() { this->deviceChanged = true; }
 
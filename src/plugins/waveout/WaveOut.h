@@ -67,6 +67,8 @@ class WaveOut : public IOutput {
         bool SetDefaultDevice(const char* deviceId) override;
         IDevice* GetDefaultDevice() override;
         int GetDefaultSampleRate() override { return -1; }
+        size_t GetUnderrunCount() override { return 0; }
+        size_t GetXrunCount() override { return 0; }
 
         void OnBufferWrittenToOutput(WaveOutBuffer *buffer);
 